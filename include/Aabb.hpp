@@ -0,0 +1,163 @@
+#ifndef AABB_HPP
+#define AABB_HPP
+
+#include "Ray.hpp"
+#include "Vec3.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace rt
+{
+    /// \brief The reciprocal of a ray direction, precomputed once for many box tests
+    struct RayInverse
+    {
+        /// \brief Precompute the reciprocal of the direction of @param ray
+        explicit RayInverse(Ray const& ray) noexcept
+        {
+            auto const origin = ray.getOrigin();
+            auto const direction = ray.getDirection();
+
+            for (std::size_t a = 0; a < 3; ++a) {
+                auto const i = static_cast<gsl::index>(a);
+                this->origin[a] = origin[i];
+
+                // Components are kept as plain doubles because a zero direction gives an infinite reciprocal
+                inverse[a] = 1.0 / direction[i];
+                negative[a] = inverse[a] < 0.0;
+            }
+        }
+
+        std::array<double, 3> origin;
+        std::array<double, 3> inverse;
+        std::array<bool, 3> negative;
+    };
+
+    /// \brief An axis-aligned bounding box. The default box is empty, and grows to hold whatever is added to it
+    class Aabb
+    {
+    public:
+        /// \brief Create an empty box
+        constexpr Aabb() noexcept = default;
+
+        /// \brief Create the box spanned by two corners
+        Aabb(Point3 const& a, Point3 const& b) noexcept
+        {
+            for (std::size_t i = 0; i < 3; ++i) {
+                m_min[i] = std::min(a[static_cast<gsl::index>(i)], b[static_cast<gsl::index>(i)]);
+                m_max[i] = std::max(a[static_cast<gsl::index>(i)], b[static_cast<gsl::index>(i)]);
+            }
+        }
+
+        /// \brief Grow the box to hold @param box
+        void merge(Aabb const& box) & noexcept
+        {
+            for (std::size_t i = 0; i < 3; ++i) {
+                m_min[i] = std::min(m_min[i], box.m_min[i]);
+                m_max[i] = std::max(m_max[i], box.m_max[i]);
+            }
+        }
+
+        /// \brief Grow the box to hold @param point
+        void merge(Point3 const& point) & noexcept
+        {
+            merge(Aabb(point, point));
+        }
+
+        /// \brief Get the box moved by @param offset
+        Aabb translated(Vec3 const& offset) const noexcept
+        {
+            Aabb box = *this;
+
+            for (std::size_t i = 0; i < 3; ++i) {
+                box.m_min[i] += offset[static_cast<gsl::index>(i)];
+                box.m_max[i] += offset[static_cast<gsl::index>(i)];
+            }
+
+            return box;
+        }
+
+        /// \brief Check if the box holds nothing
+        bool empty() const noexcept
+        {
+            return m_min[0] > m_max[0];
+        }
+
+        /// \brief Get the lower corner along axis @param i
+        double min(std::size_t const i) const noexcept
+        {
+            return m_min[i];
+        }
+
+        /// \brief Get the upper corner along axis @param i
+        double max(std::size_t const i) const noexcept
+        {
+            return m_max[i];
+        }
+
+        /// \brief Get the centre of the box along axis @param i
+        double centre(std::size_t const i) const noexcept
+        {
+            return 0.5 * (m_min[i] + m_max[i]);
+        }
+
+        /// \brief Get the axis along which the box is longest
+        std::size_t longestAxis() const noexcept
+        {
+            auto const dx = m_max[0] - m_min[0];
+            auto const dy = m_max[1] - m_min[1];
+            auto const dz = m_max[2] - m_min[2];
+
+            return dx > dy and dx > dz ? 0 : (dy > dz ? 1 : 2);
+        }
+
+        /// \brief Get the surface area of the box, or zero if it is empty
+        double surfaceArea() const noexcept
+        {
+            if (empty()) {
+                return 0.0;
+            }
+
+            auto const dx = m_max[0] - m_min[0];
+            auto const dy = m_max[1] - m_min[1];
+            auto const dz = m_max[2] - m_min[2];
+
+            return 2.0 * ((dx * dy) + (dy * dz) + (dz * dx));
+        }
+
+        /// \brief Intersect a ray with the box using the slab method
+        /// \param[in] ray The ray, with its reciprocal direction precomputed
+        /// \param[in] tMin, tMax The interval of the ray under investigation
+        /// \param[out] tEntry The distance at which the ray enters the box, if it hits
+        /// \returns true if the ray passes through the box inside [tMin, tMax]
+        bool hit(RayInverse const& ray, double tMin, double tMax, double& tEntry) const noexcept
+        {
+            for (std::size_t a = 0; a < 3; ++a) {
+                auto const near = ray.negative[a] ? m_max[a] : m_min[a];
+                auto const far = ray.negative[a] ? m_min[a] : m_max[a];
+                auto const t0 = (near - ray.origin[a]) * ray.inverse[a];
+                auto const t1 = (far - ray.origin[a]) * ray.inverse[a];
+
+                // Written so that a NaN from 0 * infinity leaves the interval unchanged
+                tMin = t0 > tMin ? t0 : tMin;
+                tMax = t1 < tMax ? t1 : tMax;
+
+                if (tMax < tMin) {
+                    return false;
+                }
+            }
+
+            tEntry = tMin;
+            return true;
+        }
+
+    private:
+        static constexpr double huge = std::numeric_limits<double>::infinity();
+
+        std::array<double, 3> m_min {huge, huge, huge};
+        std::array<double, 3> m_max {-huge, -huge, -huge};
+    };
+}
+
+#endif
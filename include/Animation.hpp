@@ -0,0 +1,87 @@
+#ifndef ANIMATION_HPP
+#define ANIMATION_HPP
+
+#include "Hittable.hpp"
+#include "Vec3.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace rt
+{
+    /// \brief An object moved away from where it was built
+    /// \details Rays are moved into the object's space instead of moving the object, so the offset can change between
+    /// frames without touching the object. It must not change while a frame is being rendered
+    class Translate : public Hittable
+    {
+    public:
+        /// \brief Wrap @param object, initially where it is
+        explicit Translate(std::shared_ptr<Hittable> object) noexcept;
+
+        /// \brief Move the object by @param offset from where it was built
+        void setOffset(Vec3 const& offset) & noexcept { m_offset = offset; }
+
+        /// \brief Get how far the object is moved from where it was built
+        Vec3 offset() const noexcept { return m_offset; }
+
+        /// \brief Determine if the ray hits the moved object
+        bool hit(Ray const& ray, double tMin, double tMax, HitRecord& record) const noexcept override;
+
+        /// \brief Determine whether the ray hits the moved object without filling in a record
+        bool occluded(Ray const& ray, double tMin, double tMax) const noexcept override;
+
+        /// \brief Get the box around the moved object
+        bool boundingBox(Aabb& box) const noexcept override;
+
+        /// \brief Get the density of sampling @param direction towards the moved object from @param origin
+        double pdfValue(Point3 const& origin, Vec3 const& direction) const override;
+
+        /// \brief Pick a random direction from @param origin towards the moved object
+        Vec3 random(Point3 const& origin) const override;
+
+    private:
+        /// \brief Move @param ray, and the rays through its neighbouring pixels, into the object's space
+        Ray toObject(Ray const& ray) const noexcept;
+
+        std::shared_ptr<Hittable> m_object;
+        Vec3 m_offset {};
+    };
+
+    /// \brief The offset of an object at one point in time
+    struct Keyframe
+    {
+        double time;    // In seconds from the start of the sequence
+        Vec3 offset;
+    };
+
+    /// \brief Moves objects along keyframed paths
+    class Animation
+    {
+    public:
+        /// \brief Move @param object along @param keys
+        /// \param[in] keys At least one keyframe, in increasing order of time
+        /// \throws std::invalid_argument if there are no keys or they are out of order
+        void add(std::shared_ptr<Translate> object, std::vector<Keyframe> keys);
+
+        /// \brief Move every object to where it is at @param time, interpolating linearly between keyframes
+        /// \details Before the first key and after the last one, objects stay where those keys put them
+        void apply(double time) noexcept;
+
+        /// \brief Get the time of the last keyframe of any object
+        double duration() const noexcept;
+
+        /// \brief Determine whether nothing is animated
+        bool empty() const noexcept { return m_tracks.empty(); }
+
+    private:
+        struct Track
+        {
+            std::shared_ptr<Translate> object;
+            std::vector<Keyframe> keys;
+        };
+
+        std::vector<Track> m_tracks;
+    };
+}
+
+#endif
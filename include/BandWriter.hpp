@@ -0,0 +1,87 @@
+#ifndef BAND_WRITER_HPP
+#define BAND_WRITER_HPP
+
+#include "Colour.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rt
+{
+    /// \brief Hands finished bands of rows to an output, in order from the top, on a dedicated I/O thread
+    /// \details Only a small window of bands is held in memory. Rows may be rendered in any order, but a row can only be
+    /// acquired once its band is inside the window, which starts at the oldest band not yet written. While the I/O thread
+    /// writes one band, the renderers fill the next ones, so with a window of two the buffers alternate.
+    /// Peak memory is window * bandHeight * width pixels, whatever the height of the image
+    class BandWriter
+    {
+    public:
+        /// \brief Receives the mean colours of a band of rows, top row first
+        using Sink = std::function<void(int firstRow, int rowCount, std::vector<Colour> const& pixels)>;
+
+        /// \brief Start the I/O thread
+        /// \param[in] width, height The size of the image
+        /// \param[in] bandHeight The number of rows in every band but the last
+        /// \param[in] window The number of bands that may be held in memory. At least two
+        /// \param[in] sink Called on the I/O thread with every band, in order
+        BandWriter(int width, int height, int bandHeight, int window, Sink sink);
+
+        BandWriter(BandWriter const&) = delete;
+        BandWriter& operator=(BandWriter const&) = delete;
+
+        /// \brief Stop the I/O thread, dropping bands that are not finished
+        ~BandWriter();
+
+        /// \brief Get the storage of a row, waiting until its band fits in the window
+        /// \param[in] y The row, counted from the top
+        /// \returns The width pixels of the row, or nullptr if writing has failed and the row should be skipped
+        Colour* acquireRow(int y);
+
+        /// \brief Mark a row acquired with acquireRow as finished
+        void releaseRow(int y);
+
+        /// \brief Wait for every band to be written
+        /// \throws Whatever the sink threw, if it failed
+        void finish();
+
+        /// \brief Get the number of bytes used by the band buffers when they are all allocated
+        std::size_t bufferBytes() const noexcept;
+
+    private:
+        struct Slot
+        {
+            int band {-1};
+            int pendingRows {};
+            std::vector<Colour> pixels;
+        };
+
+        /// \brief Get the number of rows in a band
+        int rowsIn(int band) const noexcept;
+
+        /// \brief The body of the I/O thread
+        void writeBands();
+
+        int m_width;
+        int m_height;
+        int m_bandHeight;
+        int m_bandCount;
+        Sink m_sink;
+
+        std::mutex m_mutex;
+        std::condition_variable m_bandFinished;     // Signalled when the last row of a band is released
+        std::condition_variable m_bandWritten;      // Signalled when the window moves on
+        std::vector<Slot> m_slots;
+        int m_nextBand {};                          // The oldest band not yet written
+        bool m_stopping {false};
+        std::exception_ptr m_error;
+
+        std::thread m_thread;
+    };
+}
+
+#endif
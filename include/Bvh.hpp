@@ -0,0 +1,162 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include "Aabb.hpp"
+#include "Hittable.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rt
+{
+    /// \brief A bounding volume hierarchy over a set of objects
+    /// \details The tree is built with the surface area heuristic over binned centroids and flattened depth first, so
+    /// the left child of a node follows it directly. When objects move, refit() recomputes the boxes bottom up without
+    /// changing the tree, which is much cheaper than building it again but lets its quality drift. update() refits and
+    /// rebuilds only once the estimated traversal cost has grown past a threshold.
+    /// Objects without bounds are kept outside the tree and tested against every ray.
+    /// Leaves that hold only spheres keep their centres and radii side by side as well, and test them all at once
+    /// with the kernels of the instruction set in use.
+    /// A built tree can be kept in a cache directory, in a file named after a hash of the bounds of the objects, so
+    /// that later runs over the same geometry map it instead of building it again
+    class Bvh : public Hittable
+    {
+    public:
+        /// \brief What a hierarchy made with a cache directory did with it
+        enum class CacheUse
+        {
+            none,       // No cache directory was given
+            loaded,     // The tree was read from the cache instead of being built
+            built,      // The cache held no tree for the geometry, so it was built and saved
+            replaced,   // The cached file was of another format version or geometry, or damaged, so the tree was built and saved over it
+            unsaved     // The tree was built, but could not be written to the cache
+        };
+
+        /// \brief A node of the flattened tree. The left child of an interior node follows it directly
+        struct Node
+        {
+            Aabb box;
+            std::uint32_t offset;   // A leaf's first object, or an interior node's right child
+            std::uint16_t count;    // The number of objects in a leaf. Zero for interior nodes
+            std::uint16_t axis;     // The axis an interior node was split along. sphereLeaf for a leaf of spheres only
+        };
+
+        static constexpr std::uint16_t sphereLeaf = 1;
+
+        /// \brief The depth below which nothing is split, which keeps the traversal stack within its fixed size
+        static constexpr int maxDepth = 48;
+
+        /// \brief Build a hierarchy over @param objects
+        explicit Bvh(std::vector<std::shared_ptr<Hittable>> objects);
+
+        /// \brief Load the hierarchy over @param objects from a cache, or build it and save it there
+        /// \details The file is memory-mapped and checked before anything in it is used: its format version, the hash of
+        /// the geometry, a hash of its contents, and that its tree holds every object once within the depth limit.
+        /// A file that fails any of these is built again and replaced
+        /// \param[in] cacheDirectory The directory of the cached trees, created if missing. No cache if empty
+        Bvh(std::vector<std::shared_ptr<Hittable>> objects, std::string const& cacheDirectory);
+
+        /// \brief Find the closest hit, visiting the nearer child of every node first
+        bool hit(Ray const& ray, double tMin, double tMax, HitRecord& record) const noexcept override;
+
+        /// \brief Determine whether anything blocks the ray, stopping at the first hit found
+        bool occluded(Ray const& ray, double tMin, double tMax) const noexcept override;
+
+        /// \brief Get the box around every object, if they are all bounded
+        bool boundingBox(Aabb& box) const noexcept override;
+
+        /// \brief Recompute every box from the current bounds of the objects, keeping the tree as it is
+        /// \details The copies of the spheres that the kernels test are brought up to date too
+        void refit() noexcept;
+
+        /// \brief Build the tree again from the current bounds of the objects
+        void rebuild();
+
+        /// \brief Refit the tree, and rebuild it if it has become too slow to traverse
+        /// \param[in] rebuildThreshold Rebuild when cost() exceeds the cost after the last build by this factor
+        /// \returns true if the tree was rebuilt
+        bool update(double rebuildThreshold);
+
+        /// \brief Estimate the cost of tracing a ray through the tree with the surface area heuristic
+        /// \returns The expected number of node visits and object tests for a ray that passes through the root box
+        double cost() const noexcept;
+
+        /// \brief Get the cost right after the last build
+        double builtCost() const noexcept { return m_builtCost; }
+
+        /// \brief Get the number of nodes in the tree
+        std::size_t nodeCount() const noexcept { return m_nodes.size(); }
+
+        /// \brief Get the objects in the order the leaves refer to them
+        std::vector<std::shared_ptr<Hittable>> const& objects() const noexcept { return m_objects; }
+
+        /// \brief Get the objects without bounds, which are kept outside the tree
+        std::vector<std::shared_ptr<Hittable>> const& unbounded() const noexcept { return m_unbounded; }
+
+        /// \brief Get the nodes of the tree, depth first from the root
+        std::vector<Node> const& nodes() const noexcept { return m_nodes; }
+
+        /// \brief Get what the construction did with the cache directory
+        CacheUse cacheUse() const noexcept { return m_cacheUse; }
+
+    private:
+        /// \brief Build the tree from the current bounds of the objects and put the objects in the order of its leaves
+        /// \returns The index every object had before the build, in their new order
+        std::vector<std::size_t> buildTree();
+
+        /// \brief Hash the bounds of the objects in their current order, which is all that the build reads
+        std::uint64_t hashGeometry() const noexcept;
+
+        /// \brief Read the tree saved by writeCache() for this geometry into the nodes, if its file is valid
+        /// \param[in] directory The cache directory
+        /// \param[in] geometryHash The hash of the objects in the order they were given, which names the file
+        /// \param[out] order Receives the index in that order of the object at every position of the leaves
+        /// \returns loaded, built if there is no file, or replaced if the file does not fit
+        CacheUse readCache(std::string const& directory, std::uint64_t geometryHash, std::vector<std::size_t>& order);
+
+        /// \brief Save the tree, replacing the file only once it is complete
+        /// \param[in] order The index every object had before the build, as returned by buildTree()
+        /// \returns false if the file cannot be written
+        bool writeCache(std::string const& directory, std::uint64_t geometryHash, std::vector<std::size_t> const& order) const;
+
+        /// \brief Gather the spheres of the tree into the batch arrays and mark the leaves that hold nothing else
+        void gatherSpheres();
+
+        /// \brief Build the subtree over objects [begin, end)
+        /// \returns The index of the subtree's root node
+        std::uint32_t build(std::vector<Aabb>& boxes, std::size_t begin, std::size_t end, int depth);
+
+        std::vector<std::shared_ptr<Hittable>> m_objects;
+        std::vector<Hittable const*> m_primitives;      // The objects, without the reference counting
+        std::vector<std::shared_ptr<Hittable>> m_unbounded;
+        std::vector<Node> m_nodes;
+        std::vector<double> m_sphereX;                  // The sphere that every object is, one array per coordinate
+        std::vector<double> m_sphereY;
+        std::vector<double> m_sphereZ;
+        std::vector<double> m_sphereRadius;             // Negative for objects that are not spheres
+        std::vector<std::size_t> m_order;               // During a build, the original index of every box
+        double m_builtCost {};
+        CacheUse m_cacheUse {CacheUse::none};
+    };
+
+    /// \brief How splitBoxes() divided a range of boxes
+    struct BoxSplit
+    {
+        bool leaf;              // The range is best kept whole, and was left as it was
+        std::size_t mid;        // The first box of the right-hand side
+        std::size_t axis;       // The axis the range was divided along
+    };
+
+    /// \brief Choose how to divide boxes [begin, end) with the surface area heuristic over binned centroids, and
+    /// partition them around that choice
+    /// \param[inout] boxes The boxes, reordered within the range
+    /// \param[inout] order Moves with the boxes, so that each one can be found again
+    /// \param[in] bounds The box around the range
+    /// \param[in] centroids The box around the centres of the boxes in the range
+    /// \param[in] depth The depth of the range in its tree. Ranges at Bvh::maxDepth are kept whole
+    BoxSplit splitBoxes(std::vector<Aabb>& boxes, std::vector<std::size_t>& order, std::size_t begin, std::size_t end, Aabb const& bounds, Aabb const& centroids, int depth);
+}
+
+#endif
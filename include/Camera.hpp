@@ -5,8 +5,27 @@
 #include "Ray.hpp"
 #include "Vec3.hpp"
 
+#include <vector>
+
 namespace rt
 {
+    /// \brief Where a camera is and how it is focused, independent of the image it renders
+    struct CameraSettings
+    {
+        Point3 lookFrom {13, 2, 3};
+        Point3 lookAt {0, 0, 0};
+        Vec3 viewUp {0, 1, 0};
+        double verticalFovInDegrees {20};
+        double aperture {0.1};
+        double focusDistance {10};
+    };
+
+    /// \brief Place cameras evenly on a circle around the point a camera looks at, as for a turntable
+    /// \param[in] base The first camera. The others are rotated about its up direction, through the point it looks at
+    /// \param[in] count The number of cameras
+    /// \returns The cameras, in order of increasing angle
+    std::vector<CameraSettings> orbit(CameraSettings const& base, int count);
+
     class Camera
     {
     public:
@@ -18,12 +37,23 @@ namespace rt
         /// \param[in] aspectRatio The ratio between the image width and height
         Camera(Point3 lookFrom, Point3 lookAt, Vec3 viewUp, double verticalFovInDegrees, double aspectRatio, double aperture, double focusDistance) noexcept;
 
+        /// \brief Create a camera from stored settings
+        /// \param[in] settings The placement and focus of the camera
+        /// \param[in] aspectRatio The ratio between the image width and height
+        Camera(CameraSettings const& settings, double aspectRatio) noexcept;
+
         /// \brief 
         /// \param[in] u
         /// \param[in] v
         /// \returns
         Ray getRay(double const s, double const t) const& noexcept;
 
+        /// \brief Get a ray through the viewport together with its differentials
+        /// \param[in] s, t The viewport coordinates of the ray, in [0, 1]
+        /// \param[in] ds, dt The spacing between neighbouring samples in viewport coordinates
+        /// \returns A ray whose offset rays pass through (s + ds, t) and (s, t + dt)
+        Ray getRay(double const s, double const t, double const ds, double const dt) const& noexcept;
+
     private:
         Point3 m_origin {};
         Point3 m_lowerLeftCorner;
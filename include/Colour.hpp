@@ -3,14 +3,40 @@
 
 #include "Vec3.hpp"
 
+#include <array>
+#include <cstdint>
 #include <iostream>
 #include <ostream>
+#include <vector>
 
 namespace rt
 {
     /// \brief RGB colour
     using Colour = Vec3;
 
+    /// \brief Get the perceived brightness of a linear RGB colour
+    /// \param[in] c The colour, with Rec. 709 primaries
+    /// \returns The relative luminance of @param c
+    constexpr double luminance(Colour const& c) noexcept
+    {
+        return (0.2126 * c.x()) + (0.7152 * c.y()) + (0.0722 * c.z());
+    }
+
+    /// \brief Convert a pixel's colour to 8-bit components, gamma-corrected for gamma = 2.0
+    /// \param[in] pixelColour The sum of the pixel's samples
+    /// \param[in] samplesPerPixel The number of samples of the pixel
+    /// \returns The red, green and blue components in [0, 255]
+    std::array<std::uint8_t, 3> toBytes(Colour const& pixelColour, int const samplesPerPixel) noexcept;
+
+    /// \brief Convert many pixels' colours at once, as toBytes() does for one
+    /// \param[in] pixels The sums of the pixels' samples
+    /// \param[in] samplesPerPixel The number of samples of each pixel
+    /// \returns The red, green and blue components of every pixel in turn
+    std::vector<std::uint8_t> toBytes(std::vector<Colour> const& pixels, int samplesPerPixel);
+
+    /// \brief Write already converted pixels to a stream as the text of an ASCII PPM, one pixel per line
+    void writeBytes(std::ostream& out, std::vector<std::uint8_t> const& bytes);
+
     /// \brief Write a single pixel's colour to the standard output stream
     /// \param[in] pixelColour The pixel whose colour is being written
     /// \param[inout] out The output stream written to
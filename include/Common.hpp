@@ -2,6 +2,7 @@
 #define COMMON_HPP
 
 #include <cmath>
+#include <cstdint>
 #include <limits>
 #include <random>
 
@@ -15,15 +16,80 @@ namespace rt
         return degrees * pi / 180.0;
     }
 
+    /// \brief A PCG32 random number generator: a 64-bit linear congruential state with a permuted 32-bit output
+    /// \details Unlike std::mt19937, seeding is a couple of multiplications, so the renderer can afford to restart the
+    /// sequence for every sample
+    class Pcg32
+    {
+    public:
+        using result_type = std::uint32_t;
+
+        /// \brief Start the sequence selected by @param seed
+        explicit Pcg32(std::uint64_t const seed = 0) noexcept
+        {
+            this->seed(seed);
+        }
+
+        /// \brief Restart the sequence selected by @param seed
+        void seed(std::uint64_t const seed) & noexcept
+        {
+            m_state = 0;
+            (*this)();
+            m_state += seed;
+            (*this)();
+        }
+
+        /// \brief Get the next number of the sequence
+        result_type operator()() & noexcept
+        {
+            auto const old = m_state;
+            m_state = (old * 6364136223846793005ULL) + increment;
+
+            auto const xorShifted = static_cast<std::uint32_t>(((old >> 18u) ^ old) >> 27u);
+            auto const rotation = static_cast<std::uint32_t>(old >> 59u);
+
+            return (xorShifted >> rotation) | (xorShifted << ((0u - rotation) & 31u));
+        }
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+    private:
+        static constexpr std::uint64_t increment = 1442695040888963407ULL;
+
+        std::uint64_t m_state {};
+    };
+
+    /// \brief Get the random number generator of the calling thread
+    /// \details Every thread has its own generator, so threads never share state
+    inline Pcg32& randomGenerator()
+    {
+        static thread_local Pcg32 generator((static_cast<std::uint64_t>(std::random_device{}()) << 32u) | std::random_device{}());
+        return generator;
+    }
+
+    /// \brief Restart the random sequence of the calling thread, so that it repeats for the same seed
+    inline void seedRandom(std::uint64_t const seed)
+    {
+        randomGenerator().seed(seed);
+    }
+
+    /// \brief Mix the bits of @param x, so that nearby inputs give unrelated outputs (the SplitMix64 finaliser)
+    constexpr std::uint64_t mixBits(std::uint64_t x) noexcept
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30u)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27u)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31u);
+    }
+
     /// \brief Generate a random number between [0.0, 1.0)
     /// \returns A random real number between [0, 1)
     inline double randomDouble()
     {
-        static std::random_device rd;
-        static std::mt19937 generator(rd());
-        static std::uniform_real_distribution<> distribution(0.0, 1.0);
-        
-        return distribution(generator);
+        static thread_local std::uniform_real_distribution<> distribution(0.0, 1.0);
+
+        return distribution(randomGenerator());
     }
 
     /// \brief Generate a random real number between [min, max)
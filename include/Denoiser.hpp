@@ -0,0 +1,33 @@
+#ifndef DENOISER_HPP
+#define DENOISER_HPP
+
+#include "Colour.hpp"
+#include "Framebuffer.hpp"
+
+#include <vector>
+
+namespace rt
+{
+    /// \brief Strength of the edge-stopping functions of the denoiser
+    struct DenoiseSettings
+    {
+        int iterations {5};         // Each iteration doubles the filter radius
+        float colourSigma {1.0f};   // Relative colour difference tolerated between neighbours
+        float normalSigma {0.3f};   // Normal difference tolerated between neighbours
+        float depthSigma {0.05f};   // Relative depth difference tolerated per pixel of distance
+        float albedoSigma {0.1f};   // Albedo difference tolerated between neighbours
+        unsigned threads {0};       // Zero means one thread per core
+    };
+
+    /// \brief Remove Monte Carlo noise from a rendered image with an edge-avoiding a-trous wavelet filter
+    /// \details The lighting is separated from the albedo, filtered with a 5x5 B-spline kernel whose taps spread
+    /// further apart on every iteration, and multiplied by the albedo again. Taps are weighted down where the colour,
+    /// normal, depth or albedo differ from the centre pixel, so edges and texture detail survive.
+    /// Rows are shared between threads, and each row is filtered four pixels at a time
+    /// \param[in] framebuffer The noisy image and its first-hit feature buffers
+    /// \param[in] settings The strength of the filter
+    /// \returns The mean colour of every pixel after denoising, row by row from the top
+    std::vector<Colour> denoise(Framebuffer const& framebuffer, DenoiseSettings const& settings = {});
+}
+
+#endif
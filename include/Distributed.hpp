@@ -0,0 +1,151 @@
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+#include "Framebuffer.hpp"
+#include "RenderServer.hpp"
+#include "Renderer.hpp"
+#include "Scene.hpp"
+#include "Socket.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace rt
+{
+    /// \brief Hands out the tiles of an image to workers, and hands them out again when a worker fails or falls behind
+    /// \details A tile whose worker fails goes back to the front of the queue. Once the queue is empty, an idle worker
+    /// is given a copy of a tile that has been in flight for more than slowFactor times the mean tile time. Whichever copy
+    /// finishes first is kept. All members are thread-safe
+    class TileScheduler
+    {
+    public:
+        /// \brief Split an image into tiles, ordered row by row from the top
+        /// \param[in] width, height The size of the image
+        /// \param[in] tileSize The width and height of every tile but those on the right and bottom edges
+        /// \param[in] slowFactor How many times slower than the mean a tile must be before it is duplicated
+        TileScheduler(int width, int height, int tileSize, double slowFactor = 3.0);
+
+        /// \brief Get a tile to render, waiting while every tile is in flight and none is slow
+        /// \returns The tile, or nothing once every tile is done or the scheduler is cancelled
+        std::optional<Tile> next();
+
+        /// \brief Record a finished tile
+        /// \returns true if this is the first copy of the tile to finish, so its pixels should be kept
+        bool complete(Tile const& tile);
+
+        /// \brief Give back a tile whose worker failed
+        void abandon(Tile const& tile);
+
+        /// \brief Make every call to next() return nothing
+        void cancel();
+
+        /// \brief Check if every tile is done
+        bool finished() const;
+
+        /// \brief Get the number of tiles
+        std::size_t tileCount() const noexcept
+        {
+            return m_tiles.size();
+        }
+
+        /// \brief Get the number of times a tile was handed out again after a failure or to overtake a slow worker
+        std::size_t reassignments() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct TileState
+        {
+            int copies {};              // The number of workers rendering the tile
+            bool done {false};
+            Clock::time_point started;  // When the oldest copy in flight was handed out
+        };
+
+        /// \brief Find a tile to duplicate. The mutex must be held
+        std::optional<Tile> slowTile(Clock::time_point now);
+
+        std::vector<Tile> m_tiles;
+        double m_slowFactor;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_changed;
+        std::vector<TileState> m_states;
+        std::deque<int> m_pending;
+        std::size_t m_done {};
+        std::size_t m_reassigned {};
+        bool m_cancelled {false};
+        Clock::duration m_renderTime {};    // Summed over every finished tile
+    };
+
+    /// \brief How the coordinator splits and supervises a frame
+    struct CoordinatorSettings
+    {
+        int tileSize {32};
+        double slowFactor {3.0};                        // See TileScheduler
+        std::chrono::seconds workerTimeout {30};        // Give up after this long without any connected worker
+        std::chrono::seconds tileTimeout {120};         // Drop a worker that sends nothing for this long, including its scene build
+    };
+
+    /// \brief Renders a frame with worker processes that connect over TCP, merging the tiles they send back
+    /// \details Every worker builds the scene from its description, so texture and environment files must exist at the
+    /// same paths on every machine. Workers must have the same byte order as the coordinator
+    class Coordinator
+    {
+    public:
+        /// \brief Start listening for workers
+        /// \param[in] port The TCP port to listen on. Zero lets the system choose one
+        /// \throws std::runtime_error if the port cannot be opened
+        explicit Coordinator(std::uint16_t port = 0);
+
+        /// \brief Get the port that workers connect to
+        std::uint16_t port() const noexcept
+        {
+            return m_port;
+        }
+
+        /// \brief Render a frame with whichever workers connect
+        /// \param[in] scene The scene every worker builds
+        /// \param[in] job The camera and the image
+        /// \param[in] settings How the frame is split and supervised
+        /// \param[out] framebuffer Receives the summed samples of every pixel. It must be the size of the image
+        /// \throws std::runtime_error if no worker is connected for longer than the timeout
+        /// \details A worker that sends nothing for longer than the tile timeout, because it hangs or is stopped, is treated
+        /// as if it had died: its tile is handed out again and its connection is closed
+        void render(SceneDescription const& scene, RenderJob const& job, CoordinatorSettings const& settings, Framebuffer& framebuffer);
+
+    private:
+        Socket m_listener;
+        std::uint16_t m_port;
+    };
+
+    /// \brief How a worker process renders
+    struct WorkerSettings
+    {
+        unsigned threads {0};       // Zero means one per core
+    };
+
+    /// \brief Connect to a coordinator and render the tiles it hands out until it says the frame is done
+    /// \param[in] address The coordinator as host:port
+    /// \param[in] settings How the worker renders
+    /// \throws std::runtime_error if the connection fails or the scene cannot be built
+    void runWorker(std::string const& address, WorkerSettings const& settings = {});
+
+    /// \brief Start worker processes on this machine, running this program with --worker
+    /// \param[in] count The number of processes
+    /// \param[in] port The port of the coordinator on localhost
+    /// \param[in] threadsPerWorker The number of threads of each worker
+    /// \returns The process ids of the workers
+    /// \throws std::runtime_error if a process cannot be started
+    std::vector<int> spawnLocalWorkers(int count, std::uint16_t port, unsigned threadsPerWorker);
+
+    /// \brief Wait for worker processes to exit
+    void waitForWorkers(std::vector<int> const& processIds);
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef DISTRIBUTION_HPP
+#define DISTRIBUTION_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace rt
+{
+    /// \brief A piecewise-constant probability distribution over [0, 1)
+    class Distribution1D
+    {
+    public:
+        /// \brief Default constructor. Creates an empty distribution
+        Distribution1D() = default;
+
+        /// \brief Build the distribution from non-negative function values at evenly spaced intervals
+        /// \param[in] values The function value of each interval. If they are all zero the distribution is uniform
+        explicit Distribution1D(std::vector<double> values);
+
+        /// \brief Pick a point in [0, 1) with probability proportional to the function
+        /// \param[in] u A uniformly distributed number in [0, 1)
+        /// \param[out] pdf The density of the returned point
+        /// \param[out] offset The index of the interval that contains the returned point
+        /// \returns A point in [0, 1)
+        double sampleContinuous(double u, double& pdf, std::size_t& offset) const noexcept;
+
+        /// \brief Get the density of the interval with the given index
+        double pdf(std::size_t index) const noexcept;
+
+        /// \brief Get the number of intervals
+        std::size_t count() const noexcept { return m_function.size(); }
+
+        /// \brief Get the integral of the function over [0, 1)
+        double integral() const noexcept { return m_integral; }
+
+    private:
+        std::vector<double> m_function;
+        std::vector<double> m_cdf;
+        double m_integral {};
+    };
+
+    /// \brief A piecewise-constant probability distribution over [0, 1)^2, sampled by marginal and conditional CDFs
+    class Distribution2D
+    {
+    public:
+        /// \brief Default constructor. Creates an empty distribution
+        Distribution2D() = default;
+
+        /// \brief Build the distribution from a grid of non-negative function values
+        /// \param[in] values The function values, stored row by row
+        /// \param[in] width The number of columns (the u direction)
+        /// \param[in] height The number of rows (the v direction)
+        Distribution2D(std::vector<double> const& values, std::size_t width, std::size_t height);
+
+        /// \brief Pick a point with probability proportional to the function
+        /// \param[in] u1, u2 Uniformly distributed numbers in [0, 1)
+        /// \param[out] u, v The coordinates of the sampled point in [0, 1)
+        /// \param[out] pdf The density of the sampled point with respect to area in [0, 1)^2
+        void sample(double u1, double u2, double& u, double& v, double& pdf) const noexcept;
+
+        /// \brief Get the density of the point (u, v) with respect to area in [0, 1)^2
+        double pdf(double u, double v) const noexcept;
+
+    private:
+        std::vector<Distribution1D> m_conditional;
+        Distribution1D m_marginal;
+    };
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef ENVIRONMENT_HPP
+#define ENVIRONMENT_HPP
+
+#include "Colour.hpp"
+#include "Distribution.hpp"
+#include "HdrImage.hpp"
+#include "Vec3.hpp"
+
+namespace rt
+{
+    /// \brief Light arriving from infinitely far away, seen by rays that leave the scene
+    class Environment
+    {
+    public:
+        virtual ~Environment() = default;
+
+        /// \brief Get the radiance arriving from a direction
+        /// \param[in] direction The direction in which the environment is seen. It does not need to be normalised
+        virtual Colour radiance(Vec3 const& direction) const = 0;
+
+        /// \brief Determine whether the environment should be sampled explicitly from diffuse hits
+        virtual bool isSampled() const noexcept
+        {
+            return false;
+        }
+
+        /// \brief Pick a direction in which to look for light
+        /// \param[out] pdf The solid-angle density of the returned direction
+        /// \returns A unit direction
+        virtual Vec3 sample(double& pdf) const
+        {
+            pdf = 0.0;
+            return Vec3(0, 1, 0);
+        }
+
+        /// \brief Get the solid-angle density with which sample() picks @param direction
+        virtual double pdf([[maybe_unused]] Vec3 const& direction) const
+        {
+            return 0.0;
+        }
+    };
+
+    /// \brief The white-to-blue sky from Ray Tracing in One Weekend
+    /// \details The sky is smooth enough that following the material is already a good sampling strategy,
+    /// so it is never sampled explicitly
+    class SkyGradient : public Environment
+    {
+    public:
+        /// \brief Linearly blend white and blue depending on the height of the y coordinate
+        Colour radiance(Vec3 const& direction) const override;
+    };
+
+    /// \brief An HDR image in latitude-longitude layout, importance sampled by luminance
+    /// \details The top row of the image is straight up (+y) and the bottom row straight down. 
+    /// Columns sweep the azimuth from +x through +z
+    class EnvironmentMap : public Environment
+    {
+    public:
+        /// \brief Create an environment light from a latitude-longitude image
+        /// \param[in] image The radiance in every direction
+        /// \param[in] scale A factor applied to every pixel of the image
+        explicit EnvironmentMap(HdrImage image, double scale = 1.0);
+
+        Colour radiance(Vec3 const& direction) const override;
+
+        bool isSampled() const noexcept override
+        {
+            return true;
+        }
+
+        /// \brief Pick a direction with probability proportional to its luminance
+        Vec3 sample(double& pdf) const override;
+
+        double pdf(Vec3 const& direction) const override;
+
+    private:
+        HdrImage m_image;
+        Distribution2D m_distribution;
+
+        /// \brief Map a direction to [0, 1)^2 image coordinates
+        static void toImageCoordinates(Vec3 const& direction, double& u, double& v) noexcept;
+    };
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef FOOTPRINT_HPP
+#define FOOTPRINT_HPP
+
+#include "Common.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace rt
+{
+    /// \brief The objects and materials that the paths through a tile touched, kept as a Bloom filter
+    /// \details Every key sets a few bits picked by a hash of its address. A key that was added is always found again.
+    /// One that was not is found only if others happened to set all of its bits, which stays rare while a tile
+    /// touches no more than a few hundred keys, and costs no more than re-rendering a tile that did not need it
+    class TileFootprint
+    {
+    public:
+        /// \brief The size of the filter
+        static constexpr std::size_t bits = 4096;
+
+        /// \brief Remember @param key. Null keys are left out
+        void add(void const* key) noexcept
+        {
+            if (key == nullptr) {
+                return;
+            }
+
+            auto hash = hashKey(key);
+
+            for (int i = 0; i < hashes; ++i, hash >>= bitIndexBits) {
+                auto const bit = hash & (bits - 1);
+                m_words[bit / 64] |= std::uint64_t {1} << (bit % 64);
+            }
+        }
+
+        /// \brief Determine whether @param key may have been added. False means it certainly was not
+        bool mayContain(void const* key) const noexcept
+        {
+            auto hash = hashKey(key);
+
+            for (int i = 0; i < hashes; ++i, hash >>= bitIndexBits) {
+                auto const bit = hash & (bits - 1);
+
+                if ((m_words[bit / 64] & (std::uint64_t {1} << (bit % 64))) == 0) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /// \brief Forget every key
+        void clear() noexcept { m_words.fill(0); }
+
+    private:
+        static constexpr int hashes = 3;            // The bits set by every key
+        static constexpr int bitIndexBits = 12;     // The bits of the hash that pick one bit of the filter
+
+        static_assert(bits == std::size_t {1} << bitIndexBits);
+        static_assert(hashes * bitIndexBits <= 64);
+
+        static std::uint64_t hashKey(void const* key) noexcept
+        {
+            return mixBits(static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key)));
+        }
+
+        std::array<std::uint64_t, bits / 64> m_words {};
+    };
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+
+#include "Colour.hpp"
+
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+namespace rt
+{
+    /// \brief The work and time that went into one pixel
+    struct PixelCost
+    {
+        float traversalSteps;   // Hierarchy nodes visited per sample
+        float primitiveTests;   // Intersection tests per sample
+        float pathLength;       // Ray segments traced per sample, counting the camera ray
+        float microseconds;     // Wall time spent on the whole pixel
+    };
+
+    /// \brief The accumulated samples of a rendered image and its feature buffers, stored row by row from the top
+    struct Framebuffer
+    {
+        /// \brief Create a black image
+        /// \param[in] width, height The size of the image in pixels
+        Framebuffer(int width, int height);
+
+        /// \brief Get the index of the pixel in column @param x and row @param y
+        std::size_t index(int const x, int const y) const noexcept
+        {
+            return static_cast<std::size_t>(y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(x);
+        }
+
+        /// \brief Get the mean colour of a pixel
+        Colour mean(std::size_t const i) const noexcept
+        {
+            return samplesPerPixel > 0 ? colour[i] / samplesPerPixel : Colour(0, 0, 0);
+        }
+
+        int width;
+        int height;
+        int samplesPerPixel {};         // The number of samples summed in every pixel
+
+        std::vector<Colour> colour;     // Sum of the radiance samples
+        std::vector<Colour> albedo;     // Mean first-hit albedo
+        std::vector<Vec3> normal;       // Mean first-hit normal
+        std::vector<double> depth;      // Mean first-hit distance, infinite where rays escape
+        std::vector<PixelCost> cost;    // The cost of every pixel. Empty unless the render was asked to record it
+    };
+
+    /// \brief Write the header of a plain-text PPM, which the pixels follow one per line
+    /// \param[inout] out The output stream written to
+    /// \param[in] width, height The size of the image
+    void writePpmHeader(std::ostream& out, int width, int height);
+
+    /// \brief Write the image as a plain-text PPM, gamma-corrected for gamma = 2.0
+    /// \param[inout] out The output stream written to
+    /// \param[in] pixels The mean colour of every pixel, row by row from the top
+    /// \param[in] width, height The size of the image
+    void writePpm(std::ostream& out, std::vector<Colour> const& pixels, int width, int height);
+}
+
+#endif
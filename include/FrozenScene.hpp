@@ -0,0 +1,126 @@
+#ifndef FROZEN_SCENE_HPP
+#define FROZEN_SCENE_HPP
+
+#include "Bvh.hpp"
+#include "Hittable.hpp"
+#include "Numa.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rt
+{
+    class Material;     // forward declaration
+    struct Scene;       // forward declaration
+
+    /// \brief A world compiled into one immutable block of memory
+    /// \details The hierarchy's nodes, the centres, radii and material indices of the spheres, and the table of
+    /// materials are laid out one after the other in a single allocation, with the spheres in the order the leaves
+    /// visit them. Nodes and spheres refer to each other with 32-bit indices. Nothing changes after construction, so any
+    /// number of threads can trace through it without synchronising. Objects that are not spheres, such as moving ones,
+    /// are kept as they are and tested after the spheres. The arena can be copied to every memory node, so that pinned
+    /// threads read the copy next to them
+    class FrozenScene : public Hittable
+    {
+    public:
+        /// \brief Compile the objects of a world
+        /// \details Spheres directly in the list are tested against every ray, as they were before, and the spheres of
+        /// hierarchies in it go into one tree. A hierarchy of spheres only is copied as it is built
+        /// \param[in] objects The objects of the world
+        explicit FrozenScene(std::vector<std::shared_ptr<Hittable>> const& objects);
+
+        FrozenScene(FrozenScene const&) = delete;
+        FrozenScene& operator=(FrozenScene const&) = delete;
+        ~FrozenScene() override = default;
+
+        /// \brief Find the closest hit, visiting the nearer child of every node first
+        bool hit(Ray const& ray, double tMin, double tMax, HitRecord& record) const noexcept override;
+
+        /// \brief Determine whether anything blocks the ray, stopping at the first hit found
+        bool occluded(Ray const& ray, double tMin, double tMax) const noexcept override;
+
+        /// \brief Get the box around every object, if they are all bounded
+        bool boundingBox(Aabb& box) const noexcept override;
+
+        /// \brief Get the number of spheres compiled into the arena
+        std::size_t sphereCount() const noexcept { return m_sphereCount; }
+
+        /// \brief Get the number of nodes of the tree
+        std::size_t nodeCount() const noexcept { return m_nodeCount; }
+
+        /// \brief Get the number of different materials of the spheres
+        std::size_t materialCount() const noexcept { return m_materials.size(); }
+
+        /// \brief Get the size of the arena in bytes
+        std::size_t bytes() const noexcept { return m_bytes; }
+
+        /// \brief Give every memory node its own copy of the arena, which the threads pinned to it trace through
+        /// \details Each copy is written by a thread pinned to its node, so that its pages are allocated there. The
+        /// materials themselves are still shared. Not safe while other threads trace through the scene
+        void replicateOnNodes();
+
+        /// \brief Get the number of copies of the arena
+        std::size_t replicas() const noexcept { return m_arenas.size(); }
+
+    private:
+        /// \brief Frees the arena with the alignment it was allocated with
+        struct ArenaDeleter
+        {
+            void operator()(std::byte* arena) const noexcept;
+        };
+
+        using Arena = std::unique_ptr<std::byte[], ArenaDeleter>;
+
+        /// \brief Views of the sections of one copy of the arena
+        struct Sections
+        {
+            Bvh::Node const* nodes {};
+            double const* x {};
+            double const* y {};
+            double const* z {};
+            double const* radius {};
+            std::uint32_t const* material {};
+            Material const* const* materialTable {};
+
+            /// \brief Get the same views into a copy of the arena
+            Sections movedTo(std::byte const* from, std::byte const* to) const noexcept;
+        };
+
+        /// \brief Allocate an arena of m_bytes on the cache line alignment of its sections
+        Arena allocate() const;
+
+        /// \brief Get the sections of the copy of the arena on the calling thread's node
+        Sections const& sections() const noexcept
+        {
+            auto const node = currentNode();
+            return m_sections[node < m_sections.size() ? node : 0];
+        }
+
+        /// \brief Find the nearest sphere in [first, first + count) hit in [tMin, closest], and shorten closest to it
+        /// \param[inout] nearest The index of the nearest sphere hit so far. Replaced if a sphere here is as near
+        void hitSpheres(Sections const& sections, std::uint32_t first, std::uint32_t count, Ray const& ray, double tMin, double& closest, std::uint32_t& nearest) const noexcept;
+
+        std::vector<Arena> m_arenas;            // One copy, or one per node once replicated
+        std::vector<Sections> m_sections;       // The views of every copy
+        std::size_t m_bytes {};
+
+        std::uint32_t m_nodeCount {};
+        std::uint32_t m_sphereCount {};
+        std::uint32_t m_outside {};     // The spheres before this index are tested against every ray, outside the tree
+
+        std::vector<std::shared_ptr<Material>> m_materials;     // Keeps the materials alive
+        std::vector<std::shared_ptr<Hittable>> m_others;        // Objects that are not spheres
+    };
+
+    /// \brief Replace the world of a scene with a frozen copy of it
+    /// \details The lights, the hierarchy and the original objects stay as they were, and still share the materials
+    /// with the frozen world. Moving the objects afterwards has no effect on what is rendered
+    /// \param[inout] scene The scene to freeze
+    /// \param[in] replicate Copy the frozen world to every memory node
+    /// \returns The frozen world, which is now the only object of the scene's world
+    std::shared_ptr<FrozenScene const> freezeScene(Scene& scene, bool replicate = false);
+}
+
+#endif
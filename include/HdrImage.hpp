@@ -0,0 +1,42 @@
+#ifndef HDR_IMAGE_HPP
+#define HDR_IMAGE_HPP
+
+#include "Colour.hpp"
+
+#include <string>
+#include <vector>
+
+namespace rt
+{
+    /// \brief A high dynamic range RGB image, stored row by row from the top
+    struct HdrImage
+    {
+        int width {};
+        int height {};
+        std::vector<Colour> pixels;
+
+        /// \brief Get the pixel in column @param x and row @param y
+        Colour const& at(int const x, int const y) const& { return pixels[static_cast<std::size_t>(y) * width + x]; }
+    };
+
+    /// \brief Load a Radiance RGBE (.hdr), portable float map (.pfm) or 8-bit portable pixmap (.ppm) image
+    /// \details PPM pixels are converted to linear values with the gamma of 2 that the renderer writes them with
+    /// \param[in] path The location of the image file
+    /// \returns The decoded image
+    /// \throws std::runtime_error if the file cannot be read or is not in a supported format
+    HdrImage loadHdrImage(std::string const& path);
+
+    /// \brief Save an image as a little-endian portable float map (.pfm)
+    /// \param[in] image The image to save
+    /// \param[in] path The location of the file to create
+    /// \throws std::runtime_error if the file cannot be written
+    void saveHdrImage(HdrImage const& image, std::string const& path);
+
+    /// \brief Measure how far an image is from a reference, as the root mean square difference of the displayed values
+    /// \details Both images are compared after the gamma of 2 that PPM files are written with, and clamped to [0, 1],
+    /// so the error is in the units of the 8-bit output divided by 255
+    /// \throws std::invalid_argument if the images differ in size
+    double displayedDifference(HdrImage const& image, HdrImage const& reference);
+}
+
+#endif
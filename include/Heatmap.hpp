@@ -0,0 +1,29 @@
+#ifndef HEATMAP_HPP
+#define HEATMAP_HPP
+
+#include "Colour.hpp"
+#include "Framebuffer.hpp"
+
+#include <string>
+#include <vector>
+
+namespace rt
+{
+    /// \brief Map values to colours on a ramp from black through purple, red and orange to pale yellow
+    /// \details The top of the ramp is a high percentile rather than the maximum, so that a few extreme pixels do not
+    /// leave the rest of the image dark. The colours are squared, so that they come out as shown once gamma-corrected
+    /// \param[in] values One value per pixel
+    /// \param[out] scale Receives the value at the top of the ramp. Larger values are clamped to it
+    /// \returns The colour of every pixel
+    std::vector<Colour> heatmap(std::vector<float> const& values, float& scale);
+
+    /// \brief Write the cost buffer of a framebuffer as <prefix>.traversal.ppm, <prefix>.tests.ppm, <prefix>.path.ppm
+    /// and <prefix>.time.ppm
+    /// \param[in] framebuffer A framebuffer rendered with recordCost set
+    /// \param[in] prefix The start of every file name
+    /// \returns A line per image, naming the file and the value at the top of its ramp
+    /// \throws std::runtime_error if a file cannot be written
+    std::string writeHeatmaps(Framebuffer const& framebuffer, std::string const& prefix);
+}
+
+#endif
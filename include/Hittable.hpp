@@ -1,6 +1,7 @@
 #ifndef HITTABLE_HPP
 #define HITTABLE_HPP
 
+#include "Aabb.hpp"
 #include "Ray.hpp"
 #include "Vec3.hpp"
 
@@ -9,19 +10,39 @@
 namespace rt
 {
     class Material;     // forward declaration to Material class
+    class Hittable;
 
     struct HitRecord
     {
         Point3 point;
         Vec3 normal;
-        std::shared_ptr<Material> materialPtr;
+        Material const* materialPtr {};     // Owned by the object that was hit, which outlives the render
+        Hittable const* object {};          // The object that was hit, as the world holds it. Null if it is not known
         double t;
         bool frontFace;     // In which direction is the normal pointing towards from the surface?
 
+        double u {};        // Surface coordinates of the hit point, in [0, 1]
+        double v {};
+        Vec3 dpdu;          // Change in position along the surface coordinates
+        Vec3 dpdv;
+
+        Vec3 dpdx;          // Change in position, u and v between neighbouring pixels. Zero if unknown
+        Vec3 dpdy;
+        double dudx {};
+        double dvdx {};
+        double dudy {};
+        double dvdy {};
+
         /// \brief Set the frontFace and the normal
         /// \param[in] ray The incidence ray
         /// \param[in] outwardNormal The normal at the point of ray-sphere intersection
         constexpr void setFaceNormal(Ray const& ray, Vec3 const& outwardNormal) & noexcept;
+
+        /// \brief Estimate how far apart the hits of neighbouring pixels are, in space and in (u, v)
+        /// \details The offset rays of @param ray are intersected with the tangent plane at the hit point.
+        /// Nothing is computed if the ray has no differentials
+        /// \param[in] ray The ray that produced this hit
+        void computeDifferentials(Ray const& ray) & noexcept;
     };
 
     constexpr void HitRecord::setFaceNormal(Ray const& ray, Vec3 const& outwardNormal) & noexcept
@@ -44,6 +65,58 @@ namespace rt
         virtual ~Hittable() = default;
         
         virtual bool hit(Ray const& ray, double tMin, double tMax, HitRecord& record) const noexcept = 0;
+
+        /// \brief Determine whether anything blocks the ray between tMin and tMax
+        /// \details Unlike hit(), this may stop at the first intersection it finds and never fills in a HitRecord.
+        /// Use it for shadow rays and other visibility tests
+        /// \param[in] ray The ray under investigation
+        /// \param[in] tMin The minimum t-value acceptable for a hit
+        /// \param[in] tMax The maximum t-value acceptable for a hit
+        /// \returns true if there is any intersection in [tMin, tMax]
+        virtual bool occluded(Ray const& ray, double tMin, double tMax) const noexcept
+        {
+            HitRecord record;
+            return hit(ray, tMin, tMax, record);
+        }
+
+        /// \brief Get a box that encloses the object
+        /// \param[out] box Receives the bounds of the object
+        /// \returns false if the object is unbounded, in which case @param box is left unchanged
+        virtual bool boundingBox([[maybe_unused]] Aabb& box) const noexcept
+        {
+            return false;
+        }
+
+        /// \brief Get the solid-angle density with which random() picks a direction towards this object
+        /// \param[in] origin The point from which the object is viewed
+        /// \param[in] direction The direction under investigation
+        /// \returns The probability density of sampling @param direction, or 0 if the object cannot be sampled
+        virtual double pdfValue([[maybe_unused]] Point3 const& origin, [[maybe_unused]] Vec3 const& direction) const
+        {
+            return 0.0;
+        }
+
+        /// \brief Pick a random direction from @param origin towards this object
+        /// \param[in] origin The point from which the object is viewed
+        /// \returns A unit direction distributed according to pdfValue()
+        virtual Vec3 random([[maybe_unused]] Point3 const& origin) const
+        {
+            return Vec3(1, 0, 0);
+        }
+
+        /// \brief Get the area of the surface, for objects that can emit light from a sampled point
+        /// \returns The area, or 0 if sampleSurface() is not supported
+        virtual double area() const noexcept
+        {
+            return 0.0;
+        }
+
+        /// \brief Pick a point uniformly over the surface
+        /// \param[out] record Receives the point, the outward normal, the surface coordinates and the material, 
+        /// as if the point had been hit from outside
+        virtual void sampleSurface([[maybe_unused]] HitRecord& record) const
+        {
+        }
     };    
 }
 
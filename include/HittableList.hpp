@@ -29,6 +29,27 @@ namespace rt
         /// \brief Determine if a ray hit an object
         bool hit(Ray const& ray, double tMin, double tMax, HitRecord& record) const noexcept override;
 
+        /// \brief Determine if a ray hit any object, stopping at the first one found
+        bool occluded(Ray const& ray, double tMin, double tMax) const noexcept override;
+
+        /// \brief Get the box around every object, if they are all bounded
+        bool boundingBox(Aabb& box) const noexcept override;
+
+        /// \brief Get the density of sampling @param direction when one object is picked uniformly at random
+        double pdfValue(Point3 const& origin, Vec3 const& direction) const override;
+
+        /// \brief Pick one object uniformly at random and sample a direction towards it
+        Vec3 random(Point3 const& origin) const override;
+
+        /// \brief Determine whether the list contains no objects
+        bool empty() const noexcept { return m_objects.empty(); }
+
+        /// \brief Get the number of objects in the list
+        std::size_t size() const noexcept { return m_objects.size(); }
+
+        /// \brief Get the objects in the list
+        std::vector<std::shared_ptr<Hittable>> const& objects() const noexcept { return m_objects; }
+
     private:
         std::vector<std::shared_ptr<Hittable>> m_objects;
     };
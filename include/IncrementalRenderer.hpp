@@ -0,0 +1,74 @@
+#ifndef INCREMENTAL_RENDERER_HPP
+#define INCREMENTAL_RENDERER_HPP
+
+#include "Camera.hpp"
+#include "Footprint.hpp"
+#include "Framebuffer.hpp"
+#include "Renderer.hpp"
+#include "Scene.hpp"
+
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+namespace rt
+{
+    /// \brief What changed in a scene since it was last rendered
+    struct SceneEdits
+    {
+        std::vector<Hittable const*> moved;         // Objects of the world whose place or shape changed
+        std::vector<Hittable const*> repainted;     // Objects of the world given another material
+        std::vector<Material const*> materials;     // Materials changed in place, wherever they are used
+    };
+
+    /// \brief Keeps a rendered image up to date with edits to its scene, rendering again only the tiles they affect
+    /// \details Every tile remembers, in a TileFootprint, the objects and materials its paths touched. An edit makes
+    /// stale the tiles that touched what it changed. An object that moved may also appear where it was never seen,
+    /// so the other tiles are first traced again with a single sample each to find where it is now. Effects of a moved
+    /// object that so few paths reach that one sample per pixel misses them are left out until the next full render
+    class IncrementalRenderer
+    {
+    public:
+        /// \brief Prepare to render a scene
+        /// \param[in] scene The world to render. It must outlive the renderer, and only change between calls
+        /// \param[in] camera The camera the world is seen through
+        /// \param[in] settings The size of the image and the number of samples
+        /// \param[in] tileSize The width and height of the square tiles that are rendered again as a whole
+        IncrementalRenderer(Scene& scene, Camera const& camera, RenderSettings const& settings, int tileSize = 32);
+
+        /// \brief Render every tile
+        void render();
+
+        /// \brief Bring the image up to date with edits made to the scene since the last call
+        /// \details The scene's hierarchy is refitted first if anything moved
+        /// \param[in] edits Everything that changed
+        /// \returns The number of tiles rendered again
+        std::size_t update(SceneEdits const& edits);
+
+        /// \brief Get the image as it is after the last call
+        Framebuffer const& framebuffer() const noexcept { return m_framebuffer; }
+
+        /// \brief Get the tiles the image is split into
+        std::vector<Tile> const& tiles() const noexcept { return m_tiles; }
+
+    private:
+        Scene& m_scene;
+        Camera m_camera;
+        RenderSettings m_settings;
+        std::vector<Tile> m_tiles;
+        std::vector<TileFootprint> m_footprints;    // One per tile
+        Framebuffer m_framebuffer;
+    };
+
+    /// \brief Edit the spheres of a scene's hierarchy as a stream of commands asks
+    /// \details Every line is "move <sphere> <dx> <dy> <dz>" or "paint <sphere> <red> <green> <blue>", where spheres
+    /// are numbered in the order the hierarchy holds its objects. Painting gives a sphere a new diffuse material.
+    /// Empty lines and lines starting with # are skipped
+    /// \param[inout] scene The scene. It must have an accelerator
+    /// \param[inout] in The commands
+    /// \returns What was changed
+    /// \throws std::runtime_error if a line cannot be read or does not name a sphere
+    SceneEdits applyEdits(Scene& scene, std::istream& in);
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef INTEGRATOR_HPP
+#define INTEGRATOR_HPP
+
+#include "Colour.hpp"
+#include "Ray.hpp"
+#include "Scene.hpp"
+
+namespace rt
+{
+    class TileFootprint;
+
+    /// \brief What a camera ray sees at its first hit, used to guide denoising
+    struct PathFeatures
+    {
+        Colour albedo;      // The surface colour, or the clamped background if the ray escapes
+        Vec3 normal;        // The shading normal, or zero if the ray escapes
+        double depth {};    // The distance to the hit along the ray, or infinity if the ray escapes
+    };
+
+    /// \brief Estimate the radiance arriving along a ray
+    /// \details Paths are extended by sampling the materials they hit. At every diffuse hit the scene's lights or its
+    /// environment are also sampled with a shadow ray, and both estimates are combined with multiple importance sampling
+    /// If the scene has a caustic map, diffuse hits also gather the light that mirror-like surfaces focus onto them,
+    /// and paths no longer pick that light up by reaching an emitter. Every emitter must then be one of the scene's lights
+    /// If the scene has a path guide, diffuse bounces are drawn from a mixture of the material and the guide, and while
+    /// the guide is learning every path records the light it found after each of its diffuse bounces
+    /// \param[in] ray The ray whose colour is to be computed
+    /// \param[in] scene The world, its lights, and its background
+    /// \param[in] maxDepth The maximum number of bounces along the path
+    /// \param[out] features If not null, receives what the ray sees at its first hit
+    /// \param[inout] footprint If not null, receives every object the path hits, the materials of those hits, and the
+    /// lights and the objects that its shadow rays meet
+    /// \returns An estimate of the radiance carried along @param ray
+    Colour rayColour(Ray const& ray, Scene const& scene, int maxDepth, PathFeatures* features = nullptr, TileFootprint* footprint = nullptr);
+
+    /// \brief Weight one of two sampling strategies with the power heuristic (beta = 2)
+    /// \param[in] pdf The density of the strategy that produced the sample
+    /// \param[in] otherPdf The density with which the other strategy would have produced it
+    /// \returns The weight of the sample, in [0, 1]
+    constexpr double powerHeuristic(double const pdf, double const otherPdf) noexcept
+    {
+        auto const a = pdf * pdf;
+        auto const b = otherPdf * otherPdf;
+
+        return (a + b) > 0 ? a / (a + b) : 0.0;
+    }
+}
+
+#endif
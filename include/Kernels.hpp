@@ -0,0 +1,80 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rt
+{
+    /// \brief The instruction sets the hot loops are compiled for, from the oldest up
+    enum class Isa { baseline, sse4, avx2, avx512 };
+
+    /// \brief Spheres stored one array per coordinate, so that several can be tested against a ray at once
+    struct SphereBatch
+    {
+        double const* x;
+        double const* y;
+        double const* z;
+        double const* radius;
+        std::size_t count;
+    };
+
+    /// \brief A ray as the kernels take it
+    struct KernelRay
+    {
+        double origin[3];
+        double direction[3];
+    };
+
+    /// \brief The loops that are compiled once for every instruction set, and picked between at run time
+    struct Kernels
+    {
+        /// \brief Find the sphere of the batch with the nearest hit in [tMin, tMax]
+        /// \returns The index of the sphere, or batch.count if the ray misses them all
+        std::size_t (*closestSphere)(SphereBatch const& batch, KernelRay const& ray, double tMin, double tMax);
+
+        /// \brief Determine whether any sphere of the batch is hit in [tMin, tMax]
+        bool (*anySphere)(SphereBatch const& batch, KernelRay const& ray, double tMin, double tMax);
+
+        /// \brief Turn summed linear colours into 8-bit values, gamma-corrected for gamma = 2.0 as toBytes() does
+        /// \param[in] values The red, green and blue components of every pixel
+        /// \param[in] count The number of components
+        /// \param[in] scale The inverse of the number of samples in each pixel
+        /// \param[out] bytes Receives count values
+        void (*encodePixels)(double const* values, std::size_t count, double scale, std::uint8_t* bytes);
+    };
+
+    /// \brief Get the fastest instruction set that both the processor and this build support
+    /// \details That is avx2 rather than avx512 where both are supported, as the avx512 copy renders more slowly
+    Isa detectIsa() noexcept;
+
+    /// \brief Determine whether this build has kernels for @param isa and the processor can run them
+    bool isSupported(Isa isa) noexcept;
+
+    /// \brief Use the kernels of @param isa from now on. Only call this before rendering starts
+    /// \throws std::invalid_argument if the instruction set is not supported
+    void selectIsa(Isa isa);
+
+    /// \brief Get the instruction set whose kernels are in use. detectIsa() until selectIsa() is called
+    Isa activeIsa() noexcept;
+
+    /// \brief Get the kernels of the active instruction set
+    Kernels const& kernels() noexcept;
+
+    /// \brief Get the kernels of a supported instruction set, whichever is active
+    Kernels const& kernels(Isa isa) noexcept;
+
+    /// \brief Get the name of an instruction set as the command line spells it
+    std::string isaName(Isa isa);
+
+    /// \brief Get the instruction set named @param name, as the command line spells it
+    /// \throws std::invalid_argument if the name is unknown
+    Isa parseIsa(std::string const& name);
+
+    /// \brief Get every instruction set the processor can run with this build, from the oldest up
+    std::vector<Isa> supportedIsas();
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef LAZY_BVH_HPP
+#define LAZY_BVH_HPP
+
+#include "Aabb.hpp"
+#include "Bvh.hpp"
+#include "Hittable.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rt
+{
+    /// \brief A bounding volume hierarchy that is only built where rays go
+    /// \details Only the top levels are split up front. Every other node is split, with the same heuristic as Bvh, by
+    /// the first ray that enters it, so parts of the world that no ray reaches cost nothing but their bounding boxes.
+    /// Several threads can trace at once: the first to reach a node claims it, and publishes the node's children with
+    /// a single atomic store once they are complete. Threads that reach it meanwhile wait for that store, and once it
+    /// is made nodes are read without synchronising
+    class LazyBvh : public Hittable
+    {
+    public:
+        /// \brief Prepare a hierarchy over @param objects, splitting only its top levels
+        explicit LazyBvh(std::vector<std::shared_ptr<Hittable>> objects);
+        ~LazyBvh() override;
+
+        LazyBvh(LazyBvh const&) = delete;
+        LazyBvh& operator=(LazyBvh const&) = delete;
+
+        /// \brief Find the closest hit, visiting the nearer child of every node first and splitting the nodes it enters
+        bool hit(Ray const& ray, double tMin, double tMax, HitRecord& record) const noexcept override;
+
+        /// \brief Determine whether anything blocks the ray, stopping at the first hit found
+        bool occluded(Ray const& ray, double tMin, double tMax) const noexcept override;
+
+        /// \brief Get the box around every object, if they are all bounded
+        bool boundingBox(Aabb& box) const noexcept override;
+
+        /// \brief Get the number of nodes built so far, counting the root
+        std::size_t builtNodes() const noexcept { return m_builtNodes.load(std::memory_order_relaxed); }
+
+        /// \brief Get the number of objects inside the tree
+        std::size_t objectCount() const noexcept { return m_objects.size(); }
+
+    private:
+        struct Node;
+        struct Children;
+
+        /// \brief Get the children of a node, splitting it if no ray has entered it before
+        /// \details Called while tracing, so running out of memory while splitting ends the program
+        /// \returns leafChildren() if the node is a leaf
+        Children const* expand(Node const& node) const;
+
+        /// \brief Divide the objects of a node between two new children
+        /// \returns leafChildren() if the objects are best kept together
+        Children const* split(Node const& node) const;
+
+        /// \brief Marks the nodes that are leaves
+        static Children const* leafChildren() noexcept;
+
+        std::vector<std::shared_ptr<Hittable>> m_objects;
+        std::vector<Hittable const*> m_primitives;      // The objects, without the reference counting
+        std::vector<std::shared_ptr<Hittable>> m_unbounded;
+
+        // Each node's range of these is reordered once, by the thread that splits it, before its children are published
+        mutable std::vector<Aabb> m_boxes;              // The bounds of the objects
+        mutable std::vector<std::size_t> m_order;       // The object of every box
+
+        std::unique_ptr<Node> m_root;
+        mutable std::atomic<std::size_t> m_builtNodes {0};
+    };
+}
+
+#endif
@@ -3,6 +3,9 @@
 
 #include "Common.hpp"
 #include "Colour.hpp"
+#include "Texture.hpp"
+
+#include <memory>
 
 namespace rt 
 {
@@ -24,6 +27,46 @@ namespace rt
         /// \returns True if a scattered ray was produced, false otherwise
         virtual bool scatter(Ray const& incidentRay, HitRecord const& record, Colour& attenuation, Ray& scattered) const = 0;
 
+        /// \brief Get the light emitted by the material at the point of intersection
+        /// \param[in] record A description of the ray-object intersection
+        /// \returns The emitted radiance. Non-emissive materials return black
+        virtual Colour emitted([[maybe_unused]] HitRecord const& record) const
+        {
+            return Colour(0, 0, 0);
+        }
+
+        /// \brief Determine whether the material can be evaluated for an arbitrary pair of directions
+        /// \details Only such materials take part in explicit light sampling. 
+        /// Mirror-like materials only scatter in directions that a light sample would never pick
+        virtual bool isDiffuse() const noexcept
+        {
+            return false;
+        }
+
+        /// \brief Evaluate the scattering function times the cosine term for light arriving from @param direction
+        /// \param[in] record A description of the ray-object intersection
+        /// \param[in] direction The unit direction towards the incoming light
+        /// \returns The fraction of the incoming light scattered towards the viewer
+        virtual Colour evaluate([[maybe_unused]] HitRecord const& record, [[maybe_unused]] Vec3 const& direction) const
+        {
+            return Colour(0, 0, 0);
+        }
+
+        /// \brief Get the solid-angle density with which scatter() picks @param direction
+        /// \param[in] record A description of the ray-object intersection
+        /// \param[in] direction The unit direction of the scattered ray
+        virtual double pdf([[maybe_unused]] HitRecord const& record, [[maybe_unused]] Vec3 const& direction) const
+        {
+            return 0.0;
+        }
+
+        /// \brief Get the surface colour at the hit point, without any lighting
+        /// \details This is only used as a guide for denoising. Materials that do not tint light are white
+        virtual Colour albedo([[maybe_unused]] HitRecord const& record) const
+        {
+            return Colour(1, 1, 1);
+        }
+
         virtual ~Material() = default;
     };
 
@@ -34,6 +77,10 @@ namespace rt
         /// \brief Create a lambertian material with the given attenuation
         /// \param[in] colour The attenuation of rays that intersect the lambertian material objects
         explicit Lambertian(Colour const& colour);
+
+        /// \brief Create a lambertian material whose attenuation varies over the surface
+        /// \param[in] albedo The texture that gives the attenuation at every point
+        explicit Lambertian(std::shared_ptr<Texture> albedo) noexcept;
         
         /// \brief Determine if a scattered ray is produced from the interaction of an incident ray with an object
         /// \param[in] incidentRay The incoming ray to the object
@@ -43,8 +90,18 @@ namespace rt
         /// \returns True if a scattered ray was produced, false otherwise
         bool scatter(Ray const& incidentRay, HitRecord const& record, Colour& attenuation, Ray& scattered) const override;
 
+        bool isDiffuse() const noexcept override { return true; }
+
+        /// \brief Evaluate albedo / pi * cos(theta) for light arriving from @param direction
+        Colour evaluate(HitRecord const& record, Vec3 const& direction) const override;
+
+        /// \brief Get the cosine-weighted density cos(theta) / pi of @param direction
+        double pdf(HitRecord const& record, Vec3 const& direction) const override;
+
+        Colour albedo(HitRecord const& record) const override;
+
     private:
-        Colour m_albedo;
+        std::shared_ptr<Texture> m_albedo;
     };
 
     /// \brief This class describes the properties of rays and objects with metal materials
@@ -53,7 +110,11 @@ namespace rt
     public:
         /// \brief Create a metallic material with the given albedo
         /// \param[in] albedo The attenuation of rays incident to the metallic object
-        explicit Metal(Colour const& albedo, double fuzziness) noexcept;
+        explicit Metal(Colour const& albedo, double fuzziness);
+
+        /// \brief Create a metallic material whose albedo varies over the surface
+        /// \param[in] albedo The texture that gives the attenuation at every point
+        explicit Metal(std::shared_ptr<Texture> albedo, double fuzziness) noexcept;
 
         /// \brief Determine if a scattered ray is produced from the interaction of an incident ray with an object
         /// \param[in] incidentRay The incoming ray to the object
@@ -63,8 +124,10 @@ namespace rt
         /// \returns True if a scattered ray was produced, false otherwise
         bool scatter(Ray const& incidentRay, HitRecord const& record, Colour& attenuation, Ray& scattered) const override;
 
+        Colour albedo(HitRecord const& record) const override;
+
     private:
-        Colour m_albedo;
+        std::shared_ptr<Texture> m_albedo;
         double m_fuzziness;
     };
 
@@ -91,6 +154,26 @@ namespace rt
         /// \returns The reflectance of the dielectric material
         static double getReflectance(double cosine, double refractiveIndex);
     };
+
+    /// \brief This class describes a surface that emits light but does not reflect any
+    class DiffuseLight : public Material
+    {
+    public:
+        /// \brief Create an emissive material
+        /// \param[in] emit The radiance emitted from the front face of the surface
+        explicit DiffuseLight(Colour const& emit) noexcept;
+
+        /// \brief Lights absorb every incident ray
+        /// \returns false
+        bool scatter(Ray const& incidentRay, HitRecord const& record, Colour& attenuation, Ray& scattered) const override;
+
+        /// \brief Get the radiance emitted towards the viewer
+        /// \returns The emitted radiance on the front face, black on the back face
+        Colour emitted(HitRecord const& record) const override;
+
+    private:
+        Colour m_emit;
+    };
 }
 
 #endif
\ No newline at end of file
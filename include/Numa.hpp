@@ -0,0 +1,93 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <sched.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace rt
+{
+    /// \brief How worker threads are placed on the processors
+    enum class Pinning
+    {
+        none,       // The operating system moves threads as it likes
+        compact,    // Fill the processors of one node before using the next
+        scatter     // Deal threads to the nodes in turn, so every node's memory bandwidth is used
+    };
+
+    /// \brief A memory node and the processors this process may run on in it
+    struct NumaNode
+    {
+        int id;                 // The operating system's number of the node
+        std::vector<int> cpus;
+    };
+
+    /// \brief Where one worker thread runs
+    struct WorkerPlace
+    {
+        int cpu;                // -1 if the thread is not pinned
+        std::size_t node;       // The index of its node in numaNodes()
+    };
+
+    /// \brief Get the nodes with processors this process may run on, read once from /sys/devices/system/node
+    /// \details A machine without that directory has a single node with every allowed processor
+    std::vector<NumaNode> const& numaNodes();
+
+    /// \brief Choose how the workers of parallelFor() are placed from now on
+    void setPinning(Pinning policy) noexcept;
+
+    /// \brief Get the placement of the workers
+    Pinning pinning() noexcept;
+
+    /// \brief Get the name of a policy, as parsePinning() reads it
+    std::string pinningName(Pinning policy);
+
+    /// \brief Read a policy from its name: none, compact or scatter
+    /// \throws std::invalid_argument if the name is unknown
+    Pinning parsePinning(std::string const& name);
+
+    /// \brief Get where a worker goes under the current policy
+    /// \param[in] threadIndex The number of the worker, from zero
+    WorkerPlace workerPlace(unsigned threadIndex);
+
+    /// \brief Get the index in numaNodes() of the node the calling thread is pinned to, or zero if it is not pinned
+    std::size_t currentNode() noexcept;
+
+    /// \brief Split [0, count) into one contiguous share per node, sized by the number of workers placed on it
+    /// \param[in] threads The number of workers, which must be positive
+    /// \returns The first index of every node's share, followed by count. Only one share, [0, count), when unpinned
+    std::vector<std::size_t> splitByNode(std::size_t count, unsigned threads);
+
+    /// \brief Move the pages of an array to the nodes whose workers handle its elements, as split by splitByNode()
+    /// \details Pages that straddle two shares stay where they are. Does nothing when unpinned
+    /// \param[in] data The first element
+    /// \param[in] elementBytes The size of an element
+    /// \param[in] split The shares of the elements
+    /// \returns false if the system refused to move the pages, now or in an earlier call, after which nothing is tried again
+    bool placeOnNodes(void const* data, std::size_t elementBytes, std::vector<std::size_t> const& split);
+
+    /// \brief Check whether the system has refused to move pages for placeOnNodes(), as it does where mbind is not allowed
+    bool placementRefused() noexcept;
+
+    /// \brief Pins the calling thread to a processor for its lifetime, and then lets it run where it did before
+    class ThreadPin
+    {
+    public:
+        /// \brief Pin the calling thread
+        /// \param[in] place Where to run. Nothing changes if its processor is -1
+        explicit ThreadPin(WorkerPlace const& place) noexcept;
+        ~ThreadPin();
+
+        ThreadPin(ThreadPin const&) = delete;
+        ThreadPin& operator=(ThreadPin const&) = delete;
+
+    private:
+        cpu_set_t m_previous {};
+        std::size_t m_previousNode {};
+        bool m_pinned {false};
+    };
+}
+
+#endif
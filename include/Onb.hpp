@@ -0,0 +1,40 @@
+#ifndef ONB_HPP
+#define ONB_HPP
+
+#include "Vec3.hpp"
+
+namespace rt
+{
+    /// \brief An orthonormal basis built around a single direction
+    class Onb
+    {
+    public:
+        /// \brief Build a basis whose w-axis points along @param n
+        /// \param[in] n The direction of the w-axis. It does not need to be normalised
+        explicit Onb(Vec3 const& n) noexcept;
+
+        /// \brief Get the first tangent axis
+        Vec3 u() const& noexcept { return m_u; }
+
+        /// \brief Get the second tangent axis
+        Vec3 v() const& noexcept { return m_v; }
+
+        /// \brief Get the axis the basis was built around
+        Vec3 w() const& noexcept { return m_w; }
+
+        /// \brief Transform a vector from basis coordinates to world coordinates
+        /// \param[in] a The coordinates of the vector in this basis
+        /// \returns The same vector expressed in world coordinates
+        Vec3 local(Vec3 const& a) const& noexcept
+        {
+            return (a.x() * m_u) + (a.y() * m_v) + (a.z() * m_w);
+        }
+
+    private:
+        Vec3 m_u;
+        Vec3 m_v;
+        Vec3 m_w;
+    };
+}
+
+#endif
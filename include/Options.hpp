@@ -0,0 +1,87 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace rt
+{
+    /// \brief Settings that can be changed from the command line
+    struct Options
+    {
+        std::string scene {"random"};   // The name of the scene to render
+        int width {1200};               // The width of the image. The height follows from the 3:2 aspect ratio
+        int samplesPerPixel {500};      // The number of samples averaged in every pixel
+        int maxDepth {50};              // The maximum number of bounces along a path
+        std::optional<std::uint32_t> seed;  // Seeds the random placement of the spheres. A random seed if not set
+        unsigned threads {0};           // The number of worker threads. Zero means one per core
+        std::string isa;                // The instruction set whose kernels to use. The best the processor has if empty
+        std::string pinning;            // How worker threads are pinned to processors: none, compact or scatter. None if empty
+        bool comparePinning {false};    // Render the image unpinned first, and report how much faster the pinned render is
+        double timeBudget {0.0};        // If positive, render as many samples as fit in this many seconds, up to samplesPerPixel
+
+        bool stream {false};            // Write bands of rows as they finish instead of holding the whole image
+        int bandHeight {16};            // The number of rows in a streamed band
+
+        bool serve {false};             // Keep the scene loaded and render jobs read from the standard input or a socket
+        std::string socketPath;         // If not empty, serve jobs from clients of this Unix domain socket
+
+        std::string previewFile;        // If not empty, refine previews into this PPM, restarting on cameras read from the standard input
+        std::string editsFile;          // If not empty, apply the edits in this file after rendering, and render again only the tiles they affect
+
+        int workers {0};                // The number of local worker processes to split the frame between
+        int listenPort {-1};            // If not negative, coordinate workers connecting to this TCP port. Zero picks a port
+        int tileSize {32};              // The size of the tiles handed to workers, or rendered again after edits
+        std::string workerAddress;      // If not empty, work for the coordinator at host:port instead of rendering a frame
+
+        std::string viewsFile;          // If not empty, render every view requested in this file, one per line
+        int turntableViews {0};         // If positive, render this many views around the scene
+        std::string viewsPrefix {"view-"};  // Views are written to <prefix><number>.ppm
+
+        int frames {0};                 // If positive, render this many frames of the scene's animation
+        double framesPerSecond {24.0};  // The time between frames is the inverse of this
+        std::string framesPrefix {"frame-"};    // Frames are written to <prefix><number>.ppm
+        double rebuildThreshold {1.5};  // Rebuild the hierarchy once refitting has made it this much more costly to trace
+
+        bool denoise {false};           // Filter the image before writing it
+        std::string featuresPrefix;     // If not empty, write the albedo, normal and depth buffers to <prefix>.<name>.pfm
+        std::string heatmapsPrefix;     // If not empty, write per-pixel cost heatmaps to <prefix>.<name>.ppm
+        std::string environment;        // An HDR environment map that replaces the scene's background, if not empty
+        double environmentScale {1.0};  // A factor applied to the brightness of the environment map
+        int photons {0};                // If positive, emit this many photons from the lights to gather caustics from
+        double causticRadius {0.05};    // The radius over which caustic photons are gathered
+        bool freeze {false};            // Compile the world into one immutable block of memory before rendering
+        bool replicateScene {false};    // Copy the frozen world to every memory node
+        bool lazyHierarchy {false};     // Split the hierarchy only where rays go
+        std::string hierarchyCache;     // If not empty, a directory where built hierarchies are kept for later runs of the same scene
+        bool guide {false};             // Learn where light comes from during the first passes and steer diffuse bounces towards it
+        double guideTraining {0.25};    // The share of the samples spent teaching the path guide
+        std::string texture;            // A tiled texture file for the large diffuse sphere, if not empty
+        int textureCacheMegabytes {256};// The memory budget of the texture tile cache
+
+        std::string statsFile;          // If not empty, write a JSON summary of the render statistics to this file at exit
+        std::string traceFile;          // If not empty, record a timeline of the render and write it to this file at exit
+
+        std::string golden;             // If not empty, fail unless the image is within goldenTolerance of this PPM
+        double goldenTolerance {0.02};  // The largest root mean square difference from the golden image, in [0, 1]
+        double baselineMrays {0.0};     // If positive, fail if rendering is slower than this by more than throughputTolerance
+        double throughputTolerance {0.2};   // The fraction of the baseline throughput that may be lost
+
+        std::string convertInput;       // If not empty, convert this image to a tiled texture instead of rendering
+        std::string convertOutput;      // The tiled texture file written by the conversion
+    };
+
+    /// \brief Parse the command line arguments
+    /// \param[in] argc The number of arguments, including the program name
+    /// \param[in] argv The arguments
+    /// \returns The options requested on the command line
+    /// \throws std::invalid_argument if an argument is unknown or malformed, or if options conflict
+    Options parseOptions(int argc, char const* const* argv);
+
+    /// \brief Get a description of the command line arguments
+    /// \param[in] programName The name the program was invoked with
+    std::string usage(std::string const& programName);
+}
+
+#endif
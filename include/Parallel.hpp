@@ -0,0 +1,104 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include "Numa.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace rt
+{
+    /// \brief Get the number of worker threads to use when none is requested
+    inline unsigned defaultThreadCount() noexcept
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    /// \brief Get the number of threads parallelFor() runs on
+    /// \param[in] count The number of indices
+    /// \param[in] threads The number of threads asked for. Zero means defaultThreadCount()
+    inline unsigned workerCount(std::size_t const count, unsigned const threads) noexcept
+    {
+        return static_cast<unsigned>(std::min<std::size_t>(threads > 0 ? threads : defaultThreadCount(), count));
+    }
+
+    /// \brief The order in which parallelFor() hands out indices when workers are pinned
+    enum class IndexOrder
+    {
+        byNode,     // Every node starts on its own share of the indices, as splitByNode() splits them
+        ascending   // From the first index up, whatever node the workers are on, for consumers that wait on earlier indices
+    };
+
+    /// \brief Run a function for every index in [0, count) on a number of threads
+    /// \details Indices are handed out one at a time from a shared counter, so uneven work balances itself.
+    /// The calling thread is one of the workers. When workers are pinned and the order is byNode, every node has a
+    /// counter over its own contiguous share of the indices, and its workers help the other nodes once it is done.
+    /// Memory placed with placeOnNodes() is then mostly touched by its own node
+    /// \param[in] count The number of indices
+    /// \param[in] threads The number of threads to run on. Zero means defaultThreadCount()
+    /// \param[in] order How indices are handed out to pinned workers
+    /// \param[in] function Called as function(index, threadIndex)
+    template <typename Function>
+    void parallelFor(std::size_t const count, unsigned threads, IndexOrder const order, Function&& function)
+    {
+        threads = workerCount(count, threads);
+
+        if (threads == 0) {
+            return;
+        }
+
+        /// \brief A counter on its own cache line
+        struct alignas(64) Counter
+        {
+            std::atomic<std::size_t> next;
+        };
+
+        auto const split = order == IndexOrder::byNode ? splitByNode(count, threads) : std::vector<std::size_t> {0, count};
+        auto const shares = split.size() - 1;
+        std::vector<Counter> counters(shares);
+
+        for (std::size_t share = 0; share < shares; ++share) {
+            counters[share].next = split[share];
+        }
+
+        auto const worker = [&](unsigned threadIndex) {
+            auto const place = workerPlace(threadIndex);
+            ThreadPin const pin(place);
+
+            for (std::size_t k = 0; k < shares; ++k) {
+                auto const share = (place.node + k) % shares;
+                auto& next = counters[share].next;
+
+                for (auto i = next++; i < split[share + 1]; i = next++) {
+                    function(i, threadIndex);
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+
+        for (unsigned t = 1; t < threads; ++t) {
+            pool.emplace_back(worker, t);
+        }
+
+        worker(0);
+
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+
+    /// \brief Run a function for every index in [0, count) on a number of threads, each node starting on its own share
+    template <typename Function>
+    void parallelFor(std::size_t const count, unsigned const threads, Function&& function)
+    {
+        parallelFor(count, threads, IndexOrder::byNode, std::forward<Function>(function));
+    }
+}
+
+#endif
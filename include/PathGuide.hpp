@@ -0,0 +1,145 @@
+#ifndef PATH_GUIDE_HPP
+#define PATH_GUIDE_HPP
+
+#include "Aabb.hpp"
+#include "Vec3.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rt
+{
+    /// \brief How the path guide learns and how much it is trusted
+    struct GuideSettings
+    {
+        double bsdfFraction {0.5};          // The probability of following the material instead of the guide
+        double trainingFraction {0.25};     // The share of the samples spent in learning passes
+        std::uint32_t splitSamples {4000};  // Split a region of space once a pass records this many paths in it
+        double subdivisionEnergy {0.01};    // Split a directional cell holding more than this fraction of a region's light
+        int maxDirectionalDepth {16};       // The deepest subdivision of the sphere of directions
+    };
+
+    /// \brief The light arriving at a point from every direction, as a quadtree over the sphere
+    /// \details Directions are mapped to the unit square by an equal-area cylindrical projection, and every node
+    /// stores the energy of its four quadrants. Recording only adds atomically, so any number of threads may record
+    /// into the same tree while its structure stays fixed
+    class DirectionalTree
+    {
+    public:
+        /// \brief Create a tree with one node and no energy
+        DirectionalTree();
+
+        DirectionalTree(DirectionalTree const& other);
+        DirectionalTree& operator=(DirectionalTree const& other);
+        DirectionalTree(DirectionalTree&& other) noexcept = default;
+        DirectionalTree& operator=(DirectionalTree&& other) noexcept = default;
+        ~DirectionalTree() = default;
+
+        /// \brief Add energy arriving from @param direction
+        /// \param[in] direction A unit direction
+        /// \param[in] value The energy to add. Non-positive values are ignored
+        void record(Vec3 const& direction, float value) noexcept;
+
+        /// \brief Get the energy recorded in the whole tree
+        double total() const noexcept;
+
+        /// \brief Pick a direction with probability proportional to the recorded energy
+        /// \param[out] pdf The solid-angle density of the returned direction
+        /// \returns A unit direction
+        Vec3 sample(double& pdf) const;
+
+        /// \brief Get the solid-angle density with which sample() picks @param direction
+        double pdf(Vec3 const& direction) const noexcept;
+
+        /// \brief Get a tree without energy, with cells split where this one has much energy and merged where it has little
+        /// \param[in] threshold Split a cell holding more than this fraction of the total energy
+        /// \param[in] maxDepth The deepest level of subdivision
+        DirectionalTree refined(double threshold, int maxDepth) const;
+
+        /// \brief Get the number of nodes
+        std::size_t size() const noexcept { return m_children.size() / 4; }
+
+    private:
+        std::vector<std::atomic<float>> m_energy;       // Four quadrants per node
+        std::vector<std::uint32_t> m_children;          // The node that splits each quadrant, or 0 if it is not split
+    };
+
+    /// \brief Learns where light comes from at every point of the scene, so that paths can be sent towards it
+    /// \details Space is split by a binary tree whose leaves are regions, each with two directional trees:
+    /// one that is sampled and one that learns. During a pass the structure is fixed and every thread records into
+    /// the learning trees without locks. Between passes, refine() splits busy regions and turns what was learned
+    /// into the new sampling distributions
+    class PathGuide
+    {
+    public:
+        /// \brief Create a guide with one region
+        /// \param[in] bounds The part of space to subdivide. Points outside it belong to the nearest region
+        /// \param[in] settings How the guide learns and is used
+        PathGuide(Aabb const& bounds, GuideSettings const& settings);
+
+        PathGuide(PathGuide const&) = delete;
+        PathGuide& operator=(PathGuide const&) = delete;
+
+        /// \brief Get the settings of the guide
+        GuideSettings const& settings() const noexcept { return m_settings; }
+
+        /// \brief Determine whether paths should record the light they find
+        bool isLearning() const noexcept { return m_learning; }
+
+        /// \brief Start or stop learning. Only call this between passes
+        void setLearning(bool learning) noexcept { m_learning = learning; }
+
+        /// \brief Find the region that holds @param point
+        std::uint32_t locate(Point3 const& point) const noexcept;
+
+        /// \brief Determine whether the region has learned anything to sample from
+        bool canSample(std::uint32_t region) const noexcept;
+
+        /// \brief Pick a direction in which the region has seen light
+        /// \param[out] pdf The solid-angle density of the returned direction
+        Vec3 sample(std::uint32_t region, double& pdf) const;
+
+        /// \brief Get the solid-angle density with which sample() picks @param direction in the region
+        double pdf(std::uint32_t region, Vec3 const& direction) const noexcept;
+
+        /// \brief Record light arriving in the region. Safe to call from any number of threads
+        /// \param[in] direction The unit direction towards where the light came from
+        /// \param[in] radiance The luminance of the light
+        /// \param[in] pdf The density with which the direction was sampled
+        void record(std::uint32_t region, Vec3 const& direction, double radiance, double pdf) noexcept;
+
+        /// \brief Split the regions that recorded many paths, and start sampling what the last pass learned
+        void refine();
+
+        /// \brief Get the number of regions
+        std::size_t regions() const noexcept { return m_regions.size(); }
+
+    private:
+        /// \brief A node of the spatial tree. Interior nodes have two children, split at the centre of their longest axis
+        struct SpatialNode
+        {
+            Aabb box;
+            std::uint32_t child {};     // The first of two consecutive children, or 0 for a leaf
+            std::uint32_t region {};    // The region of a leaf
+            std::uint8_t axis {};
+        };
+
+        /// \brief A leaf of the spatial tree
+        struct Region
+        {
+            DirectionalTree sampling;
+            DirectionalTree learning;
+            std::atomic<std::uint32_t> samples {0};
+        };
+
+        GuideSettings m_settings;
+        bool m_learning {false};
+        std::vector<SpatialNode> m_nodes;
+        std::vector<std::unique_ptr<Region>> m_regions;
+    };
+}
+
+#endif
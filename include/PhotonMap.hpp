@@ -0,0 +1,85 @@
+#ifndef PHOTON_MAP_HPP
+#define PHOTON_MAP_HPP
+
+#include "Colour.hpp"
+#include "Hittable.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rt
+{
+    struct Scene;
+
+    /// \brief Light that reached a diffuse surface after one or more mirror-like bounces
+    struct Photon
+    {
+        std::array<float, 3> position {};
+        std::array<float, 3> direction {};  // The unit direction in which the photon was travelling
+        std::array<float, 3> power {};      // The flux carried by the photon
+    };
+
+    /// \brief How the caustic photons are traced
+    struct PhotonSettings
+    {
+        std::size_t photons {};     // The number of photons emitted from the lights
+        double radius {0.05};       // The radius of the disc over which photons are gathered
+        int maxDepth {50};          // The maximum number of mirror-like bounces of a photon
+        unsigned threads {0};       // Zero means one per core
+        std::uint32_t seed {};      // Selects the photons. The same seed gives the same map, whatever the threads do
+    };
+
+    /// \brief Photons stored in a hash grid for fixed-radius density estimation
+    /// \details Cells are as wide as the gathering disc, so a lookup visits at most eight of them.
+    /// The photons of every bucket are contiguous, in the order in which they were traced
+    class PhotonMap
+    {
+    public:
+        PhotonMap() = default;
+
+        /// \brief Sort photons into the grid
+        /// \param[in] photons The photons to store
+        /// \param[in] radius The radius of the disc over which photons are gathered
+        /// \param[in] threads The number of threads that sort the photons. Zero means one per core
+        PhotonMap(std::vector<Photon> photons, double radius, unsigned threads);
+
+        /// \brief Estimate the radiance that a diffuse surface reflects from the stored photons
+        /// \details Photons are weighted with a cone filter. The surface is assumed to scatter like a Lambertian one,
+        /// which every diffuse material does
+        /// \param[in] record The diffuse hit, with its normal facing the viewer
+        /// \returns The reflected radiance, the same in every direction
+        Colour radiance(HitRecord const& record) const;
+
+        /// \brief Get the number of stored photons
+        std::size_t size() const noexcept { return m_photons.size(); }
+
+        /// \brief Get the radius of the disc over which photons are gathered
+        double radius() const noexcept { return m_radius; }
+
+    private:
+        /// \brief Get the bucket of the grid cell (x, y, z)
+        std::size_t bucket(std::int64_t x, std::int64_t y, std::int64_t z) const noexcept;
+
+        /// \brief Get the coordinate of the grid cell containing @param position along one axis
+        std::int64_t cell(double position) const noexcept;
+
+        std::vector<Photon> m_photons;              // Sorted by bucket
+        std::vector<std::uint32_t> m_bucketStart;   // The first photon of every bucket, and one past the last photon
+        double m_radius {};
+        double m_inverseCellSize {};
+        std::array<float, 3> m_lower {};            // The box around every photon
+        std::array<float, 3> m_upper {};
+    };
+
+    /// \brief Trace photons from the scene's lights and keep those that reach a diffuse surface through mirror-like bounces
+    /// \details Lights are picked in proportion to the power they emit. Photons that hit a diffuse surface first are
+    /// dropped, since direct light is already sampled by the integrator. Only objects that support sampleSurface() emit
+    /// \param[in] scene The world and its lights
+    /// \param[in] settings How many photons to trace, and how to store them
+    /// \returns The caustic photon map, empty if no light can emit photons
+    PhotonMap traceCaustics(Scene const& scene, PhotonSettings const& settings);
+}
+
+#endif
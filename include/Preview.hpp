@@ -0,0 +1,80 @@
+#ifndef PREVIEW_HPP
+#define PREVIEW_HPP
+
+#include "Camera.hpp"
+#include "Renderer.hpp"
+#include "Scene.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace rt
+{
+    /// \brief One refinement of a preview
+    struct PreviewStep
+    {
+        int scale;              // The image was rendered at 1 / scale of the width and of the height
+        int samplesPerPixel;    // The samples in every pixel so far at this scale
+        double seconds;         // The time since the camera was set
+        bool final;             // No more steps follow for this camera
+    };
+
+    /// \brief Renders a view coarse to fine, and starts again as soon as the camera moves
+    /// \details The first step renders a sixteenth of the pixels with one sample each, the second a quarter of them,
+    /// and every later step adds samples to the full image until it has as many as the settings ask for. Coarse steps
+    /// are enlarged to the full size, so every update is an image of the requested size. Moving the camera cancels the
+    /// tiles still being rendered and begins again with the coarsest step
+    class Preview
+    {
+    public:
+        /// \brief Called with the image after every step, from the thread that runs the preview
+        using Update = std::function<void(FloatImage const& image, PreviewStep const& step)>;
+
+        /// \brief Prepare a preview
+        /// \param[in] scene The world to render. It must outlive the preview
+        /// \param[in] settings The size of the full image and the samples it ends with
+        /// \param[in] camera Where the world is first seen from
+        /// \param[in] update Receives the image after every step
+        Preview(Scene const& scene, RenderSettings const& settings, CameraSettings const& camera, Update update);
+
+        Preview(Preview const&) = delete;
+        Preview& operator=(Preview const&) = delete;
+
+        /// \brief Move the camera, restarting the preview from its coarsest step. Safe to call from any thread
+        void setCamera(CameraSettings const& camera);
+
+        /// \brief Make run() return as soon as possible. Safe to call from any thread
+        void stop();
+
+        /// \brief Make run() return once the current camera has all its samples. Safe to call from any thread
+        void finish();
+
+        /// \brief Render steps until stop() is called, or the last step after finish(). Waits for a new camera while idle
+        void run();
+
+    private:
+        /// \brief Render every step for one camera, unless it is interrupted
+        /// \returns false if the camera changed or the preview was stopped before the last step
+        bool refine(CameraSettings const& camera);
+
+        Scene const& m_scene;
+        RenderSettings m_settings;
+        Update m_update;
+
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+        CameraSettings m_camera;        // Guarded by m_mutex
+        bool m_cameraSet {true};        // A camera is waiting to be rendered. Guarded by m_mutex
+        bool m_stopping {false};        // Guarded by m_mutex
+        bool m_finishing {false};       // Guarded by m_mutex
+        std::atomic<bool> m_interrupt {false};  // Cancels the tiles in progress
+
+        std::vector<float> m_image;     // The full-size image handed to updates
+        std::vector<float> m_pass;      // One step before it is enlarged or added to the image
+    };
+}
+
+#endif
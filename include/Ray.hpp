@@ -40,9 +40,44 @@ namespace rt
             return m_origin + (t * m_direction);
         }
 
+        /// \brief Attach the rays through the neighbouring pixels in x and y
+        /// \details The offset rays describe how the footprint of this ray grows with distance, 
+        /// which is what texture lookups use to choose a mip level
+        /// \param[in] rxOrigin, rxDirection The ray offset by one pixel in x
+        /// \param[in] ryOrigin, ryDirection The ray offset by one pixel in y
+        constexpr void setDifferentials(Point3 const& rxOrigin, Vec3 const& rxDirection, Point3 const& ryOrigin, Vec3 const& ryDirection) & noexcept
+        {
+            m_rxOrigin = rxOrigin;
+            m_rxDirection = rxDirection;
+            m_ryOrigin = ryOrigin;
+            m_ryDirection = ryDirection;
+            m_hasDifferentials = true;
+        }
+
+        /// \brief Determine whether the offset rays have been set
+        constexpr bool hasDifferentials() const& noexcept { return m_hasDifferentials; }
+
+        /// \brief Get the origin of the ray offset by one pixel in x
+        constexpr Point3 getRxOrigin() const& noexcept { return m_rxOrigin; }
+
+        /// \brief Get the direction of the ray offset by one pixel in x
+        constexpr Vec3 getRxDirection() const& noexcept { return m_rxDirection; }
+
+        /// \brief Get the origin of the ray offset by one pixel in y
+        constexpr Point3 getRyOrigin() const& noexcept { return m_ryOrigin; }
+
+        /// \brief Get the direction of the ray offset by one pixel in y
+        constexpr Vec3 getRyDirection() const& noexcept { return m_ryDirection; }
+
     private:
         Point3 m_origin;
         Vec3 m_direction;
+
+        Point3 m_rxOrigin;
+        Vec3 m_rxDirection;
+        Point3 m_ryOrigin;
+        Vec3 m_ryDirection;
+        bool m_hasDifferentials {false};
     };
 }
 
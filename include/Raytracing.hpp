@@ -0,0 +1,25 @@
+#ifndef RAYTRACING_HPP
+#define RAYTRACING_HPP
+
+// Everything a program embedding the raytracing library needs. A scene is built from spheres and materials, given
+// a hierarchy with buildHierarchy(), and rendered straight into the caller's memory:
+//
+//     rt::Scene scene;
+//     scene.world.add(std::make_shared<rt::Sphere>(rt::Point3(0, 0, -1), 0.5, std::make_shared<rt::Lambertian>(rt::Colour(0.5, 0.5, 0.5))));
+//     rt::buildHierarchy(scene);
+//
+//     std::vector<float> pixels(3 * width * height);
+//     rt::render(scene, rt::Camera(cameraSettings, aspectRatio), settings, rt::FloatImage {pixels.data(), width, height, 3u * width}, progress);
+
+#include "Camera.hpp"
+#include "Environment.hpp"
+#include "FrozenScene.hpp"
+#include "IncrementalRenderer.hpp"
+#include "Material.hpp"
+#include "Preview.hpp"
+#include "Renderer.hpp"
+#include "Scene.hpp"
+#include "Sphere.hpp"
+#include "Texture.hpp"
+
+#endif
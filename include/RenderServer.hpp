@@ -0,0 +1,65 @@
+#ifndef RENDER_SERVER_HPP
+#define RENDER_SERVER_HPP
+
+#include "Camera.hpp"
+#include "Renderer.hpp"
+#include "Scene.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace rt
+{
+    /// \brief The largest width or height that serve renders, which bounds the rows held while a band is written
+    constexpr int maxServedSide = 16384;
+
+    /// \brief The most pixels that serve renders for one request
+    constexpr std::int64_t maxServedPixels = std::int64_t {8192} * 8192;
+
+    /// \brief The most samples that serve takes for one request, over all of its pixels
+    constexpr std::int64_t maxServedSamples = std::int64_t {1} << 32;
+
+    /// \brief Parse a render request
+    /// \details A request is the word "render" followed by any of the fields width=<n> height=<n> spp=<n> depth=<n>
+    /// from=<x,y,z> at=<x,y,z> up=<x,y,z> fov=<degrees> aperture=<x> focus=<distance>, separated by spaces.
+    /// Fields that are left out keep their default. If the width is given without the height, the default aspect ratio is kept
+    /// \param[in] line The request
+    /// \param[in] defaults The job that the fields modify
+    /// \returns The requested job
+    /// \throws std::invalid_argument if the request is malformed
+    RenderJob parseRenderJob(std::string_view line, RenderJob const& defaults);
+
+    /// \brief Write a job as a request that parseRenderJob reads back exactly
+    std::string formatRenderJob(RenderJob const& job);
+
+    /// \brief Read render requests, one per line. Empty lines and lines starting with '#' are skipped
+    /// \param[inout] in The requests
+    /// \param[in] defaults The job that the fields of every request modify
+    /// \returns The requested jobs, in order
+    /// \throws std::invalid_argument if a request is malformed
+    std::vector<RenderJob> readRenderJobs(std::istream& in, RenderJob const& defaults);
+
+    /// \brief Render jobs read one per line until the input ends or a line says "quit"
+    /// \details Every job is answered with a binary PPM (P6) whose rows are written as they finish, or with a line
+    /// "error <message>" if the request is malformed or larger than maxServedSide, maxServedPixels or maxServedSamples allow.
+    /// A job that fails while rendering is answered with an error line too, after whatever part of its image was already written.
+    /// The scene and everything built for it stay loaded between jobs. Empty lines and lines starting with '#' are ignored
+    /// \param[in] scene The world every job renders
+    /// \param[in] defaults The job that requests modify
+    /// \param[inout] in The requests
+    /// \param[inout] out Receives the images
+    /// \returns true if the last line said "shutdown"
+    bool serve(Scene const& scene, RenderJob const& defaults, std::istream& in, std::ostream& out);
+
+    /// \brief Serve clients connecting to a Unix domain socket, one at a time, until a client says "shutdown"
+    /// \param[in] scene The world every job renders
+    /// \param[in] defaults The job that requests modify
+    /// \param[in] path The file system path of the socket. An existing file there is replaced
+    /// \throws std::runtime_error if the socket cannot be created
+    void serveSocket(Scene const& scene, RenderJob const& defaults, std::string const& path);
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include "BandWriter.hpp"
+#include "Camera.hpp"
+#include "Framebuffer.hpp"
+#include "Scene.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace rt
+{
+    class TileFootprint;
+
+    /// \brief How an image is sampled
+    struct RenderSettings
+    {
+        int width {1200};
+        int height {800};
+        int samplesPerPixel {500};
+        int maxDepth {50};
+        unsigned threads {0};       // Zero means one per core
+        bool showProgress {true};   // Count down the remaining rows on the standard error stream
+        bool recordCost {false};    // Fill the cost buffer of the framebuffer. Only rendering into a framebuffer records it
+        std::uint32_t seed {};      // Selects the samples. The same seed gives the same image, whatever the threads do, except
+                                    // with a path guide, which sums what it learns in the order threads get there: then only on one thread
+    };
+
+    /// \brief One image of a scene: where it is seen from and how it is sampled
+    struct RenderJob
+    {
+        CameraSettings camera;
+        RenderSettings settings;
+    };
+
+    /// \brief A rectangle of pixels [x0, x1) x [y0, y1), with rows counted from the top
+    struct Tile
+    {
+        int index;
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+
+        /// \brief Get the number of pixels in the tile
+        int area() const noexcept
+        {
+            return (x1 - x0) * (y1 - y0);
+        }
+    };
+
+    /// \brief An image owned by the caller, which a render writes into directly
+    struct FloatImage
+    {
+        float* pixels;              // Red, green and blue of every pixel, as linear means of the samples
+        int width;
+        int height;
+        std::size_t rowStride;      // The number of floats from the start of one row to the next, at least 3 * width
+    };
+
+    /// \brief How a render into a caller's image is split into tiles, reports them, and is stopped
+    struct TileProgress
+    {
+        int tileSize {32};          // The width and height of the square tiles the image is split into
+        std::function<void(Tile const& tile, int tilesDone, int tileCount)> tileDone;  // Called after every tile, one call at a time
+        std::atomic<bool> const* cancel {nullptr};     // If set, tiles not started once it becomes true are skipped
+    };
+
+    /// \brief Render an image into a caller's buffer, tile by tile
+    /// \details Every thread renders whole tiles, which are written to the image as soon as they are done. Calls of
+    /// tileDone come from the worker threads but never overlap, so they may touch the image and the caller's own state.
+    /// The scene's path guide is not trained by this render, and costs are not recorded
+    /// \param[in] scene The world to render
+    /// \param[in] camera The camera the world is seen through
+    /// \param[in] settings The size of the image and the number of samples
+    /// \param[out] image Receives the mean colour of every pixel. It must be settings.width x settings.height
+    /// \param[in] progress The size of the tiles, what to call after each, and when to stop
+    /// \returns false if the render was cancelled, leaving unfinished tiles partly or not at all written
+    bool render(Scene const& scene, Camera const& camera, RenderSettings const& settings, FloatImage const& image, TileProgress const& progress);
+
+    /// \brief Render an image into a framebuffer, together with its first-hit feature buffers
+    /// \details Rows are shared between the worker threads. If the scene has a path guide, the first passes teach it
+    /// where light comes from and the rest of the samples are guided by it. The costs of pixels are not recorded then
+    /// \param[in] scene The world to render
+    /// \param[in] camera The camera the world is seen through
+    /// \param[in] settings The size of the image and the number of samples
+    /// \param[out] framebuffer Receives the summed samples and the mean features. It must be settings.width x settings.height
+    void render(Scene const& scene, Camera const& camera, RenderSettings const& settings, Framebuffer& framebuffer);
+
+    /// \brief Render as many samples per pixel as fit before a deadline
+    /// \details A first pass of one sample per pixel measures the throughput. Each later pass is sized to take about half
+    /// of the time left, using the time per sample of the pass before, so that an estimate that is off still leaves room
+    /// for a smaller pass. Rendering stops once not even two more samples per pixel would fit
+    /// \param[in] scene The world to render
+    /// \param[in] camera The camera the world is seen through
+    /// \param[in] settings The size of the image. samplesPerPixel is an upper limit. Costs are not recorded
+    /// \param[in] deadline When the image must be finished. At least one sample per pixel is rendered even if it is past
+    /// \param[out] framebuffer Receives the summed samples and the mean features. It must be settings.width x settings.height
+    /// \returns The number of samples per pixel rendered
+    int render(Scene const& scene, Camera const& camera, RenderSettings const& settings, std::chrono::steady_clock::time_point deadline, Framebuffer& framebuffer);
+
+    /// \brief Render an image without holding all of it, handing the mean colour of every row to a band writer
+    /// \details Rows are started from the top, even when workers are pinned, so bands finish roughly in order and rarely
+    /// wait for the window to move
+    /// \param[in] scene The world to render
+    /// \param[in] camera The camera the world is seen through
+    /// \param[in] settings The size of the image and the number of samples
+    /// \param[inout] writer Receives the rows. It must be for a settings.width x settings.height image
+    void render(Scene const& scene, Camera const& camera, RenderSettings const& settings, BandWriter& writer);
+
+    /// \brief Render several views of one scene with a single pool of threads
+    /// \details The rows of every view are queued together, so threads move on to the next view while the last rows of
+    /// the previous one finish, and no thread waits at the end of each view. Each view is handed over as soon as its
+    /// last row is done, so only the views in progress are held in memory. The threads and the progress display follow
+    /// the settings of the first view
+    /// \param[in] scene The world to render
+    /// \param[in] views The cameras and images
+    /// \param[in] finished Called with the index of a view and its framebuffer once the view is done. Calls may come from
+    /// any of the threads, and more than one at a time
+    void renderViews(Scene const& scene, std::vector<RenderJob> const& views, std::function<void(std::size_t, Framebuffer&)> const& finished);
+
+    /// \brief Render one tile of an image, sharing its rows between the worker threads
+    /// \param[in] scene The world to render
+    /// \param[in] camera The camera the world is seen through
+    /// \param[in] settings The size of the whole image and the number of samples
+    /// \param[in] tile The pixels to render
+    /// \param[out] colour Receives the sum of the samples of every pixel of the tile, row by row from the top
+    void renderTile(Scene const& scene, Camera const& camera, RenderSettings const& settings, Tile const& tile, std::vector<Colour>& colour);
+
+    /// \brief Render some tiles of an image, each by a single thread, and record what the paths through every tile touched
+    /// \details The samples of a pixel are the same as a whole render's, so tiles rendered again after the scene has
+    /// changed fit in with the ones kept. The scene's path guide is not trained, and costs are not recorded
+    /// \param[in] scene The world to render
+    /// \param[in] camera The camera the world is seen through
+    /// \param[in] settings The size of the whole image and the number of samples
+    /// \param[in] tiles The tiles to render
+    /// \param[out] framebuffer If not null, receives the samples and the features of the tiles' pixels, replacing what
+    /// they held. Pixels outside the tiles are left alone. It must be settings.width x settings.height
+    /// \param[out] footprints The footprint of every tile is cleared and then filled in, at the tile's index
+    void renderTiles(Scene const& scene, Camera const& camera, RenderSettings const& settings, std::vector<Tile> const& tiles, Framebuffer* framebuffer,
+                     std::vector<TileFootprint>& footprints);
+}
+
+#endif
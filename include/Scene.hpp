@@ -0,0 +1,91 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include "Animation.hpp"
+#include "Bvh.hpp"
+#include "Environment.hpp"
+#include "HittableList.hpp"
+#include "Texture.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace rt
+{
+    class PathGuide;
+    class PhotonMap;
+
+    /// \brief Everything needed to build the same scene again, in this process or another one
+    struct SceneDescription
+    {
+        std::string name {"random"};        // One of the predefined scenes
+        std::uint32_t seed {};              // Seeds the random placement of the spheres
+        std::string texture;                // A tiled texture file for the large diffuse sphere, if not empty
+        std::string environment;            // An HDR environment map that replaces the background, if not empty
+        double environmentScale {1.0};      // A factor applied to the brightness of the environment map
+        bool lazyHierarchy {false};         // Split the hierarchy only where rays go, instead of all at once
+        std::string hierarchyCache;         // A directory to load the built hierarchy from, or save it to, if not empty. Not sent to workers
+    };
+
+    /// \brief Everything the integrator needs to know about the world being rendered
+    struct Scene
+    {
+        HittableList world;     // Every object that a ray can hit
+        HittableList lights;    // Emissive objects that are sampled explicitly. Each of them must also be part of the world
+        std::shared_ptr<Environment const> environment;     // Light arriving from outside the scene. Null means black
+        std::shared_ptr<Bvh> accelerator;   // The hierarchy over the world's objects. Update it after moving them. Null if it is lazy
+        Animation animation;                // Moves objects of the world over time. Empty for still scenes
+        std::shared_ptr<PhotonMap const> caustics;  // Light focused onto diffuse surfaces by mirror-like ones. Null to path trace it
+        std::shared_ptr<PathGuide> guide;   // Learns where light comes from and steers diffuse bounces towards it. Null to follow the materials
+    };
+
+    /// \brief Generate lots of random spheres lit by the sky
+    /// \param[in] featureTexture If not null, the albedo of the large diffuse sphere
+    /// \returns The final scene from Ray Tracing in One Weekend
+    Scene randomScene(std::shared_ptr<Texture> const& featureTexture = nullptr);
+
+    /// \brief Generate random spheres in the dark, lit only by a few small emissive spheres
+    /// \param[in] featureTexture If not null, the albedo of the large diffuse sphere
+    /// \returns A scene where paths rarely reach a light by chance
+    Scene smallLightsScene(std::shared_ptr<Texture> const& featureTexture = nullptr);
+
+    /// \brief Generate the random spheres, with some of the small diffuse ones bouncing and drifting across the ground
+    /// \param[in] featureTexture If not null, the albedo of the large diffuse sphere
+    /// \returns A scene whose hierarchy degrades as the spheres move away from where it was built
+    Scene bouncingScene(std::shared_ptr<Texture> const& featureTexture = nullptr);
+
+    /// \brief Generate the random spheres in the middle of a field of a million small ones that reaches the horizon
+    /// \param[in] featureTexture If not null, the albedo of the large diffuse sphere
+    /// \returns A world far larger than the part of it the camera sees
+    Scene sprawlScene(std::shared_ptr<Texture> const& featureTexture = nullptr);
+
+    /// \brief Put the objects of a scene's world into a hierarchy, so that rays do not test every one of them
+    /// \details Scenes built by hand call this once all their objects have been added to the world. The first
+    /// objects can be kept out of the hierarchy: a ground much larger than everything else would only fill its root box
+    /// \param[inout] scene The scene. Its world is replaced by the objects kept out followed by the hierarchy
+    /// \param[in] keepOut The number of objects at the start of the world that are tested against every ray instead
+    /// \param[in] lazy Use a LazyBvh, which is only split where rays go. The scene then has no accelerator to update
+    /// \param[in] cacheDirectory If not empty, load the hierarchy built for the same objects from this directory, or save
+    /// it there once built. Lazy hierarchies are never cached
+    void buildHierarchy(Scene& scene, std::size_t keepOut = 0, bool lazy = false, std::string const& cacheDirectory = {});
+
+    /// \brief Build one of the predefined scenes by name, with a hierarchy over its objects
+    /// \param[in] name One of "random", "lights", "bouncing" or "sprawl"
+    /// \param[in] texturePath If not empty, a tiled texture file to put on the large diffuse sphere
+    /// \param[in] lazyHierarchy Split the hierarchy only where rays go
+    /// \param[in] hierarchyCache If not empty, a directory to load the hierarchy from, or save it to once built
+    /// \returns The requested scene
+    /// \throws std::invalid_argument if there is no scene called @param name
+    /// \throws std::runtime_error if the texture cannot be opened
+    Scene makeScene(std::string const& name, std::string const& texturePath = {}, bool lazyHierarchy = false, std::string const& hierarchyCache = {});
+
+    /// \brief Build a scene from its description. The random sequence of the calling thread is reseeded
+    /// \param[in] description The scene, its seed and the files it uses
+    /// \returns The described scene
+    /// \throws std::invalid_argument if there is no scene with the described name
+    /// \throws std::runtime_error if the texture or the environment map cannot be loaded
+    Scene makeScene(SceneDescription const& description);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SOCKET_HPP
+#define SOCKET_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rt
+{
+    /// \brief A connected or listening socket, closed when it goes out of scope
+    class Socket
+    {
+    public:
+        Socket() noexcept = default;
+
+        /// \brief Take ownership of an open file descriptor
+        explicit Socket(int fd) noexcept;
+
+        Socket(Socket&& other) noexcept;
+        Socket& operator=(Socket&& other) noexcept;
+
+        Socket(Socket const&) = delete;
+        Socket& operator=(Socket const&) = delete;
+
+        ~Socket();
+
+        /// \brief Get the file descriptor, or -1 if there is none
+        int fd() const noexcept
+        {
+            return m_fd;
+        }
+
+        /// \brief Check if the socket is open
+        bool valid() const noexcept
+        {
+            return m_fd >= 0;
+        }
+
+        /// \brief Send every byte of a buffer
+        /// \throws std::runtime_error if the peer has gone
+        void sendAll(void const* data, std::size_t size) const;
+
+        /// \brief Receive exactly @param size bytes
+        /// \returns false if the peer closed the connection cleanly before the first byte
+        /// \throws std::runtime_error if the connection fails, closes part way through, or the receive timeout passes
+        bool receiveAll(void* data, std::size_t size) const;
+
+        /// \brief Make every wait for data that lasts longer than @param timeout fail. Zero waits forever
+        /// \throws std::runtime_error if the timeout cannot be set
+        void setReceiveTimeout(std::chrono::milliseconds timeout) const;
+
+        /// \brief Stop all communication, waking any thread blocked on the socket. The descriptor stays open
+        void shutdown() const noexcept;
+
+    private:
+        int m_fd {-1};
+    };
+
+    /// \brief Listen on a Unix domain socket
+    /// \param[in] path The file system path of the socket. An existing file there is replaced
+    /// \throws std::runtime_error if the socket cannot be created
+    Socket listenUnix(std::string const& path);
+
+    /// \brief Listen for TCP connections on every interface
+    /// \param[in] port The port to listen on. Zero lets the system choose one
+    /// \throws std::runtime_error if the socket cannot be created
+    Socket listenTcp(std::uint16_t port);
+
+    /// \brief Get the TCP port a socket is bound to
+    std::uint16_t localPort(Socket const& socket);
+
+    /// \brief Wait for a connection
+    /// \returns The connection, or an invalid socket if the listener was shut down
+    /// \throws std::runtime_error if accepting fails for another reason
+    Socket acceptConnection(Socket const& listener);
+
+    /// \brief Connect to a TCP server
+    /// \param[in] address The server as host:port
+    /// \throws std::runtime_error if the address is malformed or the connection fails
+    Socket connectTcp(std::string const& address);
+}
+
+#endif
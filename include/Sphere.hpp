@@ -5,6 +5,7 @@
 #include "Vec3.hpp"
 
 #include <memory>
+#include <utility>
 
 namespace rt
 {
@@ -30,7 +31,60 @@ namespace rt
         /// \returns false otherwise
         bool hit(Ray const& ray, double tMin, double tMax, HitRecord& record) const noexcept override;
 
+        /// \brief Determine whether the ray hits the sphere without computing the hit point or normal
+        bool occluded(Ray const& ray, double tMin, double tMax) const noexcept override;
+
+        /// \brief Get the box around the sphere
+        bool boundingBox(Aabb& box) const noexcept override;
+
+        /// \brief Get the density of sampling @param direction from @param origin with random()
+        /// \details Directions are sampled uniformly inside the cone subtended by the sphere
+        double pdfValue(Point3 const& origin, Vec3 const& direction) const override;
+
+        /// \brief Pick a random direction from @param origin that points at the sphere
+        Vec3 random(Point3 const& origin) const override;
+
+        double area() const noexcept override;
+
+        /// \brief Pick a point uniformly over the sphere
+        void sampleSurface(HitRecord& record) const override;
+
+        /// \brief Get the center of the sphere
+        Point3 const& center() const noexcept { return m_center; }
+
+        /// \brief Get the radius of the sphere
+        double radius() const noexcept { return m_radius; }
+
+        /// \brief Get the material of the sphere
+        std::shared_ptr<Material> const& material() const noexcept { return m_materialPtr; }
+
+        /// \brief Move the sphere to @param center. Hierarchies over it must be refitted before the next render
+        void setCenter(Point3 const& center) & noexcept { m_center = center; }
+
+        /// \brief Give the sphere another material. It must not change while a frame is being rendered
+        void setMaterial(std::shared_ptr<Material> material) & noexcept { m_materialPtr = std::move(material); }
+
+        /// \brief Find where a ray first meets a sphere, without counting the test
+        /// \param[in] center, radius The sphere
+        /// \param[in] ray The ray under investigation
+        /// \param[in] tMin, tMax The acceptable range of t-values
+        /// \param[out] t The nearest t-value in range at which the ray meets the sphere
+        /// \returns true if the ray meets the sphere in range
+        static bool intersect(Point3 const& center, double radius, Ray const& ray, double tMin, double tMax, double& t) noexcept;
+
+        /// \brief Fill in everything about a ray meeting a sphere at @param t but its material
+        /// \param[in] center, radius The sphere
+        /// \param[in] ray The ray that meets the sphere
+        /// \param[out] record The record of the hit
+        static void fillHit(Point3 const& center, double radius, Ray const& ray, double t, HitRecord& record) noexcept;
+
     private:
+        /// \brief Fill in the (u, v) coordinates of a hit point and their derivatives
+        /// \param[in] n The outward unit normal at the hit point
+        /// \param[in] radius The radius of the sphere
+        /// \param[inout] record The record of the hit
+        static void setSurfaceCoordinates(Vec3 const& n, double radius, HitRecord& record) noexcept;
+
         Point3 m_center {};
         double m_radius {};
         std::shared_ptr<Material> m_materialPtr;
@@ -0,0 +1,139 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include "Trace.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rt
+{
+    /// \brief The kinds of primitive that rays are tested against
+    enum class PrimitiveKind : std::size_t { sphere, count };
+
+    /// \brief The kinds of material a path can scatter off
+    enum class MaterialKind : std::size_t { lambertian, metal, dielectric, light, count };
+
+    /// \brief A counter written by one thread and read by any
+    /// \details Increments are a plain load and store rather than a locked read-modify-write, which is safe because only
+    /// the owning thread writes, and cheap enough for the innermost loops
+    class StatCounter
+    {
+    public:
+        /// \brief Add @param n to the counter. Only the owning thread may call this
+        void add(std::uint64_t const n = 1) noexcept
+        {
+            m_value.store(m_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        /// \brief Get the current count
+        std::uint64_t value() const noexcept
+        {
+            return m_value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::uint64_t> m_value {};
+    };
+
+    /// \brief The longest path length counted separately. Longer paths share the last bin of the histogram
+    inline constexpr std::size_t maxCountedPathLength = 64;
+
+    /// \brief The counters of one thread
+    struct ThreadStatistics
+    {
+        StatCounter primaryRays;    // Rays leaving the camera
+        StatCounter secondaryRays;  // Rays scattered off a surface
+        StatCounter shadowRays;     // Visibility tests towards sampled lights
+        StatCounter nodeVisits;     // Hierarchy nodes whose box was tested
+        std::array<StatCounter, static_cast<std::size_t>(PrimitiveKind::count)> intersectionTests;
+        std::array<StatCounter, static_cast<std::size_t>(MaterialKind::count)> scatterEvents;
+        std::array<StatCounter, maxCountedPathLength + 1> pathLengths;  // Paths by their number of segments
+    };
+
+    namespace detail
+    {
+        /// \brief The calling thread's counters, or null before its first count
+        /// \details A constant-initialised pointer is read straight from thread-local storage, without the call through
+        /// an initialisation wrapper that a thread_local object with a constructor would need on every access
+        inline thread_local ThreadStatistics* threadStatistics = nullptr;
+
+        /// \brief Create and register the counters of the calling thread
+        ThreadStatistics& registerThread();
+    }
+
+    /// \brief Get the counters of the calling thread
+    /// \details They are created on first use and merged into the totals when the thread exits
+    inline ThreadStatistics& threadStatistics() noexcept
+    {
+        auto* const stats = detail::threadStatistics;
+        return stats ? *stats : detail::registerThread();
+    }
+
+    /// \brief Count one test of a ray against a primitive of kind @param kind
+    inline void countIntersectionTest(PrimitiveKind const kind) noexcept
+    {
+        threadStatistics().intersectionTests[static_cast<std::size_t>(kind)].add();
+    }
+
+    /// \brief Count one path meeting a material of kind @param kind
+    inline void countScatter(MaterialKind const kind) noexcept
+    {
+        threadStatistics().scatterEvents[static_cast<std::size_t>(kind)].add();
+    }
+
+    /// \brief The counters of every thread added together, and the time spent in each phase
+    struct StatisticsSummary
+    {
+        std::uint64_t primaryRays {};
+        std::uint64_t secondaryRays {};
+        std::uint64_t shadowRays {};
+        std::uint64_t nodeVisits {};
+        std::array<std::uint64_t, static_cast<std::size_t>(PrimitiveKind::count)> intersectionTests {};
+        std::array<std::uint64_t, static_cast<std::size_t>(MaterialKind::count)> scatterEvents {};
+        std::array<std::uint64_t, maxCountedPathLength + 1> pathLengths {};
+        std::vector<std::pair<std::string, double>> phaseSeconds;   // In the order the phases were first entered
+        double elapsedSeconds {};   // Since the process started counting
+        std::string isa;            // The instruction set whose kernels were in use
+
+        /// \brief Get the number of rays of every kind
+        std::uint64_t rays() const noexcept { return primaryRays + secondaryRays + shadowRays; }
+    };
+
+    /// \brief Add up the counters of every thread, including those that have finished
+    /// \details Threads still running are read while they count, so their share may be slightly out of date
+    StatisticsSummary collectStatistics();
+
+    /// \brief Write @param summary as a JSON object
+    void writeStatisticsJson(std::ostream& out, StatisticsSummary const& summary);
+
+    /// \brief Adds the time between its construction and destruction to a named phase
+    /// \details Phases may nest, and a phase entered several times accumulates. Each phase counts its own wall time,
+    /// so the phases of nested timers overlap. Each phase is also a span of the trace, if tracing is enabled
+    class PhaseTimer
+    {
+    public:
+        /// \brief Start timing @param phase, whose name must live until the trace is written
+        explicit PhaseTimer(char const* phase);
+
+        /// \brief Stop timing and add the time to the phase
+        ~PhaseTimer();
+
+        PhaseTimer(PhaseTimer const&) = delete;
+        PhaseTimer& operator=(PhaseTimer const&) = delete;
+
+    private:
+        char const* m_phase;
+        std::chrono::steady_clock::time_point m_start;
+        TraceScope m_span;
+    };
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TEXTURE_HPP
+#define TEXTURE_HPP
+
+#include "Colour.hpp"
+#include "TextureCache.hpp"
+#include "TiledImage.hpp"
+
+#include <memory>
+#include <string>
+
+namespace rt
+{
+    struct HitRecord;
+
+    /// \brief A colour that varies over the surface of an object
+    class Texture
+    {
+    public:
+        virtual ~Texture() = default;
+
+        /// \brief Get the colour of the texture at a hit point
+        /// \param[in] record The hit, with its surface coordinates and, if known, their screen-space derivatives
+        virtual Colour value(HitRecord const& record) const = 0;
+    };
+
+    /// \brief A texture with the same colour everywhere
+    class SolidColour : public Texture
+    {
+    public:
+        explicit SolidColour(Colour const& colour) noexcept;
+
+        Colour value(HitRecord const& record) const override;
+
+    private:
+        Colour m_colour;
+    };
+
+    /// \brief A texture backed by a tiled, mip-mapped texture file
+    /// \details Tiles are fetched through a TextureCache, so only the tiles that rays actually touch are ever in memory.
+    /// The mip level is chosen from the (u, v) footprint of the ray differentials and filtered trilinearly
+    class ImageTexture : public Texture
+    {
+    public:
+        /// \brief Open a texture file
+        /// \param[in] path A file written by writeTiledImage()
+        /// \param[in] cache The cache that holds the texture's tiles
+        /// \throws std::runtime_error if the file cannot be opened
+        explicit ImageTexture(std::string const& path, TextureCache& cache = TextureCache::global());
+
+        Colour value(HitRecord const& record) const override;
+
+    private:
+        /// \brief Bilinearly filter the four texels around (u, v) in one mip level
+        Colour bilinear(int level, double u, double v) const;
+
+        TiledImageFile m_file;
+        TextureCache& m_cache;
+    };
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include "TiledImage.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace rt
+{
+    /// \brief The texels of one texture tile, as 8-bit RGB triples
+    using TextureTile = std::vector<std::uint8_t>;
+
+    /// \brief A thread-safe cache of texture tiles that evicts the least recently used tiles to stay within a memory budget
+    /// \details The cache is split into independently locked shards so that threads looking up different tiles rarely contend.
+    /// Tiles are handed out as shared pointers, so a tile that is evicted while in use stays valid until it is released
+    class TextureCache
+    {
+    public:
+        /// \brief Counters describing how well the cache is working
+        struct Statistics
+        {
+            std::uint64_t hits;
+            std::uint64_t misses;
+            std::size_t residentBytes;
+            std::size_t peakBytes;
+        };
+
+        /// \brief Create an empty cache
+        /// \param[in] budgetBytes The most memory that cached tiles may occupy
+        explicit TextureCache(std::size_t budgetBytes);
+
+        /// \brief Get the cache shared by all image textures
+        static TextureCache& global();
+
+        /// \brief Change the memory budget. Tiles over the new budget are evicted on the next insertion
+        void setBudget(std::size_t budgetBytes) noexcept;
+
+        /// \brief Get a tile, reading it from the file if it is not cached
+        /// \param[in] file The texture file the tile belongs to
+        /// \param[in] level, tileX, tileY The mip level and position of the tile
+        /// \returns The texels of the tile
+        std::shared_ptr<TextureTile const> tile(TiledImageFile const& file, int level, int tileX, int tileY);
+
+        /// \brief Get the hit and miss counters and the memory in use
+        Statistics statistics() const noexcept;
+
+    private:
+        static constexpr std::size_t shardCount = 16;
+
+        /// \brief The identity of a tile, which keeps every bit of the file id so that files opened later never alias earlier ones
+        struct TileKey
+        {
+            std::uint32_t fileId;
+            int level;
+            int tileX;
+            int tileY;
+
+            bool operator==(TileKey const&) const noexcept = default;
+        };
+
+        struct TileKeyHash
+        {
+            std::size_t operator()(TileKey const& key) const noexcept;
+        };
+
+        struct Entry
+        {
+            std::shared_ptr<TextureTile const> tile;
+            std::list<TileKey>::iterator position;          // Position in the shard's recency list
+        };
+
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<TileKey, Entry, TileKeyHash> entries;
+            std::list<TileKey> recency;                     // Most recently used first
+            std::size_t bytes {};
+        };
+
+        std::array<Shard, shardCount> m_shards;
+        std::atomic<std::size_t> m_shardBudget;
+        std::atomic<std::uint64_t> m_hits {};
+        std::atomic<std::uint64_t> m_misses {};
+        std::atomic<std::size_t> m_residentBytes {};
+        std::atomic<std::size_t> m_peakBytes {};
+    };
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef TILED_IMAGE_HPP
+#define TILED_IMAGE_HPP
+
+#include "HdrImage.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rt
+{
+    /// \brief The size and location of one mip level in a tiled texture file
+    struct MipLevel
+    {
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t tilesX;
+        std::uint32_t tilesY;
+        std::uint64_t offset;   // Byte offset of the level's first tile from the start of the file
+    };
+
+    /// \brief A read-only, mip-mapped texture file stored as square tiles of 8-bit RGB texels
+    /// \details Tiles are read on demand, so opening a file only costs its header.
+    /// The file is read with positioned reads and may be shared by any number of threads
+    class TiledImageFile
+    {
+    public:
+        /// \brief Open a tiled texture file and read its header
+        /// \param[in] path The location of the file
+        /// \throws std::runtime_error if the file cannot be opened or is not a tiled texture
+        explicit TiledImageFile(std::string const& path);
+
+        ~TiledImageFile();
+
+        TiledImageFile(TiledImageFile const&) = delete;
+        TiledImageFile& operator=(TiledImageFile const&) = delete;
+
+        /// \brief Read the texels of one tile
+        /// \param[in] level The mip level, 0 being the full resolution image
+        /// \param[in] tileX, tileY The column and row of the tile within the level
+        /// \param[out] texels tileSize() * tileSize() RGB triples, row by row
+        /// \throws std::runtime_error if the read fails
+        void readTile(int level, int tileX, int tileY, std::vector<std::uint8_t>& texels) const;
+
+        /// \brief Get a number that identifies this file for as long as it is open
+        std::uint32_t id() const noexcept { return m_id; }
+
+        /// \brief Get the width and height of a tile in texels
+        int tileSize() const noexcept { return static_cast<int>(m_tileSize); }
+
+        /// \brief Get the number of mip levels
+        int levelCount() const noexcept { return static_cast<int>(m_levels.size()); }
+
+        /// \brief Get the size and layout of a mip level
+        MipLevel const& level(int const index) const& { return m_levels[static_cast<std::size_t>(index)]; }
+
+    private:
+        int m_fd {-1};
+        std::uint32_t m_id {};
+        std::uint32_t m_tileSize {};
+        std::vector<MipLevel> m_levels;
+    };
+
+    /// \brief Convert an image to a tiled texture file with a full chain of box-filtered mip levels
+    /// \param[in] image The full resolution image, in linear colour
+    /// \param[in] path The location of the file to create
+    /// \param[in] tileSize The width and height of every tile in texels
+    /// \throws std::runtime_error if the file cannot be written
+    void writeTiledImage(HdrImage const& image, std::string const& path, int tileSize = 64);
+}
+
+#endif
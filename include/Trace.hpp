@@ -0,0 +1,72 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+namespace rt
+{
+    namespace detail
+    {
+        /// \brief Whether trace scopes record anything
+        inline std::atomic<bool> tracing {false};
+    }
+
+    /// \brief Determine whether trace scopes are being recorded
+    inline bool tracingEnabled() noexcept
+    {
+        return detail::tracing.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Start recording trace scopes. Timestamps count from the first call
+    void enableTracing();
+
+    /// \brief Stop recording trace scopes. What has been recorded is kept
+    void disableTracing() noexcept;
+
+    /// \brief Marks a span of work on the calling thread's lane of the timeline
+    /// \details While tracing is disabled, a scope costs one relaxed load and a branch, so scopes can stay in hot code.
+    /// Each thread records into its own buffer. Threads that exit hand their lane to the next thread that starts, so a
+    /// render has as many lanes as it had threads running at once
+    class TraceScope
+    {
+    public:
+        /// \brief Start a span
+        /// \param[in] name What the span does. It must live until the trace is written, which a string literal does
+        /// \param[in] index A tile, row or pass number shown with the span, if not negative
+        explicit TraceScope(char const* name, std::int64_t index = -1) noexcept
+        :   m_name(tracingEnabled() ? name : nullptr), m_index(index)
+        {
+            if (m_name) {
+                m_start = std::chrono::steady_clock::now();
+            }
+        }
+
+        /// \brief End the span and record it
+        ~TraceScope()
+        {
+            if (m_name) {
+                record(m_name, m_index, m_start, std::chrono::steady_clock::now());
+            }
+        }
+
+        TraceScope(TraceScope const&) = delete;
+        TraceScope& operator=(TraceScope const&) = delete;
+
+    private:
+        /// \brief Add a finished span to the calling thread's lane
+        static void record(char const* name, std::int64_t index, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) noexcept;
+
+        char const* m_name;
+        std::int64_t m_index;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    /// \brief Write every recorded span in the Chrome trace event format, which Perfetto and chrome://tracing open
+    /// \details Call it once the traced threads have finished. Spans still being recorded by other threads are not safe to read
+    void writeTrace(std::ostream& out);
+}
+
+#endif
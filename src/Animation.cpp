@@ -0,0 +1,109 @@
+#include "Animation.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rt
+{
+    Translate::Translate(std::shared_ptr<Hittable> object) noexcept
+    :   m_object(std::move(object))
+    {
+    }
+
+    Ray Translate::toObject(Ray const& ray) const noexcept
+    {
+        Ray moved(ray.getOrigin() - m_offset, ray.getDirection());
+
+        if (ray.hasDifferentials()) {
+            moved.setDifferentials(ray.getRxOrigin() - m_offset, ray.getRxDirection(), ray.getRyOrigin() - m_offset, ray.getRyDirection());
+        }
+
+        return moved;
+    }
+
+    bool Translate::hit(Ray const& ray, double const tMin, double const tMax, HitRecord& record) const noexcept
+    {
+        if (not m_object->hit(toObject(ray), tMin, tMax, record)) {
+            return false;
+        }
+
+        // Normals and derivatives are directions, which a translation leaves unchanged
+        record.point += m_offset;
+        record.object = this;
+        return true;
+    }
+
+    bool Translate::occluded(Ray const& ray, double const tMin, double const tMax) const noexcept
+    {
+        return m_object->occluded(toObject(ray), tMin, tMax);
+    }
+
+    bool Translate::boundingBox(Aabb& box) const noexcept
+    {
+        Aabb objectBox;
+
+        if (not m_object->boundingBox(objectBox)) {
+            return false;
+        }
+
+        box = objectBox.translated(m_offset);
+        return true;
+    }
+
+    double Translate::pdfValue(Point3 const& origin, Vec3 const& direction) const
+    {
+        return m_object->pdfValue(origin - m_offset, direction);
+    }
+
+    Vec3 Translate::random(Point3 const& origin) const
+    {
+        return m_object->random(origin - m_offset);
+    }
+
+    void Animation::add(std::shared_ptr<Translate> object, std::vector<Keyframe> keys)
+    {
+        if (keys.empty()) {
+            throw std::invalid_argument("An animated object needs at least one keyframe");
+        }
+
+        auto const earlier = [](Keyframe const& a, Keyframe const& b) { return a.time < b.time; };
+
+        if (not std::is_sorted(keys.cbegin(), keys.cend(), earlier)) {
+            throw std::invalid_argument("Keyframes must be in increasing order of time");
+        }
+
+        m_tracks.push_back(Track {std::move(object), std::move(keys)});
+    }
+
+    void Animation::apply(double const time) noexcept
+    {
+        for (auto const& [object, keys] : m_tracks) {
+            auto const next = std::upper_bound(keys.cbegin(), keys.cend(), time, [](double t, Keyframe const& key) {
+                return t < key.time;
+            });
+
+            if (next == keys.cbegin()) {
+                object->setOffset(keys.front().offset);
+            }
+            else if (next == keys.cend()) {
+                object->setOffset(keys.back().offset);
+            }
+            else {
+                auto const& previous = *(next - 1);
+                auto const s = (time - previous.time) / (next->time - previous.time);
+                object->setOffset(((1.0 - s) * previous.offset) + (s * next->offset));
+            }
+        }
+    }
+
+    double Animation::duration() const noexcept
+    {
+        double last = 0.0;
+
+        for (auto const& track : m_tracks) {
+            last = std::max(last, track.keys.back().time);
+        }
+
+        return last;
+    }
+}
@@ -0,0 +1,138 @@
+#include "BandWriter.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <gsl/assert>
+
+namespace rt
+{
+    BandWriter::BandWriter(int const width, int const height, int const bandHeight, int const window, Sink sink)
+    :   m_width(width)
+    ,   m_height(height)
+    ,   m_bandHeight(bandHeight)
+    ,   m_bandCount((height + bandHeight - 1) / bandHeight)
+    ,   m_sink(std::move(sink))
+    ,   m_slots(static_cast<std::size_t>(window))
+    {
+        Expects(width > 0 and height > 0 and bandHeight > 0 and window >= 2);
+
+        m_thread = std::thread(&BandWriter::writeBands, this);
+    }
+
+    BandWriter::~BandWriter()
+    {
+        if (m_thread.joinable()) {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stopping = true;
+            }
+
+            m_bandFinished.notify_all();
+            m_bandWritten.notify_all();
+            m_thread.join();
+        }
+    }
+
+    Colour* BandWriter::acquireRow(int const y)
+    {
+        Expects(y >= 0 and y < m_height);
+
+        auto const band = y / m_bandHeight;
+        auto const window = static_cast<int>(m_slots.size());
+
+        std::unique_lock lock(m_mutex);
+        m_bandWritten.wait(lock, [&] { return band < m_nextBand + window or m_error or m_stopping; });
+
+        if (m_error or m_stopping) {
+            return nullptr;
+        }
+
+        auto& slot = m_slots[static_cast<std::size_t>(band % window)];
+
+        // The first row of a band to arrive claims the slot, which the band window - 1 before it has released
+        if (slot.band != band) {
+            slot.band = band;
+            slot.pendingRows = rowsIn(band);
+            slot.pixels.resize(static_cast<std::size_t>(slot.pendingRows) * m_width);
+        }
+
+        return &slot.pixels[static_cast<std::size_t>(y - (band * m_bandHeight)) * m_width];
+    }
+
+    void BandWriter::releaseRow(int const y)
+    {
+        auto const band = y / m_bandHeight;
+        bool finished = false;
+
+        {
+            std::lock_guard lock(m_mutex);
+            auto& slot = m_slots[static_cast<std::size_t>(band) % m_slots.size()];
+
+            Expects(slot.band == band and slot.pendingRows > 0);
+            finished = --slot.pendingRows == 0;
+        }
+
+        if (finished) {
+            m_bandFinished.notify_one();
+        }
+    }
+
+    void BandWriter::finish()
+    {
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+    std::size_t BandWriter::bufferBytes() const noexcept
+    {
+        return m_slots.size() * static_cast<std::size_t>(std::min(m_bandHeight, m_height)) * m_width * sizeof(Colour);
+    }
+
+    int BandWriter::rowsIn(int const band) const noexcept
+    {
+        return std::min(m_bandHeight, m_height - (band * m_bandHeight));
+    }
+
+    void BandWriter::writeBands()
+    {
+        for (int band = 0; band < m_bandCount; ++band) {
+            auto& slot = m_slots[static_cast<std::size_t>(band) % m_slots.size()];
+
+            {
+                std::unique_lock lock(m_mutex);
+                m_bandFinished.wait(lock, [&] { return (slot.band == band and slot.pendingRows == 0) or m_stopping; });
+
+                if (m_stopping) {
+                    return;
+                }
+            }
+
+            // The slot cannot be claimed again until the window moves on, so it is read without the lock
+            try {
+                TraceScope const span("write band", band);
+                m_sink(band * m_bandHeight, rowsIn(band), slot.pixels);
+            }
+            catch (...) {
+                {
+                    std::lock_guard lock(m_mutex);
+                    m_error = std::current_exception();
+                }
+
+                m_bandWritten.notify_all();
+                return;
+            }
+
+            {
+                std::lock_guard lock(m_mutex);
+                ++m_nextBand;
+            }
+
+            m_bandWritten.notify_all();
+        }
+    }
+}
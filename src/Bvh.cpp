@@ -0,0 +1,469 @@
+#include "Bvh.hpp"
+#include "Kernels.hpp"
+#include "Sphere.hpp"
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+
+namespace rt
+{
+    namespace
+    {
+        constexpr std::size_t binCount = 16;
+        constexpr std::size_t maxLeafSize = 8;
+        constexpr double traversalCost = 1.0;       // The cost of visiting a node, relative to testing one object
+
+        KernelRay toKernelRay(Ray const& ray) noexcept
+        {
+            auto const origin = ray.getOrigin();
+            auto const direction = ray.getDirection();
+
+            return {{origin.x(), origin.y(), origin.z()}, {direction.x(), direction.y(), direction.z()}};
+        }
+
+        /// \brief Reorder @param items so that item i moves to the position of i in @param order
+        template <typename T>
+        void permute(std::vector<T>& items, std::vector<std::size_t> const& order)
+        {
+            std::vector<T> sorted;
+            sorted.reserve(items.size());
+
+            for (auto const i : order) {
+                sorted.push_back(std::move(items[i]));
+            }
+
+            items = std::move(sorted);
+        }
+    }
+
+    Bvh::Bvh(std::vector<std::shared_ptr<Hittable>> objects)
+        : Bvh(std::move(objects), std::string())
+    {
+    }
+
+    Bvh::Bvh(std::vector<std::shared_ptr<Hittable>> objects, std::string const& cacheDirectory)
+    {
+        for (auto& object : objects) {
+            Aabb box;
+
+            if (object->boundingBox(box)) {
+                m_objects.push_back(std::move(object));
+            }
+            else {
+                m_unbounded.push_back(std::move(object));
+            }
+        }
+
+        if (cacheDirectory.empty()) {
+            rebuild();
+            return;
+        }
+
+        std::vector<std::size_t> order;
+        auto const geometryHash = hashGeometry();
+
+        {
+            PhaseTimer const timer("hierarchy");
+            m_cacheUse = readCache(cacheDirectory, geometryHash, order);
+
+            if (m_cacheUse == CacheUse::loaded) {
+                permute(m_objects, order);
+
+                m_primitives.resize(m_objects.size());
+                std::transform(m_objects.cbegin(), m_objects.cend(), m_primitives.begin(), [](auto const& object) { return object.get(); });
+
+                gatherSpheres();
+                m_builtCost = cost();
+                return;
+            }
+        }
+
+        order = buildTree();
+
+        if (not writeCache(cacheDirectory, geometryHash, order)) {
+            m_cacheUse = CacheUse::unsaved;
+        }
+    }
+
+    void Bvh::rebuild()
+    {
+        buildTree();
+    }
+
+    std::vector<std::size_t> Bvh::buildTree()
+    {
+        PhaseTimer const timer("hierarchy");
+        std::vector<Aabb> boxes(m_objects.size());
+
+        for (std::size_t i = 0; i < m_objects.size(); ++i) {
+            m_objects[i]->boundingBox(boxes[i]);
+        }
+
+        std::vector<std::size_t> order(m_objects.size());
+        std::iota(order.begin(), order.end(), std::size_t{0});
+
+        m_nodes.clear();
+
+        if (not m_objects.empty()) {
+            // The build sorts the boxes, so it works on a copy that carries the original index of every object
+            std::vector<Aabb> sorted = boxes;
+            m_order = std::move(order);
+            build(sorted, 0, m_objects.size(), 0);
+            permute(m_objects, m_order);
+            order = std::move(m_order);
+            m_order.clear();
+        }
+
+        m_primitives.resize(m_objects.size());
+        std::transform(m_objects.cbegin(), m_objects.cend(), m_primitives.begin(), [](auto const& object) { return object.get(); });
+
+        gatherSpheres();
+        m_builtCost = cost();
+
+        return order;
+    }
+
+    void Bvh::gatherSpheres()
+    {
+        m_sphereX.assign(m_primitives.size(), 0.0);
+        m_sphereY.assign(m_primitives.size(), 0.0);
+        m_sphereZ.assign(m_primitives.size(), 0.0);
+        m_sphereRadius.assign(m_primitives.size(), -1.0);
+
+        for (std::size_t i = 0; i < m_primitives.size(); ++i) {
+            if (auto const sphere = dynamic_cast<Sphere const*>(m_primitives[i])) {
+                m_sphereX[i] = sphere->center().x();
+                m_sphereY[i] = sphere->center().y();
+                m_sphereZ[i] = sphere->center().z();
+                m_sphereRadius[i] = sphere->radius();
+            }
+        }
+
+        for (auto& node : m_nodes) {
+            if (node.count > 0) {
+                auto const first = m_sphereRadius.cbegin() + node.offset;
+                node.axis = std::all_of(first, first + node.count, [](double r) { return r >= 0.0; }) ? sphereLeaf : 0;
+            }
+        }
+    }
+
+    std::uint32_t Bvh::build(std::vector<Aabb>& boxes, std::size_t const begin, std::size_t const end, int const depth)
+    {
+        auto const index = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes.push_back({});
+
+        Aabb bounds;
+        Aabb centroids;
+
+        for (auto i = begin; i < end; ++i) {
+            bounds.merge(boxes[i]);
+            centroids.merge(Point3(boxes[i].centre(0), boxes[i].centre(1), boxes[i].centre(2)));
+        }
+
+        auto const split = splitBoxes(boxes, m_order, begin, end, bounds, centroids, depth);
+
+        if (split.leaf) {
+            m_nodes[index] = Node {bounds, static_cast<std::uint32_t>(begin), static_cast<std::uint16_t>(end - begin), 0};
+            return index;
+        }
+
+        build(boxes, begin, split.mid, depth + 1);
+        auto const rightChild = build(boxes, split.mid, end, depth + 1);
+
+        m_nodes[index] = Node {bounds, rightChild, 0, static_cast<std::uint16_t>(split.axis)};
+        return index;
+    }
+
+    BoxSplit splitBoxes(std::vector<Aabb>& boxes, std::vector<std::size_t>& order, std::size_t const begin, std::size_t const end, Aabb const& bounds, Aabb const& centroids, int const depth)
+    {
+        auto const count = end - begin;
+        auto const axis = centroids.longestAxis();
+        BoxSplit const leaf {true, end, axis};
+
+        if (count <= 2 or depth >= Bvh::maxDepth) {
+            return leaf;
+        }
+
+        auto const low = centroids.min(axis);
+        auto const extent = centroids.max(axis) - low;
+        auto mid = begin + (count / 2);
+
+        // Swap the boxes together with the order they came in, so that each object can be found again
+        auto const partition = [&](auto&& predicate) {
+            auto split = begin;
+
+            for (auto i = begin; i < end; ++i) {
+                if (predicate(boxes[i])) {
+                    std::swap(boxes[i], boxes[split]);
+                    std::swap(order[i], order[split]);
+                    ++split;
+                }
+            }
+
+            return split;
+        };
+
+        if (extent > 0.0) {
+            auto const binOf = [&](Aabb const& box) {
+                return std::min(binCount - 1, static_cast<std::size_t>(binCount * (box.centre(axis) - low) / extent));
+            };
+
+            std::array<Aabb, binCount> binBoxes {};
+            std::array<std::size_t, binCount> binCounts {};
+
+            for (auto i = begin; i < end; ++i) {
+                auto const bin = binOf(boxes[i]);
+                binBoxes[bin].merge(boxes[i]);
+                ++binCounts[bin];
+            }
+
+            // Sweep from the right to get the area and count of every right-hand side, then from the left to price each split
+            std::array<double, binCount> rightArea {};
+            std::array<std::size_t, binCount> rightCount {};
+            Aabb right;
+            std::size_t rightSum = 0;
+
+            for (auto b = binCount - 1; b > 0; --b) {
+                right.merge(binBoxes[b]);
+                rightSum += binCounts[b];
+                rightArea[b] = right.surfaceArea();
+                rightCount[b] = rightSum;
+            }
+
+            Aabb left;
+            std::size_t leftSum = 0;
+            auto bestCost = std::numeric_limits<double>::infinity();
+            std::size_t bestSplit = 0;
+
+            for (std::size_t b = 1; b < binCount; ++b) {
+                left.merge(binBoxes[b - 1]);
+                leftSum += binCounts[b - 1];
+
+                if (leftSum == 0 or rightCount[b] == 0) {
+                    continue;
+                }
+
+                auto const splitCost = traversalCost + (((left.surfaceArea() * leftSum) + (rightArea[b] * rightCount[b])) / bounds.surfaceArea());
+
+                if (splitCost < bestCost) {
+                    bestCost = splitCost;
+                    bestSplit = b;
+                }
+            }
+
+            if (bestCost >= static_cast<double>(count) and count <= maxLeafSize) {
+                return leaf;
+            }
+
+            if (bestSplit > 0) {
+                mid = partition([&](Aabb const& box) { return binOf(box) < bestSplit; });
+            }
+        }
+        else if (count <= maxLeafSize) {
+            return leaf;
+        }
+
+        // Identical centroids, or no split that separates them: halve the range
+        if (mid == begin or mid == end) {
+            mid = begin + (count / 2);
+        }
+
+        return BoxSplit {false, mid, axis};
+    }
+
+    bool Bvh::hit(Ray const& ray, double const tMin, double const tMax, HitRecord& record) const noexcept
+    {
+        bool hitAnything = false;
+        auto closestSoFar = tMax;
+
+        if (not m_nodes.empty()) {
+            RayInverse const inverse(ray);
+            auto const& simd = kernels();
+            auto const kernelRay = toKernelRay(ray);
+            std::array<std::uint32_t, maxDepth + 2> stack;
+            std::size_t top = 0;
+            std::uint64_t visits = 0;
+            stack[top++] = 0;
+
+            while (top > 0) {
+                auto const& node = m_nodes[stack[--top]];
+                ++visits;
+
+                if (double tEntry {}; not node.box.hit(inverse, tMin, closestSoFar, tEntry)) {
+                    continue;
+                }
+
+                if (node.axis == sphereLeaf and node.count > 0) {
+                    // The kernel finds the nearest sphere, and only that one fills in the record
+                    SphereBatch const batch {&m_sphereX[node.offset], &m_sphereY[node.offset], &m_sphereZ[node.offset], &m_sphereRadius[node.offset], node.count};
+                    auto const nearest = simd.closestSphere(batch, kernelRay, tMin, closestSoFar);
+
+                    if (nearest < node.count) {
+                        threadStatistics().intersectionTests[static_cast<std::size_t>(PrimitiveKind::sphere)].add(node.count - 1u);
+
+                        if (m_primitives[node.offset + nearest]->hit(ray, tMin, closestSoFar, record)) {
+                            hitAnything = true;
+                            closestSoFar = record.t;
+                        }
+                    }
+                    else {
+                        threadStatistics().intersectionTests[static_cast<std::size_t>(PrimitiveKind::sphere)].add(node.count);
+                    }
+                }
+                else if (node.count > 0) {
+                    for (auto i = node.offset; i < node.offset + node.count; ++i) {
+                        if (m_primitives[i]->hit(ray, tMin, closestSoFar, record)) {
+                            hitAnything = true;
+                            closestSoFar = record.t;
+                        }
+                    }
+                }
+                else {
+                    // Push the far child first, so that the near one is visited first and shortens the interval
+                    auto const left = static_cast<std::uint32_t>(&node - m_nodes.data()) + 1;
+
+                    if (inverse.negative[node.axis]) {
+                        stack[top++] = left;
+                        stack[top++] = node.offset;
+                    }
+                    else {
+                        stack[top++] = node.offset;
+                        stack[top++] = left;
+                    }
+                }
+            }
+
+            threadStatistics().nodeVisits.add(visits);
+        }
+
+        for (auto const& object : m_unbounded) {
+            if (object->hit(ray, tMin, closestSoFar, record)) {
+                hitAnything = true;
+                closestSoFar = record.t;
+            }
+        }
+
+        return hitAnything;
+    }
+
+    bool Bvh::occluded(Ray const& ray, double const tMin, double const tMax) const noexcept
+    {
+        if (not m_nodes.empty()) {
+            RayInverse const inverse(ray);
+            auto const& simd = kernels();
+            auto const kernelRay = toKernelRay(ray);
+            std::array<std::uint32_t, maxDepth + 2> stack;
+            std::size_t top = 0;
+            std::uint64_t visits = 0;
+            bool blocked = false;
+            stack[top++] = 0;
+
+            while (top > 0 and not blocked) {
+                auto const& node = m_nodes[stack[--top]];
+                ++visits;
+
+                if (double tEntry {}; not node.box.hit(inverse, tMin, tMax, tEntry)) {
+                    continue;
+                }
+
+                if (node.axis == sphereLeaf and node.count > 0) {
+                    SphereBatch const batch {&m_sphereX[node.offset], &m_sphereY[node.offset], &m_sphereZ[node.offset], &m_sphereRadius[node.offset], node.count};
+                    blocked = simd.anySphere(batch, kernelRay, tMin, tMax);
+                    threadStatistics().intersectionTests[static_cast<std::size_t>(PrimitiveKind::sphere)].add(node.count);
+                }
+                else if (node.count > 0) {
+                    for (auto i = node.offset; i < node.offset + node.count and not blocked; ++i) {
+                        blocked = m_primitives[i]->occluded(ray, tMin, tMax);
+                    }
+                }
+                else {
+                    stack[top++] = node.offset;
+                    stack[top++] = static_cast<std::uint32_t>(&node - m_nodes.data()) + 1;
+                }
+            }
+
+            threadStatistics().nodeVisits.add(visits);
+
+            if (blocked) {
+                return true;
+            }
+        }
+
+        return std::any_of(m_unbounded.cbegin(), m_unbounded.cend(), [&](auto const& object) {
+            return object->occluded(ray, tMin, tMax);
+        });
+    }
+
+    bool Bvh::boundingBox(Aabb& box) const noexcept
+    {
+        if (not m_unbounded.empty()) {
+            return false;
+        }
+
+        box = m_nodes.empty() ? Aabb() : m_nodes.front().box;
+        return true;
+    }
+
+    void Bvh::refit() noexcept
+    {
+        // Children always come after their parent, so walking backwards visits them first
+        for (auto i = m_nodes.size(); i-- > 0;) {
+            auto& node = m_nodes[i];
+            Aabb box;
+
+            if (node.count > 0) {
+                for (auto j = node.offset; j < node.offset + node.count; ++j) {
+                    Aabb objectBox;
+                    m_primitives[j]->boundingBox(objectBox);
+                    box.merge(objectBox);
+
+                    // Spheres can be moved in place, and the kernels test copies of them
+                    if (node.axis == sphereLeaf) {
+                        auto const& center = static_cast<Sphere const*>(m_primitives[j])->center();
+                        m_sphereX[j] = center.x();
+                        m_sphereY[j] = center.y();
+                        m_sphereZ[j] = center.z();
+                    }
+                }
+            }
+            else {
+                box.merge(m_nodes[i + 1].box);
+                box.merge(m_nodes[node.offset].box);
+            }
+
+            node.box = box;
+        }
+    }
+
+    bool Bvh::update(double const rebuildThreshold)
+    {
+        refit();
+
+        if (cost() > rebuildThreshold * m_builtCost) {
+            rebuild();
+            return true;
+        }
+
+        return false;
+    }
+
+    double Bvh::cost() const noexcept
+    {
+        if (m_nodes.empty()) {
+            return 0.0;
+        }
+
+        auto const rootArea = m_nodes.front().box.surfaceArea();
+        double total = 0.0;
+
+        for (auto const& node : m_nodes) {
+            auto const area = rootArea > 0.0 ? node.box.surfaceArea() / rootArea : 1.0;
+            total += area * (node.count > 0 ? static_cast<double>(node.count) : traversalCost);
+        }
+
+        return total;
+    }
+}
@@ -0,0 +1,281 @@
+#include "Bvh.hpp"
+#include "Common.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <type_traits>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief Raised whenever the layout of the file or the way trees are built changes, so older files are rebuilt
+        constexpr std::uint32_t formatVersion = 1;
+
+        constexpr std::array<char, 8> magic {'R', 'T', 'B', 'V', 'H', 'C', 'H', 'E'};
+        constexpr std::uint32_t byteOrderMark = 0x01020304;
+
+        /// \brief The start of a cached tree. The nodes follow it, then the 32-bit index of the object at every position of the leaves
+        struct CacheHeader
+        {
+            std::array<char, 8> magic;
+            std::uint32_t version;
+            std::uint32_t byteOrder;        // byteOrderMark as written by the machine that saved the file
+            std::uint32_t nodeBytes;        // The size of a node, which differs between builds of other layouts
+            std::uint32_t reserved;
+            std::uint64_t geometryHash;
+            std::uint64_t objectCount;
+            std::uint64_t nodeCount;
+            std::uint64_t payloadHash;      // A hash of everything after the header, which finds damage the other checks cannot
+        };
+
+        static_assert(std::is_trivially_copyable_v<Bvh::Node>, "Nodes are saved and loaded as they are in memory");
+        static_assert(sizeof(CacheHeader) % alignof(Bvh::Node) == 0, "The nodes follow the header aligned");
+
+        std::filesystem::path cachePath(std::string const& directory, std::uint64_t const geometryHash)
+        {
+            std::ostringstream name;
+            name << std::hex << std::setw(16) << std::setfill('0') << geometryHash << ".bvh";
+
+            return std::filesystem::path(directory) / name.str();
+        }
+
+        /// \brief Hash @param size bytes from @param data, eight at a time
+        std::uint64_t hashBytes(unsigned char const* data, std::size_t const size) noexcept
+        {
+            auto hash = mixBits(size);
+
+            for (std::size_t i = 0; i < size; i += sizeof(std::uint64_t)) {
+                std::uint64_t word {};
+                std::memcpy(&word, data + i, std::min(sizeof(word), size - i));
+                hash = mixBits(hash ^ word);
+            }
+
+            return hash;
+        }
+
+        /// \brief A whole file mapped read-only into memory, for as long as the object lives
+        class MappedFile
+        {
+        public:
+            /// \brief Map the file at @param path. Nothing is mapped if it cannot be opened
+            explicit MappedFile(std::filesystem::path const& path) noexcept
+            {
+                auto const descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+                if (descriptor < 0) {
+                    return;
+                }
+
+                m_exists = true;
+
+                if (struct stat status {}; fstat(descriptor, &status) == 0 and status.st_size > 0) {
+                    auto* data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+                    if (data != MAP_FAILED) {
+                        m_data = static_cast<unsigned char const*>(data);
+                        m_size = static_cast<std::size_t>(status.st_size);
+                    }
+                }
+
+                close(descriptor);
+            }
+
+            ~MappedFile()
+            {
+                if (m_data) {
+                    munmap(const_cast<unsigned char*>(m_data), m_size);
+                }
+            }
+
+            MappedFile(MappedFile const&) = delete;
+            MappedFile& operator=(MappedFile const&) = delete;
+
+            bool exists() const noexcept { return m_exists; }
+            unsigned char const* data() const noexcept { return m_data; }
+            std::size_t size() const noexcept { return m_size; }
+
+        private:
+            unsigned char const* m_data {};
+            std::size_t m_size {};
+            bool m_exists {false};
+        };
+    }
+
+    std::uint64_t Bvh::hashGeometry() const noexcept
+    {
+        auto hash = mixBits((static_cast<std::uint64_t>(formatVersion) << 32u) ^ m_objects.size());
+
+        auto const add = [&hash](double const value) {
+            std::uint64_t bits {};
+            std::memcpy(&bits, &value, sizeof(bits));
+            hash = mixBits(hash ^ bits);
+        };
+
+        for (auto const& object : m_objects) {
+            Aabb box;
+            object->boundingBox(box);
+
+            for (std::size_t i = 0; i < 3; ++i) {
+                add(box.min(i));
+                add(box.max(i));
+            }
+        }
+
+        return mixBits(hash ^ m_unbounded.size());
+    }
+
+    Bvh::CacheUse Bvh::readCache(std::string const& directory, std::uint64_t const geometryHash, std::vector<std::size_t>& order)
+    {
+        MappedFile const file(cachePath(directory, geometryHash));
+
+        if (not file.exists()) {
+            return CacheUse::built;
+        }
+
+        CacheHeader header {};
+
+        if (file.size() < sizeof(header)) {
+            return CacheUse::replaced;
+        }
+
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        auto const objectCount = m_objects.size();
+
+        if (header.magic != magic or header.version != formatVersion or header.byteOrder != byteOrderMark or header.nodeBytes != sizeof(Node)
+            or header.geometryHash != geometryHash or header.objectCount != objectCount
+            or header.nodeCount > (file.size() - sizeof(header)) / sizeof(Node)
+            or file.size() != sizeof(header) + (header.nodeCount * sizeof(Node)) + (objectCount * sizeof(std::uint32_t))) {
+            return CacheUse::replaced;
+        }
+
+        auto const nodeCount = static_cast<std::size_t>(header.nodeCount);
+
+        if ((objectCount == 0) != (nodeCount == 0) or hashBytes(file.data() + sizeof(header), file.size() - sizeof(header)) != header.payloadHash) {
+            return CacheUse::replaced;
+        }
+
+        std::vector<Node> nodes(nodeCount);
+        std::memcpy(nodes.data(), file.data() + sizeof(header), nodeCount * sizeof(Node));
+
+        // Every node is reached from the root within the depth the traversal stack allows, and the leaves cover every
+        // position once, so no object is lost or tested twice
+        std::vector<int> depths(nodeCount, -1);
+        std::vector<bool> covered(objectCount, false);
+
+        if (nodeCount > 0) {
+            depths[0] = 0;
+        }
+
+        for (std::size_t i = 0; i < nodeCount; ++i) {
+            auto const& node = nodes[i];
+
+            if (depths[i] < 0 or depths[i] > maxDepth) {
+                return CacheUse::replaced;
+            }
+
+            if (node.count > 0) {
+                if (node.offset + std::size_t {node.count} > objectCount) {
+                    return CacheUse::replaced;
+                }
+
+                for (std::size_t j = node.offset; j < node.offset + std::size_t {node.count}; ++j) {
+                    if (covered[j]) {
+                        return CacheUse::replaced;
+                    }
+
+                    covered[j] = true;
+                }
+            }
+            else {
+                auto const right = std::size_t {node.offset};
+
+                if (node.axis > 2 or i + 1 >= nodeCount or right <= i + 1 or right >= nodeCount or depths[i + 1] >= 0 or depths[right] >= 0) {
+                    return CacheUse::replaced;
+                }
+
+                depths[i + 1] = depths[i] + 1;
+                depths[right] = depths[i] + 1;
+            }
+        }
+
+        if (std::find(covered.cbegin(), covered.cend(), false) != covered.cend()) {
+            return CacheUse::replaced;
+        }
+
+        std::vector<std::uint32_t> indices(objectCount);
+        std::memcpy(indices.data(), file.data() + sizeof(header) + (nodeCount * sizeof(Node)), objectCount * sizeof(std::uint32_t));
+
+        std::vector<bool> seen(objectCount, false);
+
+        for (auto const index : indices) {
+            if (index >= objectCount or seen[index]) {
+                return CacheUse::replaced;
+            }
+
+            seen[index] = true;
+        }
+
+        m_nodes = std::move(nodes);
+        order.assign(indices.cbegin(), indices.cend());
+
+        return CacheUse::loaded;
+    }
+
+    bool Bvh::writeCache(std::string const& directory, std::uint64_t const geometryHash, std::vector<std::size_t> const& order) const
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        auto const path = cachePath(directory, geometryHash);
+        auto temporary = path;
+        temporary += ".tmp";
+
+        std::vector<std::uint32_t> const indices(order.cbegin(), order.cend());
+        auto const nodeBytes = m_nodes.size() * sizeof(Node);
+        auto const indexBytes = indices.size() * sizeof(std::uint32_t);
+
+        // The payload is hashed as it will be read back, in one piece
+        std::vector<unsigned char> payload(nodeBytes + indexBytes);
+
+        if (not payload.empty()) {
+            std::memcpy(payload.data(), m_nodes.data(), nodeBytes);
+            std::memcpy(payload.data() + nodeBytes, indices.data(), indexBytes);
+        }
+
+        CacheHeader const header {magic, formatVersion, byteOrderMark, sizeof(Node), 0, geometryHash, m_objects.size(), m_nodes.size(), hashBytes(payload.data(), payload.size())};
+
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+
+            out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+            out.write(reinterpret_cast<char const*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+
+            if (not out.flush()) {
+                std::filesystem::remove(temporary, error);
+                return false;
+            }
+        }
+
+        // Readers only ever see a complete file, whether the old one or the new one
+        std::filesystem::rename(temporary, path, error);
+
+        if (error) {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -22,6 +22,33 @@ namespace rt
         m_lowerLeftCorner = m_origin - (m_horizontal / 2) - (m_vertical / 2) - (focusDistance * m_w); // lower-left corner of the viewport
     }
 
+    std::vector<CameraSettings> orbit(CameraSettings const& base, int const count)
+    {
+        auto const axis = unitVector(base.viewUp);
+        auto const offset = base.lookFrom - base.lookAt;
+        std::vector<CameraSettings> cameras;
+
+        for (int i = 0; i < count; ++i) {
+            auto const angle = 2 * pi * i / count;
+            auto const cosAngle = std::cos(angle);
+            auto const sinAngle = std::sin(angle);
+
+            // Rodrigues' rotation of the offset about the axis
+            auto const rotated = (offset * cosAngle) + (cross(axis, offset) * sinAngle) + (axis * dot(axis, offset) * (1 - cosAngle));
+
+            auto camera = base;
+            camera.lookFrom = base.lookAt + rotated;
+            cameras.push_back(camera);
+        }
+
+        return cameras;
+    }
+
+    Camera::Camera(CameraSettings const& settings, double const aspectRatio) noexcept
+    :   Camera(settings.lookFrom, settings.lookAt, settings.viewUp, settings.verticalFovInDegrees, aspectRatio, settings.aperture, settings.focusDistance)
+    {
+    }
+
     Ray Camera::getRay(double const s, double const t) const& noexcept
     {
         Vec3 rd = m_lensRadius * randomInUnitDisk();
@@ -29,4 +56,18 @@ namespace rt
 
         return Ray(m_origin + offset, m_lowerLeftCorner + (s * m_horizontal) + (t * m_vertical) - m_origin - offset);
     }
+
+    Ray Camera::getRay(double const s, double const t, double const ds, double const dt) const& noexcept
+    {
+        Vec3 rd = m_lensRadius * randomInUnitDisk();
+        Vec3 offset = (m_u * rd.x()) + (m_v * rd.y());
+        Point3 const origin = m_origin + offset;
+        Point3 const target = m_lowerLeftCorner + (s * m_horizontal) + (t * m_vertical);
+
+        // The offset rays share the lens sample, so they differ only in where they cross the focus plane
+        Ray ray(origin, target - origin);
+        ray.setDifferentials(origin, target + (ds * m_horizontal) - origin, origin, target + (dt * m_vertical) - origin);
+
+        return ray;
+    }
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "Colour.hpp"
 #include "Common.hpp"
+#include "Kernels.hpp"
+
+#include <type_traits>
 
 namespace rt
 {
-    void writeColour(std::ostream& out, Colour const& pixelColour, int const samplesPerPixel)
+    std::array<std::uint8_t, 3> toBytes(Colour const& pixelColour, int const samplesPerPixel) noexcept
     {
         auto r = pixelColour.x();
         auto g = pixelColour.y();
@@ -16,9 +19,38 @@ namespace rt
         g = std::sqrt(scale * g);
         b = std::sqrt(scale * b);
 
-        // Write the translated [0, 255] value of each colour component
-        out << static_cast<int>(255.999 * clamp(r, 0.0, 0.999)) << ' '
-            << static_cast<int>(255.999 * clamp(g, 0.0, 0.999)) << ' '
-            << static_cast<int>(255.999 * clamp(b, 0.0, 0.999)) << '\n';
+        // Translate each colour component to [0, 255]
+        return {
+            static_cast<std::uint8_t>(255.999 * clamp(r, 0.0, 0.999)),
+            static_cast<std::uint8_t>(255.999 * clamp(g, 0.0, 0.999)),
+            static_cast<std::uint8_t>(255.999 * clamp(b, 0.0, 0.999))
+        };
+    }
+
+    std::vector<std::uint8_t> toBytes(std::vector<Colour> const& pixels, int const samplesPerPixel)
+    {
+        static_assert(sizeof(Colour) == 3 * sizeof(double) and std::is_standard_layout_v<Colour>, "The kernels read colours as a flat array of components");
+
+        std::vector<std::uint8_t> bytes(3 * pixels.size());
+
+        if (not pixels.empty()) {
+            kernels().encodePixels(reinterpret_cast<double const*>(pixels.data()), bytes.size(), 1.0 / samplesPerPixel, bytes.data());
+        }
+
+        return bytes;
+    }
+
+    void writeBytes(std::ostream& out, std::vector<std::uint8_t> const& bytes)
+    {
+        for (std::size_t i = 0; i + 2 < bytes.size(); i += 3) {
+            out << static_cast<int>(bytes[i]) << ' ' << static_cast<int>(bytes[i + 1]) << ' ' << static_cast<int>(bytes[i + 2]) << '\n';
+        }
+    }
+
+    void writeColour(std::ostream& out, Colour const& pixelColour, int const samplesPerPixel)
+    {
+        auto const bytes = toBytes(pixelColour, samplesPerPixel);
+
+        out << static_cast<int>(bytes[0]) << ' ' << static_cast<int>(bytes[1]) << ' ' << static_cast<int>(bytes[2]) << '\n';
     }
 }
@@ -0,0 +1,324 @@
+#include "Denoiser.hpp"
+#include "Parallel.hpp"
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <gsl/util>
+
+namespace rt
+{
+    namespace
+    {
+        using Float4 = float __attribute__((vector_size(16)));
+        using Int4 = std::int32_t __attribute__((vector_size(16)));
+
+        constexpr std::size_t lanes = 4;
+        constexpr std::array<float, 5> kernel { 1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16 };
+        constexpr float missDepth = 1e8f;
+        constexpr float albedoEpsilon = 1e-3f;
+
+        /// \brief One float per pixel for every channel, so that neighbouring pixels sit next to each other in memory
+        struct Planes
+        {
+            std::array<std::vector<float>, 3> colour;
+            std::array<std::vector<float>, 3> normal;
+            std::array<std::vector<float>, 3> albedo;
+            std::vector<float> depth;
+        };
+
+        inline Float4 load(float const* p) noexcept
+        {
+            Float4 v;
+            __builtin_memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline void store(float* p, Float4 const& v) noexcept
+        {
+            __builtin_memcpy(p, &v, sizeof(v));
+        }
+
+        inline Float4 broadcast(float const x) noexcept
+        {
+            return Float4 { x, x, x, x };
+        }
+
+        inline Float4 min(Float4 const& a, Float4 const& b) noexcept
+        {
+            return a < b ? a : b;
+        }
+
+        inline Float4 max(Float4 const& a, Float4 const& b) noexcept
+        {
+            return a > b ? a : b;
+        }
+
+        /// \brief Approximate exp(x) for x <= 0, to about 1e-4 relative error, without leaving the vector registers
+        inline Float4 fastExp(Float4 x) noexcept
+        {
+            x = max(x, broadcast(-80.0f));
+            Float4 const t = x * 1.44269504f;
+
+            // Round towards negative infinity
+            Int4 i = __builtin_convertvector(t, Int4);
+            i += (__builtin_convertvector(i, Float4) > t);
+
+            Float4 const f = t - __builtin_convertvector(i, Float4);
+            Float4 const p = 1.0f + f * (0.6931472f + f * (0.2402265f + f * (0.0555041f + f * 0.0096181f)));
+            Int4 const exponent = (i + 127) << 23;
+
+            Float4 scale;
+            __builtin_memcpy(&scale, &exponent, sizeof(scale));
+
+            return p * scale;
+        }
+
+        /// \brief Get the relative luminance of colours
+        inline Float4 luminance4(Float4 const& r, Float4 const& g, Float4 const& b) noexcept
+        {
+            return (0.2126f * r) + (0.7152f * g) + (0.0722f * b);
+        }
+
+        /// \brief The per-iteration constants of the edge-stopping functions
+        struct Weights
+        {
+            int step;
+            float inverseColour;
+            float inverseNormal;
+            float inverseDepth;
+            float inverseAlbedo;
+        };
+
+        /// \brief Filter four pixels of a row starting at column x, with every tap inside the image
+        /// \param[in] rows The row index of each vertical tap
+        /// \param[in] columns The column index of each horizontal tap for the first of the four pixels
+        void filterLanes(Planes const& in, std::array<std::vector<float>, 3>& out, int width, int y, int x,
+            std::array<int, 5> const& rows, std::array<int, 5> const& columns, Weights const& w) noexcept
+        {
+            auto const centre = static_cast<std::size_t>(y) * width + x;
+
+            Float4 const cr = load(&in.colour[0][centre]);
+            Float4 const cg = load(&in.colour[1][centre]);
+            Float4 const cb = load(&in.colour[2][centre]);
+            Float4 const nx = load(&in.normal[0][centre]);
+            Float4 const ny = load(&in.normal[1][centre]);
+            Float4 const nz = load(&in.normal[2][centre]);
+            Float4 const ar = load(&in.albedo[0][centre]);
+            Float4 const ag = load(&in.albedo[1][centre]);
+            Float4 const ab = load(&in.albedo[2][centre]);
+            Float4 const z = load(&in.depth[centre]);
+
+            Float4 const lum = luminance4(cr, cg, cb);
+            Float4 const colourScale = broadcast(w.inverseColour) / ((lum * lum) + 1e-4f);
+
+            Float4 sumR {};
+            Float4 sumG {};
+            Float4 sumB {};
+            Float4 sumW {};
+
+            for (std::size_t ky = 0; ky < 5; ++ky) {
+                auto const row = static_cast<std::size_t>(rows[ky]) * width;
+
+                for (std::size_t kx = 0; kx < 5; ++kx) {
+                    auto const q = row + static_cast<std::size_t>(columns[kx]);
+
+                    Float4 const qr = load(&in.colour[0][q]);
+                    Float4 const qg = load(&in.colour[1][q]);
+                    Float4 const qb = load(&in.colour[2][q]);
+
+                    Float4 const dr = qr - cr;
+                    Float4 const dg = qg - cg;
+                    Float4 const db = qb - cb;
+                    Float4 const colourDistance = ((dr * dr) + (dg * dg) + (db * db)) * colourScale;
+
+                    Float4 const dnx = load(&in.normal[0][q]) - nx;
+                    Float4 const dny = load(&in.normal[1][q]) - ny;
+                    Float4 const dnz = load(&in.normal[2][q]) - nz;
+                    Float4 const normalDistance = ((dnx * dnx) + (dny * dny) + (dnz * dnz)) * w.inverseNormal;
+
+                    Float4 const qz = load(&in.depth[q]);
+                    Float4 const dz = max(qz - z, z - qz);
+                    Float4 const depthDistance = dz * w.inverseDepth / (min(z, qz) + 1e-3f);
+
+                    Float4 const dar = load(&in.albedo[0][q]) - ar;
+                    Float4 const dag = load(&in.albedo[1][q]) - ag;
+                    Float4 const dab = load(&in.albedo[2][q]) - ab;
+                    Float4 const albedoDistance = ((dar * dar) + (dag * dag) + (dab * dab)) * w.inverseAlbedo;
+
+                    Float4 const weight = (kernel[kx] * kernel[ky]) * fastExp(-(colourDistance + normalDistance + depthDistance + albedoDistance));
+
+                    sumR += weight * qr;
+                    sumG += weight * qg;
+                    sumB += weight * qb;
+                    sumW += weight;
+                }
+            }
+
+            // The centre tap always has full weight, so the sum is never zero
+            store(&out[0][centre], sumR / sumW);
+            store(&out[1][centre], sumG / sumW);
+            store(&out[2][centre], sumB / sumW);
+        }
+
+        /// \brief Filter one pixel whose taps may fall outside the image. Those taps are clamped to the border
+        void filterPixel(Planes const& in, std::array<std::vector<float>, 3>& out, int width, int height, int y, int x, Weights const& w) noexcept
+        {
+            std::array<int, 5> rows {};
+            std::array<int, 5> columns {};
+
+            for (int k = 0; k < 5; ++k) {
+                rows[static_cast<std::size_t>(k)] = std::clamp(y + (k - 2) * w.step, 0, height - 1);
+                columns[static_cast<std::size_t>(k)] = std::clamp(x + (k - 2) * w.step, 0, width - 1);
+            }
+
+            auto const centre = static_cast<std::size_t>(y) * width + x;
+            auto const at = [&](std::vector<float> const& plane, std::size_t i) { return plane[i]; };
+
+            float const lum = (0.2126f * in.colour[0][centre]) + (0.7152f * in.colour[1][centre]) + (0.0722f * in.colour[2][centre]);
+            float const colourScale = w.inverseColour / ((lum * lum) + 1e-4f);
+
+            std::array<float, 3> sum {};
+            float sumW = 0.0f;
+
+            for (std::size_t ky = 0; ky < 5; ++ky) {
+                for (std::size_t kx = 0; kx < 5; ++kx) {
+                    auto const q = static_cast<std::size_t>(rows[ky]) * width + static_cast<std::size_t>(columns[kx]);
+                    float colourDistance = 0.0f;
+                    float normalDistance = 0.0f;
+                    float albedoDistance = 0.0f;
+
+                    for (std::size_t c = 0; c < 3; ++c) {
+                        auto const dc = at(in.colour[c], q) - at(in.colour[c], centre);
+                        auto const dn = at(in.normal[c], q) - at(in.normal[c], centre);
+                        auto const da = at(in.albedo[c], q) - at(in.albedo[c], centre);
+
+                        colourDistance += dc * dc;
+                        normalDistance += dn * dn;
+                        albedoDistance += da * da;
+                    }
+
+                    auto const z = in.depth[centre];
+                    auto const qz = in.depth[q];
+                    auto const depthDistance = std::fabs(qz - z) * w.inverseDepth / (std::fmin(z, qz) + 1e-3f);
+
+                    auto const exponent = (colourDistance * colourScale) + (normalDistance * w.inverseNormal) + depthDistance + (albedoDistance * w.inverseAlbedo);
+                    auto const weight = kernel[kx] * kernel[ky] * std::exp(-std::fmin(exponent, 80.0f));
+
+                    for (std::size_t c = 0; c < 3; ++c) {
+                        sum[c] += weight * in.colour[c][q];
+                    }
+
+                    sumW += weight;
+                }
+            }
+
+            for (std::size_t c = 0; c < 3; ++c) {
+                out[c][centre] = sum[c] / sumW;
+            }
+        }
+
+        /// \brief Split the framebuffer into planes, dividing the lighting by the albedo
+        Planes makePlanes(Framebuffer const& framebuffer)
+        {
+            auto const size = framebuffer.colour.size();
+            Planes planes;
+
+            for (std::size_t c = 0; c < 3; ++c) {
+                planes.colour[c].resize(size);
+                planes.normal[c].resize(size);
+                planes.albedo[c].resize(size);
+            }
+
+            planes.depth.resize(size);
+
+            for (std::size_t i = 0; i < size; ++i) {
+                auto const colour = framebuffer.mean(i);
+
+                for (gsl::index c = 0; c < 3; ++c) {
+                    auto const k = static_cast<std::size_t>(c);
+                    auto const albedo = static_cast<float>(framebuffer.albedo[i][c]);
+
+                    planes.albedo[k][i] = albedo;
+                    planes.colour[k][i] = static_cast<float>(colour[c]) / std::max(albedo, albedoEpsilon);
+                    planes.normal[k][i] = static_cast<float>(framebuffer.normal[i][c]);
+                }
+
+                planes.depth[i] = std::isfinite(framebuffer.depth[i]) ? static_cast<float>(framebuffer.depth[i]) : missDepth;
+            }
+
+            return planes;
+        }
+    }
+
+    std::vector<Colour> denoise(Framebuffer const& framebuffer, DenoiseSettings const& settings)
+    {
+        PhaseTimer const timer("denoise");
+        auto const width = framebuffer.width;
+        auto const height = framebuffer.height;
+
+        Planes planes = makePlanes(framebuffer);
+        std::array<std::vector<float>, 3> filtered = planes.colour;
+
+        for (int iteration = 0; iteration < settings.iterations; ++iteration) {
+            TraceScope const span("denoise pass", iteration);
+            auto const step = 1 << iteration;
+
+            // Colour tolerance tightens as the image gets smoother
+            auto const colourSigma = settings.colourSigma * std::pow(2.0f, -static_cast<float>(iteration) / 2);
+            Weights const weights {
+                step,
+                1.0f / (colourSigma * colourSigma),
+                1.0f / (settings.normalSigma * settings.normalSigma),
+                1.0f / (settings.depthSigma * static_cast<float>(step)),
+                1.0f / (settings.albedoSigma * settings.albedoSigma)
+            };
+
+            // Columns whose horizontal taps are all inside the image can be filtered four at a time
+            auto const firstInterior = std::min(2 * step, width);
+            auto const lastInterior = std::max(firstInterior, width - (2 * step));
+
+            parallelFor(static_cast<std::size_t>(height), settings.threads, [&](std::size_t row, unsigned) {
+                auto const y = static_cast<int>(row);
+                std::array<int, 5> rows {};
+                std::array<int, 5> columns {};
+
+                for (int k = 0; k < 5; ++k) {
+                    rows[static_cast<std::size_t>(k)] = std::clamp(y + (k - 2) * step, 0, height - 1);
+                }
+
+                int x = 0;
+
+                for (; x < firstInterior; ++x) {
+                    filterPixel(planes, filtered, width, height, y, x, weights);
+                }
+
+                for (; x + static_cast<int>(lanes) <= lastInterior; x += static_cast<int>(lanes)) {
+                    for (int k = 0; k < 5; ++k) {
+                        columns[static_cast<std::size_t>(k)] = x + (k - 2) * step;
+                    }
+
+                    filterLanes(planes, filtered, width, y, x, rows, columns, weights);
+                }
+
+                for (; x < width; ++x) {
+                    filterPixel(planes, filtered, width, height, y, x, weights);
+                }
+            });
+
+            std::swap(planes.colour, filtered);
+        }
+
+        std::vector<Colour> result(framebuffer.colour.size());
+
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            auto const albedo = [&](std::size_t c) { return static_cast<double>(std::max(planes.albedo[c][i], albedoEpsilon)); };
+
+            result[i] = Colour(planes.colour[0][i] * albedo(0), planes.colour[1][i] * albedo(1), planes.colour[2][i] * albedo(2));
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,533 @@
+#include "Distributed.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <gsl/assert>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace rt
+{
+    namespace
+    {
+        constexpr std::uint32_t protocolMagic = 0x4b575452;   // "RTWK" in little-endian order
+        constexpr std::uint32_t protocolVersion = 1;
+
+        enum class MessageType : std::uint32_t
+        {
+            Hello = 1,      // Worker to coordinator: the protocol version
+            Job,            // Coordinator to worker: the scene and the image, as text
+            Tile,           // Coordinator to worker: a tile to render
+            Result,         // Worker to coordinator: the tile index followed by float RGB sums
+            Done            // Coordinator to worker: the frame is finished
+        };
+
+        struct MessageHeader
+        {
+            std::uint32_t magic;
+            MessageType type;
+            std::uint64_t size;
+        };
+
+        struct TileMessage
+        {
+            std::int32_t index;
+            std::int32_t x0;
+            std::int32_t y0;
+            std::int32_t x1;
+            std::int32_t y1;
+        };
+
+        void sendMessage(Socket const& socket, MessageType const type, void const* payload, std::size_t const size)
+        {
+            MessageHeader const header {protocolMagic, type, size};
+
+            socket.sendAll(&header, sizeof(header));
+            socket.sendAll(payload, size);
+        }
+
+        /// \brief Receive a message
+        /// \returns false if the peer closed the connection between messages
+        /// \throws std::runtime_error if the message is not part of the protocol
+        bool receiveMessage(Socket const& socket, MessageType& type, std::vector<char>& payload)
+        {
+            MessageHeader header {};
+
+            if (not socket.receiveAll(&header, sizeof(header))) {
+                return false;
+            }
+
+            // Results are the largest messages, and a tile is at most a few megabytes
+            if (header.magic != protocolMagic or header.size > (std::uint64_t{1} << 30)) {
+                throw std::runtime_error("Received a message that is not part of the protocol");
+            }
+
+            type = header.type;
+            payload.resize(static_cast<std::size_t>(header.size));
+
+            if (not payload.empty() and not socket.receiveAll(payload.data(), payload.size())) {
+                throw std::runtime_error("Connection closed in the middle of a message");
+            }
+
+            return true;
+        }
+
+        std::string formatSceneDescription(SceneDescription const& description)
+        {
+            for (auto const* value : { &description.name, &description.texture, &description.environment }) {
+                if (value->find_first_of(" \t\n") != std::string::npos) {
+                    throw std::invalid_argument("Scene names and file paths sent to workers cannot contain spaces: " + *value);
+                }
+            }
+
+            std::ostringstream line;
+            line.precision(17);
+            line << "scene name=" << description.name << " seed=" << description.seed << " texture=" << description.texture
+                 << " environment=" << description.environment << " environment-scale=" << description.environmentScale
+                 << " lazy=" << (description.lazyHierarchy ? 1 : 0);
+
+            return line.str();
+        }
+
+        SceneDescription parseSceneDescription(std::string const& line)
+        {
+            std::istringstream fields(line);
+            std::string command;
+            fields >> command;
+
+            if (command != "scene") {
+                throw std::runtime_error("Expected a scene description: " + line);
+            }
+
+            SceneDescription description;
+
+            for (std::string field; fields >> field;) {
+                auto const equals = field.find('=');
+                auto const name = field.substr(0, equals);
+                auto const value = equals == std::string::npos ? std::string() : field.substr(equals + 1);
+
+                if (name == "name") {
+                    description.name = value;
+                }
+                else if (name == "seed") {
+                    description.seed = static_cast<std::uint32_t>(std::stoul(value));
+                }
+                else if (name == "texture") {
+                    description.texture = value;
+                }
+                else if (name == "environment") {
+                    description.environment = value;
+                }
+                else if (name == "environment-scale") {
+                    description.environmentScale = std::stod(value);
+                }
+                else if (name == "lazy") {
+                    description.lazyHierarchy = value == "1";
+                }
+                else {
+                    throw std::runtime_error("Unknown scene field: " + name);
+                }
+            }
+
+            return description;
+        }
+
+        /// \brief Hand tiles to one worker until the frame is done or the worker fails
+        /// \param[inout] framebuffer Receives the first copy of every tile the worker finishes
+        /// \returns The number of tiles kept from this worker
+        int serveWorker(Socket const& connection, std::string const& job, std::chrono::seconds const timeout, TileScheduler& scheduler, Framebuffer& framebuffer)
+        {
+            connection.setReceiveTimeout(timeout);
+
+            MessageType type {};
+            std::vector<char> payload;
+
+            if (not receiveMessage(connection, type, payload) or type != MessageType::Hello or payload.size() != sizeof(protocolVersion)) {
+                throw std::runtime_error("Expected a hello message");
+            }
+
+            std::uint32_t version {};
+            std::memcpy(&version, payload.data(), sizeof(version));
+
+            if (version != protocolVersion) {
+                throw std::runtime_error("Worker speaks protocol version " + std::to_string(version));
+            }
+
+            sendMessage(connection, MessageType::Job, job.data(), job.size());
+
+            int kept = 0;
+
+            while (auto const tile = scheduler.next()) {
+                try {
+                    TileMessage const message {tile->index, tile->x0, tile->y0, tile->x1, tile->y1};
+                    sendMessage(connection, MessageType::Tile, &message, sizeof(message));
+
+                    auto const expectedSize = sizeof(std::int32_t) + (static_cast<std::size_t>(tile->area()) * 3 * sizeof(float));
+
+                    if (not receiveMessage(connection, type, payload) or type != MessageType::Result or payload.size() != expectedSize) {
+                        throw std::runtime_error("Expected the pixels of tile " + std::to_string(tile->index));
+                    }
+                }
+                catch (...) {
+                    // A worker that timed out may still be alive, so close the connection rather than wait for the tile
+                    scheduler.abandon(*tile);
+                    connection.shutdown();
+                    throw;
+                }
+
+                if (not scheduler.complete(*tile)) {
+                    continue;
+                }
+
+                auto const* sums = payload.data() + sizeof(std::int32_t);
+
+                for (auto y = tile->y0; y < tile->y1; ++y) {
+                    for (auto x = tile->x0; x < tile->x1; ++x) {
+                        float rgb[3];
+                        std::memcpy(rgb, sums, sizeof(rgb));
+                        sums += sizeof(rgb);
+
+                        framebuffer.colour[framebuffer.index(x, y)] = Colour(rgb[0], rgb[1], rgb[2]);
+                    }
+                }
+
+                ++kept;
+            }
+
+            try {
+                sendMessage(connection, MessageType::Done, nullptr, 0);
+            }
+            catch (std::runtime_error const&) {
+                // The coordinator closes every connection once the frame is done, so the worker may be gone already
+            }
+
+            return kept;
+        }
+    }
+
+    TileScheduler::TileScheduler(int const width, int const height, int const tileSize, double const slowFactor)
+    :   m_slowFactor(slowFactor)
+    {
+        Expects(width > 0 and height > 0 and tileSize > 0);
+
+        for (int y = 0; y < height; y += tileSize) {
+            for (int x = 0; x < width; x += tileSize) {
+                auto const index = static_cast<int>(m_tiles.size());
+
+                m_tiles.push_back(Tile {index, x, y, std::min(x + tileSize, width), std::min(y + tileSize, height)});
+                m_pending.push_back(index);
+            }
+        }
+
+        m_states.resize(m_tiles.size());
+    }
+
+    std::optional<Tile> TileScheduler::next()
+    {
+        std::unique_lock lock(m_mutex);
+
+        while (true) {
+            if (m_cancelled or m_done == m_tiles.size()) {
+                return std::nullopt;
+            }
+
+            auto const now = Clock::now();
+
+            if (not m_pending.empty()) {
+                auto const index = m_pending.front();
+                m_pending.pop_front();
+
+                auto& state = m_states[static_cast<std::size_t>(index)];
+                state.copies = 1;
+                state.started = now;
+
+                return m_tiles[static_cast<std::size_t>(index)];
+            }
+
+            if (auto const tile = slowTile(now)) {
+                return tile;
+            }
+
+            // Tiles in flight may become slow without anything else changing, so look again every so often
+            m_changed.wait_for(lock, std::chrono::milliseconds(50));
+        }
+    }
+
+    bool TileScheduler::complete(Tile const& tile)
+    {
+        std::lock_guard lock(m_mutex);
+        auto& state = m_states[static_cast<std::size_t>(tile.index)];
+
+        state.copies = std::max(0, state.copies - 1);
+
+        if (state.done) {
+            return false;
+        }
+
+        state.done = true;
+        ++m_done;
+        m_renderTime += Clock::now() - state.started;
+        m_changed.notify_all();
+
+        return true;
+    }
+
+    void TileScheduler::abandon(Tile const& tile)
+    {
+        std::lock_guard lock(m_mutex);
+        auto& state = m_states[static_cast<std::size_t>(tile.index)];
+
+        state.copies = std::max(0, state.copies - 1);
+
+        if (not state.done and state.copies == 0) {
+            m_pending.push_front(tile.index);
+            ++m_reassigned;
+            m_changed.notify_all();
+        }
+    }
+
+    void TileScheduler::cancel()
+    {
+        std::lock_guard lock(m_mutex);
+        m_cancelled = true;
+        m_changed.notify_all();
+    }
+
+    bool TileScheduler::finished() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_done == m_tiles.size();
+    }
+
+    std::size_t TileScheduler::reassignments() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_reassigned;
+    }
+
+    std::optional<Tile> TileScheduler::slowTile(Clock::time_point const now)
+    {
+        if (m_done == 0) {
+            return std::nullopt;
+        }
+
+        auto const threshold = m_slowFactor * std::chrono::duration<double>(m_renderTime).count() / static_cast<double>(m_done);
+        TileState* slowest = nullptr;
+
+        for (auto& state : m_states) {
+            auto const elapsed = std::chrono::duration<double>(now - state.started).count();
+
+            if (not state.done and state.copies == 1 and elapsed > threshold and (slowest == nullptr or state.started < slowest->started)) {
+                slowest = &state;
+            }
+        }
+
+        if (slowest == nullptr) {
+            return std::nullopt;
+        }
+
+        ++slowest->copies;
+        ++m_reassigned;
+
+        return m_tiles[static_cast<std::size_t>(slowest - m_states.data())];
+    }
+
+    Coordinator::Coordinator(std::uint16_t const port)
+    :   m_listener(listenTcp(port))
+    ,   m_port(localPort(m_listener))
+    {
+    }
+
+    void Coordinator::render(SceneDescription const& scene, RenderJob const& job, CoordinatorSettings const& settings, Framebuffer& framebuffer)
+    {
+        Expects(framebuffer.width == job.settings.width and framebuffer.height == job.settings.height);
+
+        auto const jobText = formatSceneDescription(scene) + '\n' + formatRenderJob(job) + '\n';
+
+        TileScheduler scheduler(job.settings.width, job.settings.height, settings.tileSize, settings.slowFactor);
+        std::vector<std::unique_ptr<Socket>> connections;
+        std::vector<std::thread> handlers;
+        std::atomic<int> connected {0};
+        int workerCount = 0;
+
+        auto lastConnected = std::chrono::steady_clock::now();
+        bool timedOut = false;
+
+        while (not scheduler.finished()) {
+            pollfd listener {m_listener.fd(), POLLIN, 0};
+
+            if (::poll(&listener, 1, 100) > 0) {
+                auto connection = std::make_unique<Socket>(acceptConnection(m_listener));
+                auto const worker = workerCount++;
+                ++connected;
+
+                handlers.emplace_back([&, worker, socket = connection.get()] {
+                    try {
+                        auto const kept = serveWorker(*socket, jobText, settings.tileTimeout, scheduler, framebuffer);
+                        std::cerr << "Worker " << worker << " finished " << kept << " tiles\n";
+                    }
+                    catch (std::exception const& e) {
+                        // Once the frame is done, connections to workers still rendering duplicate tiles are closed on purpose
+                        if (not scheduler.finished()) {
+                            std::cerr << "Worker " << worker << " lost: " << e.what() << '\n';
+                        }
+                    }
+
+                    --connected;
+                });
+
+                connections.push_back(std::move(connection));
+            }
+
+            auto const now = std::chrono::steady_clock::now();
+
+            if (connected > 0) {
+                lastConnected = now;
+            }
+            else if (now - lastConnected > settings.workerTimeout) {
+                timedOut = true;
+                break;
+            }
+        }
+
+        // Wake workers still rendering copies of tiles that are already done. They see the connection close and exit
+        scheduler.cancel();
+
+        for (auto const& connection : connections) {
+            connection->shutdown();
+        }
+
+        for (auto& handler : handlers) {
+            handler.join();
+        }
+
+        if (timedOut) {
+            throw std::runtime_error("No worker has been connected for " + std::to_string(settings.workerTimeout.count()) + " s");
+        }
+
+        framebuffer.samplesPerPixel = job.settings.samplesPerPixel;
+
+        std::cerr << "Rendered " << scheduler.tileCount() << " tiles on " << workerCount << " workers, "
+                  << scheduler.reassignments() << " handed out again\n";
+    }
+
+    namespace detail
+    {
+        /// \brief Run a worker, calling @param beforeTile with the number of tiles rendered so far before every tile.
+        /// If it returns false the worker disconnects as if it had died. Tests declare this to inject faults
+        void runWorker(std::string const& address, WorkerSettings const& settings, std::function<bool(int)> const& beforeTile);
+    }
+
+    void runWorker(std::string const& address, WorkerSettings const& settings)
+    {
+        detail::runWorker(address, settings, [](int) { return true; });
+    }
+
+    void detail::runWorker(std::string const& address, WorkerSettings const& settings, std::function<bool(int)> const& beforeTile)
+    {
+        auto const connection = connectTcp(address);
+        sendMessage(connection, MessageType::Hello, &protocolVersion, sizeof(protocolVersion));
+
+        MessageType type {};
+        std::vector<char> payload;
+
+        if (not receiveMessage(connection, type, payload) or type != MessageType::Job) {
+            throw std::runtime_error("Expected a job from the coordinator");
+        }
+
+        std::istringstream text(std::string(payload.begin(), payload.end()));
+        std::string sceneLine;
+        std::string jobLine;
+        std::getline(text, sceneLine);
+        std::getline(text, jobLine);
+
+        auto job = parseRenderJob(jobLine, RenderJob {});
+        job.settings.threads = settings.threads;
+        job.settings.showProgress = false;
+
+        auto const scene = makeScene(parseSceneDescription(sceneLine));
+        Camera const camera(job.camera, static_cast<double>(job.settings.width) / job.settings.height);
+
+        std::vector<Colour> colour;
+        std::vector<char> result;
+        int tiles = 0;
+
+        while (receiveMessage(connection, type, payload) and type == MessageType::Tile) {
+            if (not beforeTile(tiles) or payload.size() != sizeof(TileMessage)) {
+                return;
+            }
+
+            TileMessage message {};
+            std::memcpy(&message, payload.data(), sizeof(message));
+
+            Tile const tile {message.index, message.x0, message.y0, message.x1, message.y1};
+
+            if (tile.x0 < 0 or tile.x0 >= tile.x1 or tile.x1 > job.settings.width or tile.y0 < 0 or tile.y0 >= tile.y1 or tile.y1 > job.settings.height) {
+                throw std::runtime_error("Received a tile outside the image");
+            }
+
+            renderTile(scene, camera, job.settings, tile, colour);
+
+            result.resize(sizeof(std::int32_t) + (colour.size() * 3 * sizeof(float)));
+            std::memcpy(result.data(), &message.index, sizeof(message.index));
+
+            auto* out = result.data() + sizeof(std::int32_t);
+
+            for (auto const& c : colour) {
+                float const rgb[3] { static_cast<float>(c.x()), static_cast<float>(c.y()), static_cast<float>(c.z()) };
+                std::memcpy(out, rgb, sizeof(rgb));
+                out += sizeof(rgb);
+            }
+
+            sendMessage(connection, MessageType::Result, result.data(), result.size());
+            ++tiles;
+        }
+    }
+
+    std::vector<int> spawnLocalWorkers(int const count, std::uint16_t const port, unsigned const threadsPerWorker)
+    {
+        auto const address = "127.0.0.1:" + std::to_string(port);
+        auto const threads = std::to_string(std::max(1u, threadsPerWorker));
+        std::vector<int> processIds;
+
+        for (int i = 0; i < count; ++i) {
+            auto const pid = ::fork();
+
+            if (pid < 0) {
+                throw std::runtime_error(std::string("Cannot start a worker: ") + std::strerror(errno));
+            }
+
+            if (pid == 0) {
+                // The image goes to the standard output of the coordinator, so workers must not write to it
+                auto const devNull = ::open("/dev/null", O_WRONLY);
+                ::dup2(devNull, STDOUT_FILENO);
+
+                ::execl("/proc/self/exe", "raytracer", "--worker", address.c_str(), "--threads", threads.c_str(), static_cast<char*>(nullptr));
+                ::_exit(127);
+            }
+
+            processIds.push_back(pid);
+        }
+
+        return processIds;
+    }
+
+    void waitForWorkers(std::vector<int> const& processIds)
+    {
+        for (auto const pid : processIds) {
+            while (::waitpid(pid, nullptr, 0) < 0 and errno == EINTR) {
+            }
+        }
+    }
+}
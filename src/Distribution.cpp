@@ -0,0 +1,98 @@
+#include "Distribution.hpp"
+
+#include <algorithm>
+#include <gsl/assert>
+
+namespace rt
+{
+    Distribution1D::Distribution1D(std::vector<double> values) : m_function(std::move(values)), m_cdf(m_function.size() + 1)
+    {
+        Expects(not m_function.empty());
+
+        auto const n = static_cast<double>(m_function.size());
+        m_cdf[0] = 0.0;
+
+        for (std::size_t i = 0; i < m_function.size(); ++i) {
+            m_cdf[i + 1] = m_cdf[i] + (m_function[i] / n);
+        }
+
+        m_integral = m_cdf.back();
+
+        // A function that is zero everywhere is sampled uniformly
+        if (m_integral <= 0) {
+            for (std::size_t i = 1; i < m_cdf.size(); ++i) {
+                m_cdf[i] = static_cast<double>(i) / n;
+            }
+        }
+        else {
+            for (auto& c : m_cdf) {
+                c /= m_integral;
+            }
+        }
+    }
+
+    double Distribution1D::sampleContinuous(double const u, double& pdf, std::size_t& offset) const noexcept
+    {
+        // Find the last CDF entry that is <= u
+        auto const upper = std::upper_bound(m_cdf.cbegin(), m_cdf.cend(), u);
+        offset = static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(upper - m_cdf.cbegin() - 1, 0, static_cast<std::ptrdiff_t>(count()) - 1));
+
+        auto const width = m_cdf[offset + 1] - m_cdf[offset];
+        auto const du = width > 0 ? (u - m_cdf[offset]) / width : 0.0;
+
+        pdf = this->pdf(offset);
+
+        return std::min((static_cast<double>(offset) + du) / static_cast<double>(count()), 1.0 - 1e-12);
+    }
+
+    double Distribution1D::pdf(std::size_t const index) const noexcept
+    {
+        if (m_integral <= 0) {
+            return 1.0;
+        }
+
+        return m_function[index] / m_integral;
+    }
+
+    Distribution2D::Distribution2D(std::vector<double> const& values, std::size_t const width, std::size_t const height)
+    {
+        Expects(values.size() == width * height);
+
+        std::vector<double> rowIntegrals;
+        m_conditional.reserve(height);
+        rowIntegrals.reserve(height);
+
+        for (std::size_t row = 0; row < height; ++row) {
+            auto const first = values.cbegin() + static_cast<std::ptrdiff_t>(row * width);
+            m_conditional.emplace_back(std::vector<double>(first, first + static_cast<std::ptrdiff_t>(width)));
+            rowIntegrals.push_back(m_conditional.back().integral());
+        }
+
+        m_marginal = Distribution1D(std::move(rowIntegrals));
+    }
+
+    void Distribution2D::sample(double const u1, double const u2, double& u, double& v, double& pdf) const noexcept
+    {
+        double marginalPdf {};
+        double conditionalPdf {};
+        std::size_t row {};
+        std::size_t column {};
+
+        v = m_marginal.sampleContinuous(u2, marginalPdf, row);
+        u = m_conditional[row].sampleContinuous(u1, conditionalPdf, column);
+
+        pdf = marginalPdf * conditionalPdf;
+    }
+
+    double Distribution2D::pdf(double const u, double const v) const noexcept
+    {
+        auto const toIndex = [](double x, std::size_t n) {
+            return std::min(static_cast<std::size_t>(std::max(x, 0.0) * static_cast<double>(n)), n - 1);
+        };
+
+        auto const row = toIndex(v, m_marginal.count());
+        auto const column = toIndex(u, m_conditional[row].count());
+
+        return m_marginal.pdf(row) * m_conditional[row].pdf(column);
+    }
+}
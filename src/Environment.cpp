@@ -0,0 +1,92 @@
+#include "Environment.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <gsl/assert>
+
+namespace rt
+{
+    Colour SkyGradient::radiance(Vec3 const& direction) const
+    {
+        Vec3 unitDirection = unitVector(direction);    // scale the ray direction to unit length
+        auto const t = 0.5 * (unitDirection.y() + 1.0);
+
+        // blendedValue = (1 - t) * startValue + t * endValue
+        return (1.0 - t) * Colour(1.0, 1.0, 1.0) + t * Colour(0.5, 0.7, 1.0);
+    }
+
+    EnvironmentMap::EnvironmentMap(HdrImage image, double const scale) : m_image(std::move(image))
+    {
+        Expects(m_image.width > 0 and m_image.height > 0);
+
+        for (auto& pixel : m_image.pixels) {
+            pixel *= scale;
+        }
+
+        // Rows near the poles cover less solid angle, so weight each pixel by sin(theta) as well as its brightness
+        std::vector<double> weights(m_image.pixels.size());
+
+        for (int y = 0; y < m_image.height; ++y) {
+            auto const sinTheta = std::sin(pi * (y + 0.5) / m_image.height);
+
+            for (int x = 0; x < m_image.width; ++x) {
+                weights[static_cast<std::size_t>(y) * m_image.width + x] = luminance(m_image.at(x, y)) * sinTheta;
+            }
+        }
+
+        m_distribution = Distribution2D(weights, static_cast<std::size_t>(m_image.width), static_cast<std::size_t>(m_image.height));
+    }
+
+    void EnvironmentMap::toImageCoordinates(Vec3 const& direction, double& u, double& v) noexcept
+    {
+        Vec3 const d = unitVector(direction);
+        auto phi = std::atan2(d.z(), d.x());
+
+        if (phi < 0) {
+            phi += 2.0 * pi;
+        }
+
+        u = phi / (2.0 * pi);
+        v = std::acos(clamp(d.y(), -1.0, 1.0)) / pi;
+    }
+
+    Colour EnvironmentMap::radiance(Vec3 const& direction) const
+    {
+        double u {};
+        double v {};
+        toImageCoordinates(direction, u, v);
+
+        auto const x = std::min(static_cast<int>(u * m_image.width), m_image.width - 1);
+        auto const y = std::min(static_cast<int>(v * m_image.height), m_image.height - 1);
+
+        return m_image.at(x, y);
+    }
+
+    Vec3 EnvironmentMap::sample(double& pdf) const
+    {
+        double u {};
+        double v {};
+        double mapPdf {};
+        m_distribution.sample(randomDouble(), randomDouble(), u, v, mapPdf);
+
+        auto const theta = v * pi;
+        auto const phi = u * 2.0 * pi;
+        auto const sinTheta = std::sin(theta);
+
+        // Convert the density from image area to solid angle
+        pdf = sinTheta > 0 ? mapPdf / (2.0 * pi * pi * sinTheta) : 0.0;
+
+        return Vec3(sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi));
+    }
+
+    double EnvironmentMap::pdf(Vec3 const& direction) const
+    {
+        double u {};
+        double v {};
+        toImageCoordinates(direction, u, v);
+
+        auto const sinTheta = std::sin(v * pi);
+
+        return sinTheta > 0 ? m_distribution.pdf(u, v) / (2.0 * pi * pi * sinTheta) : 0.0;
+    }
+}
@@ -0,0 +1,26 @@
+#include "Framebuffer.hpp"
+
+namespace rt
+{
+    Framebuffer::Framebuffer(int const width, int const height)
+    :   width(width)
+    ,   height(height)
+    ,   colour(static_cast<std::size_t>(width) * height)
+    ,   albedo(colour.size())
+    ,   normal(colour.size())
+    ,   depth(colour.size())
+    {
+    }
+
+    void writePpmHeader(std::ostream& out, int const width, int const height)
+    {
+        out << "P3\n" << width << ' ' << height << "\n255\n";
+    }
+
+    void writePpm(std::ostream& out, std::vector<Colour> const& pixels, int const width, int const height)
+    {
+        writePpmHeader(out, width, height);
+
+        writeBytes(out, toBytes(pixels, 1));
+    }
+}
@@ -0,0 +1,402 @@
+#include "FrozenScene.hpp"
+#include "HittableList.hpp"
+#include "Kernels.hpp"
+#include "Scene.hpp"
+#include "Sphere.hpp"
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief Every section of the arena starts on its own cache line
+        constexpr std::size_t sectionAlignment = 64;
+
+        /// \brief Deeper than any tree a Bvh builds
+        constexpr std::size_t stackSize = 64;
+
+        std::size_t alignUp(std::size_t const size) noexcept
+        {
+            return (size + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+        }
+
+        KernelRay toKernelRay(Ray const& ray) noexcept
+        {
+            auto const origin = ray.getOrigin();
+            auto const direction = ray.getDirection();
+
+            return {{origin.x(), origin.y(), origin.z()}, {direction.x(), direction.y(), direction.z()}};
+        }
+
+        /// \brief The objects of a world, sorted by where they go in the frozen scene
+        struct Gathered
+        {
+            std::vector<std::shared_ptr<Hittable>> outside;     // Spheres tested against every ray
+            std::vector<std::shared_ptr<Hittable>> tree;        // Spheres of the hierarchies
+            std::vector<std::shared_ptr<Hittable>> others;      // Everything that is not a sphere
+            std::vector<Bvh const*> hierarchies;
+            bool onlySpheresInTrees {true};
+
+            void add(std::vector<std::shared_ptr<Hittable>> const& objects)
+            {
+                for (auto const& object : objects) {
+                    if (dynamic_cast<Sphere const*>(object.get()) != nullptr) {
+                        outside.push_back(object);
+                    }
+                    else if (auto const* bvh = dynamic_cast<Bvh const*>(object.get())) {
+                        hierarchies.push_back(bvh);
+
+                        for (auto const& member : bvh->objects()) {
+                            if (dynamic_cast<Sphere const*>(member.get()) != nullptr) {
+                                tree.push_back(member);
+                            }
+                            else {
+                                others.push_back(member);
+                                onlySpheresInTrees = false;
+                            }
+                        }
+
+                        others.insert(others.end(), bvh->unbounded().cbegin(), bvh->unbounded().cend());
+                    }
+                    else if (auto const* list = dynamic_cast<HittableList const*>(object.get())) {
+                        add(list->objects());
+                    }
+                    else {
+                        others.push_back(object);
+                    }
+                }
+            }
+        };
+    }
+
+    void FrozenScene::ArenaDeleter::operator()(std::byte* arena) const noexcept
+    {
+        ::operator delete[](arena, std::align_val_t {sectionAlignment});
+    }
+
+    FrozenScene::Sections FrozenScene::Sections::movedTo(std::byte const* from, std::byte const* to) const noexcept
+    {
+        auto const move = [from, to](auto const* view) {
+            using View = decltype(view);
+            return reinterpret_cast<View>(to + (reinterpret_cast<std::byte const*>(view) - from));
+        };
+
+        return {move(nodes), move(x), move(y), move(z), move(radius), move(material), move(materialTable)};
+    }
+
+    FrozenScene::Arena FrozenScene::allocate() const
+    {
+        return Arena(static_cast<std::byte*>(::operator new[](std::max<std::size_t>(m_bytes, 1), std::align_val_t {sectionAlignment})));
+    }
+
+    FrozenScene::FrozenScene(std::vector<std::shared_ptr<Hittable>> const& objects)
+    {
+        PhaseTimer const timer("freeze");
+
+        Gathered gathered;
+        gathered.add(objects);
+        m_others = std::move(gathered.others);
+
+        // A single hierarchy of spheres is copied node for node, so the frozen scene traces exactly as it did.
+        // Otherwise the spheres of all the hierarchies are gathered into a new one
+        std::unique_ptr<Bvh> built;
+        Bvh const* source = nullptr;
+
+        if (gathered.hierarchies.size() == 1 and gathered.onlySpheresInTrees) {
+            source = gathered.hierarchies.front();
+        }
+        else if (not gathered.tree.empty()) {
+            built = std::make_unique<Bvh>(gathered.tree);
+            source = built.get();
+        }
+
+        std::vector<Sphere const*> spheres;
+
+        for (auto const& object : gathered.outside) {
+            spheres.push_back(static_cast<Sphere const*>(object.get()));
+        }
+
+        if (source != nullptr) {
+            for (auto const& object : source->objects()) {
+                spheres.push_back(static_cast<Sphere const*>(object.get()));
+            }
+        }
+
+        auto const nodeCount = source != nullptr ? source->nodes().size() : std::size_t {0};
+
+        if (spheres.size() >= std::numeric_limits<std::uint32_t>::max() or nodeCount >= std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("Too many objects to freeze");
+        }
+
+        m_sphereCount = static_cast<std::uint32_t>(spheres.size());
+        m_nodeCount = static_cast<std::uint32_t>(nodeCount);
+        m_outside = static_cast<std::uint32_t>(gathered.outside.size());
+
+        // Materials shared by many spheres are stored once
+        std::unordered_map<Material const*, std::uint32_t> materialIndex;
+        std::vector<std::uint32_t> materials(spheres.size());
+
+        for (std::size_t i = 0; i < spheres.size(); ++i) {
+            auto const& material = spheres[i]->material();
+            auto const [entry, added] = materialIndex.emplace(material.get(), static_cast<std::uint32_t>(m_materials.size()));
+
+            if (added) {
+                m_materials.push_back(material);
+            }
+
+            materials[i] = entry->second;
+        }
+
+        // Lay out the sections and allocate them all at once
+        auto const nodeBytes = alignUp(nodeCount * sizeof(Bvh::Node));
+        auto const coordinateBytes = alignUp(spheres.size() * sizeof(double));
+        auto const indexBytes = alignUp(spheres.size() * sizeof(std::uint32_t));
+        auto const tableBytes = alignUp(m_materials.size() * sizeof(Material const*));
+
+        m_bytes = nodeBytes + (4 * coordinateBytes) + indexBytes + tableBytes;
+        m_arenas.push_back(allocate());
+
+        auto* cursor = m_arenas.front().get();
+        auto const section = [&cursor](std::size_t const bytes) {
+            auto* start = cursor;
+            cursor += bytes;
+            return start;
+        };
+
+        auto* nodes = reinterpret_cast<Bvh::Node*>(section(nodeBytes));
+        auto* x = reinterpret_cast<double*>(section(coordinateBytes));
+        auto* y = reinterpret_cast<double*>(section(coordinateBytes));
+        auto* z = reinterpret_cast<double*>(section(coordinateBytes));
+        auto* radius = reinterpret_cast<double*>(section(coordinateBytes));
+        auto* material = reinterpret_cast<std::uint32_t*>(section(indexBytes));
+        auto* table = reinterpret_cast<Material const**>(section(tableBytes));
+
+        for (std::size_t i = 0; i < nodeCount; ++i) {
+            auto node = source->nodes()[i];
+
+            // Leaves refer to the spheres of the tree, which come after the ones outside it
+            if (node.count > 0) {
+                node.offset += m_outside;
+            }
+
+            new (nodes + i) Bvh::Node(node);
+        }
+
+        for (std::size_t i = 0; i < spheres.size(); ++i) {
+            x[i] = spheres[i]->center().x();
+            y[i] = spheres[i]->center().y();
+            z[i] = spheres[i]->center().z();
+            radius[i] = spheres[i]->radius();
+            material[i] = materials[i];
+        }
+
+        for (std::size_t i = 0; i < m_materials.size(); ++i) {
+            table[i] = m_materials[i].get();
+        }
+
+        m_sections.push_back(Sections {nodes, x, y, z, radius, material, table});
+    }
+
+    void FrozenScene::replicateOnNodes()
+    {
+        auto const& nodes = numaNodes();
+        std::vector<Arena> arenas;
+
+        // Pages belong to the node of the thread that first writes them, so each copy is filled on its own node
+        for (std::size_t node = 0; node < nodes.size(); ++node) {
+            arenas.push_back(allocate());
+
+            std::thread([&, node] {
+                ThreadPin const pin(WorkerPlace {nodes[node].cpus.front(), node});
+                std::copy_n(m_arenas.front().get(), m_bytes, arenas[node].get());
+            }).join();
+        }
+
+        std::vector<Sections> sections;
+
+        for (auto const& arena : arenas) {
+            sections.push_back(m_sections.front().movedTo(m_arenas.front().get(), arena.get()));
+        }
+
+        m_arenas = std::move(arenas);
+        m_sections = std::move(sections);
+    }
+
+    void FrozenScene::hitSpheres(Sections const& data, std::uint32_t const first, std::uint32_t const count, Ray const& ray, double const tMin, double& closest, std::uint32_t& nearest) const noexcept
+    {
+        if (count == 0) {
+            return;
+        }
+
+        SphereBatch const batch {data.x + first, data.y + first, data.z + first, data.radius + first, count};
+        auto const index = kernels().closestSphere(batch, toKernelRay(ray), tMin, closest);
+        threadStatistics().intersectionTests[static_cast<std::size_t>(PrimitiveKind::sphere)].add(count);
+
+        // The kernel does the same arithmetic, so the sphere it picks is always hit
+        if (double t {}; index < count and Sphere::intersect(Point3(batch.x[index], batch.y[index], batch.z[index]), batch.radius[index], ray, tMin, closest, t)) {
+            closest = t;
+            nearest = first + static_cast<std::uint32_t>(index);
+        }
+    }
+
+    bool FrozenScene::hit(Ray const& ray, double const tMin, double const tMax, HitRecord& record) const noexcept
+    {
+        auto const& data = sections();
+        auto closest = tMax;
+        auto nearest = m_sphereCount;
+
+        hitSpheres(data, 0, m_outside, ray, tMin, closest, nearest);
+
+        if (m_nodeCount > 0) {
+            RayInverse const inverse(ray);
+            std::array<std::uint32_t, stackSize> stack;
+            std::size_t top = 0;
+            std::uint64_t visits = 0;
+            stack[top++] = 0;
+
+            while (top > 0) {
+                auto const& node = data.nodes[stack[--top]];
+                ++visits;
+
+                if (double tEntry {}; not node.box.hit(inverse, tMin, closest, tEntry)) {
+                    continue;
+                }
+
+                if (node.count > 0) {
+                    hitSpheres(data, node.offset, node.count, ray, tMin, closest, nearest);
+                }
+                else {
+                    // Push the far child first, so that the near one is visited first and shortens the interval
+                    auto const left = static_cast<std::uint32_t>(&node - data.nodes) + 1;
+
+                    if (inverse.negative[node.axis]) {
+                        stack[top++] = left;
+                        stack[top++] = node.offset;
+                    }
+                    else {
+                        stack[top++] = node.offset;
+                        stack[top++] = left;
+                    }
+                }
+            }
+
+            threadStatistics().nodeVisits.add(visits);
+        }
+
+        // Only the nearest sphere fills in the record
+        bool hitAnything = nearest < m_sphereCount;
+
+        if (hitAnything) {
+            Sphere::fillHit(Point3(data.x[nearest], data.y[nearest], data.z[nearest]), data.radius[nearest], ray, closest, record);
+            record.materialPtr = data.materialTable[data.material[nearest]];
+        }
+
+        for (auto const& object : m_others) {
+            if (object->hit(ray, tMin, closest, record)) {
+                hitAnything = true;
+                closest = record.t;
+            }
+        }
+
+        return hitAnything;
+    }
+
+    bool FrozenScene::occluded(Ray const& ray, double const tMin, double const tMax) const noexcept
+    {
+        auto const& data = sections();
+        auto const& simd = kernels();
+        auto const kernelRay = toKernelRay(ray);
+        auto& tests = threadStatistics().intersectionTests[static_cast<std::size_t>(PrimitiveKind::sphere)];
+
+        auto const blockedBy = [&](std::uint32_t const first, std::uint32_t const count) {
+            tests.add(count);
+            return count > 0 and simd.anySphere(SphereBatch {data.x + first, data.y + first, data.z + first, data.radius + first, count}, kernelRay, tMin, tMax);
+        };
+
+        if (blockedBy(0, m_outside)) {
+            return true;
+        }
+
+        if (m_nodeCount > 0) {
+            RayInverse const inverse(ray);
+            std::array<std::uint32_t, stackSize> stack;
+            std::size_t top = 0;
+            std::uint64_t visits = 0;
+            bool blocked = false;
+            stack[top++] = 0;
+
+            while (top > 0 and not blocked) {
+                auto const& node = data.nodes[stack[--top]];
+                ++visits;
+
+                if (double tEntry {}; not node.box.hit(inverse, tMin, tMax, tEntry)) {
+                    continue;
+                }
+
+                if (node.count > 0) {
+                    blocked = blockedBy(node.offset, node.count);
+                }
+                else {
+                    stack[top++] = node.offset;
+                    stack[top++] = static_cast<std::uint32_t>(&node - data.nodes) + 1;
+                }
+            }
+
+            threadStatistics().nodeVisits.add(visits);
+
+            if (blocked) {
+                return true;
+            }
+        }
+
+        return std::any_of(m_others.cbegin(), m_others.cend(), [&](auto const& object) {
+            return object->occluded(ray, tMin, tMax);
+        });
+    }
+
+    bool FrozenScene::boundingBox(Aabb& box) const noexcept
+    {
+        auto const& data = sections();
+        Aabb bounds = m_nodeCount > 0 ? data.nodes[0].box : Aabb();
+
+        for (std::uint32_t i = 0; i < m_outside; ++i) {
+            auto const extent = Vec3(data.radius[i], data.radius[i], data.radius[i]);
+            auto const center = Point3(data.x[i], data.y[i], data.z[i]);
+            bounds.merge(Aabb(center - extent, center + extent));
+        }
+
+        for (auto const& object : m_others) {
+            Aabb objectBox;
+
+            if (not object->boundingBox(objectBox)) {
+                return false;
+            }
+
+            bounds.merge(objectBox);
+        }
+
+        box = bounds;
+        return true;
+    }
+
+    std::shared_ptr<FrozenScene const> freezeScene(Scene& scene, bool const replicate)
+    {
+        auto frozen = std::make_shared<FrozenScene>(scene.world.objects());
+
+        if (replicate) {
+            frozen->replicateOnNodes();
+        }
+
+        scene.world = HittableList(frozen);
+
+        return frozen;
+    }
+}
@@ -0,0 +1,319 @@
+#include "HdrImage.hpp"
+#include "Common.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace rt
+{
+    namespace
+    {
+        using Rgbe = std::array<std::uint8_t, 4>;
+
+        /// \brief Convert a shared-exponent RGBE pixel to a floating point colour
+        Colour fromRgbe(Rgbe const& rgbe) noexcept
+        {
+            if (rgbe[3] == 0) {
+                return Colour(0, 0, 0);
+            }
+
+            auto const f = std::ldexp(1.0, static_cast<int>(rgbe[3]) - (128 + 8));
+            return Colour((rgbe[0] + 0.5) * f, (rgbe[1] + 0.5) * f, (rgbe[2] + 0.5) * f);
+        }
+
+        /// \brief Read one scanline, either flat or in the adaptive run-length encoding
+        void readRgbeScanline(std::istream& in, std::vector<Rgbe>& scanline)
+        {
+            auto const width = static_cast<int>(scanline.size());
+            Rgbe head {};
+
+            if (not in.read(reinterpret_cast<char*>(head.data()), 4)) {
+                throw std::runtime_error("Unexpected end of HDR file");
+            }
+
+            bool const isRunLengthEncoded = width >= 8 and width < 0x8000 and head[0] == 2 and head[1] == 2 and (head[2] & 0x80) == 0;
+
+            if (not isRunLengthEncoded) {
+                scanline[0] = head;
+
+                if (not in.read(reinterpret_cast<char*>(scanline[1].data()), static_cast<std::streamsize>(4 * (width - 1)))) {
+                    throw std::runtime_error("Unexpected end of HDR file");
+                }
+
+                return;
+            }
+
+            if (((head[2] << 8) | head[3]) != width) {
+                throw std::runtime_error("HDR scanline width mismatch");
+            }
+
+            // Each of the four channels is stored separately as a sequence of runs and literals
+            for (std::size_t channel = 0; channel < 4; ++channel) {
+                int x = 0;
+
+                while (x < width) {
+                    auto count = in.get();
+                    
+                    if (count == std::char_traits<char>::eof()) {
+                        throw std::runtime_error("Unexpected end of HDR file");
+                    }
+
+                    if (count > 128) {
+                        count -= 128;
+                        auto const value = static_cast<std::uint8_t>(in.get());
+
+                        if (count > width - x) {
+                            throw std::runtime_error("Bad HDR run length");
+                        }
+
+                        for (int k = 0; k < count; ++k) {
+                            scanline[x++][channel] = value;
+                        }
+                    }
+                    else {
+                        if (count == 0 or count > width - x) {
+                            throw std::runtime_error("Bad HDR literal length");
+                        }
+
+                        for (int k = 0; k < count; ++k) {
+                            scanline[x++][channel] = static_cast<std::uint8_t>(in.get());
+                        }
+                    }
+                }
+            }
+
+            if (not in) {
+                throw std::runtime_error("Unexpected end of HDR file");
+            }
+        }
+
+        HdrImage loadRadiance(std::istream& in)
+        {
+            std::string line;
+            bool formatOk = true;
+
+            // The header is a list of variables terminated by an empty line
+            while (std::getline(in, line) and not line.empty()) {
+                if (line.rfind("FORMAT=", 0) == 0 and line != "FORMAT=32-bit_rle_rgbe") {
+                    formatOk = false;
+                }
+            }
+
+            if (not formatOk) {
+                throw std::runtime_error("Only 32-bit_rle_rgbe HDR files are supported");
+            }
+
+            std::string yLabel;
+            std::string xLabel;
+            HdrImage image;
+
+            if (not std::getline(in, line) or not (std::istringstream(line) >> yLabel >> image.height >> xLabel >> image.width) or yLabel != "-Y" or xLabel != "+X") {
+                throw std::runtime_error("Only -Y +X oriented HDR files are supported");
+            }
+
+            if (image.width <= 0 or image.height <= 0) {
+                throw std::runtime_error("Bad HDR image size");
+            }
+
+            image.pixels.reserve(static_cast<std::size_t>(image.width) * image.height);
+            std::vector<Rgbe> scanline(static_cast<std::size_t>(image.width));
+
+            for (int y = 0; y < image.height; ++y) {
+                readRgbeScanline(in, scanline);
+
+                for (auto const& rgbe : scanline) {
+                    image.pixels.push_back(fromRgbe(rgbe));
+                }
+            }
+
+            return image;
+        }
+
+        bool isLittleEndian() noexcept
+        {
+            std::uint16_t const probe = 1;
+            std::uint8_t first {};
+            std::memcpy(&first, &probe, 1);
+
+            return first == 1;
+        }
+
+        HdrImage loadPortableFloatMap(std::istream& in)
+        {
+            std::string magic;
+            HdrImage image;
+            float scale {};
+
+            if (not (in >> magic >> image.width >> image.height >> scale) or magic != "PF" or image.width <= 0 or image.height <= 0) {
+                throw std::runtime_error("Only colour PFM files are supported");
+            }
+
+            in.get();   // the single whitespace character before the raster
+
+            // Rows are stored from the bottom of the image. A negative scale means little-endian data
+            bool const swapBytes = (scale < 0) != isLittleEndian();
+            std::vector<float> row(static_cast<std::size_t>(image.width) * 3);
+            image.pixels.resize(static_cast<std::size_t>(image.width) * image.height);
+
+            for (int y = image.height - 1; y >= 0; --y) {
+                if (not in.read(reinterpret_cast<char*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)))) {
+                    throw std::runtime_error("Unexpected end of PFM file");
+                }
+
+                for (auto& value : row) {
+                    if (swapBytes) {
+                        std::array<char, sizeof(float)> bytes {};
+                        std::memcpy(bytes.data(), &value, sizeof(float));
+                        std::swap(bytes[0], bytes[3]);
+                        std::swap(bytes[1], bytes[2]);
+                        std::memcpy(&value, bytes.data(), sizeof(float));
+                    }
+                }
+
+                for (int x = 0; x < image.width; ++x) {
+                    auto const* rgb = &row[static_cast<std::size_t>(x) * 3];
+                    image.pixels[static_cast<std::size_t>(y) * image.width + x] = Colour(rgb[0], rgb[1], rgb[2]);
+                }
+            }
+
+            return image;
+        }
+
+        HdrImage loadPortablePixmap(std::istream& in)
+        {
+            std::string magic;
+            HdrImage image;
+            int maxValue {};
+
+            // Skip comments between the header fields
+            auto const readField = [&in](auto& field) {
+                while ((in >> std::ws).peek() == '#') {
+                    std::string comment;
+                    std::getline(in, comment);
+                }
+
+                return static_cast<bool>(in >> field);
+            };
+
+            if (not readField(magic) or (magic != "P3" and magic != "P6") or not readField(image.width) or not readField(image.height) or not readField(maxValue)) {
+                throw std::runtime_error("Bad PPM header");
+            }
+
+            if (image.width <= 0 or image.height <= 0 or maxValue <= 0 or maxValue > 255) {
+                throw std::runtime_error("Only 8-bit PPM files are supported");
+            }
+
+            bool const isBinary = magic == "P6";
+
+            if (isBinary) {
+                in.get();
+            }
+
+            // Pixels are stored with the same gamma of 2 that writeColour() applies
+            auto const toLinear = [maxValue](int value) {
+                auto const c = static_cast<double>(value) / maxValue;
+                return c * c;
+            };
+
+            image.pixels.resize(static_cast<std::size_t>(image.width) * image.height);
+
+            for (auto& pixel : image.pixels) {
+                std::array<int, 3> rgb {};
+
+                for (auto& channel : rgb) {
+                    if (isBinary) {
+                        channel = in.get();
+                    }
+                    else {
+                        in >> channel;
+                    }
+                }
+
+                if (not in) {
+                    throw std::runtime_error("Unexpected end of PPM file");
+                }
+
+                pixel = Colour(toLinear(rgb[0]), toLinear(rgb[1]), toLinear(rgb[2]));
+            }
+
+            return image;
+        }
+    }
+
+    HdrImage loadHdrImage(std::string const& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+
+        if (not in) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+
+        std::array<char, 2> magic {};
+        in.read(magic.data(), 2);
+        in.seekg(0);
+
+        if (magic[0] == '#') {
+            return loadRadiance(in);
+        }
+        else if (magic[0] == 'P' and magic[1] == 'F') {
+            return loadPortableFloatMap(in);
+        }
+        else if (magic[0] == 'P' and (magic[1] == '3' or magic[1] == '6')) {
+            return loadPortablePixmap(in);
+        }
+        else {
+            throw std::runtime_error(path + " is not a Radiance HDR, PFM or PPM file");
+        }
+    }
+
+    void saveHdrImage(HdrImage const& image, std::string const& path)
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "PF\n" << image.width << ' ' << image.height << "\n" << (isLittleEndian() ? "-1.0" : "1.0") << "\n";
+
+        std::vector<float> row(static_cast<std::size_t>(image.width) * 3);
+
+        // Rows are stored from the bottom of the image
+        for (int y = image.height - 1; y >= 0; --y) {
+            for (int x = 0; x < image.width; ++x) {
+                auto const& c = image.at(x, y);
+                auto* rgb = &row[static_cast<std::size_t>(x) * 3];
+
+                rgb[0] = static_cast<float>(c.x());
+                rgb[1] = static_cast<float>(c.y());
+                rgb[2] = static_cast<float>(c.z());
+            }
+
+            out.write(reinterpret_cast<char const*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+        }
+
+        if (not out) {
+            throw std::runtime_error("Failed to write " + path);
+        }
+    }
+
+    double displayedDifference(HdrImage const& image, HdrImage const& reference)
+    {
+        if (image.width != reference.width or image.height != reference.height) {
+            throw std::invalid_argument("Cannot compare a " + std::to_string(image.width) + " x " + std::to_string(image.height) + " image with a "
+                                        + std::to_string(reference.width) + " x " + std::to_string(reference.height) + " reference");
+        }
+
+        auto const displayed = [](double const c) { return std::sqrt(clamp(c, 0.0, 1.0)); };
+        double sum = 0.0;
+
+        for (std::size_t i = 0; i < image.pixels.size(); ++i) {
+            for (gsl::index c = 0; c < 3; ++c) {
+                auto const d = displayed(image.pixels[i][c]) - displayed(reference.pixels[i][c]);
+                sum += d * d;
+            }
+        }
+
+        return image.pixels.empty() ? 0.0 : std::sqrt(sum / (3.0 * static_cast<double>(image.pixels.size())));
+    }
+}
@@ -0,0 +1,93 @@
+#include "Heatmap.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief The fraction of pixels at or below the top of the ramp
+        constexpr double topPercentile = 0.99;
+
+        /// \brief Get the colour at @param t in [0, 1] along the ramp, before gamma correction
+        Colour ramp(double const t) noexcept
+        {
+            static std::array<Colour, 5> const stops {
+                Colour(0.0, 0.0, 0.0),
+                Colour(0.35, 0.05, 0.55),
+                Colour(0.85, 0.2, 0.3),
+                Colour(1.0, 0.6, 0.05),
+                Colour(1.0, 1.0, 0.65)
+            };
+
+            auto const position = clamp(t, 0.0, 1.0) * static_cast<double>(stops.size() - 1);
+            auto const i = std::min(static_cast<std::size_t>(position), stops.size() - 2);
+            auto const s = position - static_cast<double>(i);
+
+            return ((1.0 - s) * stops[i]) + (s * stops[i + 1]);
+        }
+    }
+
+    std::vector<Colour> heatmap(std::vector<float> const& values, float& scale)
+    {
+        scale = 0.0f;
+
+        if (not values.empty()) {
+            auto sorted = values;
+            auto const top = sorted.begin() + static_cast<std::ptrdiff_t>(topPercentile * static_cast<double>(sorted.size() - 1));
+            std::nth_element(sorted.begin(), top, sorted.end());
+            scale = *top > 0.0f ? *top : *std::max_element(sorted.cbegin(), sorted.cend());
+        }
+
+        std::vector<Colour> colours(values.size());
+
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            auto const c = ramp(scale > 0.0f ? values[i] / scale : 0.0);
+            colours[i] = c * c;
+        }
+
+        return colours;
+    }
+
+    std::string writeHeatmaps(Framebuffer const& framebuffer, std::string const& prefix)
+    {
+        struct Map
+        {
+            char const* name;
+            char const* unit;
+            float PixelCost::*value;
+        };
+
+        static std::array<Map, 4> const maps {
+            Map {"traversal", "node visits per sample", &PixelCost::traversalSteps},
+            Map {"tests", "intersection tests per sample", &PixelCost::primitiveTests},
+            Map {"path", "segments per sample", &PixelCost::pathLength},
+            Map {"time", "microseconds per pixel", &PixelCost::microseconds}
+        };
+
+        std::ostringstream legend;
+        std::vector<float> values(framebuffer.cost.size());
+
+        for (auto const& map : maps) {
+            std::transform(framebuffer.cost.cbegin(), framebuffer.cost.cend(), values.begin(), [&](PixelCost const& cost) { return cost.*map.value; });
+
+            float scale {};
+            auto const path = prefix + '.' + map.name + ".ppm";
+            std::ofstream out(path);
+            writePpm(out, heatmap(values, scale), framebuffer.width, framebuffer.height);
+
+            if (not out.flush()) {
+                throw std::runtime_error("Failed to write " + path);
+            }
+
+            legend << path << ": 0 to " << scale << ' ' << map.unit << '\n';
+        }
+
+        return legend.str();
+    }
+}
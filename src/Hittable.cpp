@@ -0,0 +1,54 @@
+#include "Hittable.hpp"
+
+#include <cmath>
+
+namespace rt
+{
+    void HitRecord::computeDifferentials(Ray const& ray) & noexcept
+    {
+        dpdx = dpdy = Vec3(0, 0, 0);
+        dudx = dvdx = dudy = dvdy = 0.0;
+
+        if (not ray.hasDifferentials()) {
+            return;
+        }
+
+        // Intersect both offset rays with the plane through the hit point
+        auto const d = dot(normal, point);
+        auto const denominatorX = dot(normal, ray.getRxDirection());
+        auto const denominatorY = dot(normal, ray.getRyDirection());
+
+        if (std::fabs(denominatorX) < 1e-12 or std::fabs(denominatorY) < 1e-12) {
+            return;
+        }
+
+        auto const tx = (d - dot(normal, ray.getRxOrigin())) / denominatorX;
+        auto const ty = (d - dot(normal, ray.getRyOrigin())) / denominatorY;
+
+        dpdx = ray.getRxOrigin() + (tx * ray.getRxDirection()) - point;
+        dpdy = ray.getRyOrigin() + (ty * ray.getRyDirection()) - point;
+
+        // Solve dp = dpdu * du + dpdv * dv in the least-squares sense
+        auto const a00 = dot(dpdu, dpdu);
+        auto const a01 = dot(dpdu, dpdv);
+        auto const a11 = dot(dpdv, dpdv);
+        auto const determinant = (a00 * a11) - (a01 * a01);
+
+        if (std::fabs(determinant) < 1e-24) {
+            return;
+        }
+
+        auto const inverse = 1.0 / determinant;
+
+        auto const solve = [&](Vec3 const& dp, double& du, double& dv) {
+            auto const b0 = dot(dpdu, dp);
+            auto const b1 = dot(dpdv, dp);
+
+            du = ((a11 * b0) - (a01 * b1)) * inverse;
+            dv = ((a00 * b1) - (a01 * b0)) * inverse;
+        };
+
+        solve(dpdx, dudx, dvdx);
+        solve(dpdy, dudy, dvdy);
+    }
+}
@@ -1,4 +1,7 @@
 #include "HittableList.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
 
 namespace rt
 {
@@ -33,4 +36,52 @@ namespace rt
 
         return hitAnything;
     }
+
+    bool HittableList::occluded(Ray const& ray, double tMin, double tMax) const noexcept
+    {
+        return std::any_of(m_objects.cbegin(), m_objects.cend(), [&](auto const& obj) {
+            return obj->occluded(ray, tMin, tMax);
+        });
+    }
+
+    bool HittableList::boundingBox(Aabb& box) const noexcept
+    {
+        Aabb bounds;
+
+        for (auto const& obj : m_objects) {
+            Aabb objectBox;
+
+            if (not obj->boundingBox(objectBox)) {
+                return false;
+            }
+
+            bounds.merge(objectBox);
+        }
+
+        box = bounds;
+        return true;
+    }
+
+    double HittableList::pdfValue(Point3 const& origin, Vec3 const& direction) const
+    {
+        if (m_objects.empty()) {
+            return 0.0;
+        }
+
+        double sum = 0.0;
+
+        for (auto const& obj : m_objects) {
+            sum += obj->pdfValue(origin, direction);
+        }
+
+        return sum / static_cast<double>(m_objects.size());
+    }
+
+    Vec3 HittableList::random(Point3 const& origin) const
+    {
+        auto const count = m_objects.size();
+        auto const index = std::min(static_cast<std::size_t>(randomDouble() * static_cast<double>(count)), count - 1);
+
+        return m_objects[index]->random(origin);
+    }
 }
\ No newline at end of file
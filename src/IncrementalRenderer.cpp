@@ -0,0 +1,123 @@
+#include "IncrementalRenderer.hpp"
+#include "Material.hpp"
+#include "Sphere.hpp"
+
+#include <algorithm>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <gsl/assert>
+
+namespace rt
+{
+    IncrementalRenderer::IncrementalRenderer(Scene& scene, Camera const& camera, RenderSettings const& settings, int const tileSize)
+        : m_scene(scene)
+        , m_camera(camera)
+        , m_settings(settings)
+        , m_framebuffer(settings.width, settings.height)
+    {
+        Expects(tileSize > 0);
+
+        for (int y = 0; y < settings.height; y += tileSize) {
+            for (int x = 0; x < settings.width; x += tileSize) {
+                auto const index = static_cast<int>(m_tiles.size());
+                m_tiles.push_back(Tile {index, x, y, std::min(x + tileSize, settings.width), std::min(y + tileSize, settings.height)});
+            }
+        }
+
+        m_footprints.resize(m_tiles.size());
+    }
+
+    void IncrementalRenderer::render()
+    {
+        renderTiles(m_scene, m_camera, m_settings, m_tiles, &m_framebuffer, m_footprints);
+        m_framebuffer.samplesPerPixel = m_settings.samplesPerPixel;
+    }
+
+    std::size_t IncrementalRenderer::update(SceneEdits const& edits)
+    {
+        if (not edits.moved.empty() and m_scene.accelerator) {
+            m_scene.accelerator->refit();
+        }
+
+        std::vector<void const*> keys(edits.moved.cbegin(), edits.moved.cend());
+        keys.insert(keys.end(), edits.repainted.cbegin(), edits.repainted.cend());
+        keys.insert(keys.end(), edits.materials.cbegin(), edits.materials.cend());
+
+        auto const touchesAny = [](TileFootprint const& footprint, auto const& changed) {
+            return std::any_of(changed.cbegin(), changed.cend(), [&footprint](void const* key) { return footprint.mayContain(key); });
+        };
+
+        std::vector<Tile> stale;
+        std::vector<Tile> kept;
+
+        for (auto const& tile : m_tiles) {
+            (touchesAny(m_footprints[static_cast<std::size_t>(tile.index)], keys) ? stale : kept).push_back(tile);
+        }
+
+        // Find where the moved objects are seen now, with one sample per pixel of the tiles that never saw them
+        if (not edits.moved.empty() and not kept.empty()) {
+            auto probe = m_settings;
+            probe.samplesPerPixel = 1;
+
+            std::vector<TileFootprint> probed(m_tiles.size());
+            renderTiles(m_scene, m_camera, probe, kept, nullptr, probed);
+
+            for (auto const& tile : kept) {
+                if (touchesAny(probed[static_cast<std::size_t>(tile.index)], edits.moved)) {
+                    stale.push_back(tile);
+                }
+            }
+        }
+
+        renderTiles(m_scene, m_camera, m_settings, stale, &m_framebuffer, m_footprints);
+
+        return stale.size();
+    }
+
+    SceneEdits applyEdits(Scene& scene, std::istream& in)
+    {
+        Expects(scene.accelerator != nullptr);
+
+        auto const& objects = scene.accelerator->objects();
+        SceneEdits edits;
+        int lineNumber = 0;
+
+        for (std::string line; std::getline(in, line);) {
+            ++lineNumber;
+
+            if (line.empty() or line[0] == '#') {
+                continue;
+            }
+
+            std::istringstream fields(line);
+            std::string command;
+            std::size_t index {};
+            double x {};
+            double y {};
+            double z {};
+
+            if (not (fields >> command >> index >> x >> y >> z) or (command != "move" and command != "paint")) {
+                throw std::runtime_error("Cannot read edit on line " + std::to_string(lineNumber) + ": " + line);
+            }
+
+            auto const sphere = index < objects.size() ? std::dynamic_pointer_cast<Sphere>(objects[index]) : nullptr;
+
+            if (not sphere) {
+                throw std::runtime_error("Edit on line " + std::to_string(lineNumber) + " does not name a sphere: " + line);
+            }
+
+            if (command == "move") {
+                sphere->setCenter(sphere->center() + Vec3(x, y, z));
+                edits.moved.push_back(sphere.get());
+            }
+            else {
+                sphere->setMaterial(std::make_shared<Lambertian>(Colour(x, y, z)));
+                edits.repainted.push_back(sphere.get());
+            }
+        }
+
+        return edits;
+    }
+}
@@ -0,0 +1,344 @@
+#include "Integrator.hpp"
+#include "Common.hpp"
+#include "Footprint.hpp"
+#include "Hittable.hpp"
+#include "Material.hpp"
+#include "Onb.hpp"
+#include "PathGuide.hpp"
+#include "PhotonMap.hpp"
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief Determine whether a colour carries no energy
+        constexpr bool isBlack(Colour const& c) noexcept
+        {
+            return c.x() <= 0 and c.y() <= 0 and c.z() <= 0;
+        }
+
+        /// \brief Determine whether the environment takes part in explicit light sampling
+        bool isEnvironmentSampled(Scene const& scene) noexcept
+        {
+            return scene.environment and scene.environment->isSampled();
+        }
+
+        /// \brief Get the probability of sampling the light list rather than the environment
+        double areaLightProbability(Scene const& scene) noexcept
+        {
+            if (scene.lights.empty()) {
+                return 0.0;
+            }
+
+            return isEnvironmentSampled(scene) ? 0.5 : 1.0;
+        }
+
+        /// \brief How a diffuse bounce picks its direction: by the material alone, or by a mixture of the material and the path guide
+        struct BounceSampler
+        {
+            PathGuide const* guide {};      // Null if the material alone is sampled
+            std::uint32_t region {};        // The region of the guide that holds the hit
+            double materialFraction {1.0};  // The probability of sampling the material rather than the guide
+
+            /// \brief Get the solid-angle density with which the bounce picks @param direction
+            double pdf(HitRecord const& record, Vec3 const& direction) const noexcept
+            {
+                auto const materialPdf = record.materialPtr->pdf(record, direction);
+
+                if (not guide) {
+                    return materialPdf;
+                }
+
+                return (materialFraction * materialPdf) + ((1.0 - materialFraction) * guide->pdf(region, direction));
+            }
+        };
+
+        /// \brief A diffuse bounce of a path, remembered so that the guide can learn the light found after it
+        struct GuideVertex
+        {
+            std::uint32_t region;
+            Vec3 direction;         // The unit direction the path continued in
+            double pdf;             // The density with which that direction was picked
+            Colour throughput;      // The throughput of the path after the bounce
+            Colour radiance;        // The radiance the path had gathered before continuing
+        };
+
+        /// \brief Give a scattered ray approximate differentials, so that textures seen after a bounce are filtered too
+        /// \details Mirror-like bounces keep the angular spread of the incident ray. A diffuse bounce blurs the footprint,
+        /// so its offset rays are spread over a fixed cone around the new direction
+        /// \param[in] incident The ray that hit the surface
+        /// \param[in] record The hit, with its position differentials
+        /// \param[in] isDiffuse Whether the material scatters diffusely
+        /// \param[inout] scattered The scattered ray
+        void propagateDifferentials(Ray const& incident, HitRecord const& record, bool isDiffuse, Ray& scattered) noexcept
+        {
+            constexpr double diffuseSpread = 0.2;
+
+            if (not incident.hasDifferentials()) {
+                return;
+            }
+
+            Vec3 const direction = unitVector(scattered.getDirection());
+            Vec3 dx;
+            Vec3 dy;
+
+            if (isDiffuse) {
+                Onb const basis(direction);
+                dx = diffuseSpread * basis.u();
+                dy = diffuseSpread * basis.v();
+            }
+            else {
+                Vec3 const incidentDirection = unitVector(incident.getDirection());
+                dx = unitVector(incident.getRxDirection()) - incidentDirection;
+                dy = unitVector(incident.getRyDirection()) - incidentDirection;
+            }
+
+            scattered.setDifferentials(record.point + record.dpdx, direction + dx, record.point + record.dpdy, direction + dy);
+        }
+
+        /// \brief Sample the scene's lights or its environment from a diffuse hit and trace a shadow ray towards it
+        /// \param[in] scene The world, its lights, and its environment
+        /// \param[in] record The diffuse hit the light is sampled from
+        /// \param[in] bounce How the path would otherwise continue, for weighting the two strategies
+        /// \param[inout] footprint If not null, receives the light and whatever casts a shadow on the hit
+        /// \returns The MIS-weighted direct light reflected towards the viewer
+        Colour sampleDirectLight(Scene const& scene, HitRecord const& record, BounceSampler const& bounce, TileFootprint* footprint)
+        {
+            auto const pArea = areaLightProbability(scene);
+            Vec3 direction;
+            Colour emitted;
+            double tMax = infinity;
+            bool const sampleArea = randomDouble() < pArea;
+
+            if (sampleArea) {
+                direction = scene.lights.random(record.point);
+
+                if (HitRecord lightRecord; scene.lights.hit(Ray(record.point, direction), 0.001, infinity, lightRecord)) {
+                    emitted = lightRecord.materialPtr->emitted(lightRecord);
+                    tMax = lightRecord.t * (1.0 - 1e-6);
+
+                    if (footprint) {
+                        footprint->add(lightRecord.object);
+                        footprint->add(lightRecord.materialPtr);
+                    }
+                }
+            }
+            else {
+                double environmentPdf {};
+                direction = scene.environment->sample(environmentPdf);
+                emitted = scene.environment->radiance(direction);
+            }
+
+            if (isBlack(emitted)) {
+                return Colour(0, 0, 0);
+            }
+
+            // Each strategy only ever finds its own kind of light: a direction drawn from the environment towards an
+            // area light is blocked by that light. So each sample is weighted by the density of the strategy that drew
+            // it, as paths that reach an emitter or escape to the environment are
+            auto const lightPdf = sampleArea ? pArea * scene.lights.pdfValue(record.point, direction)
+                                             : (1.0 - pArea) * scene.environment->pdf(direction);
+
+            if (lightPdf <= 0) {
+                return Colour(0, 0, 0);
+            }
+
+            Colour const f = record.materialPtr->evaluate(record, direction);
+
+            if (isBlack(f)) {
+                return Colour(0, 0, 0);
+            }
+
+            // Anything in front of the light casts a shadow
+            threadStatistics().shadowRays.add();
+
+            if (Ray const shadowRay(record.point, direction); scene.world.occluded(shadowRay, 0.001, tMax)) {
+                // Whatever casts the shadow would let the light through if it were moved
+                if (HitRecord blocker; footprint and scene.world.hit(shadowRay, 0.001, tMax, blocker)) {
+                    footprint->add(blocker.object);
+                }
+
+                return Colour(0, 0, 0);
+            }
+
+            auto const bsdfPdf = bounce.pdf(record, direction);
+            auto const weight = powerHeuristic(lightPdf, bsdfPdf);
+
+            return (weight / lightPdf) * (f * emitted);
+        }
+    }
+
+    Colour rayColour(Ray const& cameraRay, Scene const& scene, int maxDepth, PathFeatures* features, TileFootprint* footprint)
+    {
+        Colour radiance(0, 0, 0);
+        Colour throughput(1, 1, 1);
+        Ray ray = cameraRay;
+
+        auto const pArea = areaLightProbability(scene);
+        bool const canSampleLights = pArea > 0 or isEnvironmentSampled(scene);
+
+        // Emitters reached by a camera ray or a mirror bounce could not have been light-sampled, so they count in full
+        bool lightSampled = false;
+        double bsdfPdf = 0.0;
+
+        // With a caustic map, light reaching a diffuse hit through mirror-like bounces is gathered from the photons,
+        // so an emitter found at the end of such a chain would count it twice
+        bool const gathersCaustics = scene.caustics != nullptr;
+        bool afterDiffuse = false;
+        bool causticChain = false;
+
+        // While the guide learns, every diffuse bounce is remembered until the path ends and its light is known
+        bool const learning = scene.guide and scene.guide->isLearning();
+        static thread_local std::vector<GuideVertex> guideVertices;
+
+        if (learning) {
+            guideVertices.clear();
+        }
+        Point3 previousPoint;
+        int depth = 0;
+
+        for (; depth < maxDepth; ++depth) {
+            HitRecord record;
+
+            if (not scene.world.hit(ray, 0.001, infinity, record)) {
+                if (features and depth == 0) {
+                    Colour const background = scene.environment ? scene.environment->radiance(ray.getDirection()) : Colour(0, 0, 0);
+
+                    features->albedo = Colour(clamp(background.x(), 0, 1), clamp(background.y(), 0, 1), clamp(background.z(), 0, 1));
+                    features->normal = Vec3(0, 0, 0);
+                    features->depth = infinity;
+                }
+
+                if (scene.environment) {
+                    Colour const background = scene.environment->radiance(ray.getDirection());
+
+                    if (lightSampled and scene.environment->isSampled()) {
+                        auto const lightPdf = (1.0 - pArea) * scene.environment->pdf(ray.getDirection());
+                        radiance += powerHeuristic(bsdfPdf, lightPdf) * (throughput * background);
+                    }
+                    else {
+                        radiance += throughput * background;
+                    }
+                }
+
+                break;
+            }
+
+            Material const& material = *record.materialPtr;
+            record.computeDifferentials(ray);
+
+            if (footprint) {
+                footprint->add(record.object);
+                footprint->add(record.materialPtr);
+            }
+
+            if (features and depth == 0) {
+                features->albedo = material.albedo(record);
+                features->normal = record.normal;
+                features->depth = record.t * ray.getDirection().length();
+            }
+
+            if (Colour const emitted = material.emitted(record); not isBlack(emitted) and not (gathersCaustics and causticChain)) {
+                if (lightSampled) {
+                    auto const lightPdf = pArea * scene.lights.pdfValue(previousPoint, ray.getDirection());
+                    radiance += powerHeuristic(bsdfPdf, lightPdf) * (throughput * emitted);
+                }
+                else {
+                    radiance += throughput * emitted;
+                }
+            }
+
+            Colour attenuation;
+            Ray scattered;
+
+            if (not material.scatter(ray, record, attenuation, scattered)) {
+                break;
+            }
+
+            BounceSampler bounce;
+
+            if (scene.guide and material.isDiffuse()) {
+                bounce.region = scene.guide->locate(record.point);
+
+                if (scene.guide->canSample(bounce.region)) {
+                    bounce.guide = scene.guide.get();
+                    bounce.materialFraction = scene.guide->settings().bsdfFraction;
+                }
+            }
+
+            // The material has already picked a direction. Some of the time the guide picks one instead,
+            // and either way the path is weighted by the density of the mixture
+            if (bounce.guide) {
+                if (randomDouble() >= bounce.materialFraction) {
+                    double guidePdf {};
+                    scattered = Ray(record.point, bounce.guide->sample(bounce.region, guidePdf));
+                }
+
+                auto const direction = unitVector(scattered.getDirection());
+                auto const pdf = bounce.pdf(record, direction);
+
+                // A direction below the surface ends the path, but only after the lights have been sampled from here
+                attenuation = pdf > 0 ? material.evaluate(record, direction) / pdf : Colour(0, 0, 0);
+            }
+
+            lightSampled = canSampleLights and material.isDiffuse();
+
+            if (material.isDiffuse()) {
+                if (gathersCaustics) {
+                    radiance += throughput * scene.caustics->radiance(record);
+                }
+
+                afterDiffuse = true;
+                causticChain = false;
+            }
+            else {
+                causticChain = afterDiffuse;
+            }
+
+            if (lightSampled) {
+                radiance += throughput * sampleDirectLight(scene, record, bounce, footprint);
+
+                bsdfPdf = bounce.pdf(record, unitVector(scattered.getDirection()));
+                previousPoint = record.point;
+            }
+
+            if (isBlack(attenuation)) {
+                break;
+            }
+
+            if (learning and material.isDiffuse()) {
+                auto const direction = unitVector(scattered.getDirection());
+                guideVertices.push_back({bounce.region, direction, bounce.pdf(record, direction), throughput * attenuation, radiance});
+            }
+
+            propagateDifferentials(ray, record, material.isDiffuse(), scattered);
+
+            throughput = throughput * attenuation;
+            ray = scattered;
+        }
+
+        // The light a path gathered after a bounce, divided by its throughput there, is the light that arrived from
+        // the direction it took
+        if (learning) {
+            for (auto const& vertex : guideVertices) {
+                Colour const gathered = radiance - vertex.radiance;
+                auto const incident = [&](double const light, double const weight) { return weight > 0 ? light / weight : 0.0; };
+                Colour const arriving(incident(gathered.x(), vertex.throughput.x()), incident(gathered.y(), vertex.throughput.y()), incident(gathered.z(), vertex.throughput.z()));
+
+                scene.guide->record(vertex.region, vertex.direction, luminance(arriving), vertex.pdf);
+            }
+        }
+
+        // The camera ray is counted by the caller, so a path of n segments traced n - 1 secondary rays
+        auto& stats = threadStatistics();
+        auto const segments = static_cast<std::size_t>(std::min(depth + 1, maxDepth));
+        stats.secondaryRays.add(segments > 0 ? segments - 1 : 0);
+        stats.pathLengths[std::min(segments, maxCountedPathLength)].add();
+
+        return radiance;
+    }
+}
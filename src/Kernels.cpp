@@ -0,0 +1,131 @@
+#include "Kernels.hpp"
+
+#include <array>
+#include <atomic>
+#include <stdexcept>
+
+namespace rt
+{
+    // Every copy of SimdKernels.cpp defines the table of its instruction set
+    namespace simd::baseline { extern Kernels const table; }
+
+#ifdef RT_KERNEL_VARIANTS
+    namespace simd::sse4 { extern Kernels const table; }
+    namespace simd::avx2 { extern Kernels const table; }
+    namespace simd::avx512 { extern Kernels const table; }
+#endif
+
+    namespace
+    {
+        constexpr std::array<char const*, 4> names {"baseline", "sse4", "avx2", "avx512"};
+
+        /// \brief The selected instruction set, or -1 until the first kernel is wanted
+        std::atomic<int> selected {-1};
+    }
+
+    bool isSupported(Isa const isa) noexcept
+    {
+#ifdef RT_KERNEL_VARIANTS
+        __builtin_cpu_init();
+
+        switch (isa) {
+        case Isa::baseline:
+            return true;
+        case Isa::sse4:
+            return __builtin_cpu_supports("sse4.2");
+        case Isa::avx2:
+            return __builtin_cpu_supports("avx2");
+        case Isa::avx512:
+            return __builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512dq");
+        }
+
+        return false;
+#else
+        return isa == Isa::baseline;
+#endif
+    }
+
+    Isa detectIsa() noexcept
+    {
+        // The avx512 copy measured slower than the avx2 one, since the kernels are too short to fill its wider vectors,
+        // so it is only used when asked for
+        for (auto const isa : {Isa::avx2, Isa::sse4}) {
+            if (isSupported(isa)) {
+                return isa;
+            }
+        }
+
+        return Isa::baseline;
+    }
+
+    void selectIsa(Isa const isa)
+    {
+        if (not isSupported(isa)) {
+            throw std::invalid_argument("This processor or build does not support " + isaName(isa) + " (the default here is " + isaName(detectIsa()) + ")");
+        }
+
+        selected.store(static_cast<int>(isa), std::memory_order_relaxed);
+    }
+
+    Isa activeIsa() noexcept
+    {
+        auto isa = selected.load(std::memory_order_relaxed);
+
+        if (isa < 0) {
+            isa = static_cast<int>(detectIsa());
+            selected.store(isa, std::memory_order_relaxed);
+        }
+
+        return static_cast<Isa>(isa);
+    }
+
+    Kernels const& kernels() noexcept
+    {
+        return kernels(activeIsa());
+    }
+
+    Kernels const& kernels(Isa const isa) noexcept
+    {
+        switch (isa) {
+#ifdef RT_KERNEL_VARIANTS
+        case Isa::sse4:
+            return simd::sse4::table;
+        case Isa::avx2:
+            return simd::avx2::table;
+        case Isa::avx512:
+            return simd::avx512::table;
+#endif
+        default:
+            return simd::baseline::table;
+        }
+    }
+
+    std::string isaName(Isa const isa)
+    {
+        return names[static_cast<std::size_t>(isa)];
+    }
+
+    Isa parseIsa(std::string const& name)
+    {
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            if (name == names[i]) {
+                return static_cast<Isa>(i);
+            }
+        }
+
+        throw std::invalid_argument("Unknown instruction set " + name + " (expected baseline, sse4, avx2 or avx512)");
+    }
+
+    std::vector<Isa> supportedIsas()
+    {
+        std::vector<Isa> isas;
+
+        for (auto const isa : {Isa::baseline, Isa::sse4, Isa::avx2, Isa::avx512}) {
+            if (isSupported(isa)) {
+                isas.push_back(isa);
+            }
+        }
+
+        return isas;
+    }
+}
@@ -0,0 +1,272 @@
+#include "LazyBvh.hpp"
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <thread>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief The levels split before the first ray is traced
+        constexpr int eagerLevels = 4;
+    }
+
+    /// \brief A node of the tree. Everything but its children is set before the node is published
+    struct LazyBvh::Node
+    {
+        Aabb box;
+        std::size_t begin;      // The first of the node's objects in m_boxes and m_order
+        std::size_t end;
+        int depth;
+
+        mutable std::atomic<Children const*> children {nullptr};   // Null until the node is split
+        mutable std::atomic_flag claimed = ATOMIC_FLAG_INIT;        // Set by the thread that splits the node
+
+        ~Node();
+    };
+
+    /// \brief The two halves of a split node
+    struct LazyBvh::Children
+    {
+        Node left;
+        Node right;
+        std::size_t axis;       // The axis the node was split along
+    };
+
+    LazyBvh::Node::~Node()
+    {
+        auto const* built = children.load(std::memory_order_relaxed);
+
+        if (built != leafChildren()) {
+            delete built;
+        }
+    }
+
+    LazyBvh::Children const* LazyBvh::leafChildren() noexcept
+    {
+        static Children const leaf {};
+        return &leaf;
+    }
+
+    LazyBvh::LazyBvh(std::vector<std::shared_ptr<Hittable>> objects)
+    {
+        PhaseTimer const timer("hierarchy");
+
+        for (auto& object : objects) {
+            Aabb box;
+
+            if (object->boundingBox(box)) {
+                m_boxes.push_back(box);
+                m_objects.push_back(std::move(object));
+            }
+            else {
+                m_unbounded.push_back(std::move(object));
+            }
+        }
+
+        m_primitives.resize(m_objects.size());
+        std::transform(m_objects.cbegin(), m_objects.cend(), m_primitives.begin(), [](auto const& object) { return object.get(); });
+
+        m_order.resize(m_objects.size());
+
+        for (std::size_t i = 0; i < m_order.size(); ++i) {
+            m_order[i] = i;
+        }
+
+        if (m_objects.empty()) {
+            return;
+        }
+
+        Aabb bounds;
+
+        for (auto const& box : m_boxes) {
+            bounds.merge(box);
+        }
+
+        m_root.reset(new Node {bounds, 0, m_boxes.size(), 0});
+        m_builtNodes = 1;
+
+        // Split the top levels, breadth first, so that the first rays do not all wait on the root
+        std::vector<Node const*> level {m_root.get()};
+
+        for (int depth = 0; depth < eagerLevels and not level.empty(); ++depth) {
+            std::vector<Node const*> next;
+
+            for (auto const* node : level) {
+                if (auto const* children = expand(*node); children != leafChildren()) {
+                    next.push_back(&children->left);
+                    next.push_back(&children->right);
+                }
+            }
+
+            level = std::move(next);
+        }
+    }
+
+    LazyBvh::~LazyBvh() = default;
+
+    LazyBvh::Children const* LazyBvh::expand(Node const& node) const
+    {
+        if (auto const* children = node.children.load(std::memory_order_acquire)) {
+            return children;
+        }
+
+        if (not node.claimed.test_and_set(std::memory_order_acquire)) {
+            auto const* children = split(node);
+            node.children.store(children, std::memory_order_release);
+            return children;
+        }
+
+        // Another thread is splitting the node, and its ranges of the boxes are not to be read until it is done
+        Children const* children;
+
+        while ((children = node.children.load(std::memory_order_acquire)) == nullptr) {
+            std::this_thread::yield();
+        }
+
+        return children;
+    }
+
+    LazyBvh::Children const* LazyBvh::split(Node const& node) const
+    {
+        Aabb centroids;
+
+        for (auto i = node.begin; i < node.end; ++i) {
+            centroids.merge(Point3(m_boxes[i].centre(0), m_boxes[i].centre(1), m_boxes[i].centre(2)));
+        }
+
+        auto const division = splitBoxes(m_boxes, m_order, node.begin, node.end, node.box, centroids, node.depth);
+
+        if (division.leaf) {
+            return leafChildren();
+        }
+
+        Aabb left;
+        Aabb right;
+
+        for (auto i = node.begin; i < division.mid; ++i) {
+            left.merge(m_boxes[i]);
+        }
+
+        for (auto i = division.mid; i < node.end; ++i) {
+            right.merge(m_boxes[i]);
+        }
+
+        m_builtNodes.fetch_add(2, std::memory_order_relaxed);
+
+        return new Children {
+            Node {left, node.begin, division.mid, node.depth + 1},
+            Node {right, division.mid, node.end, node.depth + 1},
+            division.axis
+        };
+    }
+
+    bool LazyBvh::hit(Ray const& ray, double const tMin, double const tMax, HitRecord& record) const noexcept
+    {
+        bool hitAnything = false;
+        auto closestSoFar = tMax;
+
+        if (m_root) {
+            RayInverse const inverse(ray);
+            std::array<Node const*, Bvh::maxDepth + 2> stack;
+            std::size_t top = 0;
+            std::uint64_t visits = 0;
+            stack[top++] = m_root.get();
+
+            while (top > 0) {
+                auto const& node = *stack[--top];
+                ++visits;
+
+                if (double tEntry {}; not node.box.hit(inverse, tMin, closestSoFar, tEntry)) {
+                    continue;
+                }
+
+                auto const* children = expand(node);
+
+                if (children == leafChildren()) {
+                    for (auto i = node.begin; i < node.end; ++i) {
+                        if (m_primitives[m_order[i]]->hit(ray, tMin, closestSoFar, record)) {
+                            hitAnything = true;
+                            closestSoFar = record.t;
+                        }
+                    }
+                }
+                else if (inverse.negative[children->axis]) {
+                    // Push the far child first, so that the near one is visited first and shortens the interval
+                    stack[top++] = &children->left;
+                    stack[top++] = &children->right;
+                }
+                else {
+                    stack[top++] = &children->right;
+                    stack[top++] = &children->left;
+                }
+            }
+
+            threadStatistics().nodeVisits.add(visits);
+        }
+
+        for (auto const& object : m_unbounded) {
+            if (object->hit(ray, tMin, closestSoFar, record)) {
+                hitAnything = true;
+                closestSoFar = record.t;
+            }
+        }
+
+        return hitAnything;
+    }
+
+    bool LazyBvh::occluded(Ray const& ray, double const tMin, double const tMax) const noexcept
+    {
+        if (m_root) {
+            RayInverse const inverse(ray);
+            std::array<Node const*, Bvh::maxDepth + 2> stack;
+            std::size_t top = 0;
+            std::uint64_t visits = 0;
+            bool blocked = false;
+            stack[top++] = m_root.get();
+
+            while (top > 0 and not blocked) {
+                auto const& node = *stack[--top];
+                ++visits;
+
+                if (double tEntry {}; not node.box.hit(inverse, tMin, tMax, tEntry)) {
+                    continue;
+                }
+
+                auto const* children = expand(node);
+
+                if (children == leafChildren()) {
+                    for (auto i = node.begin; i < node.end and not blocked; ++i) {
+                        blocked = m_primitives[m_order[i]]->occluded(ray, tMin, tMax);
+                    }
+                }
+                else {
+                    stack[top++] = &children->right;
+                    stack[top++] = &children->left;
+                }
+            }
+
+            threadStatistics().nodeVisits.add(visits);
+
+            if (blocked) {
+                return true;
+            }
+        }
+
+        return std::any_of(m_unbounded.cbegin(), m_unbounded.cend(), [&](auto const& object) {
+            return object->occluded(ray, tMin, tMax);
+        });
+    }
+
+    bool LazyBvh::boundingBox(Aabb& box) const noexcept
+    {
+        if (not m_unbounded.empty()) {
+            return false;
+        }
+
+        box = m_root ? m_root->box : Aabb();
+        return true;
+    }
+}
@@ -1,18 +1,25 @@
 #include "Material.hpp"
 #include "Common.hpp"
 #include "Hittable.hpp"
+#include "Statistics.hpp"
 #include "Vec3.hpp"
 
 #include <functional>
 
 namespace rt
 {
-    Lambertian::Lambertian(Colour const& c) : m_albedo(c)
+    Lambertian::Lambertian(Colour const& c) : m_albedo(std::make_shared<SolidColour>(c))
+    {
+    }
+
+    Lambertian::Lambertian(std::shared_ptr<Texture> albedo) noexcept : m_albedo(std::move(albedo))
     {
     }
 
     bool Lambertian::scatter([[maybe_unused]] Ray const& incidentRay, HitRecord const& record, Colour& attenuation, Ray& scattered) const
     {
+        countScatter(MaterialKind::lambertian);
+
         auto scatterDirection = record.normal + randomUnitVector();
 
         // Catch degenerate scatter direction
@@ -21,20 +28,43 @@ namespace rt
         }
 
         scattered = Ray(record.point, scatterDirection);
-        attenuation = m_albedo;
+        attenuation = m_albedo->value(record);
         
         return true;
     }
 
-    Metal::Metal(Colour const& albedo, double fuzziness) noexcept : m_albedo(albedo), m_fuzziness(fuzziness < 1 ? fuzziness : 1)
+    Colour Lambertian::evaluate(HitRecord const& record, Vec3 const& direction) const
+    {
+        auto const cosine = dot(record.normal, direction);
+        return cosine > 0 ? (cosine / pi) * m_albedo->value(record) : Colour(0, 0, 0);
+    }
+
+    double Lambertian::pdf(HitRecord const& record, Vec3 const& direction) const
+    {
+        auto const cosine = dot(record.normal, direction);
+        return cosine > 0 ? cosine / pi : 0.0;
+    }
+
+    Colour Lambertian::albedo(HitRecord const& record) const
+    {
+        return m_albedo->value(record);
+    }
+
+    Metal::Metal(Colour const& albedo, double fuzziness) : Metal(std::make_shared<SolidColour>(albedo), fuzziness)
+    {
+    }
+
+    Metal::Metal(std::shared_ptr<Texture> albedo, double fuzziness) noexcept : m_albedo(std::move(albedo)), m_fuzziness(fuzziness < 1 ? fuzziness : 1)
     {
     }
 
     bool Metal::scatter(Ray const& incidentRay, HitRecord const& record, Colour& attenuation, Ray& scattered) const
     {
+        countScatter(MaterialKind::metal);
+
         auto reflectedRay = getReflectedRay(unitVector(incidentRay.getDirection()), record.normal);
         scattered = Ray(record.point, reflectedRay + m_fuzziness * randomInUnitSphere());
-        attenuation = m_albedo;
+        attenuation = m_albedo->value(record);
 
         if (dot(scattered.getDirection(), record.normal) > 0) {
             return true;
@@ -44,12 +74,19 @@ namespace rt
         }
     }
 
+    Colour Metal::albedo(HitRecord const& record) const
+    {
+        return m_albedo->value(record);
+    }
+
     Dielectric::Dielectric(double refractiveIndex) : m_refractiveIndex(refractiveIndex)
     {
     }
 
     bool Dielectric::scatter(Ray const& incidentRay, HitRecord const& record, Colour& attenuation, Ray& scattered) const
     {
+        countScatter(MaterialKind::dielectric);
+
         // Attenuation is always 0 because glass surfaces don't absorb any light
         attenuation = Colour(1.0, 1.0, 1.0);
         double const refractionRatio = record.frontFace ? (1.0 / m_refractiveIndex) : m_refractiveIndex;
@@ -89,4 +126,19 @@ namespace rt
         
         return r_0 + (1 - r_0) * std::pow((1 - cosine), 5);
     }
+
+    DiffuseLight::DiffuseLight(Colour const& emit) noexcept : m_emit(emit)
+    {
+    }
+
+    bool DiffuseLight::scatter([[maybe_unused]] Ray const& incidentRay, [[maybe_unused]] HitRecord const& record, [[maybe_unused]] Colour& attenuation, [[maybe_unused]] Ray& scattered) const
+    {
+        countScatter(MaterialKind::light);
+        return false;
+    }
+
+    Colour DiffuseLight::emitted(HitRecord const& record) const
+    {
+        return record.frontFace ? m_emit : Colour(0, 0, 0);
+    }
 }
\ No newline at end of file
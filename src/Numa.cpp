@@ -0,0 +1,275 @@
+#include "Numa.hpp"
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace rt
+{
+    namespace
+    {
+        constexpr std::array<char const*, 3> names {"none", "compact", "scatter"};
+
+        std::atomic<Pinning> policy {Pinning::none};
+
+        /// \brief Set once the system refuses to move pages, which it does in many containers
+        std::atomic<bool> placementWasRefused {false};
+
+        thread_local std::size_t threadNode {0};
+
+        /// \brief Read a list of processors such as "0-3,8-11"
+        std::vector<int> parseCpuList(std::string const& list)
+        {
+            std::vector<int> cpus;
+            std::istringstream in(list);
+
+            for (std::string range; std::getline(in, range, ',');) {
+                auto const dash = range.find('-');
+                auto const first = std::stoi(range.substr(0, dash));
+                auto const last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+                for (auto cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+
+            return cpus;
+        }
+
+        std::vector<NumaNode> detectNodes()
+        {
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+                CPU_ZERO(&allowed);
+                CPU_SET(0, &allowed);
+            }
+
+            std::vector<NumaNode> nodes;
+            std::error_code error;
+
+            for (auto const& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+                auto const name = entry.path().filename().string();
+
+                if (name.rfind("node", 0) != 0 or name.size() == 4 or not std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c) != 0; })) {
+                    continue;
+                }
+
+                std::ifstream file(entry.path() / "cpulist");
+                std::string list;
+
+                if (not std::getline(file, list) or list.empty()) {
+                    continue;
+                }
+
+                NumaNode node {std::stoi(name.substr(4)), {}};
+
+                for (auto const cpu : parseCpuList(list)) {
+                    if (cpu < CPU_SETSIZE and CPU_ISSET(cpu, &allowed)) {
+                        node.cpus.push_back(cpu);
+                    }
+                }
+
+                // Nodes of memory only, or of processors this process may not use, get no workers
+                if (not node.cpus.empty()) {
+                    nodes.push_back(std::move(node));
+                }
+            }
+
+            if (nodes.empty()) {
+                NumaNode node {0, {}};
+
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &allowed)) {
+                        node.cpus.push_back(cpu);
+                    }
+                }
+
+                nodes.push_back(std::move(node));
+            }
+
+            std::sort(nodes.begin(), nodes.end(), [](NumaNode const& a, NumaNode const& b) { return a.id < b.id; });
+
+            return nodes;
+        }
+    }
+
+    std::vector<NumaNode> const& numaNodes()
+    {
+        static auto const nodes = detectNodes();
+        return nodes;
+    }
+
+    void setPinning(Pinning const pinning) noexcept
+    {
+        policy.store(pinning, std::memory_order_relaxed);
+    }
+
+    Pinning pinning() noexcept
+    {
+        return policy.load(std::memory_order_relaxed);
+    }
+
+    std::string pinningName(Pinning const pinning)
+    {
+        return names[static_cast<std::size_t>(pinning)];
+    }
+
+    Pinning parsePinning(std::string const& name)
+    {
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            if (name == names[i]) {
+                return static_cast<Pinning>(i);
+            }
+        }
+
+        throw std::invalid_argument("Unknown pinning policy " + name + " (expected none, compact or scatter)");
+    }
+
+    WorkerPlace workerPlace(unsigned const threadIndex)
+    {
+        auto const& nodes = numaNodes();
+
+        switch (pinning()) {
+        case Pinning::compact: {
+            // Count through the processors of every node in turn
+            std::size_t total = 0;
+
+            for (auto const& node : nodes) {
+                total += node.cpus.size();
+            }
+
+            auto slot = threadIndex % total;
+
+            for (std::size_t i = 0; i < nodes.size(); ++i) {
+                if (slot < nodes[i].cpus.size()) {
+                    return {nodes[i].cpus[slot], i};
+                }
+
+                slot -= nodes[i].cpus.size();
+            }
+
+            break;
+        }
+        case Pinning::scatter: {
+            auto const node = threadIndex % nodes.size();
+            auto const& cpus = nodes[node].cpus;
+
+            return {cpus[(threadIndex / nodes.size()) % cpus.size()], node};
+        }
+        case Pinning::none:
+            break;
+        }
+
+        return {-1, 0};
+    }
+
+    std::size_t currentNode() noexcept
+    {
+        return threadNode;
+    }
+
+    std::vector<std::size_t> splitByNode(std::size_t const count, unsigned const threads)
+    {
+        if (pinning() == Pinning::none or threads == 0) {
+            return {0, count};
+        }
+
+        std::vector<std::size_t> workers(numaNodes().size());
+
+        for (unsigned t = 0; t < threads; ++t) {
+            ++workers[workerPlace(t).node];
+        }
+
+        std::vector<std::size_t> split {0};
+        std::size_t placed = 0;
+
+        for (auto const nodeWorkers : workers) {
+            placed += nodeWorkers;
+            split.push_back(count * placed / threads);
+        }
+
+        return split;
+    }
+
+    bool placeOnNodes(void const* data, std::size_t const elementBytes, std::vector<std::size_t> const& split)
+    {
+        if (pinning() == Pinning::none) {
+            return true;
+        }
+
+        if (placementWasRefused.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        auto const& nodes = numaNodes();
+        auto const pageBytes = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+        auto const base = reinterpret_cast<std::uintptr_t>(data);
+        bool placed = true;
+
+        for (std::size_t i = 0; i + 1 < split.size(); ++i) {
+            // Only whole pages inside the share
+            auto const begin = (base + (split[i] * elementBytes) + pageBytes - 1) / pageBytes * pageBytes;
+            auto const end = (base + (split[i + 1] * elementBytes)) / pageBytes * pageBytes;
+
+            if (end <= begin) {
+                continue;
+            }
+
+            constexpr auto wordBits = 8 * sizeof(unsigned long);
+            auto const id = static_cast<std::size_t>(nodes[i].id);
+            std::vector<unsigned long> mask(id / wordBits + 1);
+            mask[id / wordBits] = 1ul << (id % wordBits);
+
+            // The system reads one bit less than it is told
+            if (syscall(SYS_mbind, begin, end - begin, MPOL_BIND, mask.data(), mask.size() * wordBits + 1, MPOL_MF_MOVE) != 0) {
+                placementWasRefused.store(true, std::memory_order_relaxed);
+                placed = false;
+                break;
+            }
+        }
+
+        return placed;
+    }
+
+    bool placementRefused() noexcept
+    {
+        return placementWasRefused.load(std::memory_order_relaxed);
+    }
+
+    ThreadPin::ThreadPin(WorkerPlace const& place) noexcept
+    {
+        if (place.cpu < 0 or sched_getaffinity(0, sizeof(m_previous), &m_previous) != 0) {
+            return;
+        }
+
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(place.cpu, &mask);
+
+        if (sched_setaffinity(0, sizeof(mask), &mask) == 0) {
+            m_pinned = true;
+            m_previousNode = threadNode;
+            threadNode = place.node;
+        }
+    }
+
+    ThreadPin::~ThreadPin()
+    {
+        if (m_pinned) {
+            sched_setaffinity(0, sizeof(m_previous), &m_previous);
+            threadNode = m_previousNode;
+        }
+    }
+}
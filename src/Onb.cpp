@@ -0,0 +1,13 @@
+#include "Onb.hpp"
+
+namespace rt
+{
+    Onb::Onb(Vec3 const& n) noexcept : m_w(unitVector(n))
+    {
+        // Pick a helper axis that cannot be parallel to w
+        Vec3 const a = (std::fabs(m_w.x()) > 0.9) ? Vec3(0, 1, 0) : Vec3(1, 0, 0);
+
+        m_v = unitVector(cross(m_w, a));
+        m_u = cross(m_w, m_v);
+    }
+}
@@ -0,0 +1,448 @@
+#include "Options.hpp"
+#include "Kernels.hpp"
+#include "Numa.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief Get the value that follows a flag
+        /// \param[inout] i The index of the flag. It is advanced past the value
+        /// \throws std::invalid_argument if the flag is the last argument
+        std::string nextValue(int& i, int argc, char const* const* argv)
+        {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(std::string("Missing value for ") + argv[i]);
+            }
+
+            return argv[++i];
+        }
+
+        /// \brief Convert a command line value to a number
+        /// \throws std::invalid_argument if @param value is not a number in the range of double
+        double toDouble(std::string const& value)
+        {
+            try {
+                std::size_t parsed {};
+                auto const number = std::stod(value, &parsed);
+
+                if (parsed == value.size()) {
+                    return number;
+                }
+            }
+            catch (std::logic_error const&) {
+            }
+
+            throw std::invalid_argument("Not a number: " + value);
+        }
+
+        /// \brief Convert a command line value to a positive integer
+        /// \throws std::invalid_argument if @param value is not a positive integer
+        int toPositiveInt(std::string const& value)
+        {
+            try {
+                std::size_t parsed {};
+                auto const number = std::stoi(value, &parsed);
+
+                if (parsed == value.size() and number > 0) {
+                    return number;
+                }
+            }
+            catch (std::logic_error const&) {
+            }
+
+            throw std::invalid_argument("Not a positive integer: " + value);
+        }
+
+        /// \brief Convert a command line value to a TCP port, where zero lets the system choose one
+        /// \throws std::invalid_argument if @param value is not an integer from 0 to 65535
+        int toPort(std::string const& value)
+        {
+            if (not value.empty() and std::isdigit(static_cast<unsigned char>(value.front()))) {
+                try {
+                    std::size_t parsed {};
+                    auto const number = std::stoi(value, &parsed);
+
+                    if (parsed == value.size() and number <= 65535) {
+                        return number;
+                    }
+                }
+                catch (std::logic_error const&) {
+                }
+            }
+
+            throw std::invalid_argument("Not a port number: " + value);
+        }
+
+        /// \brief Convert a command line value to a seed
+        /// \throws std::invalid_argument if @param value is not an integer from 0 to 2^32 - 1
+        std::uint32_t toSeed(std::string const& value)
+        {
+            // std::stoull would read a leading minus sign and wrap the number around
+            if (not value.empty() and std::isdigit(static_cast<unsigned char>(value.front()))) {
+                try {
+                    std::size_t parsed {};
+                    auto const number = std::stoull(value, &parsed);
+
+                    if (parsed == value.size() and number <= std::numeric_limits<std::uint32_t>::max()) {
+                        return static_cast<std::uint32_t>(number);
+                    }
+                }
+                catch (std::logic_error const&) {
+                }
+            }
+
+            throw std::invalid_argument("Not a seed from 0 to " + std::to_string(std::numeric_limits<std::uint32_t>::max()) + ": " + value);
+        }
+    }
+
+    Options parseOptions(int argc, char const* const* argv)
+    {
+        Options options;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string_view const arg = argv[i];
+
+            if (arg == "--scene") {
+                options.scene = nextValue(i, argc, argv);
+            }
+            else if (arg == "--width") {
+                options.width = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--spp") {
+                options.samplesPerPixel = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--max-depth") {
+                options.maxDepth = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--seed") {
+                options.seed = toSeed(nextValue(i, argc, argv));
+            }
+            else if (arg == "--threads") {
+                options.threads = static_cast<unsigned>(toPositiveInt(nextValue(i, argc, argv)));
+            }
+            else if (arg == "--isa") {
+                options.isa = nextValue(i, argc, argv);
+                parseIsa(options.isa);
+            }
+            else if (arg == "--pin") {
+                options.pinning = nextValue(i, argc, argv);
+                parsePinning(options.pinning);
+            }
+            else if (arg == "--pin-compare") {
+                options.comparePinning = true;
+            }
+            else if (arg == "--time-budget") {
+                options.timeBudget = toDouble(nextValue(i, argc, argv));
+
+                if (not (options.timeBudget > 0.0)) {
+                    throw std::invalid_argument("The time budget must be positive");
+                }
+            }
+            else if (arg == "--stream") {
+                options.stream = true;
+            }
+            else if (arg == "--band-height") {
+                options.bandHeight = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--preview") {
+                options.previewFile = nextValue(i, argc, argv);
+            }
+            else if (arg == "--edits") {
+                options.editsFile = nextValue(i, argc, argv);
+            }
+            else if (arg == "--serve") {
+                options.serve = true;
+            }
+            else if (arg == "--serve-socket") {
+                options.serve = true;
+                options.socketPath = nextValue(i, argc, argv);
+            }
+            else if (arg == "--workers") {
+                options.workers = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--listen") {
+                options.listenPort = toPort(nextValue(i, argc, argv));
+            }
+            else if (arg == "--tile-size") {
+                options.tileSize = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--worker") {
+                options.workerAddress = nextValue(i, argc, argv);
+            }
+            else if (arg == "--views") {
+                options.viewsFile = nextValue(i, argc, argv);
+            }
+            else if (arg == "--turntable") {
+                options.turntableViews = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--views-prefix") {
+                options.viewsPrefix = nextValue(i, argc, argv);
+            }
+            else if (arg == "--frames") {
+                options.frames = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--fps") {
+                options.framesPerSecond = toDouble(nextValue(i, argc, argv));
+
+                if (not (options.framesPerSecond > 0.0)) {
+                    throw std::invalid_argument("The frame rate must be positive");
+                }
+            }
+            else if (arg == "--frames-prefix") {
+                options.framesPrefix = nextValue(i, argc, argv);
+            }
+            else if (arg == "--rebuild-threshold") {
+                options.rebuildThreshold = toDouble(nextValue(i, argc, argv));
+
+                if (not (options.rebuildThreshold >= 1.0)) {
+                    throw std::invalid_argument("The rebuild threshold must be at least 1");
+                }
+            }
+            else if (arg == "--denoise") {
+                options.denoise = true;
+            }
+            else if (arg == "--features") {
+                options.featuresPrefix = nextValue(i, argc, argv);
+            }
+            else if (arg == "--heatmaps") {
+                options.heatmapsPrefix = nextValue(i, argc, argv);
+            }
+            else if (arg == "--environment") {
+                options.environment = nextValue(i, argc, argv);
+            }
+            else if (arg == "--environment-scale") {
+                options.environmentScale = toDouble(nextValue(i, argc, argv));
+            }
+            else if (arg == "--photons") {
+                options.photons = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--caustic-radius") {
+                options.causticRadius = toDouble(nextValue(i, argc, argv));
+
+                if (not (options.causticRadius > 0.0)) {
+                    throw std::invalid_argument("The caustic radius must be positive");
+                }
+            }
+            else if (arg == "--freeze") {
+                options.freeze = true;
+            }
+            else if (arg == "--lazy-hierarchy") {
+                options.lazyHierarchy = true;
+            }
+            else if (arg == "--hierarchy-cache") {
+                options.hierarchyCache = nextValue(i, argc, argv);
+            }
+            else if (arg == "--replicate-scene") {
+                options.replicateScene = true;
+            }
+            else if (arg == "--guide") {
+                options.guide = true;
+            }
+            else if (arg == "--guide-training") {
+                options.guideTraining = toDouble(nextValue(i, argc, argv));
+
+                if (not (options.guideTraining > 0.0 and options.guideTraining < 1.0)) {
+                    throw std::invalid_argument("The guide training share must be between 0 and 1");
+                }
+            }
+            else if (arg == "--texture") {
+                options.texture = nextValue(i, argc, argv);
+            }
+            else if (arg == "--texture-cache-mb") {
+                options.textureCacheMegabytes = toPositiveInt(nextValue(i, argc, argv));
+            }
+            else if (arg == "--stats") {
+                options.statsFile = nextValue(i, argc, argv);
+            }
+            else if (arg == "--trace") {
+                options.traceFile = nextValue(i, argc, argv);
+            }
+            else if (arg == "--golden") {
+                options.golden = nextValue(i, argc, argv);
+            }
+            else if (arg == "--golden-tolerance") {
+                options.goldenTolerance = toDouble(nextValue(i, argc, argv));
+            }
+            else if (arg == "--baseline-mrays") {
+                options.baselineMrays = toDouble(nextValue(i, argc, argv));
+            }
+            else if (arg == "--throughput-tolerance") {
+                options.throughputTolerance = toDouble(nextValue(i, argc, argv));
+            }
+            else if (arg == "--make-texture") {
+                options.convertInput = nextValue(i, argc, argv);
+                options.convertOutput = nextValue(i, argc, argv);
+            }
+            else {
+                throw std::invalid_argument("Unknown argument: " + std::string(arg));
+            }
+        }
+
+        // The denoiser and the feature buffers need the whole image at once
+        if (options.stream and (options.denoise or not options.featuresPrefix.empty())) {
+            throw std::invalid_argument("--stream cannot be combined with --denoise or --features");
+        }
+
+        if (options.serve and (options.stream or options.denoise or not options.featuresPrefix.empty())) {
+            throw std::invalid_argument("--serve cannot be combined with --stream, --denoise or --features");
+        }
+
+        auto const distributed = options.workers > 0 or options.listenPort >= 0;
+
+        if (distributed and (options.stream or options.serve or options.denoise or not options.featuresPrefix.empty())) {
+            throw std::invalid_argument("--workers and --listen cannot be combined with --stream, --serve, --denoise or --features");
+        }
+
+        auto const batch = not options.viewsFile.empty() or options.turntableViews > 0;
+
+        if (batch and (distributed or options.stream or options.serve or not options.featuresPrefix.empty())) {
+            throw std::invalid_argument("--views and --turntable cannot be combined with --workers, --listen, --stream, --serve or --features");
+        }
+
+        if (options.frames > 0 and (batch or distributed or options.stream or options.serve or not options.featuresPrefix.empty())) {
+            throw std::invalid_argument("--frames cannot be combined with --views, --turntable, --workers, --listen, --stream, --serve or --features");
+        }
+
+        if (not options.heatmapsPrefix.empty() and (batch or distributed or options.stream or options.serve or options.frames > 0)) {
+            throw std::invalid_argument("--heatmaps cannot be combined with --views, --turntable, --workers, --listen, --stream, --serve or --frames");
+        }
+
+        if (options.timeBudget > 0.0 and (batch or distributed or options.stream or options.serve or options.frames > 0 or not options.heatmapsPrefix.empty())) {
+            throw std::invalid_argument("--time-budget cannot be combined with --views, --turntable, --workers, --listen, --stream, --serve, --frames or --heatmaps");
+        }
+
+        // Workers build their own scenes, and moving objects would leave the photons behind
+        if (options.photons > 0 and (distributed or options.frames > 0)) {
+            throw std::invalid_argument("--photons cannot be combined with --workers, --listen or --frames");
+        }
+
+        // A preview never ends with one finished image to post-process or check
+        if (not options.previewFile.empty() and (batch or distributed or options.stream or options.serve or options.frames > 0 or options.timeBudget > 0.0
+                                                 or options.guide or options.denoise or not options.featuresPrefix.empty() or not options.heatmapsPrefix.empty()
+                                                 or not options.golden.empty() or options.baselineMrays > 0.0)) {
+            throw std::invalid_argument("--preview cannot be combined with --views, --turntable, --workers, --listen, --stream, --serve, --frames, --time-budget, "
+                                        "--guide, --denoise, --features, --heatmaps, --golden or --baseline-mrays");
+        }
+
+        // Only a hierarchy built in full can be refitted, flattened into a frozen world, or saved
+        if (options.lazyHierarchy and (options.frames > 0 or options.freeze or not options.hierarchyCache.empty())) {
+            throw std::invalid_argument("--lazy-hierarchy cannot be combined with --frames, --freeze or --hierarchy-cache");
+        }
+
+        // Workers build their own scenes, and a frozen world does not follow the animation
+        if (options.freeze and (distributed or options.frames > 0)) {
+            throw std::invalid_argument("--freeze cannot be combined with --workers, --listen or --frames");
+        }
+
+        // Only a whole image rendered in one go has the passes the guide learns from
+        if (options.guide and (batch or distributed or options.stream or options.serve or options.frames > 0 or options.timeBudget > 0.0 or not options.heatmapsPrefix.empty())) {
+            throw std::invalid_argument("--guide cannot be combined with --views, --turntable, --workers, --listen, --stream, --serve, --frames, --time-budget or --heatmaps");
+        }
+
+        auto const pinned = not options.pinning.empty() and parsePinning(options.pinning) != Pinning::none;
+
+        if (options.replicateScene and not (options.freeze and pinned)) {
+            throw std::invalid_argument("--replicate-scene needs --freeze and a --pin policy other than none");
+        }
+
+        // Only a single image rendered in one go can be rendered twice and compared
+        if (options.comparePinning and (not pinned or batch or distributed or options.stream or options.serve or options.frames > 0 or options.timeBudget > 0.0
+                                        or not options.previewFile.empty() or options.guide or options.baselineMrays > 0.0)) {
+            throw std::invalid_argument("--pin-compare needs a --pin policy other than none, and cannot be combined with --views, --turntable, "
+                                        "--workers, --listen, --stream, --serve, --frames, --time-budget, --preview, --guide or --baseline-mrays");
+        }
+
+        // Tiles kept from before the edits must have been sampled as the edited ones are, and their objects refitted in place.
+        // Photons are laid down before the edits, and tiles do not record the objects their caustics came through
+        if (not options.editsFile.empty() and (batch or distributed or options.stream or options.serve or options.frames > 0 or options.timeBudget > 0.0
+                                               or not options.previewFile.empty() or options.guide or options.freeze or options.lazyHierarchy
+                                               or options.comparePinning or not options.heatmapsPrefix.empty() or options.photons > 0)) {
+            throw std::invalid_argument("--edits cannot be combined with --views, --turntable, --workers, --listen, --stream, --serve, --frames, --time-budget, "
+                                        "--preview, --guide, --freeze, --lazy-hierarchy, --pin-compare, --heatmaps or --photons");
+        }
+
+        auto const regression = not options.golden.empty() or options.baselineMrays > 0.0;
+
+        if (regression and (batch or distributed or options.stream or options.serve or options.frames > 0 or options.timeBudget > 0.0)) {
+            throw std::invalid_argument("--golden and --baseline-mrays cannot be combined with --views, --turntable, --workers, --listen, --stream, --serve, --frames or --time-budget");
+        }
+
+        return options;
+    }
+
+    std::string usage(std::string const& programName)
+    {
+        return "Usage: " + programName + " [options] > image.ppm\n"
+            "  --scene <name>                Scene to render: random (default), lights, bouncing or sprawl\n"
+            "  --width <pixels>              Image width (default 1200). The height follows from a 3:2 aspect ratio\n"
+            "  --spp <n>                     Samples per pixel (default 500)\n"
+            "  --max-depth <n>               Maximum number of bounces per path (default 50)\n"
+            "  --seed <n>                    Seed for the random spheres and the samples, 0 to 4294967295, which makes runs\n"
+            "                                repeat exactly (default: a different scene every run, whose seed is printed)\n"
+            "  --threads <n>                 Worker threads (default: one per core)\n"
+            "  --isa <name>                  Use the kernels built for baseline, sse4, avx2 or avx512 instead of the fastest\n"
+            "                                the processor supports, which is never avx512\n"
+            "  --pin <policy>                Pin worker threads to processors: none (default), compact fills one memory node\n"
+            "                                before the next, scatter deals threads to the nodes in turn. Rows of the image\n"
+            "                                are kept in the memory of the node that renders them\n"
+            "  --pin-compare                 Render the image unpinned first, and report the gain of pinning\n"
+            "  --time-budget <seconds>       Finish the image this long after starting, with as many samples as fit, up to --spp\n"
+            "  --stream                      Write bands of rows as they finish, so memory does not grow with the image\n"
+            "  --band-height <rows>          Rows per streamed band (default 16)\n"
+            "  --serve                       Keep the scene loaded and render jobs read from the standard input, one per line:\n"
+            "                                render [width=<n>] [height=<n>] [spp=<n>] [depth=<n>] [seed=<n>] [from=<x,y,z>]\n"
+            "                                [at=<x,y,z>] [up=<x,y,z>] [fov=<degrees>] [aperture=<x>] [focus=<distance>]\n"
+            "                                Each job is answered with a binary PPM. \"quit\" ends the session\n"
+            "  --preview <file.ppm>          Refine the view coarse to fine into this file, which is replaced after every step.\n"
+            "                                Each line of the standard input in the form of a --serve job moves the camera and\n"
+            "                                starts again. \"quit\" stops, and the end of the input waits for the last step\n"
+            "  --edits <file>                After rendering, apply the edits in the file and render again only the tiles whose\n"
+            "                                paths touched what changed. One edit per line: move <sphere> <dx> <dy> <dz> or\n"
+            "                                paint <sphere> <red> <green> <blue>. The edited image is written\n"
+            "  --serve-socket <path>         Serve jobs to clients of a Unix domain socket until one sends \"shutdown\"\n"
+            "  --workers <n>                 Split the frame into tiles rendered by n local worker processes\n"
+            "  --listen <port>               Also accept workers from other machines on this TCP port. 0 lets the system\n"
+            "                                choose one, which is printed\n"
+            "  --tile-size <pixels>          Size of the tiles handed to workers or rendered again after edits (default 32)\n"
+            "  --worker <host:port>          Render tiles for the coordinator at host:port until its frame is done\n"
+            "  --views <file>                Render every view in the file, one request per line as for --serve, sharing one scene\n"
+            "  --turntable <n>               Render n views on a circle around the scene, sharing one scene\n"
+            "  --views-prefix <prefix>       Write views to <prefix><number>.ppm (default view-)\n"
+            "  --frames <n>                  Render n frames of the scene's animation, refitting its hierarchy between frames\n"
+            "  --fps <x>                     Frames per second of animation time (default 24)\n"
+            "  --frames-prefix <prefix>      Write frames to <prefix><number>.ppm (default frame-)\n"
+            "  --rebuild-threshold <x>       Rebuild the hierarchy once refitting makes it x times as costly to trace (default 1.5)\n"
+            "  --denoise                     Denoise the image using first-hit albedo, normal and depth\n"
+            "  --features <prefix>           Also write <prefix>.albedo.pfm, <prefix>.normal.pfm and <prefix>.depth.pfm\n"
+            "  --heatmaps <prefix>           Also write the traversal steps, intersection tests, path length and time of every\n"
+            "                                pixel as heatmaps <prefix>.traversal.ppm, .tests.ppm, .path.ppm and .time.ppm\n"
+            "  --environment <file>          Light the scene with a latitude-longitude .hdr or .pfm image\n"
+            "  --environment-scale <x>       Multiply the environment map by x (default 1)\n"
+            "  --photons <n>                 Emit n photons from the lights and gather the caustics they form from them\n"
+            "  --caustic-radius <x>          Radius over which caustic photons are gathered (default 0.05)\n"
+            "  --freeze                      Compile the world into one block of memory, with the spheres in traversal order\n"
+            "  --lazy-hierarchy              Split the hierarchy only where rays go, the first time one enters each node\n"
+            "  --hierarchy-cache <dir>       Keep the built hierarchy in this directory, named after a hash of the scene's\n"
+            "                                geometry, and map it instead of building it when the same scene is rendered again\n"
+            "  --replicate-scene             Copy the frozen world to every memory node (needs --freeze and --pin)\n"
+            "  --guide                       Learn where light comes from in the first passes and guide diffuse bounces towards it.\n"
+            "                                A seeded run then repeats exactly only with --threads 1\n"
+            "  --guide-training <x>          Share of the samples spent teaching the guide, between 0 and 1 (default 0.25)\n"
+            "  --texture <file.rtt>          Put a tiled texture on the large diffuse sphere\n"
+            "  --texture-cache-mb <n>        Memory budget of the texture tile cache (default 256)\n"
+            "  --stats <file.json>           Write ray, intersection, scatter, path length and timing counters to a JSON file\n"
+            "  --trace <file.json>           Record a timeline of phases, rows, tiles and writes for chrome://tracing or Perfetto\n"
+            "  --golden <file.ppm>           Fail unless the image matches this reference within the golden tolerance\n"
+            "  --golden-tolerance <x>        Largest root mean square difference from the reference, 0 to 1 (default 0.02)\n"
+            "  --baseline-mrays <x>          Fail if rendering traces fewer Mrays/s than this, less the throughput tolerance\n"
+            "  --throughput-tolerance <x>    Fraction of the baseline throughput that may be lost (default 0.2)\n"
+            "  --make-texture <in> <out.rtt> Convert a .ppm, .pfm or .hdr image to a tiled, mip-mapped texture and exit\n";
+    }
+}
@@ -0,0 +1,377 @@
+#include "PathGuide.hpp"
+#include "Common.hpp"
+
+#include <cmath>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief Add to an atomic float without a lock
+        void atomicAdd(std::atomic<float>& target, float const value) noexcept
+        {
+            auto current = target.load(std::memory_order_relaxed);
+
+            while (not target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+            }
+        }
+
+        /// \brief Map a unit direction to the unit square, preserving area: u is the height, v the azimuth
+        void toSquare(Vec3 const& direction, double& u, double& v) noexcept
+        {
+            auto phi = std::atan2(direction.z(), direction.x());
+
+            if (phi < 0) {
+                phi += 2.0 * pi;
+            }
+
+            u = clamp(0.5 * (direction.y() + 1.0), 0.0, 1.0);
+            v = clamp(phi / (2.0 * pi), 0.0, 1.0);
+        }
+
+        /// \brief Map a point of the unit square back to a unit direction
+        Vec3 fromSquare(double const u, double const v) noexcept
+        {
+            auto const cosTheta = (2.0 * u) - 1.0;
+            auto const sinTheta = std::sqrt(std::fmax(0.0, 1.0 - (cosTheta * cosTheta)));
+            auto const phi = 2.0 * pi * v;
+
+            return Vec3(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi));
+        }
+
+        /// \brief Get the quadrant of a node that holds (u, v), and map (u, v) into that quadrant
+        std::size_t descend(double& u, double& v) noexcept
+        {
+            std::size_t quadrant = 0;
+
+            if (u >= 0.5) {
+                quadrant |= 1;
+                u -= 0.5;
+            }
+
+            if (v >= 0.5) {
+                quadrant |= 2;
+                v -= 0.5;
+            }
+
+            u *= 2.0;
+            v *= 2.0;
+
+            return quadrant;
+        }
+    }
+
+    DirectionalTree::DirectionalTree() : m_energy(4), m_children(4, 0)
+    {
+        for (auto& energy : m_energy) {
+            energy.store(0.0f, std::memory_order_relaxed);
+        }
+    }
+
+    DirectionalTree::DirectionalTree(DirectionalTree const& other) : m_energy(other.m_energy.size()), m_children(other.m_children)
+    {
+        for (std::size_t i = 0; i < m_energy.size(); ++i) {
+            m_energy[i].store(other.m_energy[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+    DirectionalTree& DirectionalTree::operator=(DirectionalTree const& other)
+    {
+        if (this != &other) {
+            *this = DirectionalTree(other);
+        }
+
+        return *this;
+    }
+
+    void DirectionalTree::record(Vec3 const& direction, float const value) noexcept
+    {
+        if (not (value > 0.0f) or not std::isfinite(value)) {
+            return;
+        }
+
+        double u {};
+        double v {};
+        toSquare(direction, u, v);
+
+        // Every level holds the energy of its quadrants, so the value is added once per level on the way down
+        std::size_t node = 0;
+
+        while (true) {
+            auto const quadrant = descend(u, v);
+            atomicAdd(m_energy[(4 * node) + quadrant], value);
+
+            auto const child = m_children[(4 * node) + quadrant];
+
+            if (child == 0) {
+                break;
+            }
+
+            node = child;
+        }
+    }
+
+    double DirectionalTree::total() const noexcept
+    {
+        double sum = 0.0;
+
+        for (std::size_t q = 0; q < 4; ++q) {
+            sum += m_energy[q].load(std::memory_order_relaxed);
+        }
+
+        return sum;
+    }
+
+    Vec3 DirectionalTree::sample(double& pdf) const
+    {
+        double squarePdf = 1.0;
+        double u = 0.0;
+        double v = 0.0;
+        double size = 1.0;
+        std::size_t node = 0;
+
+        while (true) {
+            std::array<double, 4> energy {};
+            double sum = 0.0;
+
+            for (std::size_t q = 0; q < 4; ++q) {
+                energy[q] = m_energy[(4 * node) + q].load(std::memory_order_relaxed);
+                sum += energy[q];
+            }
+
+            // A node without energy is sampled uniformly
+            if (sum <= 0.0) {
+                break;
+            }
+
+            // Rounding must never pick a quadrant without energy, so the search stops at the last one with some
+            std::size_t last = 3;
+
+            while (energy[last] <= 0.0) {
+                --last;
+            }
+
+            auto pick = randomDouble() * sum;
+            std::size_t quadrant = 0;
+
+            while (quadrant < last and pick >= energy[quadrant]) {
+                pick -= energy[quadrant];
+                ++quadrant;
+            }
+
+            squarePdf *= 4.0 * energy[quadrant] / sum;
+            size *= 0.5;
+            u += (quadrant & 1) ? size : 0.0;
+            v += (quadrant & 2) ? size : 0.0;
+
+            auto const child = m_children[(4 * node) + quadrant];
+
+            if (child == 0) {
+                break;
+            }
+
+            node = child;
+        }
+
+        u += size * randomDouble();
+        v += size * randomDouble();
+
+        pdf = squarePdf / (4.0 * pi);
+        return fromSquare(u, v);
+    }
+
+    double DirectionalTree::pdf(Vec3 const& direction) const noexcept
+    {
+        double u {};
+        double v {};
+        toSquare(direction, u, v);
+
+        double squarePdf = 1.0;
+        std::size_t node = 0;
+
+        while (true) {
+            double sum = 0.0;
+
+            for (std::size_t q = 0; q < 4; ++q) {
+                sum += m_energy[(4 * node) + q].load(std::memory_order_relaxed);
+            }
+
+            if (sum <= 0.0) {
+                break;
+            }
+
+            auto const quadrant = descend(u, v);
+            squarePdf *= 4.0 * m_energy[(4 * node) + quadrant].load(std::memory_order_relaxed) / sum;
+
+            auto const child = m_children[(4 * node) + quadrant];
+
+            if (child == 0 or squarePdf <= 0.0) {
+                break;
+            }
+
+            node = child;
+        }
+
+        return squarePdf / (4.0 * pi);
+    }
+
+    DirectionalTree DirectionalTree::refined(double const threshold, int const maxDepth) const
+    {
+        struct Pending
+        {
+            std::size_t oldNode;            // The matching node of this tree, or size() if there is none
+            std::array<double, 4> energy;   // The energy of the quadrants of the node
+            int depth;
+            std::size_t newNode;
+        };
+
+        auto const sum = total();
+        auto const none = size();
+
+        DirectionalTree tree;
+        std::vector<std::uint32_t> children(4, 0);
+        std::vector<Pending> stack;
+
+        std::array<double, 4> rootEnergy {};
+
+        for (std::size_t q = 0; q < 4; ++q) {
+            rootEnergy[q] = m_energy[q].load(std::memory_order_relaxed);
+        }
+
+        stack.push_back({0, rootEnergy, 1, 0});
+
+        while (not stack.empty() and sum > 0.0) {
+            auto const pending = stack.back();
+            stack.pop_back();
+
+            for (std::size_t q = 0; q < 4; ++q) {
+                if (pending.depth >= maxDepth or pending.energy[q] <= threshold * sum) {
+                    continue;
+                }
+
+                auto const newChild = children.size() / 4;
+                children.resize(children.size() + 4, 0);
+                children[(4 * pending.newNode) + q] = static_cast<std::uint32_t>(newChild);
+
+                // A quadrant that was not split yet passes a quarter of its energy to each of its new quadrants
+                auto const oldChild = pending.oldNode == none ? 0 : m_children[(4 * pending.oldNode) + q];
+                std::array<double, 4> childEnergy {};
+
+                for (std::size_t c = 0; c < 4; ++c) {
+                    childEnergy[c] = oldChild != 0 ? m_energy[(4 * oldChild) + c].load(std::memory_order_relaxed) : 0.25 * pending.energy[q];
+                }
+
+                stack.push_back({oldChild != 0 ? oldChild : none, childEnergy, pending.depth + 1, newChild});
+            }
+        }
+
+        tree.m_energy = std::vector<std::atomic<float>>(children.size());
+
+        for (auto& energy : tree.m_energy) {
+            energy.store(0.0f, std::memory_order_relaxed);
+        }
+
+        tree.m_children = std::move(children);
+        return tree;
+    }
+
+    PathGuide::PathGuide(Aabb const& bounds, GuideSettings const& settings) : m_settings(settings)
+    {
+        m_nodes.push_back({bounds, 0, 0, 0});
+        m_regions.push_back(std::make_unique<Region>());
+    }
+
+    std::uint32_t PathGuide::locate(Point3 const& point) const noexcept
+    {
+        std::size_t node = 0;
+
+        while (m_nodes[node].child != 0) {
+            auto const& n = m_nodes[node];
+            node = n.child + (point[static_cast<gsl::index>(n.axis)] >= n.box.centre(n.axis) ? 1 : 0);
+        }
+
+        return m_nodes[node].region;
+    }
+
+    bool PathGuide::canSample(std::uint32_t const region) const noexcept
+    {
+        return m_regions[region]->sampling.total() > 0.0;
+    }
+
+    Vec3 PathGuide::sample(std::uint32_t const region, double& pdf) const
+    {
+        return m_regions[region]->sampling.sample(pdf);
+    }
+
+    double PathGuide::pdf(std::uint32_t const region, Vec3 const& direction) const noexcept
+    {
+        return m_regions[region]->sampling.pdf(direction);
+    }
+
+    void PathGuide::record(std::uint32_t const region, Vec3 const& direction, double const radiance, double const pdf) noexcept
+    {
+        if (not (pdf > 0.0)) {
+            return;
+        }
+
+        auto& target = *m_regions[region];
+        target.samples.fetch_add(1, std::memory_order_relaxed);
+        target.learning.record(direction, static_cast<float>(radiance / pdf));
+    }
+
+    void PathGuide::refine()
+    {
+        // Nodes appended while splitting are visited too, so a busy region keeps splitting until its halves are quiet enough
+        for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+            if (m_nodes[i].child != 0) {
+                continue;
+            }
+
+            auto& parent = *m_regions[m_nodes[i].region];
+            auto const samples = parent.samples.load(std::memory_order_relaxed);
+
+            if (samples <= m_settings.splitSamples) {
+                continue;
+            }
+
+            auto const box = m_nodes[i].box;
+            auto const axis = box.longestAxis();
+            auto const middle = box.centre(axis);
+
+            std::array<double, 3> lower {box.min(0), box.min(1), box.min(2)};
+            std::array<double, 3> upper {box.max(0), box.max(1), box.max(2)};
+            auto lowerUpper = upper;
+            auto upperLower = lower;
+            lowerUpper[axis] = middle;
+            upperLower[axis] = middle;
+
+            // The first half keeps the region of the parent, and the second half starts as a copy of it
+            auto region = std::make_unique<Region>();
+            region->sampling = parent.sampling;
+            region->learning = parent.learning;
+            region->samples.store(samples / 2, std::memory_order_relaxed);
+            parent.samples.store(samples / 2, std::memory_order_relaxed);
+
+            auto const child = static_cast<std::uint32_t>(m_nodes.size());
+            auto const firstRegion = m_nodes[i].region;
+
+            m_nodes[i].child = child;
+            m_nodes[i].axis = static_cast<std::uint8_t>(axis);
+
+            m_nodes.push_back({Aabb(Point3(lower[0], lower[1], lower[2]), Point3(lowerUpper[0], lowerUpper[1], lowerUpper[2])), 0, firstRegion, 0});
+            m_nodes.push_back({Aabb(Point3(upperLower[0], upperLower[1], upperLower[2]), Point3(upper[0], upper[1], upper[2])), 0, static_cast<std::uint32_t>(m_regions.size()), 0});
+            m_regions.push_back(std::move(region));
+        }
+
+        // What was learned becomes what is sampled, and learning starts again on a tree fitted to it.
+        // Regions that saw no light keep sampling what they learned before
+        for (auto& region : m_regions) {
+            if (region->learning.total() > 0.0) {
+                region->sampling = region->learning;
+            }
+
+            region->learning = region->sampling.refined(m_settings.subdivisionEnergy, m_settings.maxDirectionalDepth);
+            region->samples.store(0, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,326 @@
+#include "PhotonMap.hpp"
+#include "Common.hpp"
+#include "Distribution.hpp"
+#include "Material.hpp"
+#include "Parallel.hpp"
+#include "Scene.hpp"
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief The number of photons traced from one seed. Blocks are gathered in order, so the map does not depend on the threads
+        constexpr std::size_t photonsPerBlock = 4096;
+
+        /// \brief Pack a colour into single precision
+        std::array<float, 3> toFloats(Vec3 const& v) noexcept
+        {
+            return {static_cast<float>(v.x()), static_cast<float>(v.y()), static_cast<float>(v.z())};
+        }
+
+        /// \brief Determine whether a colour carries no energy
+        constexpr bool isBlack(Colour const& c) noexcept
+        {
+            return c.x() <= 0 and c.y() <= 0 and c.z() <= 0;
+        }
+
+        /// \brief Get the smallest power of two that is not less than @param n
+        std::size_t ceilPowerOfTwo(std::size_t const n) noexcept
+        {
+            std::size_t power = 1;
+
+            while (power < n) {
+                power <<= 1;
+            }
+
+            return power;
+        }
+
+        /// \brief Follow one photon from a light until it is absorbed, escapes, or lands on a diffuse surface
+        /// \param[in] scene The world the photon travels through
+        /// \param[in] ray The photon leaving the light
+        /// \param[in] power The flux carried by the photon
+        /// \param[in] maxDepth The maximum number of mirror-like bounces
+        /// \param[inout] photons Receives the photon if it lands on a diffuse surface after a mirror-like bounce
+        void tracePhoton(Scene const& scene, Ray ray, Colour power, int const maxDepth, std::vector<Photon>& photons)
+        {
+            for (int depth = 0; depth <= maxDepth; ++depth) {
+                HitRecord record;
+
+                if (not scene.world.hit(ray, 0.001, infinity, record)) {
+                    return;
+                }
+
+                Material const& material = *record.materialPtr;
+
+                if (material.isDiffuse()) {
+                    // Light that arrives without a mirror-like bounce is direct light, which the integrator samples itself
+                    if (depth > 0) {
+                        photons.push_back({toFloats(record.point), toFloats(unitVector(ray.getDirection())), toFloats(power)});
+                    }
+
+                    return;
+                }
+
+                Colour attenuation;
+                Ray scattered;
+
+                if (not material.scatter(ray, record, attenuation, scattered)) {
+                    return;
+                }
+
+                power = power * attenuation;
+
+                if (isBlack(power)) {
+                    return;
+                }
+
+                ray = scattered;
+            }
+        }
+    }
+
+    PhotonMap::PhotonMap(std::vector<Photon> photons, double const radius, unsigned threads)
+    :   m_radius(radius), m_inverseCellSize(1.0 / (2.0 * radius))
+    {
+        if (not (radius > 0)) {
+            throw std::invalid_argument("The photon gathering radius must be positive");
+        }
+
+        if (photons.size() >= std::numeric_limits<std::uint32_t>::max()) {
+            throw std::invalid_argument("Too many photons");
+        }
+
+        if (photons.empty()) {
+            m_bucketStart.assign(2, 0);
+            return;
+        }
+
+        if (threads == 0) {
+            threads = defaultThreadCount();
+        }
+
+        m_lower = photons.front().position;
+        m_upper = photons.front().position;
+
+        for (auto const& photon : photons) {
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                m_lower[axis] = std::min(m_lower[axis], photon.position[axis]);
+                m_upper[axis] = std::max(m_upper[axis], photon.position[axis]);
+            }
+        }
+
+        // A counting sort by bucket. Every thread counts and then places a contiguous chunk of the photons,
+        // so the photons of a bucket keep the order in which they were traced
+        auto const buckets = ceilPowerOfTwo(2 * photons.size());
+        auto const chunks = static_cast<std::size_t>(std::min<std::size_t>(threads, (photons.size() + photonsPerBlock - 1) / photonsPerBlock));
+        auto const chunkSize = (photons.size() + chunks - 1) / chunks;
+
+        m_bucketStart.assign(buckets + 1, 0);
+
+        std::vector<std::uint32_t> keys(photons.size());
+        std::vector<std::vector<std::uint32_t>> counts(chunks, std::vector<std::uint32_t>(buckets, 0));
+
+        parallelFor(chunks, threads, [&](std::size_t chunk, unsigned) {
+            auto const end = std::min(photons.size(), (chunk + 1) * chunkSize);
+
+            for (auto i = chunk * chunkSize; i < end; ++i) {
+                auto const& p = photons[i].position;
+                keys[i] = static_cast<std::uint32_t>(bucket(cell(p[0]), cell(p[1]), cell(p[2])));
+                ++counts[chunk][keys[i]];
+            }
+        });
+
+        // Turn the counts into the offset at which each chunk writes into each bucket
+        std::uint32_t offset = 0;
+
+        for (std::size_t b = 0; b < buckets; ++b) {
+            m_bucketStart[b] = offset;
+
+            for (auto& count : counts) {
+                auto const n = count[b];
+                count[b] = offset;
+                offset += n;
+            }
+        }
+
+        m_bucketStart[buckets] = offset;
+        m_photons.resize(photons.size());
+
+        parallelFor(chunks, threads, [&](std::size_t chunk, unsigned) {
+            auto const end = std::min(photons.size(), (chunk + 1) * chunkSize);
+
+            for (auto i = chunk * chunkSize; i < end; ++i) {
+                m_photons[counts[chunk][keys[i]]++] = photons[i];
+            }
+        });
+    }
+
+    std::int64_t PhotonMap::cell(double const position) const noexcept
+    {
+        return static_cast<std::int64_t>(std::floor(position * m_inverseCellSize));
+    }
+
+    std::size_t PhotonMap::bucket(std::int64_t const x, std::int64_t const y, std::int64_t const z) const noexcept
+    {
+        auto const hash = (static_cast<std::uint64_t>(x) * 73856093u) ^ (static_cast<std::uint64_t>(y) * 19349663u) ^ (static_cast<std::uint64_t>(z) * 83492791u);
+        return static_cast<std::size_t>(hash & (m_bucketStart.size() - 2));
+    }
+
+    Colour PhotonMap::radiance(HitRecord const& record) const
+    {
+        if (m_photons.empty()) {
+            return Colour(0, 0, 0);
+        }
+
+        std::array<double, 3> const point {record.point.x(), record.point.y(), record.point.z()};
+
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            if (point[axis] + m_radius < m_lower[axis] or point[axis] - m_radius > m_upper[axis]) {
+                return Colour(0, 0, 0);
+            }
+        }
+
+        std::array<std::int64_t, 3> lower {};
+        std::array<std::int64_t, 3> upper {};
+
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            lower[axis] = cell(point[axis] - m_radius);
+            upper[axis] = std::min(cell(point[axis] + m_radius), lower[axis] + 1);    // The disc is no wider than a cell
+        }
+
+        // Different cells can share a bucket, which must then be visited only once
+        std::array<std::size_t, 8> visited {};
+        std::size_t visitedCount = 0;
+
+        auto const radiusSquared = m_radius * m_radius;
+        std::array<double, 3> power {};
+
+        for (auto z = lower[2]; z <= upper[2]; ++z) {
+            for (auto y = lower[1]; y <= upper[1]; ++y) {
+                for (auto x = lower[0]; x <= upper[0]; ++x) {
+                    auto const b = bucket(x, y, z);
+
+                    if (std::find(visited.begin(), visited.begin() + visitedCount, b) != visited.begin() + visitedCount) {
+                        continue;
+                    }
+
+                    visited[visitedCount++] = b;
+
+                    for (auto i = m_bucketStart[b]; i < m_bucketStart[b + 1]; ++i) {
+                        auto const& photon = m_photons[i];
+                        auto const dx = photon.position[0] - point[0];
+                        auto const dy = photon.position[1] - point[1];
+                        auto const dz = photon.position[2] - point[2];
+                        auto const distanceSquared = (dx * dx) + (dy * dy) + (dz * dz);
+
+                        if (distanceSquared >= radiusSquared) {
+                            continue;
+                        }
+
+                        // Photons that arrived on the other side of the surface do not light this one
+                        auto const facing = (photon.direction[0] * record.normal.x()) + (photon.direction[1] * record.normal.y()) + (photon.direction[2] * record.normal.z());
+
+                        if (facing >= 0) {
+                            continue;
+                        }
+
+                        auto const weight = 1.0 - (std::sqrt(distanceSquared) / m_radius);
+
+                        for (std::size_t c = 0; c < 3; ++c) {
+                            power[c] += weight * photon.power[c];
+                        }
+                    }
+                }
+            }
+        }
+
+        if (power[0] <= 0 and power[1] <= 0 and power[2] <= 0) {
+            return Colour(0, 0, 0);
+        }
+
+        // The cone filter keeps a third of the disc's area, and evaluating towards the normal gives albedo / pi
+        auto const area = pi * radiusSquared / 3.0;
+        Colour const f = record.materialPtr->evaluate(record, record.normal);
+
+        return f * Colour(power[0], power[1], power[2]) / area;
+    }
+
+    PhotonMap traceCaustics(Scene const& scene, PhotonSettings const& settings)
+    {
+        PhaseTimer const timer("photons");
+
+        std::vector<std::shared_ptr<Hittable>> emitters;
+        std::vector<Colour> emission;
+        std::vector<double> powers;
+
+        // Lights are assumed to emit the same radiance all over, so one point tells how bright each of them is
+        for (auto const& light : scene.lights.objects()) {
+            HitRecord record;
+            light->sampleSurface(record);
+
+            if (light->area() <= 0 or not record.materialPtr) {
+                continue;
+            }
+
+            Colour const emitted = record.materialPtr->emitted(record);
+
+            emitters.push_back(light);
+            emission.push_back(emitted);
+            powers.push_back(luminance(emitted) * light->area() * pi);
+        }
+
+        if (emitters.empty() or settings.photons == 0) {
+            return PhotonMap({}, settings.radius, settings.threads);
+        }
+
+        Distribution1D const pick(powers);
+        auto const blocks = (settings.photons + photonsPerBlock - 1) / photonsPerBlock;
+        std::vector<std::vector<Photon>> stored(blocks);
+
+        parallelFor(blocks, settings.threads, [&](std::size_t block, unsigned) {
+            seedRandom(mixBits((static_cast<std::uint64_t>(settings.seed) << 32) ^ block));
+
+            auto const end = std::min(settings.photons, (block + 1) * photonsPerBlock);
+
+            for (auto i = block * photonsPerBlock; i < end; ++i) {
+                double pdf {};
+                std::size_t index {};
+                pick.sampleContinuous(randomDouble(), pdf, index);
+
+                auto const probability = pdf / static_cast<double>(pick.count());
+
+                if (probability <= 0) {
+                    continue;
+                }
+
+                HitRecord record;
+                emitters[index]->sampleSurface(record);
+
+                // A Lambertian emitter sends its photons out in a cosine-weighted distribution, which cancels the cosine in its power
+                auto direction = record.normal + randomUnitVector();
+
+                if (direction.isNearZero()) {
+                    direction = record.normal;
+                }
+
+                auto const flux = (emitters[index]->area() * pi / (probability * static_cast<double>(settings.photons))) * emission[index];
+                tracePhoton(scene, Ray(record.point, direction), flux, settings.maxDepth, stored[block]);
+            }
+        });
+
+        std::vector<Photon> photons;
+
+        for (auto const& block : stored) {
+            photons.insert(photons.end(), block.begin(), block.end());
+        }
+
+        return PhotonMap(std::move(photons), settings.radius, settings.threads);
+    }
+}
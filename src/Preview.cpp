@@ -0,0 +1,146 @@
+#include "Preview.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief The coarse steps, each given by the fraction of the width and height it renders
+        constexpr std::array<int, 2> coarseScales {4, 2};
+
+        /// \brief The full-size steps multiply the samples in every pixel by this much
+        constexpr int sampleGrowth = 4;
+    }
+
+    Preview::Preview(Scene const& scene, RenderSettings const& settings, CameraSettings const& camera, Update update)
+    :   m_scene(scene), m_settings(settings), m_update(std::move(update)), m_camera(camera)
+    {
+        m_settings.showProgress = false;
+
+        auto const size = 3 * static_cast<std::size_t>(settings.width) * static_cast<std::size_t>(settings.height);
+        m_image.assign(size, 0.0f);
+        m_pass.assign(size, 0.0f);
+    }
+
+    void Preview::setCamera(CameraSettings const& camera)
+    {
+        std::lock_guard lock(m_mutex);
+        m_camera = camera;
+        m_cameraSet = true;
+        m_interrupt = true;
+        m_changed.notify_all();
+    }
+
+    void Preview::stop()
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+        m_interrupt = true;
+        m_changed.notify_all();
+    }
+
+    void Preview::finish()
+    {
+        std::lock_guard lock(m_mutex);
+        m_finishing = true;
+        m_changed.notify_all();
+    }
+
+    void Preview::run()
+    {
+        while (true) {
+            CameraSettings camera;
+
+            {
+                std::unique_lock lock(m_mutex);
+                m_changed.wait(lock, [this] { return m_stopping or m_cameraSet or m_finishing; });
+
+                if (m_stopping or not m_cameraSet) {
+                    return;
+                }
+
+                camera = m_camera;
+                m_cameraSet = false;
+                m_interrupt = false;
+            }
+
+            auto const completed = refine(camera);
+
+            std::lock_guard lock(m_mutex);
+
+            if (m_stopping or (completed and m_finishing and not m_cameraSet)) {
+                return;
+            }
+        }
+    }
+
+    bool Preview::refine(CameraSettings const& cameraSettings)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        auto const width = m_settings.width;
+        auto const height = m_settings.height;
+        Camera const camera(cameraSettings, static_cast<double>(width) / height);
+
+        TileProgress progress;
+        progress.cancel = &m_interrupt;
+
+        auto const report = [&](int const scale, int const samples, bool const final) {
+            std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+            m_update(FloatImage {m_image.data(), width, height, 3 * static_cast<std::size_t>(width)}, PreviewStep {scale, samples, elapsed.count(), final});
+        };
+
+        // Coarse steps: one sample in each of fewer, larger pixels, enlarged to the full size
+        for (auto const scale : coarseScales) {
+            auto coarse = m_settings;
+            coarse.width = std::max(1, width / scale);
+            coarse.height = std::max(1, height / scale);
+            coarse.samplesPerPixel = 1;
+
+            if (not render(m_scene, camera, coarse, FloatImage {m_pass.data(), coarse.width, coarse.height, 3 * static_cast<std::size_t>(coarse.width)}, progress)) {
+                return false;
+            }
+
+            for (int y = 0; y < height; ++y) {
+                auto const sourceRow = std::min(coarse.height - 1, y * coarse.height / height);
+
+                for (int x = 0; x < width; ++x) {
+                    auto const sourceColumn = std::min(coarse.width - 1, x * coarse.width / width);
+                    auto const* source = &m_pass[3 * ((static_cast<std::size_t>(sourceRow) * coarse.width) + sourceColumn)];
+                    std::copy(source, source + 3, &m_image[3 * ((static_cast<std::size_t>(y) * width) + x)]);
+                }
+            }
+
+            report(scale, 1, false);
+        }
+
+        // Full-size steps: each brings the samples per pixel to the next power of the growth, and is averaged into
+        // the image with the weight of its share of the samples. Every step has its own seed, so no sample repeats
+        int samples = 0;
+
+        for (std::uint32_t step = 0; samples < m_settings.samplesPerPixel; ++step) {
+            auto const target = std::min(m_settings.samplesPerPixel, samples == 0 ? 1 : samples * sampleGrowth);
+
+            auto pass = m_settings;
+            pass.samplesPerPixel = target - samples;
+            pass.seed = m_settings.seed + step;
+
+            if (not render(m_scene, camera, pass, FloatImage {m_pass.data(), width, height, 3 * static_cast<std::size_t>(width)}, progress)) {
+                return false;
+            }
+
+            auto const weight = static_cast<float>(pass.samplesPerPixel) / static_cast<float>(target);
+
+            for (std::size_t i = 0; i < m_image.size(); ++i) {
+                m_image[i] = samples == 0 ? m_pass[i] : ((1.0f - weight) * m_image[i]) + (weight * m_pass[i]);
+            }
+
+            samples = target;
+            report(1, samples, samples >= m_settings.samplesPerPixel);
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,385 @@
+#include "RenderServer.hpp"
+#include "BandWriter.hpp"
+#include "Parallel.hpp"
+#include "Socket.hpp"
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace rt
+{
+    namespace
+    {
+        constexpr int bandHeight = 16;
+
+        /// \brief Convert a request field to a number
+        /// \throws std::invalid_argument if @param value is not entirely a number
+        double toNumber(std::string const& field, std::string const& value)
+        {
+            try {
+                std::size_t parsed {};
+                auto const number = std::stod(value, &parsed);
+
+                if (parsed == value.size()) {
+                    return number;
+                }
+            }
+            catch (std::logic_error const&) {
+            }
+
+            throw std::invalid_argument("Bad value for " + field + ": " + value);
+        }
+
+        /// \brief Convert a request field to a positive integer
+        /// \throws std::invalid_argument if @param value is not a positive integer
+        int toCount(std::string const& field, std::string const& value)
+        {
+            auto const number = toNumber(field, value);
+
+            if (number < 1 or number > 1e6 or number != static_cast<int>(number)) {
+                throw std::invalid_argument("Bad value for " + field + ": " + value);
+            }
+
+            return static_cast<int>(number);
+        }
+
+        /// \brief Convert a request field of the form x,y,z to a vector
+        /// \throws std::invalid_argument if @param value is not three numbers
+        Vec3 toVector(std::string const& field, std::string const& value)
+        {
+            std::array<double, 3> xyz {};
+            std::size_t start = 0;
+
+            for (std::size_t i = 0; i < 3; ++i) {
+                auto const end = i < 2 ? value.find(',', start) : value.size();
+
+                if (end == std::string::npos) {
+                    throw std::invalid_argument("Bad value for " + field + ": " + value);
+                }
+
+                xyz[i] = toNumber(field, value.substr(start, end - start));
+                start = end + 1;
+            }
+
+            return Vec3(xyz[0], xyz[1], xyz[2]);
+        }
+
+        /// \brief Check that a served job is small enough that one request cannot take the memory or the time of every other client
+        /// \throws std::invalid_argument if @param job is too large
+        void checkServedJob(RenderJob const& job)
+        {
+            auto const& settings = job.settings;
+            auto const pixels = std::int64_t {settings.width} * settings.height;
+
+            if (settings.width > maxServedSide or settings.height > maxServedSide) {
+                throw std::invalid_argument("The image must be at most " + std::to_string(maxServedSide) + " pixels on a side");
+            }
+
+            if (pixels > maxServedPixels) {
+                throw std::invalid_argument("The image must have at most " + std::to_string(maxServedPixels) + " pixels");
+            }
+
+            if (pixels * settings.samplesPerPixel > maxServedSamples) {
+                throw std::invalid_argument("The job must take at most " + std::to_string(maxServedSamples) + " samples");
+            }
+        }
+
+        /// \brief Render a job, writing it as a binary PPM whose rows stream out as their band is finished
+        void renderJob(Scene const& scene, RenderJob const& job, std::ostream& out)
+        {
+            auto const& settings = job.settings;
+            Camera const camera(job.camera, static_cast<double>(settings.width) / settings.height);
+
+            out << "P6\n" << settings.width << ' ' << settings.height << "\n255\n";
+
+            auto const threads = settings.threads > 0 ? settings.threads : defaultThreadCount();
+            auto const window = 2 + static_cast<int>(threads / bandHeight);
+
+            BandWriter writer(settings.width, settings.height, bandHeight, window, [&](int, int, std::vector<Colour> const& pixels) {
+                auto const bytes = toBytes(pixels, 1);
+
+                if (not out.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size())).flush()) {
+                    throw std::runtime_error("The client stopped reading");
+                }
+            });
+
+            render(scene, camera, settings, writer);
+            writer.finish();
+        }
+
+        /// \brief A stream buffer over a connected socket
+        class SocketBuffer : public std::streambuf
+        {
+        public:
+            explicit SocketBuffer(int const fd) : m_fd(fd)
+            {
+                setg(m_input.data(), m_input.data(), m_input.data());
+                setp(m_output.data(), m_output.data() + m_output.size());
+            }
+
+        protected:
+            int_type underflow() override
+            {
+                auto const received = ::recv(m_fd, m_input.data(), m_input.size(), 0);
+
+                if (received <= 0) {
+                    return traits_type::eof();
+                }
+
+                setg(m_input.data(), m_input.data(), m_input.data() + received);
+                return traits_type::to_int_type(m_input[0]);
+            }
+
+            int_type overflow(int_type const c) override
+            {
+                if (sync() != 0) {
+                    return traits_type::eof();
+                }
+
+                if (not traits_type::eq_int_type(c, traits_type::eof())) {
+                    *pptr() = traits_type::to_char_type(c);
+                    pbump(1);
+                }
+
+                return traits_type::not_eof(c);
+            }
+
+            int sync() override
+            {
+                for (char const* p = pbase(); p < pptr();) {
+                    // Without MSG_NOSIGNAL a client that hangs up would kill the server with SIGPIPE
+                    auto const sent = ::send(m_fd, p, static_cast<std::size_t>(pptr() - p), MSG_NOSIGNAL);
+
+                    if (sent < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+
+                        return -1;
+                    }
+
+                    p += sent;
+                }
+
+                setp(m_output.data(), m_output.data() + m_output.size());
+                return 0;
+            }
+
+        private:
+            int m_fd;
+            std::array<char, 4096> m_input {};
+            std::array<char, 65536> m_output {};
+        };
+    }
+
+    RenderJob parseRenderJob(std::string_view const line, RenderJob const& defaults)
+    {
+        std::istringstream fields {std::string(line)};
+        std::string command;
+        fields >> command;
+
+        if (command != "render") {
+            throw std::invalid_argument("Unknown request: " + command);
+        }
+
+        RenderJob job = defaults;
+        bool heightGiven = false;
+
+        for (std::string field; fields >> field;) {
+            auto const equals = field.find('=');
+
+            if (equals == std::string::npos) {
+                throw std::invalid_argument("Expected name=value: " + field);
+            }
+
+            auto const name = field.substr(0, equals);
+            auto const value = field.substr(equals + 1);
+
+            if (name == "width") {
+                job.settings.width = toCount(name, value);
+            }
+            else if (name == "height") {
+                job.settings.height = toCount(name, value);
+                heightGiven = true;
+            }
+            else if (name == "spp") {
+                job.settings.samplesPerPixel = toCount(name, value);
+            }
+            else if (name == "depth") {
+                job.settings.maxDepth = toCount(name, value);
+            }
+            else if (name == "seed") {
+                auto const seed = toNumber(name, value);
+
+                if (seed < 0 or seed > std::numeric_limits<std::uint32_t>::max() or seed != std::floor(seed)) {
+                    throw std::invalid_argument("Bad value for " + name + ": " + value);
+                }
+
+                job.settings.seed = static_cast<std::uint32_t>(seed);
+            }
+            else if (name == "from") {
+                job.camera.lookFrom = toVector(name, value);
+            }
+            else if (name == "at") {
+                job.camera.lookAt = toVector(name, value);
+            }
+            else if (name == "up") {
+                job.camera.viewUp = toVector(name, value);
+            }
+            else if (name == "fov") {
+                job.camera.verticalFovInDegrees = toNumber(name, value);
+            }
+            else if (name == "aperture") {
+                job.camera.aperture = toNumber(name, value);
+            }
+            else if (name == "focus") {
+                job.camera.focusDistance = toNumber(name, value);
+            }
+            else {
+                throw std::invalid_argument("Unknown field: " + name);
+            }
+        }
+
+        if (not heightGiven) {
+            auto const aspectRatio = static_cast<double>(defaults.settings.width) / defaults.settings.height;
+            job.settings.height = std::max(1, static_cast<int>(job.settings.width / aspectRatio));
+        }
+
+        // The sample positions are spread over width - 1 and height - 1 pixel spacings
+        if (job.settings.width < 2 or job.settings.height < 2) {
+            throw std::invalid_argument("The image must be at least 2 x 2 pixels");
+        }
+
+        return job;
+    }
+
+    std::string formatRenderJob(RenderJob const& job)
+    {
+        std::ostringstream request;
+        request.precision(17);
+
+        auto const vector = [&](char const* name, Vec3 const& v) {
+            request << ' ' << name << '=' << v.x() << ',' << v.y() << ',' << v.z();
+        };
+
+        request << "render width=" << job.settings.width << " height=" << job.settings.height
+                << " spp=" << job.settings.samplesPerPixel << " depth=" << job.settings.maxDepth << " seed=" << job.settings.seed;
+
+        vector("from", job.camera.lookFrom);
+        vector("at", job.camera.lookAt);
+        vector("up", job.camera.viewUp);
+
+        request << " fov=" << job.camera.verticalFovInDegrees << " aperture=" << job.camera.aperture << " focus=" << job.camera.focusDistance;
+
+        return request.str();
+    }
+
+    std::vector<RenderJob> readRenderJobs(std::istream& in, RenderJob const& defaults)
+    {
+        std::vector<RenderJob> jobs;
+        int lineNumber = 0;
+
+        for (std::string line; std::getline(in, line);) {
+            ++lineNumber;
+
+            if (line.empty() or line.front() == '#') {
+                continue;
+            }
+
+            try {
+                jobs.push_back(parseRenderJob(line, defaults));
+            }
+            catch (std::invalid_argument const& e) {
+                throw std::invalid_argument("Line " + std::to_string(lineNumber) + ": " + e.what());
+            }
+        }
+
+        return jobs;
+    }
+
+    bool serve(Scene const& scene, RenderJob const& defaults, std::istream& in, std::ostream& out)
+    {
+        auto jobDefaults = defaults;
+        jobDefaults.settings.showProgress = false;
+
+        int jobCount = 0;
+
+        for (std::string line; std::getline(in, line);) {
+            if (line.empty() or line.front() == '#') {
+                continue;
+            }
+
+            if (line == "quit") {
+                return false;
+            }
+
+            if (line == "shutdown") {
+                return true;
+            }
+
+            RenderJob job;
+
+            try {
+                job = parseRenderJob(line, jobDefaults);
+                checkServedJob(job);
+            }
+            catch (std::invalid_argument const& e) {
+                out << "error " << e.what() << '\n' << std::flush;
+                continue;
+            }
+
+            auto const start = std::chrono::steady_clock::now();
+
+            try {
+                renderJob(scene, job, out);
+            }
+            catch (std::exception const& e) {
+                std::cerr << "Job " << jobCount << ": " << e.what() << '\n';
+
+                // Nothing more can reach a client that stopped reading, but any other failure only ends this job
+                if (not out) {
+                    return false;
+                }
+
+                out << "error " << e.what() << '\n' << std::flush;
+                continue;
+            }
+
+            std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+            std::cerr << "Job " << jobCount++ << ": " << job.settings.width << 'x' << job.settings.height << ", "
+                      << job.settings.samplesPerPixel << " spp in " << elapsed.count() << " s\n";
+        }
+
+        return false;
+    }
+
+    void serveSocket(Scene const& scene, RenderJob const& defaults, std::string const& path)
+    {
+        auto const listener = listenUnix(path);
+        std::cerr << "Listening on " << path << '\n';
+
+        for (bool shutdown = false; not shutdown;) {
+            auto const client = acceptConnection(listener);
+
+            SocketBuffer buffer(client.fd());
+            std::istream in(&buffer);
+            std::ostream out(&buffer);
+
+            shutdown = serve(scene, defaults, in, out);
+            out.flush();
+        }
+
+        ::unlink(path.c_str());
+    }
+}
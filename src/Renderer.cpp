@@ -0,0 +1,533 @@
+#include "Renderer.hpp"
+#include "Common.hpp"
+#include "Footprint.hpp"
+#include "Integrator.hpp"
+#include "Parallel.hpp"
+#include "PathGuide.hpp"
+#include "Statistics.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <gsl/assert>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief The samples of one pixel
+        struct PixelSamples
+        {
+            Colour colour;  // Sum of the radiance samples
+            Colour albedo;  // Mean first-hit albedo
+            Vec3 normal;    // Mean first-hit normal
+            double depth;   // Mean first-hit distance
+        };
+
+        /// \brief Trace all the samples of one pixel
+        /// \details Every sample restarts the random sequence of the thread from the image seed, the pixel and the sample
+        /// number, so a sample comes out the same whichever thread takes it and whatever that thread did before
+        /// \param[in] x, y The column and the row of the pixel, counted from the top left
+        /// \param[in] firstSample The number of the first sample, for passes that add to samples taken before
+        /// \param[inout] footprint If not null, receives what the paths of the samples touched
+        PixelSamples renderPixel(Scene const& scene, Camera const& camera, RenderSettings const& settings, int const x, int const y, int const firstSample = 0,
+                                 TileFootprint* footprint = nullptr)
+        {
+            auto const imgWidth = settings.width;
+            auto const imgHeight = settings.height;
+            auto const samplesPerPixel = settings.samplesPerPixel;
+
+            // Shrink the differentials as the samples of a pixel get closer together, but not so far that textures alias
+            auto const differentialScale = std::fmax(0.125, 1.0 / std::sqrt(samplesPerPixel));
+            auto const du = differentialScale / (imgWidth - 1);
+            auto const dv = differentialScale / (imgHeight - 1);
+
+            // The camera counts rows from the bottom
+            auto const j = imgHeight - 1 - y;
+
+            PixelSamples pixel {};
+
+            // The index is taken in 64 bits, as streamed images may have more pixels than an int counts
+            auto const pixelIndex = (static_cast<std::uint64_t>(y) * static_cast<std::uint64_t>(imgWidth)) + static_cast<std::uint64_t>(x);
+            auto const pixelSeed = mixBits((static_cast<std::uint64_t>(settings.seed) << 32u) | pixelIndex);
+
+            for (int s = 0; s < samplesPerPixel; ++s) {
+                seedRandom(mixBits(pixelSeed ^ static_cast<std::uint64_t>(firstSample + s)));
+                auto const rand = randomDouble();
+
+                auto u = (x + rand) / (imgWidth - 1);
+                auto v = (j + rand) / (imgHeight - 1);
+
+                Ray ray = camera.getRay(u, v, du, dv);
+                PathFeatures features;
+                pixel.colour += rayColour(ray, scene, settings.maxDepth, &features, footprint);
+
+                pixel.albedo += features.albedo;
+                pixel.normal += features.normal;
+                pixel.depth += features.depth;
+            }
+
+            threadStatistics().primaryRays.add(static_cast<std::uint64_t>(samplesPerPixel));
+
+            pixel.albedo /= samplesPerPixel;
+            pixel.normal /= samplesPerPixel;
+            pixel.depth /= samplesPerPixel;
+
+            return pixel;
+        }
+
+        /// \brief The counters of the calling thread that add up to the cost of a pixel
+        struct CostSnapshot
+        {
+            std::uint64_t nodeVisits;
+            std::uint64_t primitiveTests;
+            std::uint64_t segments;
+            std::chrono::steady_clock::time_point time;
+
+            /// \brief Read the counters of the calling thread
+            static CostSnapshot take() noexcept
+            {
+                auto const& stats = threadStatistics();
+                std::uint64_t tests = 0;
+
+                for (auto const& counter : stats.intersectionTests) {
+                    tests += counter.value();
+                }
+
+                return {stats.nodeVisits.value(), tests, stats.primaryRays.value() + stats.secondaryRays.value(), std::chrono::steady_clock::now()};
+            }
+
+            /// \brief Get the cost of the work done by the calling thread since this snapshot
+            /// \param[in] samples The number of samples the work was spread over
+            PixelCost since(int const samples) const noexcept
+            {
+                auto const now = take();
+                auto const perSample = [samples](std::uint64_t const count) { return static_cast<float>(count) / static_cast<float>(samples); };
+
+                return PixelCost {
+                    perSample(now.nodeVisits - nodeVisits),
+                    perSample(now.primitiveTests - primitiveTests),
+                    perSample(now.segments - segments),
+                    std::chrono::duration<float, std::micro>(now.time - time).count()
+                };
+            }
+        };
+
+        /// \brief Move the rows of the framebuffer to the nodes whose workers render them, if workers are pinned
+        /// \details The first time the system refuses, that is reported once and no render tries again
+        void placeRows(Framebuffer const& framebuffer, RenderSettings const& settings)
+        {
+            if (pinning() == Pinning::none or placementRefused()) {
+                return;
+            }
+
+            auto const rows = static_cast<std::size_t>(framebuffer.height);
+            auto const width = static_cast<std::size_t>(framebuffer.width);
+            auto const split = splitByNode(rows, workerCount(rows, settings.threads));
+
+            auto const placed = placeOnNodes(framebuffer.colour.data(), width * sizeof(Colour), split)
+                and placeOnNodes(framebuffer.albedo.data(), width * sizeof(Colour), split)
+                and placeOnNodes(framebuffer.normal.data(), width * sizeof(Vec3), split)
+                and placeOnNodes(framebuffer.depth.data(), width * sizeof(double), split);
+
+            if (not placed) {
+                std::cerr << "The system refused to move memory between nodes, so rows stay where they were first written "
+                             "and only the threads are pinned\n";
+            }
+        }
+
+        /// \brief Add a pass of samples to every pixel of the framebuffer
+        /// \param[in] pass The settings of the pass, with the number of samples it adds
+        /// \param[in] samples The number of samples each pixel already has
+        void renderPass(Scene const& scene, Camera const& camera, RenderSettings const& pass, int const samples, Framebuffer& framebuffer)
+        {
+            TraceScope const span("pass", samples);
+
+            parallelFor(static_cast<std::size_t>(pass.height), pass.threads, [&](std::size_t row, unsigned) {
+                TraceScope const rowSpan("row", static_cast<std::int64_t>(row));
+                auto const y = static_cast<int>(row);
+
+                for (auto x = 0; x < pass.width; ++x) {
+                    auto const pixel = renderPixel(scene, camera, pass, x, y, samples);
+                    auto const index = framebuffer.index(x, y);
+
+                    framebuffer.colour[index] += pixel.colour;
+
+                    // The features are means, so each pass is weighted by its share of the samples. Written as a blend
+                    // rather than a difference, so that infinite depths stay infinite instead of becoming NaN
+                    auto const weight = static_cast<double>(pass.samplesPerPixel) / (samples + pass.samplesPerPixel);
+                    framebuffer.albedo[index] = ((1.0 - weight) * framebuffer.albedo[index]) + (weight * pixel.albedo);
+                    framebuffer.normal[index] = ((1.0 - weight) * framebuffer.normal[index]) + (weight * pixel.normal);
+                    framebuffer.depth[index] = samples == 0 ? pixel.depth : ((1.0 - weight) * framebuffer.depth[index]) + (weight * pixel.depth);
+                }
+            });
+        }
+
+        /// \brief Render with the scene's path guide: passes of 1, 2, 4... samples while it learns, then the rest at once
+        /// \details The guide is refined after every learning pass, so each pass samples what the ones before it found.
+        /// Every sample is kept, since guided samples are weighted by the density they were drawn with
+        void renderGuided(Scene const& scene, Camera const& camera, RenderSettings const& settings, Framebuffer& framebuffer)
+        {
+            auto& guide = *scene.guide;
+            auto const learningSamples = static_cast<int>(settings.samplesPerPixel * guide.settings().trainingFraction);
+
+            auto pass = settings;
+            int samples = 0;
+
+            std::fill(framebuffer.colour.begin(), framebuffer.colour.end(), Colour(0, 0, 0));
+            guide.setLearning(true);
+
+            for (int passSamples = 1; samples + passSamples <= learningSamples; passSamples *= 2) {
+                pass.samplesPerPixel = passSamples;
+                renderPass(scene, camera, pass, samples, framebuffer);
+                samples += passSamples;
+                guide.refine();
+
+                if (settings.showProgress) {
+                    std::cerr << "Learning pass of " << passSamples << " spp, " << guide.regions() << " guide regions\n";
+                }
+            }
+
+            guide.setLearning(false);
+
+            if (samples < settings.samplesPerPixel) {
+                pass.samplesPerPixel = settings.samplesPerPixel - samples;
+                renderPass(scene, camera, pass, samples, framebuffer);
+            }
+
+            framebuffer.samplesPerPixel = settings.samplesPerPixel;
+        }
+
+        /// \brief Count down the rows still to render on the standard error stream, with the current ray throughput
+        /// \details The line is rewritten in place at most a few times per second, so that printing never holds up the
+        /// threads, and finished with a newline once the last row is done
+        class Progress
+        {
+        public:
+            Progress(int const rows, bool const enabled)
+            :   m_remaining(rows), m_enabled(enabled), m_start(std::chrono::steady_clock::now()), m_lastPrint(m_start)
+            {
+                if (m_enabled) {
+                    m_startRays = collectStatistics().rays();
+                }
+            }
+
+            /// \brief Record a finished row
+            void rowDone()
+            {
+                if (not m_enabled) {
+                    return;
+                }
+
+                static constexpr std::chrono::milliseconds interval {250};
+
+                std::lock_guard lock(m_mutex);
+                auto const now = std::chrono::steady_clock::now();
+
+                if (--m_remaining > 0 and now - m_lastPrint < interval) {
+                    return;
+                }
+
+                m_lastPrint = now;
+                auto const seconds = std::chrono::duration<double>(now - m_start).count();
+                auto const rays = static_cast<double>(collectStatistics().rays() - m_startRays);
+
+                std::cerr << "\rRows remaining: " << m_remaining << ", " << (seconds > 0 ? rays / seconds / 1e6 : 0.0) << " Mrays/s   "
+                          << (m_remaining == 0 ? "\n" : "") << std::flush;
+            }
+
+        private:
+            std::mutex m_mutex;
+            int m_remaining;
+            bool m_enabled;
+            std::chrono::steady_clock::time_point m_start;
+            std::chrono::steady_clock::time_point m_lastPrint;
+            std::uint64_t m_startRays {};
+        };
+    }
+
+    void render(Scene const& scene, Camera const& camera, RenderSettings const& settings, Framebuffer& framebuffer)
+    {
+        Expects(framebuffer.width == settings.width and framebuffer.height == settings.height);
+
+        PhaseTimer const timer("render");
+        placeRows(framebuffer, settings);
+
+        if (scene.guide) {
+            renderGuided(scene, camera, settings, framebuffer);
+            return;
+        }
+
+        Progress progress(settings.height, settings.showProgress);
+
+        if (settings.recordCost) {
+            framebuffer.cost.assign(framebuffer.colour.size(), PixelCost {});
+        }
+
+        parallelFor(static_cast<std::size_t>(settings.height), settings.threads, [&](std::size_t row, unsigned) {
+            TraceScope const span("row", static_cast<std::int64_t>(row));
+            auto const y = static_cast<int>(row);
+
+            for (auto x = 0; x < settings.width; ++x) {
+                auto const before = settings.recordCost ? CostSnapshot::take() : CostSnapshot {};
+                auto const pixel = renderPixel(scene, camera, settings, x, y);
+                auto const index = framebuffer.index(x, y);
+
+                if (settings.recordCost) {
+                    framebuffer.cost[index] = before.since(settings.samplesPerPixel);
+                }
+
+                framebuffer.colour[index] = pixel.colour;
+                framebuffer.albedo[index] = pixel.albedo;
+                framebuffer.normal[index] = pixel.normal;
+                framebuffer.depth[index] = pixel.depth;
+            }
+
+            progress.rowDone();
+        });
+
+        framebuffer.samplesPerPixel = settings.samplesPerPixel;
+    }
+
+    int render(Scene const& scene, Camera const& camera, RenderSettings const& settings, std::chrono::steady_clock::time_point const deadline, Framebuffer& framebuffer)
+    {
+        Expects(framebuffer.width == settings.width and framebuffer.height == settings.height);
+
+        PhaseTimer const timer("render");
+        placeRows(framebuffer, settings);
+
+        auto pass = settings;
+        int samples = 0;
+        double secondsPerSample {};
+
+        while (samples < settings.samplesPerPixel) {
+            auto const start = std::chrono::steady_clock::now();
+            pass.samplesPerPixel = 1;
+
+            if (samples > 0) {
+                auto const remaining = std::chrono::duration<double>(deadline - start).count();
+                auto const fit = std::floor(0.5 * remaining / secondsPerSample);
+
+                if (fit < 1.0) {
+                    break;
+                }
+
+                pass.samplesPerPixel = static_cast<int>(std::min(fit, static_cast<double>(settings.samplesPerPixel - samples)));
+            }
+
+            renderPass(scene, camera, pass, samples, framebuffer);
+
+            std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+            samples += pass.samplesPerPixel;
+            secondsPerSample = elapsed.count() / pass.samplesPerPixel;
+
+            if (settings.showProgress) {
+                std::cerr << "Pass of " << pass.samplesPerPixel << " spp in " << elapsed.count() << " s, " << samples << " spp so far\n";
+            }
+        }
+
+        framebuffer.samplesPerPixel = samples;
+        return samples;
+    }
+
+    void render(Scene const& scene, Camera const& camera, RenderSettings const& settings, BandWriter& writer)
+    {
+        PhaseTimer const timer("render");
+        Progress progress(settings.height, settings.showProgress);
+
+        // A row waits until its band is in the window, so pinned workers must not start part way down the image
+        parallelFor(static_cast<std::size_t>(settings.height), settings.threads, IndexOrder::ascending, [&](std::size_t row, unsigned) {
+            TraceScope const span("row", static_cast<std::int64_t>(row));
+            auto const y = static_cast<int>(row);
+            auto* const pixels = writer.acquireRow(y);
+
+            if (pixels == nullptr) {
+                return;
+            }
+
+            for (auto x = 0; x < settings.width; ++x) {
+                pixels[x] = renderPixel(scene, camera, settings, x, y).colour / settings.samplesPerPixel;
+            }
+
+            writer.releaseRow(y);
+            progress.rowDone();
+        });
+    }
+
+    void renderViews(Scene const& scene, std::vector<RenderJob> const& views, std::function<void(std::size_t, Framebuffer&)> const& finished)
+    {
+        if (views.empty()) {
+            return;
+        }
+
+        PhaseTimer const timer("render");
+
+        struct View
+        {
+            View(Camera const& camera, int const rows) : camera(camera), rowsLeft(rows)
+            {
+            }
+
+            Camera camera;
+            std::unique_ptr<Framebuffer> framebuffer;   // Created by the first row of the view and released after the last
+            std::atomic<int> rowsLeft;
+            std::once_flag started;
+        };
+
+        std::vector<std::size_t> firstRow;
+        std::deque<View> state;
+        std::size_t rows = 0;
+
+        for (auto const& view : views) {
+            auto const& settings = view.settings;
+            state.emplace_back(Camera(view.camera, static_cast<double>(settings.width) / settings.height), settings.height);
+            firstRow.push_back(rows);
+            rows += static_cast<std::size_t>(settings.height);
+        }
+
+        Progress progress(static_cast<int>(rows), views.front().settings.showProgress);
+
+        parallelFor(rows, views.front().settings.threads, [&](std::size_t row, unsigned) {
+            TraceScope const span("row", static_cast<std::int64_t>(row));
+            auto const v = static_cast<std::size_t>(std::upper_bound(firstRow.begin(), firstRow.end(), row) - firstRow.begin()) - 1;
+            auto const& settings = views[v].settings;
+            auto& view = state[v];
+            auto const y = static_cast<int>(row - firstRow[v]);
+
+            std::call_once(view.started, [&] { view.framebuffer = std::make_unique<Framebuffer>(settings.width, settings.height); });
+            auto& framebuffer = *view.framebuffer;
+
+            for (auto x = 0; x < settings.width; ++x) {
+                auto const pixel = renderPixel(scene, view.camera, settings, x, y);
+                auto const index = framebuffer.index(x, y);
+
+                framebuffer.colour[index] = pixel.colour;
+                framebuffer.albedo[index] = pixel.albedo;
+                framebuffer.normal[index] = pixel.normal;
+                framebuffer.depth[index] = pixel.depth;
+            }
+
+            progress.rowDone();
+
+            // The thread that finishes the last row of a view hands it over
+            if (--view.rowsLeft == 0) {
+                framebuffer.samplesPerPixel = settings.samplesPerPixel;
+                finished(v, framebuffer);
+                view.framebuffer.reset();
+            }
+        });
+    }
+
+    bool render(Scene const& scene, Camera const& camera, RenderSettings const& settings, FloatImage const& image, TileProgress const& progress)
+    {
+        Expects(image.width == settings.width and image.height == settings.height);
+        Expects(image.rowStride >= 3 * static_cast<std::size_t>(image.width));
+        Expects(progress.tileSize > 0);
+
+        PhaseTimer const timer("render");
+
+        auto const columns = (settings.width + progress.tileSize - 1) / progress.tileSize;
+        auto const rows = (settings.height + progress.tileSize - 1) / progress.tileSize;
+        auto const tileCount = columns * rows;
+        auto const cancelled = [&progress] { return progress.cancel != nullptr and progress.cancel->load(std::memory_order_relaxed); };
+
+        std::mutex reportMutex;
+        int tilesDone = 0;
+
+        parallelFor(static_cast<std::size_t>(tileCount), settings.threads, [&](std::size_t index, unsigned) {
+            if (cancelled()) {
+                return;
+            }
+
+            auto const i = static_cast<int>(index);
+            auto const x0 = (i % columns) * progress.tileSize;
+            auto const y0 = (i / columns) * progress.tileSize;
+            Tile const tile {i, x0, y0, std::min(x0 + progress.tileSize, settings.width), std::min(y0 + progress.tileSize, settings.height)};
+
+            TraceScope const span("tile", tile.index);
+
+            for (auto y = tile.y0; y < tile.y1; ++y) {
+                // A cancelled tile stops between rows, so the caller does not wait for a whole tile
+                if (cancelled()) {
+                    return;
+                }
+
+                auto* row = image.pixels + (static_cast<std::size_t>(y) * image.rowStride);
+
+                for (auto x = tile.x0; x < tile.x1; ++x) {
+                    auto const mean = renderPixel(scene, camera, settings, x, y).colour / settings.samplesPerPixel;
+                    auto* pixel = row + (3 * static_cast<std::size_t>(x));
+
+                    pixel[0] = static_cast<float>(mean.x());
+                    pixel[1] = static_cast<float>(mean.y());
+                    pixel[2] = static_cast<float>(mean.z());
+                }
+            }
+
+            std::lock_guard lock(reportMutex);
+            ++tilesDone;
+
+            if (progress.tileDone) {
+                progress.tileDone(tile, tilesDone, tileCount);
+            }
+        });
+
+        return tilesDone == tileCount;
+    }
+
+    void renderTile(Scene const& scene, Camera const& camera, RenderSettings const& settings, Tile const& tile, std::vector<Colour>& colour)
+    {
+        Expects(tile.x0 >= 0 and tile.x0 < tile.x1 and tile.x1 <= settings.width);
+        Expects(tile.y0 >= 0 and tile.y0 < tile.y1 and tile.y1 <= settings.height);
+
+        PhaseTimer const timer("render");
+        TraceScope const tileSpan("tile", tile.index);
+
+        auto const tileWidth = static_cast<std::size_t>(tile.x1 - tile.x0);
+        colour.resize(static_cast<std::size_t>(tile.area()));
+
+        parallelFor(static_cast<std::size_t>(tile.y1 - tile.y0), settings.threads, [&](std::size_t row, unsigned) {
+            TraceScope const span("row", tile.y0 + static_cast<std::int64_t>(row));
+            for (auto x = tile.x0; x < tile.x1; ++x) {
+                auto const y = tile.y0 + static_cast<int>(row);
+                colour[(row * tileWidth) + static_cast<std::size_t>(x - tile.x0)] = renderPixel(scene, camera, settings, x, y).colour;
+            }
+        });
+    }
+
+    void renderTiles(Scene const& scene, Camera const& camera, RenderSettings const& settings, std::vector<Tile> const& tiles, Framebuffer* framebuffer,
+                     std::vector<TileFootprint>& footprints)
+    {
+        Expects(framebuffer == nullptr or (framebuffer->width == settings.width and framebuffer->height == settings.height));
+
+        PhaseTimer const timer("render");
+
+        parallelFor(tiles.size(), settings.threads, [&](std::size_t i, unsigned) {
+            auto const& tile = tiles[i];
+            auto& footprint = footprints[static_cast<std::size_t>(tile.index)];
+            TraceScope const span("tile", tile.index);
+
+            footprint.clear();
+
+            for (auto y = tile.y0; y < tile.y1; ++y) {
+                for (auto x = tile.x0; x < tile.x1; ++x) {
+                    auto const pixel = renderPixel(scene, camera, settings, x, y, 0, &footprint);
+
+                    if (framebuffer) {
+                        auto const index = framebuffer->index(x, y);
+
+                        framebuffer->colour[index] = pixel.colour;
+                        framebuffer->albedo[index] = pixel.albedo;
+                        framebuffer->normal[index] = pixel.normal;
+                        framebuffer->depth[index] = pixel.depth;
+                    }
+                }
+            }
+        });
+    }
+}
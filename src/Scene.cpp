@@ -0,0 +1,254 @@
+#include "Scene.hpp"
+#include "Common.hpp"
+#include "HdrImage.hpp"
+#include "LazyBvh.hpp"
+#include "Material.hpp"
+#include "Sphere.hpp"
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief Scatter small spheres with random materials over the ground plane
+        /// \param[inout] world The list the spheres are added to
+        void addRandomSpheres(HittableList& world)
+        {
+            for (int a = -11; a < 11; ++a) {
+                for (int b = -11; b < 11; ++b) {
+                    auto chooseMaterial = randomDouble();
+                    auto centre = Point3(a + 0.9 * randomDouble(), 0.2, b + 0.9 * randomDouble());
+
+                    if ((centre - Point3(4, 0.2, 0)).length() > 0.9) {
+                        std::shared_ptr<Material> sphereMaterial;
+
+                        if (chooseMaterial < 0.8) {
+                            // Diffuse
+                            auto albedo = Colour::random() * Colour::random();
+                            sphereMaterial = std::make_shared<Lambertian>(albedo);
+                            world.add(std::make_shared<Sphere>(centre, 0.2, sphereMaterial));
+                        }
+                        else if (chooseMaterial < 0.95) {
+                            // Metal
+                            auto albedo = Colour::random(0.5, 1);
+                            auto fuzz = randomDouble(0, 0.5);
+                            sphereMaterial = std::make_shared<Metal>(albedo, fuzz);
+                            world.add(std::make_shared<Sphere>(centre, 0.2, sphereMaterial));
+                        }
+                        else {
+                            // Glass
+                            sphereMaterial = std::make_shared<Dielectric>(1.5);
+                            world.add(std::make_shared<Sphere>(centre, 0.2, sphereMaterial));
+                        }
+                    }
+                }
+            }
+        }
+
+        /// \brief Add the three large spheres in the middle of the scene
+        /// \param[inout] world The list the spheres are added to
+        /// \param[in] featureTexture If not null, the albedo of the diffuse sphere
+        void addLargeSpheres(HittableList& world, std::shared_ptr<Texture> const& featureTexture)
+        {
+            auto mat1 = std::make_shared<Dielectric>(1.5);
+            world.add(std::make_shared<Sphere>(Point3(0, 1, 0), 1.0, mat1));
+
+            auto mat2 = featureTexture ? std::make_shared<Lambertian>(featureTexture) : std::make_shared<Lambertian>(Colour(0.4, 0.2, 0.1));
+            world.add(std::make_shared<Sphere>(Point3(-4, 1, 0), 1.0, mat2));
+
+            auto mat3 = std::make_shared<Metal>(Colour(0.7, 0.6, 0.5), 0.0);
+            world.add(std::make_shared<Sphere>(Point3(4, 1, 0), 1.0, mat3));
+        }
+    }
+
+    Scene randomScene(std::shared_ptr<Texture> const& featureTexture)
+    {
+        auto groundMaterial = std::make_shared<Lambertian>(Colour(0.5, 0.5, 0.5));
+
+        Scene scene;
+        scene.environment = std::make_shared<SkyGradient>();
+        scene.world.add(std::make_shared<Sphere>(Point3(0, -1000, 0), 1000, groundMaterial));
+
+        addRandomSpheres(scene.world);
+        addLargeSpheres(scene.world, featureTexture);
+
+        return scene;
+    }
+
+    Scene smallLightsScene(std::shared_ptr<Texture> const& featureTexture)
+    {
+        auto groundMaterial = std::make_shared<Lambertian>(Colour(0.5, 0.5, 0.5));
+
+        Scene scene;
+        scene.world.add(std::make_shared<Sphere>(Point3(0, -1000, 0), 1000, groundMaterial));
+
+        addRandomSpheres(scene.world);
+        addLargeSpheres(scene.world, featureTexture);
+
+        // A warm key light above the large spheres and a dim, cool fill light to the side
+        auto keyLight = std::make_shared<Sphere>(Point3(0, 4, 1.5), 0.5, std::make_shared<DiffuseLight>(Colour(40, 36, 30)));
+        auto fillLight = std::make_shared<Sphere>(Point3(-6, 2.5, 4), 0.3, std::make_shared<DiffuseLight>(Colour(8, 10, 16)));
+
+        for (auto const& light : { keyLight, fillLight }) {
+            scene.world.add(light);
+            scene.lights.add(light);
+        }
+
+        return scene;
+    }
+
+    Scene bouncingScene(std::shared_ptr<Texture> const& featureTexture)
+    {
+        Scene scene = randomScene(featureTexture);
+        auto const& objects = scene.world.objects();
+        HittableList world;
+
+        static constexpr double duration = 4.0;
+        static constexpr double step = 1.0 / 24.0;
+
+        for (std::size_t i = 0; i < objects.size(); ++i) {
+            // The ground is first and the three large spheres last. Every third small sphere moves
+            auto const small = i > 0 and i + 3 < objects.size();
+
+            if (not small or i % 3 != 0) {
+                world.add(objects[i]);
+                continue;
+            }
+
+            auto moving = std::make_shared<Translate>(objects[i]);
+            auto const height = randomDouble(0.5, 2.0);
+            auto const bounces = randomDouble(1.0, 3.0);
+            auto const drift = 2.0 * Vec3(randomDouble(-1, 1), 0.0, randomDouble(-1, 1));
+
+            std::vector<Keyframe> keys;
+
+            for (double t = 0.0; t <= duration + (0.5 * step); t += step) {
+                auto const bounce = std::fabs(std::sin(pi * bounces * t / duration));
+                keys.push_back(Keyframe {t, (t * drift) + Vec3(0.0, height * bounce, 0.0)});
+            }
+
+            scene.animation.add(moving, std::move(keys));
+            world.add(std::move(moving));
+        }
+
+        scene.world = std::move(world);
+        return scene;
+    }
+
+    Scene sprawlScene(std::shared_ptr<Texture> const& featureTexture)
+    {
+        static constexpr int fieldSpheres = 1'000'000;
+        static constexpr double fieldRadius = 600.0;
+        static constexpr double groundRadius = 1000.0;
+        static constexpr double sphereRadius = 0.2;
+
+        Scene scene = randomScene(featureTexture);
+
+        // The field shares a few materials, so that a million spheres do not bring a million materials
+        std::vector<std::shared_ptr<Material>> palette;
+
+        for (int i = 0; i < 64; ++i) {
+            if (i % 8 == 0) {
+                palette.push_back(std::make_shared<Metal>(Colour::random(0.5, 1), randomDouble(0, 0.5)));
+            }
+            else {
+                palette.push_back(std::make_shared<Lambertian>(Colour::random() * Colour::random()));
+            }
+        }
+
+        for (int placed = 0; placed < fieldSpheres;) {
+            auto const x = randomDouble(-fieldRadius, fieldRadius);
+            auto const z = randomDouble(-fieldRadius, fieldRadius);
+            auto const distance = std::sqrt((x * x) + (z * z));
+
+            // Leave the middle to the random scene, and follow the curve of the ground out to the edge of the disc
+            if (distance > fieldRadius or (std::fabs(x) < 12.0 and std::fabs(z) < 12.0)) {
+                continue;
+            }
+
+            auto const height = std::sqrt(((groundRadius + sphereRadius) * (groundRadius + sphereRadius)) - (distance * distance)) - groundRadius;
+            auto const& material = palette[static_cast<std::size_t>(randomDouble(0, static_cast<double>(palette.size())))];
+            scene.world.add(std::make_shared<Sphere>(Point3(x, height, z), sphereRadius, material));
+            ++placed;
+        }
+
+        return scene;
+    }
+
+    void buildHierarchy(Scene& scene, std::size_t const keepOut, bool const lazy, std::string const& cacheDirectory)
+    {
+        auto const& objects = scene.world.objects();
+        auto const split = objects.cbegin() + static_cast<std::ptrdiff_t>(std::min(keepOut, objects.size()));
+
+        HittableList world;
+
+        for (auto i = objects.cbegin(); i != split; ++i) {
+            world.add(*i);
+        }
+
+        std::vector<std::shared_ptr<Hittable>> inside(split, objects.cend());
+
+        if (lazy) {
+            scene.accelerator.reset();
+            world.add(std::make_shared<LazyBvh>(std::move(inside)));
+        }
+        else {
+            scene.accelerator = std::make_shared<Bvh>(std::move(inside), cacheDirectory);
+            world.add(scene.accelerator);
+        }
+
+        scene.world = std::move(world);
+    }
+
+    Scene makeScene(std::string const& name, std::string const& texturePath, bool const lazyHierarchy, std::string const& hierarchyCache)
+    {
+        std::shared_ptr<Texture> featureTexture;
+
+        if (not texturePath.empty()) {
+            featureTexture = std::make_shared<ImageTexture>(texturePath);
+        }
+
+        Scene scene;
+
+        if (name == "random") {
+            scene = randomScene(featureTexture);
+        }
+        else if (name == "lights") {
+            scene = smallLightsScene(featureTexture);
+        }
+        else if (name == "bouncing") {
+            scene = bouncingScene(featureTexture);
+        }
+        else if (name == "sprawl") {
+            scene = sprawlScene(featureTexture);
+        }
+        else {
+            throw std::invalid_argument("Unknown scene: " + name);
+        }
+
+        // The ground comes first in every scene. It is so much larger than everything else that it would fill the root
+        // box, and every ray hits it anyway, so it stays outside the hierarchy. The lights keep their own list for sampling
+        buildHierarchy(scene, 1, lazyHierarchy, hierarchyCache);
+
+        return scene;
+    }
+
+    Scene makeScene(SceneDescription const& description)
+    {
+        PhaseTimer const timer("scene");
+        seedRandom(description.seed);
+
+        Scene scene = makeScene(description.name, description.texture, description.lazyHierarchy, description.hierarchyCache);
+
+        if (not description.environment.empty()) {
+            scene.environment = std::make_shared<EnvironmentMap>(loadHdrImage(description.environment), description.environmentScale);
+        }
+
+        return scene;
+    }
+}
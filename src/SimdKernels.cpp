@@ -0,0 +1,141 @@
+// The kernels of one instruction set. This file is compiled once per instruction set, with RT_KERNEL_ISA naming
+// the namespace of that copy and RT_KERNEL_BYTES the width of its vector registers. It must not use inline
+// functions from other headers: the linker keeps one copy of each, and that copy could be the one built for
+// the newest instruction set
+#include "Kernels.hpp"
+
+#ifndef RT_KERNEL_ISA
+#error "RT_KERNEL_ISA must name the instruction set this copy of the kernels is compiled for"
+#endif
+
+#ifndef RT_KERNEL_BYTES
+#error "RT_KERNEL_BYTES must give the width of the vector registers of the instruction set"
+#endif
+
+namespace rt::simd::RT_KERNEL_ISA
+{
+    namespace
+    {
+        using Double = double __attribute__((vector_size(RT_KERNEL_BYTES)));
+        using Int64 = long long __attribute__((vector_size(RT_KERNEL_BYTES)));
+
+        constexpr std::size_t lanes = RT_KERNEL_BYTES / sizeof(double);
+        constexpr double infinity = __builtin_inf();
+
+        /// \brief Load @param count values, leaving the lanes after them zero
+        inline Double load(double const* p, std::size_t const count) noexcept
+        {
+            Double v {};
+            __builtin_memcpy(&v, p, count * sizeof(double));
+            return v;
+        }
+
+        inline Double broadcast(double const x) noexcept
+        {
+            return Double {} + x;
+        }
+
+        /// \brief Take the square root of every lane. Without errno to set, the compiler turns this into one instruction
+        inline Double sqrt(Double v) noexcept
+        {
+            for (std::size_t i = 0; i < lanes; ++i) {
+                v[i] = __builtin_sqrt(v[i]);
+            }
+
+            return v;
+        }
+
+        /// \brief Get the distance to the nearest hit in [tMin, tMax] of spheres [first, first + count), or infinity
+        /// \details The arithmetic is that of Sphere::hit(), step by step, so both find exactly the same roots
+        Double distances(SphereBatch const& batch, std::size_t const first, std::size_t const count, KernelRay const& ray, double const tMin, double const tMax) noexcept
+        {
+            auto const& d = ray.direction;
+
+            Double const ocx = ray.origin[0] - load(batch.x + first, count);
+            Double const ocy = ray.origin[1] - load(batch.y + first, count);
+            Double const ocz = ray.origin[2] - load(batch.z + first, count);
+            Double const radius = load(batch.radius + first, count);
+
+            auto const a = (d[0] * d[0]) + (d[1] * d[1]) + (d[2] * d[2]);
+            Double const b = (ocx * d[0]) + (ocy * d[1]) + (ocz * d[2]);
+            Double const c = ((ocx * ocx) + (ocy * ocy) + (ocz * ocz)) - (radius * radius);
+            Double const discriminant = (b * b) - (a * c);
+
+            Int64 const real = discriminant >= 0.0;
+            Double const root = sqrt(real ? discriminant : broadcast(0.0));
+            Double const nearRoot = (-b - root) / a;
+            Double const farRoot = (-b + root) / a;
+
+            Int64 const nearInside = (nearRoot >= tMin) & (nearRoot <= tMax);
+            Int64 const farInside = (farRoot >= tMin) & (farRoot <= tMax);
+            Double t = nearInside ? nearRoot : (farInside ? farRoot : broadcast(infinity));
+            t = real ? t : broadcast(infinity);
+
+            // The lanes past the end of the batch hold no sphere
+            for (auto i = count; i < lanes; ++i) {
+                t[i] = infinity;
+            }
+
+            return t;
+        }
+
+        std::size_t closestSphere(SphereBatch const& batch, KernelRay const& ray, double const tMin, double const tMax)
+        {
+            auto closest = batch.count;
+            auto nearest = infinity;
+
+            for (std::size_t first = 0; first < batch.count; first += lanes) {
+                auto const count = batch.count - first < lanes ? batch.count - first : lanes;
+                Double const t = distances(batch, first, count, ray, tMin, tMax);
+
+                // Testing the spheres one by one, a later sphere at the same distance replaces an earlier one
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (t[i] <= nearest and t[i] < infinity) {
+                        nearest = t[i];
+                        closest = first + i;
+                    }
+                }
+            }
+
+            return closest;
+        }
+
+        bool anySphere(SphereBatch const& batch, KernelRay const& ray, double const tMin, double const tMax)
+        {
+            for (std::size_t first = 0; first < batch.count; first += lanes) {
+                auto const count = batch.count - first < lanes ? batch.count - first : lanes;
+                Int64 const hit = distances(batch, first, count, ray, tMin, tMax) < infinity;
+
+                for (std::size_t i = 0; i < lanes; ++i) {
+                    if (hit[i]) {
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        void encodePixels(double const* values, std::size_t const count, double const scale, std::uint8_t* bytes)
+        {
+            for (std::size_t first = 0; first < count; first += lanes) {
+                auto const n = count - first < lanes ? count - first : lanes;
+                Double v = load(values + first, n) * scale;
+
+                // Negative sums are clamped before the square root rather than after it, so they give 0 and not NaN
+                v = v < 0.0 ? broadcast(0.0) : v;
+                v = sqrt(v);
+                v = v > 0.999 ? broadcast(0.999) : v;
+
+                Int64 const encoded = __builtin_convertvector(255.999 * v, Int64);
+
+                for (std::size_t i = 0; i < n; ++i) {
+                    bytes[first + i] = static_cast<std::uint8_t>(encoded[i]);
+                }
+            }
+        }
+    }
+
+    extern Kernels const table;
+    Kernels const table {closestSphere, anySphere, encodePixels};
+}
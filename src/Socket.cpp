@@ -0,0 +1,251 @@
+#include "Socket.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief Describe the last system error
+        std::string lastError()
+        {
+            return std::strerror(errno);
+        }
+    }
+
+    Socket::Socket(int const fd) noexcept : m_fd(fd)
+    {
+    }
+
+    Socket::Socket(Socket&& other) noexcept : m_fd(std::exchange(other.m_fd, -1))
+    {
+    }
+
+    Socket& Socket::operator=(Socket&& other) noexcept
+    {
+        if (this != &other) {
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+
+            m_fd = std::exchange(other.m_fd, -1);
+        }
+
+        return *this;
+    }
+
+    Socket::~Socket()
+    {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    void Socket::sendAll(void const* const data, std::size_t const size) const
+    {
+        auto const* p = static_cast<char const*>(data);
+
+        for (std::size_t sent = 0; sent < size;) {
+            // Without MSG_NOSIGNAL a peer that hangs up would kill the process with SIGPIPE
+            auto const n = ::send(m_fd, p + sent, size - sent, MSG_NOSIGNAL);
+
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                throw std::runtime_error("Failed to send: " + lastError());
+            }
+
+            sent += static_cast<std::size_t>(n);
+        }
+    }
+
+    bool Socket::receiveAll(void* const data, std::size_t const size) const
+    {
+        auto* p = static_cast<char*>(data);
+
+        for (std::size_t received = 0; received < size;) {
+            auto const n = ::recv(m_fd, p + received, size - received, 0);
+
+            if (n < 0 and errno == EINTR) {
+                continue;
+            }
+
+            if (n < 0 and (errno == EAGAIN or errno == EWOULDBLOCK)) {
+                throw std::runtime_error("Timed out waiting to receive");
+            }
+
+            if (n < 0) {
+                throw std::runtime_error("Failed to receive: " + lastError());
+            }
+
+            if (n == 0) {
+                if (received == 0) {
+                    return false;
+                }
+
+                throw std::runtime_error("Connection closed in the middle of a message");
+            }
+
+            received += static_cast<std::size_t>(n);
+        }
+
+        return true;
+    }
+
+    void Socket::setReceiveTimeout(std::chrono::milliseconds const timeout) const
+    {
+        timeval value {};
+        value.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+        value.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+
+        if (::setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &value, sizeof(value)) != 0) {
+            throw std::runtime_error("Cannot set the receive timeout: " + lastError());
+        }
+    }
+
+    void Socket::shutdown() const noexcept
+    {
+        if (m_fd >= 0) {
+            ::shutdown(m_fd, SHUT_RDWR);
+        }
+    }
+
+    Socket listenUnix(std::string const& path)
+    {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path is too long: " + path);
+        }
+
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        Socket listener(::socket(AF_UNIX, SOCK_STREAM, 0));
+
+        if (not listener.valid()) {
+            throw std::runtime_error("Cannot create a socket: " + lastError());
+        }
+
+        ::unlink(path.c_str());
+
+        if (::bind(listener.fd(), reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0 or ::listen(listener.fd(), 8) != 0) {
+            throw std::runtime_error("Cannot listen on " + path + ": " + lastError());
+        }
+
+        return listener;
+    }
+
+    Socket listenTcp(std::uint16_t const port)
+    {
+        Socket listener(::socket(AF_INET, SOCK_STREAM, 0));
+
+        if (not listener.valid()) {
+            throw std::runtime_error("Cannot create a socket: " + lastError());
+        }
+
+        int const reuse = 1;
+        ::setsockopt(listener.fd(), SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+
+        if (::bind(listener.fd(), reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0 or ::listen(listener.fd(), 64) != 0) {
+            throw std::runtime_error("Cannot listen on port " + std::to_string(port) + ": " + lastError());
+        }
+
+        return listener;
+    }
+
+    std::uint16_t localPort(Socket const& socket)
+    {
+        sockaddr_in address {};
+        socklen_t length = sizeof(address);
+
+        if (::getsockname(socket.fd(), reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            throw std::runtime_error("Cannot get the port of a socket: " + lastError());
+        }
+
+        return ntohs(address.sin_port);
+    }
+
+    Socket acceptConnection(Socket const& listener)
+    {
+        while (true) {
+            Socket connection(::accept(listener.fd(), nullptr, nullptr));
+
+            if (connection.valid()) {
+                return connection;
+            }
+
+            if (errno == EINTR or errno == ECONNABORTED) {
+                continue;
+            }
+
+            // A listener that has been shut down fails with EINVAL
+            if (errno == EINVAL) {
+                return Socket();
+            }
+
+            throw std::runtime_error("Cannot accept a connection: " + lastError());
+        }
+    }
+
+    Socket connectTcp(std::string const& address)
+    {
+        auto const colon = address.rfind(':');
+
+        if (colon == std::string::npos or colon == 0 or colon + 1 == address.size()) {
+            throw std::runtime_error("Expected host:port, not " + address);
+        }
+
+        auto const host = address.substr(0, colon);
+        auto const port = address.substr(colon + 1);
+
+        addrinfo hints {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        addrinfo* found = nullptr;
+
+        if (auto const status = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &found); status != 0) {
+            throw std::runtime_error("Cannot resolve " + address + ": " + ::gai_strerror(status));
+        }
+
+        std::string error = "no addresses";
+
+        for (auto const* info = found; info != nullptr; info = info->ai_next) {
+            Socket connection(::socket(info->ai_family, info->ai_socktype, info->ai_protocol));
+
+            if (connection.valid() and ::connect(connection.fd(), info->ai_addr, info->ai_addrlen) == 0) {
+                ::freeaddrinfo(found);
+
+                // Messages are written whole, so waiting to coalesce them only adds latency
+                int const noDelay = 1;
+                ::setsockopt(connection.fd(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+                return connection;
+            }
+
+            error = lastError();
+        }
+
+        ::freeaddrinfo(found);
+        throw std::runtime_error("Cannot connect to " + address + ": " + error);
+    }
+}
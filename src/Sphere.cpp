@@ -1,4 +1,6 @@
 #include "Sphere.hpp"
+#include "Onb.hpp"
+#include "Statistics.hpp"
 
 namespace rt
 {
@@ -9,10 +11,27 @@ namespace rt
 
     bool Sphere::hit(Ray const& ray, double tMin, double tMax, HitRecord& record) const noexcept
     {
-        Vec3 oc = ray.getOrigin() - m_center;
+        countIntersectionTest(PrimitiveKind::sphere);
+
+        double t {};
+
+        if (not intersect(m_center, m_radius, ray, tMin, tMax, t)) {
+            return false;
+        }
+
+        fillHit(m_center, m_radius, ray, t, record);
+        record.materialPtr = m_materialPtr.get();
+        record.object = this;
+
+        return true;
+    }
+
+    bool Sphere::intersect(Point3 const& center, double const radius, Ray const& ray, double const tMin, double const tMax, double& t) noexcept
+    {
+        Vec3 oc = ray.getOrigin() - center;
         auto a = ray.getDirection().lengthSquared();
         auto b = dot(oc, ray.getDirection());
-        auto c = oc.lengthSquared() - (m_radius * m_radius);
+        auto c = oc.lengthSquared() - (radius * radius);
 
         auto discriminant = (b * b) - (a * c);
 
@@ -33,13 +52,114 @@ namespace rt
             }
         }
 
-        record.t = root;
+        t = root;
+        return true;
+    }
+
+    void Sphere::fillHit(Point3 const& center, double const radius, Ray const& ray, double const t, HitRecord& record) noexcept
+    {
+        record.t = t;
         record.point = ray.at(record.t);
 
-        Vec3 const outwardNormal = (record.point - m_center) / m_radius;
+        Vec3 const outwardNormal = (record.point - center) / radius;
         record.setFaceNormal(ray, outwardNormal);
-        record.materialPtr = m_materialPtr;
+        setSurfaceCoordinates(outwardNormal, radius, record);
+    }
+
+    void Sphere::setSurfaceCoordinates(Vec3 const& n, double const radius, HitRecord& record) noexcept
+    {
+        // u is the angle around the y axis from x = -1, v the angle from y = -1 up to y = +1
+        auto const theta = std::acos(clamp(-n.y(), -1.0, 1.0));
+        auto const phi = std::atan2(-n.z(), n.x()) + pi;
+
+        record.u = phi / (2.0 * pi);
+        record.v = theta / pi;
+
+        auto const sinTheta = std::sqrt(std::fmax(0.0, 1.0 - (n.y() * n.y())));
+        record.dpdu = (2.0 * pi * radius) * Vec3(n.z(), 0.0, -n.x());
+
+        if (sinTheta > 1e-9) {
+            auto const k = pi * radius * n.y() / sinTheta;
+            record.dpdv = Vec3(-k * n.x(), pi * radius * sinTheta, -k * n.z());
+        }
+        else {
+            record.dpdv = Vec3(pi * radius, 0.0, 0.0);
+        }
+    }
+
+    bool Sphere::occluded(Ray const& ray, double tMin, double tMax) const noexcept
+    {
+        countIntersectionTest(PrimitiveKind::sphere);
+
+        double t {};
+        return intersect(m_center, m_radius, ray, tMin, tMax, t);
+    }
+
+    bool Sphere::boundingBox(Aabb& box) const noexcept
+    {
+        auto const extent = Vec3(m_radius, m_radius, m_radius);
+        box = Aabb(m_center - extent, m_center + extent);
 
         return true;
     }
-}
\ No newline at end of file
+
+    double Sphere::pdfValue(Point3 const& origin, Vec3 const& direction) const
+    {
+        // Only whether the direction reaches the sphere matters, so neither the hit record nor a counted test is needed
+        if (double t {}; not intersect(m_center, m_radius, Ray(origin, direction), 0.001, infinity, t)) {
+            return 0.0;
+        }
+
+        auto const distanceSquared = (m_center - origin).lengthSquared();
+        auto const radiusSquared = m_radius * m_radius;
+
+        // From inside the sphere every direction hits it
+        if (distanceSquared <= radiusSquared) {
+            return 1.0 / (4.0 * pi);
+        }
+
+        auto const cosThetaMax = std::sqrt(1.0 - (radiusSquared / distanceSquared));
+        auto const solidAngle = 2.0 * pi * (1.0 - cosThetaMax);
+
+        return 1.0 / solidAngle;
+    }
+
+    Vec3 Sphere::random(Point3 const& origin) const
+    {
+        Vec3 const direction = m_center - origin;
+        auto const distanceSquared = direction.lengthSquared();
+        auto const radiusSquared = m_radius * m_radius;
+
+        if (distanceSquared <= radiusSquared) {
+            return randomUnitVector();
+        }
+
+        // Sample the cone of directions subtended by the sphere
+        auto const r1 = randomDouble();
+        auto const r2 = randomDouble();
+        auto const cosThetaMax = std::sqrt(1.0 - (radiusSquared / distanceSquared));
+        auto const z = 1.0 + r2 * (cosThetaMax - 1.0);
+        auto const phi = 2.0 * pi * r1;
+        auto const sinTheta = std::sqrt(std::fmax(0.0, 1.0 - (z * z)));
+
+        Onb const uvw(direction);
+        return uvw.local(Vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, z));
+    }
+
+    double Sphere::area() const noexcept
+    {
+        return 4.0 * pi * m_radius * m_radius;
+    }
+
+    void Sphere::sampleSurface(HitRecord& record) const
+    {
+        Vec3 const outwardNormal = randomUnitVector();
+
+        record.point = m_center + m_radius * outwardNormal;
+        record.normal = outwardNormal;
+        record.frontFace = true;
+        record.t = 0.0;
+        record.materialPtr = m_materialPtr.get();
+        setSurfaceCoordinates(outwardNormal, m_radius, record);
+    }
+}
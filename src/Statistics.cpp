@@ -0,0 +1,166 @@
+#include "Statistics.hpp"
+#include "Kernels.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <ostream>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief Every thread's counters, and the totals of the threads that have exited
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<ThreadStatistics const*> live;
+            StatisticsSummary retired;
+            std::chrono::steady_clock::time_point start {std::chrono::steady_clock::now()};
+        };
+
+        /// \brief Get the registry. It is never destroyed, so threads can still retire while the program exits
+        Registry& registry()
+        {
+            static auto* const instance = new Registry;
+            return *instance;
+        }
+
+        /// \brief Add the counters of one thread to @param summary
+        void accumulate(StatisticsSummary& summary, ThreadStatistics const& stats) noexcept
+        {
+            summary.primaryRays += stats.primaryRays.value();
+            summary.secondaryRays += stats.secondaryRays.value();
+            summary.shadowRays += stats.shadowRays.value();
+            summary.nodeVisits += stats.nodeVisits.value();
+
+            for (std::size_t i = 0; i < summary.intersectionTests.size(); ++i) {
+                summary.intersectionTests[i] += stats.intersectionTests[i].value();
+            }
+
+            for (std::size_t i = 0; i < summary.scatterEvents.size(); ++i) {
+                summary.scatterEvents[i] += stats.scatterEvents[i].value();
+            }
+
+            for (std::size_t i = 0; i < summary.pathLengths.size(); ++i) {
+                summary.pathLengths[i] += stats.pathLengths[i].value();
+            }
+        }
+
+        /// \brief A thread's counters, registered while the thread runs
+        struct Registration
+        {
+            Registration()
+            {
+                auto& r = registry();
+                std::lock_guard lock(r.mutex);
+                r.live.push_back(&stats);
+            }
+
+            ~Registration()
+            {
+                detail::threadStatistics = nullptr;
+
+                auto& r = registry();
+                std::lock_guard lock(r.mutex);
+                accumulate(r.retired, stats);
+                r.live.erase(std::find(r.live.begin(), r.live.end(), &stats));
+            }
+
+            ThreadStatistics stats;
+        };
+
+        /// \brief Write a JSON array of numbers
+        template <typename Container>
+        void writeArray(std::ostream& out, Container const& values)
+        {
+            out << '[';
+
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                out << (i > 0 ? ", " : "") << values[i];
+            }
+
+            out << ']';
+        }
+    }
+
+    ThreadStatistics& detail::registerThread()
+    {
+        thread_local Registration registration;
+        detail::threadStatistics = &registration.stats;
+        return registration.stats;
+    }
+
+    StatisticsSummary collectStatistics()
+    {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+
+        StatisticsSummary summary = r.retired;
+
+        for (auto const* stats : r.live) {
+            accumulate(summary, *stats);
+        }
+
+        summary.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - r.start).count();
+        summary.isa = isaName(activeIsa());
+        return summary;
+    }
+
+    void writeStatisticsJson(std::ostream& out, StatisticsSummary const& summary)
+    {
+        auto const& tests = summary.intersectionTests;
+        auto const& scatters = summary.scatterEvents;
+        auto const at = [](auto const& values, auto kind) { return values[static_cast<std::size_t>(kind)]; };
+
+        // Trim the histogram after the longest path seen
+        auto lengths = std::vector<std::uint64_t>(summary.pathLengths.cbegin(), summary.pathLengths.cend());
+
+        while (not lengths.empty() and lengths.back() == 0) {
+            lengths.pop_back();
+        }
+
+        out << "{\n"
+            << "  \"elapsedSeconds\": " << summary.elapsedSeconds << ",\n"
+            << "  \"isa\": \"" << summary.isa << "\",\n"
+            << "  \"rays\": {\"primary\": " << summary.primaryRays << ", \"secondary\": " << summary.secondaryRays
+            << ", \"shadow\": " << summary.shadowRays << ", \"total\": " << summary.rays() << "},\n"
+            << "  \"intersectionTests\": {\"sphere\": " << at(tests, PrimitiveKind::sphere) << "},\n"
+            << "  \"nodeVisits\": " << summary.nodeVisits << ",\n"
+            << "  \"scatterEvents\": {\"lambertian\": " << at(scatters, MaterialKind::lambertian)
+            << ", \"metal\": " << at(scatters, MaterialKind::metal)
+            << ", \"dielectric\": " << at(scatters, MaterialKind::dielectric)
+            << ", \"light\": " << at(scatters, MaterialKind::light) << "},\n"
+            << "  \"pathLengths\": ";
+
+        writeArray(out, lengths);
+        out << ",\n  \"phaseSeconds\": {";
+
+        for (std::size_t i = 0; i < summary.phaseSeconds.size(); ++i) {
+            out << (i > 0 ? ", " : "") << '"' << summary.phaseSeconds[i].first << "\": " << summary.phaseSeconds[i].second;
+        }
+
+        out << "}\n}\n";
+    }
+
+    PhaseTimer::PhaseTimer(char const* phase)
+    :   m_phase(phase), m_start(std::chrono::steady_clock::now()), m_span(phase)
+    {
+    }
+
+    PhaseTimer::~PhaseTimer()
+    {
+        auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+        auto& phases = r.retired.phaseSeconds;
+        auto const phase = std::find_if(phases.begin(), phases.end(), [&](auto const& p) { return p.first == m_phase; });
+
+        if (phase == phases.end()) {
+            phases.emplace_back(m_phase, seconds);
+        }
+        else {
+            phase->second += seconds;
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#include "Texture.hpp"
+#include "Hittable.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace rt
+{
+    namespace
+    {
+        /// \brief Decode 8-bit texels stored with a gamma of 2 to linear values
+        std::array<double, 256> const decodeTable = [] {
+            std::array<double, 256> table {};
+
+            for (std::size_t i = 0; i < table.size(); ++i) {
+                auto const c = static_cast<double>(i) / 255.0;
+                table[i] = c * c;
+            }
+
+            return table;
+        }();
+    }
+
+    SolidColour::SolidColour(Colour const& colour) noexcept : m_colour(colour)
+    {
+    }
+
+    Colour SolidColour::value([[maybe_unused]] HitRecord const& record) const
+    {
+        return m_colour;
+    }
+
+    ImageTexture::ImageTexture(std::string const& path, TextureCache& cache) : m_file(path), m_cache(cache)
+    {
+    }
+
+    Colour ImageTexture::value(HitRecord const& record) const
+    {
+        auto const& base = m_file.level(0);
+
+        // The width of the ray footprint in texels of the full resolution image selects the mip level
+        auto const widthX = std::hypot(record.dudx * base.width, record.dvdx * base.height);
+        auto const widthY = std::hypot(record.dudy * base.width, record.dvdy * base.height);
+        auto const width = std::max(widthX, widthY);
+
+        auto const maxLevel = static_cast<double>(m_file.levelCount() - 1);
+        auto const lod = width > 1.0 ? std::min(std::log2(width), maxLevel) : 0.0;
+        auto const level = static_cast<int>(lod);
+        auto const blend = lod - level;
+
+        Colour colour = bilinear(level, record.u, record.v);
+
+        if (blend > 0 and level + 1 <= static_cast<int>(maxLevel)) {
+            colour = ((1.0 - blend) * colour) + (blend * bilinear(level + 1, record.u, record.v));
+        }
+
+        return colour;
+    }
+
+    Colour ImageTexture::bilinear(int const level, double const u, double const v) const
+    {
+        auto const& mip = m_file.level(level);
+        auto const width = static_cast<int>(mip.width);
+        auto const height = static_cast<int>(mip.height);
+        auto const tileSize = m_file.tileSize();
+
+        // v runs from the bottom of the image to the top, rows from the top to the bottom
+        auto const x = (u * width) - 0.5;
+        auto const y = ((1.0 - v) * height) - 0.5;
+        auto const x0 = static_cast<int>(std::floor(x));
+        auto const y0 = static_cast<int>(std::floor(y));
+        auto const fx = x - x0;
+        auto const fy = y - y0;
+
+        // Neighbouring texels usually share a tile, so keep the last one instead of going back to the cache
+        std::shared_ptr<TextureTile const> tile;
+        int tileX = -1;
+        int tileY = -1;
+
+        auto const texel = [&](int tx, int ty) {
+            tx = ((tx % width) + width) % width;        // wrap around in u
+            ty = std::clamp(ty, 0, height - 1);         // clamp at the poles
+
+            if (tx / tileSize != tileX or ty / tileSize != tileY) {
+                tileX = tx / tileSize;
+                tileY = ty / tileSize;
+                tile = m_cache.tile(m_file, level, tileX, tileY);
+            }
+
+            auto const index = 3 * static_cast<std::size_t>(((ty % tileSize) * tileSize) + (tx % tileSize));
+            auto const& texels = *tile;
+
+            return Colour(decodeTable[texels[index]], decodeTable[texels[index + 1]], decodeTable[texels[index + 2]]);
+        };
+
+        auto const top = ((1.0 - fx) * texel(x0, y0)) + (fx * texel(x0 + 1, y0));
+        auto const bottom = ((1.0 - fx) * texel(x0, y0 + 1)) + (fx * texel(x0 + 1, y0 + 1));
+
+        return ((1.0 - fy) * top) + (fy * bottom);
+    }
+}
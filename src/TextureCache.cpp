@@ -0,0 +1,95 @@
+#include "TextureCache.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+
+namespace rt
+{
+    namespace
+    {
+        constexpr std::size_t defaultBudget = std::size_t{256} << 20;
+    }
+
+    std::size_t TextureCache::TileKeyHash::operator()(TileKey const& key) const noexcept
+    {
+        // Mixed well enough that neighbouring tiles land in different shards as well as different buckets
+        auto const file = (std::uint64_t {key.fileId} << 32) | static_cast<std::uint32_t>(key.level);
+        auto const position = (std::uint64_t {static_cast<std::uint32_t>(key.tileX)} << 32) | static_cast<std::uint32_t>(key.tileY);
+
+        return static_cast<std::size_t>(mixBits(mixBits(file) ^ position));
+    }
+
+    TextureCache::TextureCache(std::size_t const budgetBytes) : m_shardBudget(budgetBytes / shardCount)
+    {
+    }
+
+    TextureCache& TextureCache::global()
+    {
+        static TextureCache cache(defaultBudget);
+        return cache;
+    }
+
+    void TextureCache::setBudget(std::size_t const budgetBytes) noexcept
+    {
+        m_shardBudget = budgetBytes / shardCount;
+    }
+
+    std::shared_ptr<TextureTile const> TextureCache::tile(TiledImageFile const& file, int const level, int const tileX, int const tileY)
+    {
+        TileKey const key {file.id(), level, tileX, tileY};
+        auto& shard = m_shards[TileKeyHash {}(key) % shardCount];
+
+        {
+            std::lock_guard lock(shard.mutex);
+
+            if (auto const found = shard.entries.find(key); found != shard.entries.end()) {
+                shard.recency.splice(shard.recency.begin(), shard.recency, found->second.position);
+                m_hits.fetch_add(1, std::memory_order_relaxed);
+
+                return found->second.tile;
+            }
+        }
+
+        // Read outside the lock so that slow I/O does not block lookups of cached tiles
+        auto loaded = std::make_shared<TextureTile>();
+        file.readTile(level, tileX, tileY, *loaded);
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard lock(shard.mutex);
+
+        // Another thread may have loaded the same tile in the meantime
+        if (auto const found = shard.entries.find(key); found != shard.entries.end()) {
+            return found->second.tile;
+        }
+
+        auto const tileBytes = loaded->size();
+        auto const budget = m_shardBudget.load(std::memory_order_relaxed);
+
+        while (not shard.recency.empty() and shard.bytes + tileBytes > budget) {
+            auto const victim = shard.recency.back();
+            auto const evicted = shard.entries.find(victim);
+
+            shard.bytes -= evicted->second.tile->size();
+            m_residentBytes.fetch_sub(evicted->second.tile->size(), std::memory_order_relaxed);
+            shard.entries.erase(evicted);
+            shard.recency.pop_back();
+        }
+
+        shard.recency.push_front(key);
+        shard.entries.emplace(key, Entry { loaded, shard.recency.begin() });
+        shard.bytes += tileBytes;
+
+        auto const resident = m_residentBytes.fetch_add(tileBytes, std::memory_order_relaxed) + tileBytes;
+        auto peak = m_peakBytes.load(std::memory_order_relaxed);
+
+        while (resident > peak and not m_peakBytes.compare_exchange_weak(peak, resident, std::memory_order_relaxed)) {
+        }
+
+        return loaded;
+    }
+
+    TextureCache::Statistics TextureCache::statistics() const noexcept
+    {
+        return { m_hits.load(), m_misses.load(), m_residentBytes.load(), m_peakBytes.load() };
+    }
+}
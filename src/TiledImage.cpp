@@ -0,0 +1,175 @@
+#include "TiledImage.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace rt
+{
+    namespace
+    {
+        constexpr std::array<char, 4> magic { 'R', 'T', 'T', 'X' };
+        constexpr std::uint32_t formatVersion = 1;
+
+        struct FileHeader
+        {
+            std::array<char, 4> magic;
+            std::uint32_t version;
+            std::uint32_t tileSize;
+            std::uint32_t levelCount;
+        };
+
+        /// \brief Get the overlap of pixel @param i with the interval [begin, end)
+        double coverage(int const i, double const begin, double const end) noexcept
+        {
+            return std::fmax(0.0, std::fmin(end, i + 1.0) - std::fmax(begin, static_cast<double>(i)));
+        }
+
+        /// \brief Halve an image in each dimension with an exact box filter
+        /// \details Odd sizes are rounded down, and each output pixel averages the fraction of every source pixel it covers,
+        /// so the mean of the image is the same at every level
+        HdrImage downsample(HdrImage const& image)
+        {
+            HdrImage result { std::max(1, image.width / 2), std::max(1, image.height / 2), {} };
+            result.pixels.reserve(static_cast<std::size_t>(result.width) * result.height);
+
+            auto const rx = static_cast<double>(image.width) / result.width;
+            auto const ry = static_cast<double>(image.height) / result.height;
+
+            for (int y = 0; y < result.height; ++y) {
+                for (int x = 0; x < result.width; ++x) {
+                    Colour sum;
+                    double weight = 0.0;
+
+                    for (auto sy = static_cast<int>(y * ry); sy < std::min(image.height, static_cast<int>(std::ceil((y + 1) * ry))); ++sy) {
+                        for (auto sx = static_cast<int>(x * rx); sx < std::min(image.width, static_cast<int>(std::ceil((x + 1) * rx))); ++sx) {
+                            auto const w = coverage(sx, x * rx, (x + 1) * rx) * coverage(sy, y * ry, (y + 1) * ry);
+                            sum += w * image.at(sx, sy);
+                            weight += w;
+                        }
+                    }
+
+                    result.pixels.push_back(sum / weight);
+                }
+            }
+
+            return result;
+        }
+
+        /// \brief Encode a linear value with a gamma of 2, matching writeColour()
+        std::uint8_t encode(double const linear) noexcept
+        {
+            return static_cast<std::uint8_t>(255.999 * clamp(std::sqrt(std::fmax(linear, 0.0)), 0.0, 0.999));
+        }
+
+        std::atomic<std::uint32_t> nextFileId {1};
+    }
+
+    TiledImageFile::TiledImageFile(std::string const& path) : m_fd(::open(path.c_str(), O_RDONLY)), m_id(nextFileId++)
+    {
+        if (m_fd < 0) {
+            throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+        }
+
+        FileHeader header {};
+
+        if (::pread(m_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) or header.magic != magic or header.version != formatVersion
+            or header.tileSize == 0 or header.levelCount == 0 or header.levelCount > 32) {
+            ::close(m_fd);
+            throw std::runtime_error(path + " is not a tiled texture file");
+        }
+
+        m_tileSize = header.tileSize;
+        m_levels.resize(header.levelCount);
+
+        auto const tableBytes = static_cast<ssize_t>(sizeof(MipLevel) * m_levels.size());
+
+        if (::pread(m_fd, m_levels.data(), static_cast<std::size_t>(tableBytes), sizeof(header)) != tableBytes) {
+            ::close(m_fd);
+            throw std::runtime_error(path + " has a truncated level table");
+        }
+    }
+
+    TiledImageFile::~TiledImageFile()
+    {
+        ::close(m_fd);
+    }
+
+    void TiledImageFile::readTile(int const level, int const tileX, int const tileY, std::vector<std::uint8_t>& texels) const
+    {
+        auto const& mip = this->level(level);
+        auto const tileBytes = static_cast<std::size_t>(m_tileSize) * m_tileSize * 3;
+        auto const offset = mip.offset + (static_cast<std::uint64_t>(tileY) * mip.tilesX + static_cast<std::uint64_t>(tileX)) * tileBytes;
+
+        texels.resize(tileBytes);
+
+        if (::pread(m_fd, texels.data(), tileBytes, static_cast<off_t>(offset)) != static_cast<ssize_t>(tileBytes)) {
+            throw std::runtime_error("Failed to read texture tile");
+        }
+    }
+
+    void writeTiledImage(HdrImage const& image, std::string const& path, int const tileSize)
+    {
+        std::vector<HdrImage> chain { image };
+
+        while (chain.back().width > 1 or chain.back().height > 1) {
+            chain.push_back(downsample(chain.back()));
+        }
+
+        auto const size = static_cast<std::uint32_t>(tileSize);
+        FileHeader const header { magic, formatVersion, size, static_cast<std::uint32_t>(chain.size()) };
+        std::vector<MipLevel> levels;
+        std::uint64_t offset = sizeof(FileHeader) + sizeof(MipLevel) * chain.size();
+
+        for (auto const& mip : chain) {
+            auto const tilesX = (static_cast<std::uint32_t>(mip.width) + size - 1) / size;
+            auto const tilesY = (static_cast<std::uint32_t>(mip.height) + size - 1) / size;
+
+            levels.push_back({ static_cast<std::uint32_t>(mip.width), static_cast<std::uint32_t>(mip.height), tilesX, tilesY, offset });
+            offset += static_cast<std::uint64_t>(tilesX) * tilesY * size * size * 3;
+        }
+
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        out.write(reinterpret_cast<char const*>(levels.data()), static_cast<std::streamsize>(sizeof(MipLevel) * levels.size()));
+
+        std::vector<std::uint8_t> tile(static_cast<std::size_t>(size) * size * 3);
+
+        for (std::size_t l = 0; l < chain.size(); ++l) {
+            auto const& mip = chain[l];
+
+            for (std::uint32_t ty = 0; ty < levels[l].tilesY; ++ty) {
+                for (std::uint32_t tx = 0; tx < levels[l].tilesX; ++tx) {
+                    auto* texel = tile.data();
+
+                    // Partial tiles at the right and bottom edges repeat the last row and column
+                    for (int y = 0; y < tileSize; ++y) {
+                        for (int x = 0; x < tileSize; ++x) {
+                            auto const sx = std::min(static_cast<int>(tx) * tileSize + x, mip.width - 1);
+                            auto const sy = std::min(static_cast<int>(ty) * tileSize + y, mip.height - 1);
+                            auto const& c = mip.at(sx, sy);
+
+                            *texel++ = encode(c.x());
+                            *texel++ = encode(c.y());
+                            *texel++ = encode(c.z());
+                        }
+                    }
+
+                    out.write(reinterpret_cast<char const*>(tile.data()), static_cast<std::streamsize>(tile.size()));
+                }
+            }
+        }
+
+        if (not out) {
+            throw std::runtime_error("Failed to write " + path);
+        }
+    }
+}
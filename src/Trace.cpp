@@ -0,0 +1,141 @@
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace rt
+{
+    namespace
+    {
+        struct TraceEvent
+        {
+            char const* name;
+            std::int64_t index;
+            std::chrono::steady_clock::time_point start;
+            std::chrono::steady_clock::time_point end;
+        };
+
+        /// \brief One row of the timeline, owned by one thread at a time
+        struct Lane
+        {
+            int id;
+            std::vector<TraceEvent> events;
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<Lane>> lanes;
+            std::vector<Lane*> idle;    // Lanes whose threads have exited
+            std::chrono::steady_clock::time_point origin;
+            bool started {false};
+        };
+
+        /// \brief Get the registry. It is never destroyed, so threads can still hand back lanes while the program exits
+        Registry& registry()
+        {
+            static auto* const instance = new Registry;
+            return *instance;
+        }
+
+        /// \brief The lane of a thread while it runs
+        struct Registration
+        {
+            Registration()
+            {
+                auto& r = registry();
+                std::lock_guard lock(r.mutex);
+
+                if (r.idle.empty()) {
+                    r.lanes.push_back(std::make_unique<Lane>(Lane {static_cast<int>(r.lanes.size()), {}}));
+                    lane = r.lanes.back().get();
+                }
+                else {
+                    // Reuse the lowest lane, so that lanes stay in a stable order across parallel loops
+                    auto const lowest = std::min_element(r.idle.begin(), r.idle.end(), [](Lane const* a, Lane const* b) { return a->id < b->id; });
+                    lane = *lowest;
+                    r.idle.erase(lowest);
+                }
+            }
+
+            ~Registration()
+            {
+                auto& r = registry();
+                std::lock_guard lock(r.mutex);
+                r.idle.push_back(lane);
+            }
+
+            Lane* lane;
+        };
+
+        /// \brief Get the microseconds from the start of tracing to @param time
+        double microseconds(std::chrono::steady_clock::time_point const time, std::chrono::steady_clock::time_point const origin) noexcept
+        {
+            return std::chrono::duration<double, std::micro>(time - origin).count();
+        }
+    }
+
+    void enableTracing()
+    {
+        auto& r = registry();
+
+        {
+            std::lock_guard lock(r.mutex);
+
+            if (not r.started) {
+                r.origin = std::chrono::steady_clock::now();
+                r.started = true;
+            }
+        }
+
+        detail::tracing.store(true, std::memory_order_relaxed);
+    }
+
+    void disableTracing() noexcept
+    {
+        detail::tracing.store(false, std::memory_order_relaxed);
+    }
+
+    void TraceScope::record(char const* name, std::int64_t const index, std::chrono::steady_clock::time_point const start, std::chrono::steady_clock::time_point const end) noexcept
+    {
+        try {
+            thread_local Registration registration;
+            registration.lane->events.push_back(TraceEvent {name, index, start, end});
+        }
+        catch (...) {
+            // Out of memory. The span is dropped rather than ending the render
+        }
+    }
+
+    void writeTrace(std::ostream& out)
+    {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"raytracer\"}}";
+
+        for (auto const& lane : r.lanes) {
+            out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << lane->id
+                << ", \"args\": {\"name\": \"thread " << lane->id << "\"}}";
+
+            for (auto const& event : lane->events) {
+                out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << lane->id
+                    << ", \"ts\": " << microseconds(event.start, r.origin) << ", \"dur\": " << microseconds(event.end, event.start);
+
+                if (event.index >= 0) {
+                    out << ", \"args\": {\"index\": " << event.index << '}';
+                }
+
+                out << '}';
+            }
+        }
+
+        out << "\n]}\n";
+    }
+}
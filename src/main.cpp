@@ -1,149 +1,785 @@
+#include "BandWriter.hpp"
 #include "Colour.hpp"
 #include "Common.hpp"
-#include "HittableList.hpp"
-#include "Ray.hpp"
-#include "Sphere.hpp"
+#include "Denoiser.hpp"
+#include "Distributed.hpp"
+#include "Environment.hpp"
+#include "Framebuffer.hpp"
+#include "FrozenScene.hpp"
+#include "HdrImage.hpp"
+#include "Heatmap.hpp"
+#include "IncrementalRenderer.hpp"
+#include "Kernels.hpp"
+#include "LazyBvh.hpp"
+#include "Numa.hpp"
+#include "Options.hpp"
+#include "Parallel.hpp"
+#include "PathGuide.hpp"
+#include "PhotonMap.hpp"
+#include "Preview.hpp"
+#include "RenderServer.hpp"
+#include "Renderer.hpp"
+#include "Scene.hpp"
+#include "Statistics.hpp"
 #include "Camera.hpp"
-#include "Material.hpp"
+#include "TextureCache.hpp"
+#include "Trace.hpp"
+#include "TiledImage.hpp"
 
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 
 using namespace rt;
 
 namespace
 {
-    /// \brief Linearly blend white and blue colours
-    /// \param[in] ray The ray whose colour at a point is to be computed
-    /// \returns A blended colour of white and blue
-    Colour rayColour(Ray const& ray, Hittable const& world, int recursionDepth) noexcept;
-
-    /// \brief Generate lots of random spheres
-    /// \returns A list of randomly generated spheres
-    HittableList randomScene();
+    /// \brief Print the overall ray throughput, and write the statistics and the trace requested with --stats and --trace
+    /// \returns false if a file cannot be written
+    bool writeReports(Options const& options);
+
+    /// \brief Compare the image with the golden image and the throughput with the baseline requested on the command line
+    /// \param[in] pixels The final colour of every pixel
+    /// \returns true if both are within their tolerances, or were not requested
+    bool checkRegression(Options const& options, std::vector<Colour> const& pixels, int width, int height);
+
+    /// \brief Write the first-hit feature buffers as <prefix>.albedo.pfm, <prefix>.normal.pfm and <prefix>.depth.pfm
+    /// \param[in] framebuffer The rendered image and its features
+    /// \param[in] prefix The start of every file name
+    void writeFeatures(Framebuffer const& framebuffer, std::string const& prefix);
+
+    /// \brief Get the colours to write: the mean of every pixel, denoised if requested
+    std::vector<Colour> finalPixels(Framebuffer const& framebuffer, Options const& options);
+
+    /// \brief Render every view requested with --views and --turntable in one pass over a shared scene
+    /// \param[in] defaults The view that requests modify, and the first camera of the turntable
+    void renderBatch(Scene const& scene, RenderJob const& defaults, Options const& options);
+
+    /// \brief Render the frames requested with --frames, moving the scene's objects and updating its hierarchy before each
+    void renderSequence(Scene& scene, Camera const& camera, RenderSettings const& settings, Options const& options);
+
+    /// \brief Render the image band by band, writing each band to the standard output as soon as it is in order
+    /// \param[in] bandHeight The number of rows in a band
+    void renderStream(Scene const& scene, Camera const& camera, RenderSettings const& settings, int bandHeight);
+
+    /// \brief Refine previews into a file, moving the camera to every job read from the standard input
+    /// \param[in] defaults The first view, which the jobs modify
+    /// \param[in] path The PPM replaced after every step
+    void runPreview(Scene const& scene, RenderJob const& defaults, std::string const& path);
+
+    /// \brief Render the image unpinned and then pinned, and report how much faster the pinned render was
+    /// \param[in] policy How the second render pins its workers
+    /// \param[out] framebuffer Receives the pinned render
+    void comparePinning(Scene const& scene, Camera const& camera, RenderSettings const& settings, Pinning policy, Framebuffer& framebuffer);
+
+    /// \brief Render the image, apply the edits requested with --edits, and render again only the tiles they affect
+    /// \param[out] framebuffer Receives the edited image
+    /// \throws std::runtime_error if the edits cannot be read
+    void renderEdited(Scene& scene, Camera const& camera, RenderSettings const& settings, Options const& options, Framebuffer& framebuffer);
+
+    /// \brief Render the image with worker processes, starting the local ones first
+    void renderDistributed(SceneDescription const& description, RenderJob const& job, Options const& options, Framebuffer& framebuffer);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    auto const programStart = std::chrono::steady_clock::now();
+    Options options;
+
+    try {
+        options = parseOptions(argc, argv);
+    }
+    catch (std::invalid_argument const& e) {
+        std::cerr << e.what() << '\n' << usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (not options.convertInput.empty()) {
+        try {
+            writeTiledImage(loadHdrImage(options.convertInput), options.convertOutput);
+            return EXIT_SUCCESS;
+        }
+        catch (std::runtime_error const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (not options.isa.empty()) {
+        try {
+            selectIsa(parseIsa(options.isa));
+        }
+        catch (std::invalid_argument const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cerr << "Kernels: " << isaName(activeIsa()) << " (the default here is " << isaName(detectIsa()) << ")\n";
+
+    // A comparison starts unpinned, and pins for its second render
+    auto const pinningPolicy = options.pinning.empty() ? Pinning::none : parsePinning(options.pinning);
+
+    if (pinningPolicy != Pinning::none) {
+        std::size_t cpus = 0;
+
+        for (auto const& node : numaNodes()) {
+            cpus += node.cpus.size();
+        }
+
+        std::cerr << "Pinning: " << pinningName(pinningPolicy) << " over " << numaNodes().size() << " memory nodes and " << cpus << " processors\n";
+
+        if (not options.comparePinning) {
+            setPinning(pinningPolicy);
+        }
+    }
+
+    if (not options.traceFile.empty()) {
+        enableTracing();
+    }
+
+    TextureCache::global().setBudget(static_cast<std::size_t>(options.textureCacheMegabytes) << 20);
+
+    if (not options.workerAddress.empty()) {
+        try {
+            WorkerSettings workerSettings;
+            workerSettings.threads = options.threads;
+            runWorker(options.workerAddress, workerSettings);
+            return writeReports(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        catch (std::exception const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
     // Image
     static constexpr double aspectRatio {3.0 / 2.0};
-    static constexpr int imgWidth {1200};
-    static constexpr auto imgHeight = static_cast<int>(imgWidth / aspectRatio);
-    static constexpr int samplesPerPixel = 500;
-    static constexpr int maxRecursionDepth = 50;
+
+    RenderSettings settings;
+    settings.width = options.width;
+    settings.height = std::max(1, static_cast<int>(options.width / aspectRatio));
+    settings.samplesPerPixel = options.samplesPerPixel;
+    settings.maxDepth = options.maxDepth;
+    settings.threads = options.threads;
+    settings.recordCost = not options.heatmapsPrefix.empty();
 
     // World
-    HittableList world = randomScene();
+    SceneDescription description;
+    description.name = options.scene;
+    description.seed = options.seed ? *options.seed : std::random_device{}();
+
+    if (not options.seed) {
+        std::cerr << "Seed: " << description.seed << " (pass --seed " << description.seed << " to repeat this run)\n";
+    }
+    description.texture = options.texture;
+    description.environment = options.environment;
+    description.environmentScale = options.environmentScale;
+    description.lazyHierarchy = options.lazyHierarchy;
+    description.hierarchyCache = options.hierarchyCache;
+
+    // The same seed picks the same samples, so a seeded run repeats exactly
+    settings.seed = description.seed;
+
+    Scene scene;
+
+    try {
+        scene = makeScene(description);
+    }
+    catch (std::exception const& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    if (scene.accelerator) {
+        switch (scene.accelerator->cacheUse()) {
+        case Bvh::CacheUse::loaded:
+            std::cerr << "Hierarchy cache: loaded from " << options.hierarchyCache << '\n';
+            break;
+        case Bvh::CacheUse::built:
+            std::cerr << "Hierarchy cache: built and saved to " << options.hierarchyCache << '\n';
+            break;
+        case Bvh::CacheUse::replaced:
+            std::cerr << "Hierarchy cache: the cached file did not match, so it was built and saved again to " << options.hierarchyCache << '\n';
+            break;
+        case Bvh::CacheUse::unsaved:
+            std::cerr << "Hierarchy cache: built, but it could not be saved to " << options.hierarchyCache << '\n';
+            break;
+        case Bvh::CacheUse::none:
+            break;
+        }
+    }
+
+    if (options.freeze) {
+        auto const frozen = freezeScene(scene, options.replicateScene);
+        std::cerr << "Frozen scene: " << frozen->sphereCount() << " spheres, " << frozen->nodeCount() << " nodes and "
+                  << frozen->materialCount() << " materials in " << (frozen->bytes() >> 10) << " KiB\n";
+
+        if (options.replicateScene) {
+            std::cerr << "Replicated the frozen scene on " << frozen->replicas() << " memory nodes\n";
+        }
+    }
+
+    if (options.photons > 0) {
+        PhotonSettings photonSettings;
+        photonSettings.photons = static_cast<std::size_t>(options.photons);
+        photonSettings.radius = options.causticRadius;
+        photonSettings.maxDepth = options.maxDepth;
+        photonSettings.threads = options.threads;
+        photonSettings.seed = description.seed;
+
+        auto const caustics = std::make_shared<PhotonMap const>(traceCaustics(scene, photonSettings));
+        std::cerr << "Caustic map: " << caustics->size() << " of " << options.photons << " photons stored\n";
+        scene.caustics = caustics;
+    }
+
+    if (options.guide) {
+        GuideSettings guideSettings;
+        guideSettings.trainingFraction = options.guideTraining;
+
+        // The hierarchy leaves out the ground, whose bounds are far larger than anything worth telling apart
+        Aabb bounds;
+
+        if (not (scene.accelerator and scene.accelerator->boundingBox(bounds))) {
+            scene.world.boundingBox(bounds);
+        }
+
+        scene.guide = std::make_shared<PathGuide>(bounds, guideSettings);
+    }
 
     // Camera
-    Point3 lookFrom(13, 2, 3);
-    Point3 lookAt(0, 0, 0);
-    Vec3 viewUp(0, 1, 0);
-    auto distanceToFocus = 10.0;
-    auto aperture = 0.1;
-    
-    Camera cam(lookFrom, lookAt, viewUp, 20, aspectRatio, aperture, distanceToFocus);
+    CameraSettings cameraSettings;
+    Camera cam(cameraSettings, aspectRatio);
+
+    if (options.serve) {
+        try {
+            RenderJob const defaults {cameraSettings, settings};
+
+            if (options.socketPath.empty()) {
+                serve(scene, defaults, std::cin, std::cout);
+            }
+            else {
+                serveSocket(scene, defaults, options.socketPath);
+            }
+        }
+        catch (std::exception const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return writeReports(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (not options.previewFile.empty()) {
+        try {
+            runPreview(scene, RenderJob {cameraSettings, settings}, options.previewFile);
+        }
+        catch (std::exception const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return writeReports(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
     // Render
-    std::cout << "P3\n" << imgWidth << ' ' << imgHeight << "\n255\n";
+    if (not options.viewsFile.empty() or options.turntableViews > 0) {
+        try {
+            renderBatch(scene, RenderJob {cameraSettings, settings}, options);
+        }
+        catch (std::exception const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
 
-    for (auto j = imgHeight - 1; j >= 0; --j) {
-        std::cerr << "\rScanlines remaining: " << j << '\n' << std::flush;
+        std::cerr << "\nDone.\n";
+        return writeReports(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-        for (auto i = 0; i < imgWidth; ++i) {
-            Colour pixelColour;
+    if (options.frames > 0) {
+        try {
+            renderSequence(scene, cam, settings, options);
+        }
+        catch (std::exception const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
 
-            for (int s = 0; s < samplesPerPixel; ++s) {
-                auto const rand = randomDouble();
+        std::cerr << "\nDone.\n";
+        return writeReports(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-                auto u = (i + rand) / (imgWidth - 1);
-                auto v = (j + rand) / (imgHeight - 1);
+    if (options.stream) {
+        try {
+            renderStream(scene, cam, settings, options.bandHeight);
+        }
+        catch (std::exception const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
 
-                Ray ray = cam.getRay(u, v);
-                pixelColour = pixelColour + rayColour(ray, world, maxRecursionDepth);
-            }
+        std::cerr << "\nDone.\n";
+        return writeReports(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    Framebuffer framebuffer(settings.width, settings.height);
+
+    if (options.workers > 0 or options.listenPort >= 0) {
+        try {
+            renderDistributed(description, RenderJob {cameraSettings, settings}, options, framebuffer);
+        }
+        catch (std::exception const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    else if (options.timeBudget > 0.0) {
+        auto const deadline = programStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.timeBudget));
+        auto const samples = render(scene, cam, settings, deadline, framebuffer);
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - programStart;
+
+        std::cerr << "Achieved " << samples << " spp in " << elapsed.count() << " s of a " << options.timeBudget << " s budget\n";
+    }
+    else if (options.comparePinning) {
+        comparePinning(scene, cam, settings, pinningPolicy, framebuffer);
+    }
+    else if (not options.editsFile.empty()) {
+        try {
+            renderEdited(scene, cam, settings, options, framebuffer);
+        }
+        catch (std::exception const& e) {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        render(scene, cam, settings, framebuffer);
+    }
+
+    try {
+        if (not options.featuresPrefix.empty()) {
+            writeFeatures(framebuffer, options.featuresPrefix);
+        }
+
+        if (not options.heatmapsPrefix.empty()) {
+            std::cerr << writeHeatmaps(framebuffer, options.heatmapsPrefix);
+        }
+    }
+    catch (std::runtime_error const& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    auto const pixels = finalPixels(framebuffer, options);
 
-            writeColour(std::cout, pixelColour, samplesPerPixel);
+    {
+        PhaseTimer const timer("output");
+        writePpm(std::cout, pixels, framebuffer.width, framebuffer.height);
+    }
+
+    try {
+        if (not checkRegression(options, pixels, framebuffer.width, framebuffer.height)) {
+            return EXIT_FAILURE;
+        }
+    }
+    catch (std::exception const& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    for (auto const& object : scene.world.objects()) {
+        if (auto const* lazy = dynamic_cast<LazyBvh const*>(object.get())) {
+            std::cerr << "Lazy hierarchy: " << lazy->builtNodes() << " nodes built over " << lazy->objectCount() << " objects\n";
         }
     }
 
+    if (not options.texture.empty()) {
+        auto const stats = TextureCache::global().statistics();
+        std::cerr << "Texture cache: " << stats.hits << " hits, " << stats.misses << " misses, peak " << (stats.peakBytes >> 10) << " KiB\n";
+    }
+
     std::cerr << "\nDone.\n";
-    return EXIT_SUCCESS;
+    return writeReports(options) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-namespace 
+namespace
 {
-    Colour rayColour(Ray const& ray, Hittable const& world, int recursionDepth) noexcept
+    bool checkRegression(Options const& options, std::vector<Colour> const& pixels, int const width, int const height)
+    {
+        bool passed = true;
+
+        if (not options.golden.empty()) {
+            auto const difference = displayedDifference(HdrImage {width, height, pixels}, loadHdrImage(options.golden));
+            passed = difference <= options.goldenTolerance;
+
+            std::cerr << "Difference from " << options.golden << ": " << difference << " (tolerance " << options.goldenTolerance << ") "
+                      << (passed ? "passed" : "FAILED") << '\n';
+        }
+
+        if (options.baselineMrays > 0.0) {
+            auto const summary = collectStatistics();
+            auto const render = std::find_if(summary.phaseSeconds.cbegin(), summary.phaseSeconds.cend(), [](auto const& phase) {
+                return phase.first == "render";
+            });
+
+            auto const seconds = render != summary.phaseSeconds.cend() ? render->second : 0.0;
+            auto const mrays = seconds > 0.0 ? static_cast<double>(summary.rays()) / seconds / 1e6 : 0.0;
+            auto const minimum = options.baselineMrays * (1.0 - options.throughputTolerance);
+            auto const fastEnough = mrays >= minimum;
+            passed = passed and fastEnough;
+
+            std::cerr << "Throughput " << mrays << " Mrays/s against a baseline of " << options.baselineMrays << " (at least " << minimum << ") "
+                      << (fastEnough ? "passed" : "FAILED") << '\n';
+        }
+
+        return passed;
+    }
+
+    bool writeReports(Options const& options)
     {
-        // If we've exceeded the ray bounce limit, no more light is gathered
-        if (recursionDepth <= 0) {
-            return Colour(0, 0, 0);
+        auto const summary = collectStatistics();
+
+        auto const render = std::find_if(summary.phaseSeconds.cbegin(), summary.phaseSeconds.cend(), [](auto const& phase) {
+            return phase.first == "render";
+        });
+
+        if (render != summary.phaseSeconds.cend() and render->second > 0.0) {
+            std::cerr << "Traced " << static_cast<double>(summary.rays()) / 1e6 << " Mrays in " << render->second << " s ("
+                      << static_cast<double>(summary.rays()) / render->second / 1e6 << " Mrays/s)\n";
         }
 
-        if (HitRecord record; world.hit(ray, 0.001, infinity, record)) {
-            Ray scattered;
+        auto const write = [](std::string const& path, auto const& writer) {
+            if (path.empty()) {
+                return true;
+            }
+
+            std::ofstream out(path);
+            writer(out);
 
-            if (Colour attenuation; record.materialPtr->scatter(ray, record, attenuation, scattered)) {
-                return attenuation * rayColour(scattered, world, recursionDepth - 1);
+            if (not out.flush()) {
+                std::cerr << "Failed to write " << path << '\n';
+                return false;
             }
-            else {
-                return Colour(0, 0, 0);
+
+            return true;
+        };
+
+        auto const statsWritten = write(options.statsFile, [&](std::ostream& out) { writeStatisticsJson(out, summary); });
+        auto const traceWritten = write(options.traceFile, [](std::ostream& out) { writeTrace(out); });
+
+        return statsWritten and traceWritten;
+    }
+
+    void writeFeatures(Framebuffer const& framebuffer, std::string const& prefix)
+    {
+        HdrImage image { framebuffer.width, framebuffer.height, framebuffer.albedo };
+        saveHdrImage(image, prefix + ".albedo.pfm");
+
+        image.pixels = framebuffer.normal;
+        saveHdrImage(image, prefix + ".normal.pfm");
+
+        for (std::size_t i = 0; i < image.pixels.size(); ++i) {
+            auto const d = framebuffer.depth[i];
+            image.pixels[i] = std::isfinite(d) ? Colour(d, d, d) : Colour(0, 0, 0);
+        }
+
+        saveHdrImage(image, prefix + ".depth.pfm");
+    }
+
+    void renderStream(Scene const& scene, Camera const& camera, RenderSettings const& settings, int const bandHeight)
+    {
+        writePpmHeader(std::cout, settings.width, settings.height);
+
+        // Two bands double-buffer the output. Each band beyond that lets more threads work ahead of the writer
+        auto const threads = settings.threads > 0 ? settings.threads : defaultThreadCount();
+        auto const window = 2 + static_cast<int>(threads / static_cast<unsigned>(bandHeight));
+
+        BandWriter writer(settings.width, settings.height, bandHeight, window, [](int, int, std::vector<Colour> const& pixels) {
+            writeBytes(std::cout, toBytes(pixels, 1));
+
+            if (not std::cout.flush()) {
+                throw std::runtime_error("Failed to write the image");
+            }
+        });
+
+        std::cerr << "Streaming in bands of " << bandHeight << " rows, " << (writer.bufferBytes() >> 10) << " KiB of band buffers\n";
+
+        render(scene, camera, settings, writer);
+        writer.finish();
+    }
+
+    void runPreview(Scene const& scene, RenderJob const& defaults, std::string const& path)
+    {
+        auto const temporary = path + ".tmp";
+
+        // Each step is written beside the file and renamed over it, so a viewer never reads half an image
+        auto const preview = std::make_shared<Preview>(scene, defaults.settings, defaults.camera, [&](FloatImage const& image, PreviewStep const& step) {
+            std::vector<Colour> pixels(static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height));
+
+            for (int y = 0; y < image.height; ++y) {
+                auto const* row = image.pixels + (y * image.rowStride);
+
+                for (int x = 0; x < image.width; ++x) {
+                    pixels[(static_cast<std::size_t>(y) * image.width) + x] = Colour(row[3 * x], row[(3 * x) + 1], row[(3 * x) + 2]);
+                }
+            }
+
+            {
+                std::ofstream out(temporary);
+                writePpmHeader(out, image.width, image.height);
+                writeBytes(out, toBytes(pixels, 1));
+
+                if (not out.flush()) {
+                    throw std::runtime_error("Failed to write " + temporary);
+                }
+            }
+
+            if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+                throw std::runtime_error("Failed to replace " + path);
+            }
+
+            std::cerr << "Preview 1/" << step.scale << ": " << step.samplesPerPixel << " spp after "
+                      << static_cast<int>(step.seconds * 1000.0) << " ms" << (step.final ? ", done\n" : "\n");
+        });
+
+        // The standard input is read beside the preview, so a new camera interrupts the step in progress. The reader
+        // shares the preview, since it is left blocked on the input if the preview fails
+        std::thread reader([preview, current = defaults]() mutable {
+            for (std::string line; std::getline(std::cin, line);) {
+                if (line.empty() or line.front() == '#') {
+                    continue;
+                }
+
+                if (line == "quit") {
+                    preview->stop();
+                    return;
+                }
+
+                try {
+                    current = parseRenderJob(line, current);
+                    preview->setCamera(current.camera);
+                }
+                catch (std::invalid_argument const& e) {
+                    std::cerr << e.what() << '\n';
+                }
+            }
+
+            preview->finish();
+        });
+
+        try {
+            preview->run();
+        }
+        catch (...) {
+            reader.detach();
+            throw;
+        }
+
+        reader.join();
+    }
+
+    void comparePinning(Scene const& scene, Camera const& camera, RenderSettings const& settings, Pinning const policy, Framebuffer& framebuffer)
+    {
+        auto const measure = [&](Pinning const pinning) {
+            setPinning(pinning);
+
+            auto const rays = collectStatistics().rays();
+            auto const start = std::chrono::steady_clock::now();
+            render(scene, camera, settings, framebuffer);
+            std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+            return static_cast<double>(collectStatistics().rays() - rays) / elapsed.count() / 1e6;
+        };
+
+        auto const unpinned = measure(Pinning::none);
+        auto const pinned = measure(policy);
+
+        std::cerr << "Unpinned: " << unpinned << " Mrays/s, pinned " << pinningName(policy) << ": " << pinned << " Mrays/s ("
+                  << std::showpos << std::fixed << std::setprecision(1) << (100.0 * (pinned / unpinned - 1.0)) << "%"
+                  << (placementRefused() ? ", threads only, as memory could not be moved" : "") << ")\n"
+                  << std::noshowpos << std::defaultfloat << std::setprecision(6);
+    }
+
+    void renderEdited(Scene& scene, Camera const& camera, RenderSettings const& settings, Options const& options, Framebuffer& framebuffer)
+    {
+        using Seconds = std::chrono::duration<double>;
+
+        IncrementalRenderer renderer(scene, camera, settings, options.tileSize);
+
+        auto start = std::chrono::steady_clock::now();
+        renderer.render();
+        Seconds const fullTime = std::chrono::steady_clock::now() - start;
+
+        std::ifstream file(options.editsFile);
+
+        if (not file) {
+            throw std::runtime_error("Cannot open " + options.editsFile);
+        }
+
+        auto const edits = applyEdits(scene, file);
+
+        start = std::chrono::steady_clock::now();
+        auto const rendered = renderer.update(edits);
+        Seconds const updateTime = std::chrono::steady_clock::now() - start;
+
+        std::cerr << "Edits: " << rendered << " of " << renderer.tiles().size() << " tiles rendered again in " << updateTime.count()
+                  << " s, against " << fullTime.count() << " s for the whole image\n";
+
+        framebuffer = renderer.framebuffer();
+    }
+
+    void renderDistributed(SceneDescription const& description, RenderJob const& job, Options const& options, Framebuffer& framebuffer)
+    {
+        Coordinator coordinator(static_cast<std::uint16_t>(std::max(0, options.listenPort)));
+        std::cerr << "Coordinating workers on port " << coordinator.port() << '\n';
+
+        // Local workers share the cores between them
+        auto const threads = options.threads > 0 ? options.threads : defaultThreadCount();
+        auto const workers = spawnLocalWorkers(options.workers, coordinator.port(), threads / static_cast<unsigned>(std::max(1, options.workers)));
+
+        CoordinatorSettings settings;
+        settings.tileSize = options.tileSize;
+
+        try {
+            coordinator.render(description, job, settings, framebuffer);
+        }
+        catch (...) {
+            for (auto const pid : workers) {
+                ::kill(pid, SIGTERM);
             }
+
+            waitForWorkers(workers);
+            throw;
+        }
+
+        waitForWorkers(workers);
+    }
+
+    std::vector<Colour> finalPixels(Framebuffer const& framebuffer, Options const& options)
+    {
+        if (options.denoise) {
+            DenoiseSettings denoiseSettings;
+            denoiseSettings.threads = options.threads;
+            return denoise(framebuffer, denoiseSettings);
         }
 
-        Vec3 unitDirection = unitVector(ray.getDirection());    // scale the ray direction to unit length
-        auto const t = 0.5 * (unitDirection.y() + 1.0);
+        std::vector<Colour> pixels(framebuffer.colour.size());
 
-        // Linearly blend white and blue depending on the height of the y coordinate
-        // blendedValue = (1 - t) * startValue + t * endValue
-        return (1.0 - t) * Colour(1.0, 1.0, 1.0) + t * Colour(0.5, 0.7, 1.0);
+        for (std::size_t i = 0; i < pixels.size(); ++i) {
+            pixels[i] = framebuffer.mean(i);
+        }
+
+        return pixels;
     }
 
-    HittableList randomScene()
+    void renderBatch(Scene const& scene, RenderJob const& defaults, Options const& options)
     {
-        auto groundMaterial = std::make_shared<Lambertian>(Colour(0.5, 0.5, 0.5));
-        
-        HittableList world;
-        world.add(std::make_shared<Sphere>(Point3(0, -1000, 0), 1000, groundMaterial));
-
-        for (int a = -11; a < 11; ++a) {
-            for (int b = -11; b < 11; ++b) {
-                auto chooseMaterial = randomDouble();
-                auto centre = Point3(a + 0.9 * randomDouble(), 0.2, b + 0.9 * randomDouble());
-
-                if ((centre - Point3(4, 0.2, 0)).length() > 0.9) {
-                    std::shared_ptr<Material> sphereMaterial;
-
-                    if (chooseMaterial < 0.8) {
-                        // Diffuse
-                        auto albedo = Colour::random() * Colour::random();
-                        sphereMaterial = std::make_shared<Lambertian>(albedo);
-                        world.add(std::make_shared<Sphere>(centre, 0.2, sphereMaterial));
-                    }
-                    else if (chooseMaterial < 0.95) {
-                        // Metal
-                        auto albedo = Colour::random(0.5, 1);
-                        auto fuzz = randomDouble(0, 0.5);
-                        sphereMaterial = std::make_shared<Metal>(albedo, fuzz);
-                        world.add(std::make_shared<Sphere>(centre, 0.2, sphereMaterial));
-                    }
-                    else {
-                        // Glass
-                        sphereMaterial = std::make_shared<Dielectric>(1.5);
-                        world.add(std::make_shared<Sphere>(centre, 0.2, sphereMaterial));
-                    }
+        std::vector<RenderJob> views;
+
+        if (not options.viewsFile.empty()) {
+            std::ifstream file(options.viewsFile);
+
+            if (not file) {
+                throw std::runtime_error("Cannot open " + options.viewsFile);
+            }
+
+            views = readRenderJobs(file, defaults);
+        }
+
+        for (auto const& camera : orbit(defaults.camera, options.turntableViews)) {
+            views.push_back(RenderJob {camera, defaults.settings});
+        }
+
+        std::mutex mutex;
+        std::exception_ptr error;
+        auto const start = std::chrono::steady_clock::now();
+
+        renderViews(scene, views, [&](std::size_t view, Framebuffer& framebuffer) {
+            std::ostringstream name;
+            name << options.viewsPrefix << std::setw(4) << std::setfill('0') << view << ".ppm";
+
+            try {
+                std::ofstream out(name.str());
+                writePpm(out, finalPixels(framebuffer, options), framebuffer.width, framebuffer.height);
+
+                if (not out.flush()) {
+                    throw std::runtime_error("Failed to write " + name.str());
                 }
             }
+            catch (...) {
+                std::lock_guard lock(mutex);
+                error = error ? error : std::current_exception();
+            }
+        });
+
+        if (error) {
+            std::rethrow_exception(error);
         }
 
-        auto mat1 = std::make_shared<Dielectric>(1.5);
-        world.add(std::make_shared<Sphere>(Point3(0, 1, 0), 1.0, mat1));
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        std::cerr << "Rendered " << views.size() << " views in " << elapsed.count() << " s\n";
+    }
+
+    void renderSequence(Scene& scene, Camera const& camera, RenderSettings const& settings, Options const& options)
+    {
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+        auto& accelerator = *scene.accelerator;
+
+        // A full build is the reference the per-frame setup is measured against
+        auto start = std::chrono::steady_clock::now();
+        accelerator.rebuild();
+        Milliseconds const buildTime = std::chrono::steady_clock::now() - start;
+
+        std::cerr << "Hierarchy of " << accelerator.nodeCount() << " nodes built in " << buildTime.count() << " ms\n";
+
+        if (scene.animation.empty()) {
+            std::cerr << "The scene has no animation. Every frame will be the same\n";
+        }
+
+        Milliseconds totalSetup {};
+        int rebuilds = 0;
 
-        auto mat2 = std::make_shared<Lambertian>(Colour(0.4, 0.2, 0.1));
-        world.add(std::make_shared<Sphere>(Point3(-4, 1, 0), 1.0, mat2));
+        for (int frame = 0; frame < options.frames; ++frame) {
+            TraceScope const span("frame", frame);
+            start = std::chrono::steady_clock::now();
+            auto const rebuilt = [&] {
+                TraceScope const setupSpan("update hierarchy", frame);
+                scene.animation.apply(frame / options.framesPerSecond);
+                return accelerator.update(options.rebuildThreshold);
+            }();
+            Milliseconds const setup = std::chrono::steady_clock::now() - start;
 
-        auto mat3 = std::make_shared<Metal>(Colour(0.7, 0.6, 0.5), 0.0);
-        world.add(std::make_shared<Sphere>(Point3(4, 1, 0), 1.0, mat3));
+            totalSetup += setup;
+            rebuilds += rebuilt ? 1 : 0;
 
-        return world;
+            std::cerr << "\nFrame " << frame << ": " << (rebuilt ? "rebuilt" : "refitted") << " in " << setup.count() << " ms, "
+                      << "cost " << accelerator.cost() / accelerator.builtCost() << "x of the last build\n";
+
+            Framebuffer framebuffer(settings.width, settings.height);
+            render(scene, camera, settings, framebuffer);
+
+            std::ostringstream name;
+            name << options.framesPrefix << std::setw(4) << std::setfill('0') << frame << ".ppm";
+            std::ofstream out(name.str());
+            writePpm(out, finalPixels(framebuffer, options), framebuffer.width, framebuffer.height);
+
+            if (not out.flush()) {
+                throw std::runtime_error("Failed to write " + name.str());
+            }
+        }
+
+        auto const meanSetup = totalSetup.count() / options.frames;
+        std::cerr << "Mean per-frame setup " << meanSetup << " ms (" << 100.0 * meanSetup / buildTime.count() << "% of a full build), "
+                  << rebuilds << " rebuilds in " << options.frames << " frames\n";
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,85 @@
+#include "BandWriter.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(BandWriterTest, BandsAreWrittenInOrderWhenRowsFinishOutOfOrder)
+{
+    std::vector<int> firstRows;
+    std::vector<double> values;
+
+    BandWriter writer(2, 7, 3, 3, [&](int firstRow, int rowCount, std::vector<Colour> const& pixels) {
+        firstRows.push_back(firstRow);
+        for (int i = 0; i < rowCount * 2; ++i) {
+            values.push_back(pixels[static_cast<std::size_t>(i)].x());
+        }
+    });
+
+    for (int y : { 5, 2, 0, 6, 4, 3, 1 }) {
+        auto* const row = writer.acquireRow(y);
+        ASSERT_THAT(row, NotNull());
+        row[0] = Colour(y, 0, 0);
+        row[1] = Colour(y, 0, 0);
+        writer.releaseRow(y);
+    }
+
+    writer.finish();
+
+    EXPECT_THAT(firstRows, ElementsAre(0, 3, 6));
+    EXPECT_THAT(values, ElementsAre(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6));
+}
+
+TEST(BandWriterTest, RowsBeyondTheWindowWaitForTheOldestBand)
+{
+    std::atomic<int> written {0};
+    BandWriter writer(1, 4, 1, 2, [&](int, int, std::vector<Colour> const&) { ++written; });
+
+    writer.acquireRow(1);
+    writer.releaseRow(1);
+
+    std::atomic<bool> acquired {false};
+    std::thread late([&] {
+        writer.acquireRow(2);
+        acquired = true;
+        writer.releaseRow(2);
+    });
+
+    // Row 2 shares its buffer with row 0, which has not been written yet
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(acquired);
+    EXPECT_THAT(written.load(), Eq(0));
+
+    writer.acquireRow(0);
+    writer.releaseRow(0);
+    late.join();
+
+    EXPECT_TRUE(acquired);
+
+    writer.acquireRow(3);
+    writer.releaseRow(3);
+    writer.finish();
+
+    EXPECT_THAT(written.load(), Eq(4));
+    EXPECT_THAT(writer.bufferBytes(), Eq(2 * sizeof(Colour)));
+}
+
+TEST(BandWriterTest, SinkErrorsAreReportedByFinish)
+{
+    BandWriter writer(1, 4, 2, 2, [](int, int, std::vector<Colour> const&) { throw std::runtime_error("disk full"); });
+
+    writer.acquireRow(0);
+    writer.releaseRow(0);
+    writer.acquireRow(1);
+    writer.releaseRow(1);
+
+    EXPECT_THROW(writer.finish(), std::runtime_error);
+    EXPECT_THAT(writer.acquireRow(2), IsNull());
+}
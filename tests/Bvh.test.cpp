@@ -0,0 +1,107 @@
+#include "Animation.hpp"
+#include "Bvh.hpp"
+#include "Common.hpp"
+#include "HittableList.hpp"
+#include "Sphere.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+class BvhTest : public Test
+{
+public:
+    void SetUp() override
+    {
+        seedRandom(7);
+
+        for (int i = 0; i < 200; ++i) {
+            auto sphere = std::make_shared<Sphere>(Point3::random(-10, 10), randomDouble(0.1, 0.5), nullptr);
+            auto moving = std::make_shared<Translate>(sphere);
+            objects.push_back(moving);
+            list.add(moving);
+        }
+    }
+
+    /// \brief Check that the hierarchy finds the same closest hits as testing every object
+    void expectSameHits(Bvh const& bvh)
+    {
+        for (int i = 0; i < 500; ++i) {
+            Ray const ray(Point3::random(-15, 15), randomUnitVector());
+            HitRecord expected;
+            HitRecord actual;
+
+            auto const hit = list.hit(ray, 0.001, infinity, expected);
+            ASSERT_THAT(bvh.hit(ray, 0.001, infinity, actual), Eq(hit));
+            ASSERT_THAT(bvh.occluded(ray, 0.001, infinity), Eq(hit));
+
+            if (hit) {
+                ASSERT_THAT(actual.t, DoubleEq(expected.t));
+            }
+        }
+    }
+
+    /// \brief Move every object by a random offset of up to @param distance in each direction
+    void scatter(double distance)
+    {
+        for (auto const& object : objects) {
+            object->setOffset(Vec3::random(-distance, distance));
+        }
+    }
+
+    std::vector<std::shared_ptr<Translate>> objects;
+    HittableList list;
+};
+
+TEST_F(BvhTest, FindsTheSameHitsAsAList)
+{
+    Bvh const bvh(list.objects());
+
+    expectSameHits(bvh);
+    ASSERT_THAT(bvh.cost(), Lt(static_cast<double>(objects.size()) / 4));
+}
+
+TEST_F(BvhTest, RefitKeepsHitsCorrectAfterObjectsMove)
+{
+    Bvh bvh(list.objects());
+    auto const nodes = bvh.nodeCount();
+
+    scatter(5.0);
+    bvh.refit();
+
+    ASSERT_THAT(bvh.nodeCount(), Eq(nodes));
+    expectSameHits(bvh);
+}
+
+TEST_F(BvhTest, UpdateRebuildsOnlyOnceTheCostPassesTheThreshold)
+{
+    Bvh bvh(list.objects());
+
+    scatter(0.01);
+    ASSERT_FALSE(bvh.update(1.5));
+
+    scatter(10.0);
+    ASSERT_TRUE(bvh.update(1.5));
+    ASSERT_THAT(bvh.cost(), DoubleEq(bvh.builtCost()));
+    expectSameHits(bvh);
+}
+
+TEST(AnimationTest, InterpolatesBetweenKeyframesAndHoldsAtTheEnds)
+{
+    auto object = std::make_shared<Translate>(std::make_shared<Sphere>(Point3(0, 0, 0), 1.0, nullptr));
+    Animation animation;
+    animation.add(object, { Keyframe {1.0, Vec3(0, 0, 0)}, Keyframe {3.0, Vec3(4, 2, 0)} });
+
+    animation.apply(2.0);
+    ASSERT_THAT(object->offset().x(), DoubleEq(2.0));
+    ASSERT_THAT(object->offset().y(), DoubleEq(1.0));
+
+    animation.apply(0.0);
+    ASSERT_THAT(object->offset().x(), DoubleEq(0.0));
+
+    animation.apply(10.0);
+    ASSERT_THAT(object->offset().x(), DoubleEq(4.0));
+    ASSERT_THAT(animation.duration(), DoubleEq(3.0));
+}
@@ -0,0 +1,123 @@
+#include "Bvh.hpp"
+#include "Common.hpp"
+#include "HittableList.hpp"
+#include "Sphere.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace rt;
+using namespace ::testing;
+
+class BvhCacheTest : public Test
+{
+public:
+    void SetUp() override
+    {
+        std::filesystem::remove_all(directory);
+        seedRandom(11);
+
+        for (int i = 0; i < 300; ++i) {
+            auto sphere = std::make_shared<Sphere>(Point3::random(-10, 10), randomDouble(0.1, 0.5), nullptr);
+            objects.push_back(sphere);
+            list.add(sphere);
+        }
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    /// \brief Check that the hierarchy finds the same closest hits as testing every object
+    void expectSameHits(Bvh const& bvh)
+    {
+        for (int i = 0; i < 500; ++i) {
+            Ray const ray(Point3::random(-15, 15), randomUnitVector());
+            HitRecord expected;
+            HitRecord actual;
+
+            auto const hit = list.hit(ray, 0.001, infinity, expected);
+            ASSERT_THAT(bvh.hit(ray, 0.001, infinity, actual), Eq(hit));
+            ASSERT_THAT(bvh.occluded(ray, 0.001, infinity), Eq(hit));
+
+            if (hit) {
+                ASSERT_THAT(actual.t, DoubleEq(expected.t));
+            }
+        }
+    }
+
+    /// \brief Get the only file in the cache directory
+    std::filesystem::path cachedFile() const
+    {
+        std::vector<std::filesystem::path> files;
+
+        for (auto const& entry : std::filesystem::directory_iterator(directory)) {
+            files.push_back(entry.path());
+        }
+
+        EXPECT_THAT(files, SizeIs(1));
+        return files.empty() ? std::filesystem::path() : files.front();
+    }
+
+    std::string directory {(std::filesystem::temp_directory_path() / "raytracing-bvh-cache-test").string()};
+    std::vector<std::shared_ptr<Hittable>> objects;
+    HittableList list;
+};
+
+TEST_F(BvhCacheTest, ASecondHierarchyOverTheSameObjectsIsLoadedAsItWasBuilt)
+{
+    Bvh const built(objects, directory);
+    Bvh const loaded(objects, directory);
+
+    EXPECT_THAT(built.cacheUse(), Eq(Bvh::CacheUse::built));
+    EXPECT_THAT(loaded.cacheUse(), Eq(Bvh::CacheUse::loaded));
+    EXPECT_THAT(loaded.nodeCount(), Eq(built.nodeCount()));
+    EXPECT_THAT(loaded.cost(), DoubleEq(built.cost()));
+    expectSameHits(loaded);
+
+    // Other geometry is cached in a file of its own
+    auto moved = objects;
+    moved.push_back(std::make_shared<Sphere>(Point3(20, 0, 0), 1.0, nullptr));
+    EXPECT_THAT(Bvh(moved, directory).cacheUse(), Eq(Bvh::CacheUse::built));
+}
+
+TEST_F(BvhCacheTest, AFileThatDoesNotFitIsBuiltAgainAndReplaced)
+{
+    Bvh const built(objects, directory);
+    auto const file = cachedFile();
+    auto const size = std::filesystem::file_size(file);
+
+    // Another format version
+    {
+        std::fstream out(file, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(8);
+        out.put(static_cast<char>(0x7f));
+    }
+
+    Bvh const fromOtherVersion(objects, directory);
+    EXPECT_THAT(fromOtherVersion.cacheUse(), Eq(Bvh::CacheUse::replaced));
+    expectSameHits(fromOtherVersion);
+    EXPECT_THAT(Bvh(objects, directory).cacheUse(), Eq(Bvh::CacheUse::loaded));
+
+    // The right header over a damaged tree, whose first leaf claims objects that are not there
+    {
+        std::fstream out(file, std::ios::binary | std::ios::in | std::ios::out);
+        auto const& nodes = built.nodes();
+        auto const leaf = std::find_if(nodes.cbegin(), nodes.cend(), [](Bvh::Node const& node) { return node.count > 0; });
+        auto corrupt = *leaf;
+        corrupt.offset = static_cast<std::uint32_t>(objects.size());
+
+        out.seekp(static_cast<std::streamoff>(size - (objects.size() * sizeof(std::uint32_t)) - ((nodes.size() - static_cast<std::size_t>(leaf - nodes.cbegin())) * sizeof(Bvh::Node))));
+        out.write(reinterpret_cast<char const*>(&corrupt), sizeof(corrupt));
+    }
+
+    Bvh const fromDamagedFile(objects, directory);
+    EXPECT_THAT(fromDamagedFile.cacheUse(), Eq(Bvh::CacheUse::replaced));
+    expectSameHits(fromDamagedFile);
+    EXPECT_THAT(std::filesystem::file_size(cachedFile()), Eq(size));
+}
@@ -1,3 +1,26 @@
 #include "Camera.hpp"
 
 #include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(CameraOrbitTest, CamerasCircleTheLookAtPoint)
+{
+    CameraSettings base;
+    base.lookFrom = Point3(4, 1, 0);
+    base.lookAt = Point3(0, 1, 0);
+
+    auto const cameras = orbit(base, 4);
+
+    ASSERT_THAT(cameras.size(), Eq(4u));
+    EXPECT_THAT(cameras[0].lookFrom.x(), DoubleNear(4.0, 1e-12));
+    EXPECT_THAT(cameras[1].lookFrom.z(), DoubleNear(-4.0, 1e-12));
+    EXPECT_THAT(cameras[2].lookFrom.x(), DoubleNear(-4.0, 1e-12));
+
+    for (auto const& camera : cameras) {
+        EXPECT_THAT((camera.lookFrom - camera.lookAt).length(), DoubleNear(4.0, 1e-12));
+        EXPECT_THAT(camera.lookFrom.y(), DoubleNear(1.0, 1e-12));
+    }
+}
@@ -0,0 +1,78 @@
+#include "Denoiser.hpp"
+#include "Common.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+namespace
+{
+    Framebuffer flatWall(int const width, int const height)
+    {
+        Framebuffer framebuffer(width, height);
+        framebuffer.samplesPerPixel = 1;
+        for (std::size_t i = 0; i < framebuffer.colour.size(); ++i) {
+            framebuffer.albedo[i] = Colour(0.5, 0.5, 0.5);
+            framebuffer.normal[i] = Vec3(0, 0, 1);
+            framebuffer.depth[i] = 10.0;
+        }
+        return framebuffer;
+    }
+
+    double meanSquaredError(std::vector<Colour> const& pixels, Colour const& expected)
+    {
+        auto error = 0.0;
+        for (auto const& pixel : pixels) {
+            error += (pixel - expected).lengthSquared();
+        }
+        return error / static_cast<double>(pixels.size());
+    }
+}
+
+TEST(DenoiserTest, ConstantImageIsUnchanged)
+{
+    auto framebuffer = flatWall(37, 21);
+    for (auto& colour : framebuffer.colour) {
+        colour = Colour(0.25, 0.5, 0.125);
+    }
+
+    for (auto const& pixel : denoise(framebuffer)) {
+        ASSERT_THAT(pixel.x(), DoubleNear(0.25, 1e-4));
+        ASSERT_THAT(pixel.y(), DoubleNear(0.5, 1e-4));
+        ASSERT_THAT(pixel.z(), DoubleNear(0.125, 1e-4));
+    }
+}
+
+TEST(DenoiserTest, NoiseOnAFlatSurfaceIsReduced)
+{
+    auto const expected = Colour(0.25, 0.25, 0.25);
+    auto framebuffer = flatWall(64, 48);
+    for (auto& colour : framebuffer.colour) {
+        colour = expected * (0.5 + randomDouble());
+    }
+
+    auto const noisy = meanSquaredError(std::vector<Colour>(framebuffer.colour), expected);
+    auto const filtered = meanSquaredError(denoise(framebuffer), expected);
+
+    EXPECT_THAT(filtered, Lt(noisy * 0.1));
+}
+
+TEST(DenoiserTest, EdgesBetweenSurfacesArePreserved)
+{
+    auto framebuffer = flatWall(32, 32);
+    for (int y = 0; y < framebuffer.height; ++y) {
+        for (int x = 0; x < framebuffer.width; ++x) {
+            auto const i = framebuffer.index(x, y);
+            auto const left = x < framebuffer.width / 2;
+            framebuffer.colour[i] = left ? Colour(0.9, 0.9, 0.9) : Colour(0.1, 0.1, 0.1);
+            framebuffer.normal[i] = left ? Vec3(0, 0, 1) : Vec3(1, 0, 0);
+        }
+    }
+
+    auto const pixels = denoise(framebuffer);
+
+    EXPECT_THAT(pixels[framebuffer.index(15, 16)].x(), DoubleNear(0.9, 0.05));
+    EXPECT_THAT(pixels[framebuffer.index(16, 16)].x(), DoubleNear(0.1, 0.05));
+}
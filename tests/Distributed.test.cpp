@@ -0,0 +1,153 @@
+#include "Distributed.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+namespace rt::detail
+{
+    // Defined in Distributed.cpp, and only declared here, so that tests can make workers fail
+    void runWorker(std::string const& address, WorkerSettings const& settings, std::function<bool(int)> const& beforeTile);
+}
+
+using namespace rt;
+using namespace ::testing;
+
+namespace
+{
+    RenderJob smallJob()
+    {
+        RenderJob job;
+        job.settings.width = 48;
+        job.settings.height = 32;
+        job.settings.samplesPerPixel = 1;
+        job.settings.maxDepth = 4;
+        return job;
+    }
+}
+
+TEST(TileSchedulerTest, TilesCoverTheImageOnce)
+{
+    TileScheduler scheduler(70, 45, 32);
+    int area = 0;
+
+    while (auto const tile = scheduler.next()) {
+        area += tile->area();
+        EXPECT_TRUE(scheduler.complete(*tile));
+    }
+
+    EXPECT_THAT(scheduler.tileCount(), Eq(6u));
+    EXPECT_THAT(area, Eq(70 * 45));
+    EXPECT_TRUE(scheduler.finished());
+}
+
+TEST(TileSchedulerTest, AbandonedTilesAreHandedOutFirst)
+{
+    TileScheduler scheduler(64, 32, 32);
+
+    auto const first = scheduler.next();
+    scheduler.abandon(*first);
+
+    auto const again = scheduler.next();
+    ASSERT_TRUE(again.has_value());
+    EXPECT_THAT(again->index, Eq(first->index));
+    EXPECT_THAT(scheduler.reassignments(), Eq(1u));
+}
+
+TEST(TileSchedulerTest, SlowTilesAreDuplicatedAndTheFirstCopyWins)
+{
+    TileScheduler scheduler(64, 32, 32, 2.0);
+
+    auto const slow = scheduler.next();
+    auto const fast = scheduler.next();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_TRUE(scheduler.complete(*fast));
+
+    // The slow tile has now taken longer than twice the mean, so an idle worker gets a copy of it
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    auto const copy = scheduler.next();
+
+    ASSERT_TRUE(copy.has_value());
+    EXPECT_THAT(copy->index, Eq(slow->index));
+    EXPECT_TRUE(scheduler.complete(*copy));
+    EXPECT_FALSE(scheduler.complete(*slow));
+    EXPECT_TRUE(scheduler.finished());
+    EXPECT_FALSE(scheduler.next().has_value());
+}
+
+TEST(CoordinatorTest, FrameIsFinishedWhenAWorkerDies)
+{
+    SceneDescription scene;
+    scene.seed = 7;
+
+    auto const job = smallJob();
+
+    CoordinatorSettings settings;
+    settings.tileSize = 8;
+
+    Framebuffer framebuffer(job.settings.width, job.settings.height);
+    std::fill(framebuffer.colour.begin(), framebuffer.colour.end(), Colour(-1, -1, -1));
+
+    Coordinator coordinator;
+    auto const address = "127.0.0.1:" + std::to_string(coordinator.port());
+
+    std::vector<std::thread> workers;
+    workers.emplace_back([&] { detail::runWorker(address, WorkerSettings {1}, [](int const tiles) { return tiles < 2; }); });
+    workers.emplace_back([&] { runWorker(address, WorkerSettings {1}); });
+    workers.emplace_back([&] { runWorker(address, WorkerSettings {1}); });
+
+    coordinator.render(scene, job, settings, framebuffer);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    EXPECT_THAT(framebuffer.samplesPerPixel, Eq(1));
+
+    for (auto const& pixel : framebuffer.colour) {
+        ASSERT_THAT(pixel.x(), Ge(0.0));
+    }
+}
+
+TEST(CoordinatorTest, AWorkerThatStopsRespondingIsDroppedInsteadOfWaitedForForever)
+{
+    SceneDescription scene;
+    scene.seed = 7;
+
+    auto const job = smallJob();
+
+    CoordinatorSettings settings;
+    settings.tileSize = 8;
+    settings.workerTimeout = std::chrono::seconds(1);
+    settings.tileTimeout = std::chrono::seconds(1);
+
+    Framebuffer framebuffer(job.settings.width, job.settings.height);
+    Coordinator coordinator;
+    auto const address = "127.0.0.1:" + std::to_string(coordinator.port());
+
+    // The only worker hangs on its second tile, as if it had been stopped, and finds the connection closed when it wakes up
+    std::thread worker([&] {
+        try {
+            detail::runWorker(address, WorkerSettings {1}, [](int const tiles) {
+                if (tiles == 1) {
+                    std::this_thread::sleep_for(std::chrono::seconds(4));
+                }
+
+                return true;
+            });
+        }
+        catch (std::runtime_error const&) {
+        }
+    });
+
+    auto const start = std::chrono::steady_clock::now();
+    EXPECT_THROW(coordinator.render(scene, job, settings, framebuffer), std::runtime_error);
+    EXPECT_THAT(std::chrono::steady_clock::now() - start, Lt(std::chrono::seconds(4)));
+
+    worker.join();
+}
@@ -0,0 +1,100 @@
+#include "Distribution.hpp"
+#include "Environment.hpp"
+#include "Common.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(DistributionTest, SamplesIntervalsInProportionToTheirValues)
+{
+    Distribution1D const distribution({ 1.0, 0.0, 3.0 });
+    std::array<int, 3> counts {};
+
+    for (int i = 0; i < 40000; ++i) {
+        double pdf {};
+        std::size_t offset {};
+        distribution.sampleContinuous(randomDouble(), pdf, offset);
+        ++counts.at(offset);
+    }
+
+    ASSERT_THAT(counts[1], Eq(0));
+    ASSERT_THAT(counts[2] / static_cast<double>(counts[0]), DoubleNear(3.0, 0.2));
+}
+
+TEST(DistributionTest, DensityIntegratesToOne)
+{
+    Distribution2D const distribution({ 1, 2, 3, 4, 0, 0, 5, 6 }, 4, 2);
+    double integral = 0.0;
+
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            integral += distribution.pdf((x + 0.5) / 4, (y + 0.5) / 2) / 8.0;
+        }
+    }
+
+    ASSERT_THAT(integral, DoubleNear(1.0, 1e-9));
+}
+
+TEST(DistributionTest, AllZeroFunctionIsSampledUniformly)
+{
+    Distribution2D const distribution({ 0, 0, 0, 0 }, 2, 2);
+
+    ASSERT_THAT(distribution.pdf(0.1, 0.9), DoubleNear(1.0, 1e-9));
+}
+
+class EnvironmentMapTest : public Test
+{
+public:
+    static HdrImage makeSun()
+    {
+        HdrImage image { 16, 8, std::vector<Colour>(16 * 8, Colour(0.1, 0.1, 0.1)) };
+        image.pixels[2 * 16 + 5] = Colour(1000, 1000, 1000);
+        return image;
+    }
+
+    EnvironmentMap map { makeSun() };
+};
+
+TEST_F(EnvironmentMapTest, SampledDensityMatchesThePdfQuery)
+{
+    for (int i = 0; i < 100; ++i) {
+        double pdf {};
+        auto const direction = map.sample(pdf);
+
+        ASSERT_THAT(direction.length(), DoubleNear(1.0, 1e-9));
+        ASSERT_THAT(map.pdf(direction), DoubleNear(pdf, pdf * 1e-6));
+    }
+}
+
+TEST_F(EnvironmentMapTest, MostSamplesPointAtTheSun)
+{
+    int hits = 0;
+
+    for (int i = 0; i < 1000; ++i) {
+        double pdf {};
+
+        if (luminance(map.radiance(map.sample(pdf))) > 100) {
+            ++hits;
+        }
+    }
+
+    ASSERT_THAT(hits, Gt(900));
+}
+
+TEST_F(EnvironmentMapTest, DensityIntegratesToOneOverTheSphere)
+{
+    double integral = 0.0;
+    constexpr int samples = 200000;
+
+    // The sun makes the estimate noisy, so the directions are the same every run
+    seedRandom(3);
+
+    for (int i = 0; i < samples; ++i) {
+        integral += map.pdf(randomUnitVector()) * (4.0 * pi) / samples;
+    }
+
+    ASSERT_THAT(integral, DoubleNear(1.0, 0.05));
+}
@@ -0,0 +1,72 @@
+#include "FrozenScene.hpp"
+#include "Common.hpp"
+#include "Parallel.hpp"
+#include "Scene.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(FrozenSceneTest, TracesExactlyAsTheWorldItWasFrozenFrom)
+{
+    // The bouncing scene has moving objects, which stay outside the arena
+    for (auto const* name : {"random", "bouncing"}) {
+        seedRandom(11);
+        auto scene = makeScene(name);
+        auto const original = scene.world;
+        auto const frozen = freezeScene(scene);
+
+        EXPECT_THAT(frozen->sphereCount(), Gt(300u));
+        EXPECT_THAT(frozen->materialCount(), Le(frozen->sphereCount()));
+
+        for (int i = 0; i < 2000; ++i) {
+            Ray const ray(Point3(randomDouble(-12, 12), randomDouble(0.1, 3), randomDouble(-12, 12)), randomUnitVector());
+
+            HitRecord expected;
+            HitRecord actual;
+            auto const wasHit = original.hit(ray, 0.001, infinity, expected);
+
+            ASSERT_THAT(scene.world.hit(ray, 0.001, infinity, actual), Eq(wasHit)) << name;
+            ASSERT_THAT(scene.world.occluded(ray, 0.001, 5.0), Eq(original.occluded(ray, 0.001, 5.0))) << name;
+
+            if (wasHit) {
+                EXPECT_THAT(actual.t, Eq(expected.t));
+                EXPECT_THAT(actual.materialPtr, Eq(expected.materialPtr));
+                EXPECT_THAT(actual.u, Eq(expected.u));
+            }
+        }
+    }
+}
+
+TEST(FrozenSceneTest, PinnedThreadsTraceTheCopyOnTheirNodeExactlyAsTheOriginal)
+{
+    seedRandom(5);
+    auto scene = makeScene("random");
+    auto const original = scene.world;
+    auto const frozen = freezeScene(scene, true);
+
+    EXPECT_THAT(frozen->replicas(), Eq(numaNodes().size()));
+
+    setPinning(Pinning::scatter);
+
+    parallelFor(200, 3, [&](std::size_t i, unsigned) {
+        seedRandom(i);
+        Ray const ray(Point3(randomDouble(-12, 12), randomDouble(0.1, 3), randomDouble(-12, 12)), randomUnitVector());
+
+        HitRecord expected;
+        HitRecord actual;
+
+        auto const wasHit = original.hit(ray, 0.001, infinity, expected);
+
+        ASSERT_THAT(scene.world.hit(ray, 0.001, infinity, actual), Eq(wasHit));
+
+        if (wasHit) {
+            EXPECT_THAT(actual.t, Eq(expected.t));
+            EXPECT_THAT(actual.materialPtr, Eq(expected.materialPtr));
+        }
+    });
+
+    setPinning(Pinning::none);
+}
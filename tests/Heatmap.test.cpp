@@ -0,0 +1,54 @@
+#include "Heatmap.hpp"
+#include "Renderer.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(HeatmapTest, OutliersAreClampedToAHighPercentile)
+{
+    std::vector<float> values(200);
+
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<float>(i % 100);
+    }
+
+    values[7] = 1e6f;
+
+    float scale {};
+    auto const colours = heatmap(values, scale);
+
+    ASSERT_THAT(scale, Eq(99.0f));
+    ASSERT_THAT(colours[0].length(), Eq(0.0));
+    ASSERT_THAT(colours[99].length(), DoubleNear(colours[7].length(), 1e-12));
+    ASSERT_THAT(colours[50].length(), Lt(colours[99].length()));
+}
+
+TEST(HeatmapTest, RenderRecordsTheCostOfEveryPixel)
+{
+    SceneDescription description;
+    description.seed = 3;
+    Scene const scene = makeScene(description);
+
+    RenderSettings settings;
+    settings.width = 12;
+    settings.height = 8;
+    settings.samplesPerPixel = 2;
+    settings.threads = 2;
+    settings.showProgress = false;
+    settings.recordCost = true;
+
+    Framebuffer framebuffer(settings.width, settings.height);
+    render(scene, Camera(CameraSettings {}, 1.5), settings, framebuffer);
+
+    ASSERT_THAT(framebuffer.cost, SizeIs(framebuffer.colour.size()));
+
+    for (auto const& cost : framebuffer.cost) {
+        ASSERT_THAT(cost.pathLength, Ge(1.0f));
+        ASSERT_THAT(cost.primitiveTests, Gt(0.0f));
+        ASSERT_THAT(cost.traversalSteps, Gt(0.0f));
+        ASSERT_THAT(cost.microseconds, Gt(0.0f));
+    }
+}
@@ -0,0 +1,97 @@
+#include "IncrementalRenderer.hpp"
+#include "Material.hpp"
+#include "Sphere.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+namespace
+{
+    RenderSettings editSettings(int const samplesPerPixel)
+    {
+        RenderSettings settings;
+        settings.width = 48;
+        settings.height = 32;
+        settings.samplesPerPixel = samplesPerPixel;
+        settings.threads = 2;
+        settings.showProgress = false;
+        settings.seed = 5;
+        return settings;
+    }
+
+    /// \brief Get the small sphere closest to a point between the default camera and what it looks at
+    std::shared_ptr<Sphere> sphereInView(Scene const& scene)
+    {
+        Point3 const target(6, 0.2, 2);
+        std::shared_ptr<Sphere> closest;
+
+        for (auto const& object : scene.accelerator->objects()) {
+            auto sphere = std::dynamic_pointer_cast<Sphere>(object);
+
+            if (sphere and sphere->radius() < 0.5 and (not closest or (sphere->center() - target).length() < (closest->center() - target).length())) {
+                closest = sphere;
+            }
+        }
+
+        return closest;
+    }
+
+    std::vector<double> channels(Framebuffer const& framebuffer)
+    {
+        std::vector<double> values;
+
+        for (auto const& colour : framebuffer.colour) {
+            values.insert(values.end(), { colour.x(), colour.y(), colour.z() });
+        }
+
+        return values;
+    }
+}
+
+TEST(IncrementalRendererTest, RepaintingASphereRendersAgainOnlyTheTilesThatTouchedItAndMatchesAFullRender)
+{
+    auto scene = makeScene("random");
+    auto const settings = editSettings(4);
+    Camera const camera(CameraSettings {}, 1.5);
+
+    IncrementalRenderer incremental(scene, camera, settings, 8);
+    incremental.render();
+
+    auto const sphere = sphereInView(scene);
+    sphere->setMaterial(std::make_shared<Lambertian>(Colour(0.9, 0.1, 0.1)));
+
+    auto const rendered = incremental.update(SceneEdits {{}, {sphere.get()}, {}});
+
+    EXPECT_THAT(rendered, AllOf(Gt(0u), Lt(incremental.tiles().size())));
+
+    Framebuffer full(settings.width, settings.height);
+    render(scene, camera, settings, full);
+
+    EXPECT_THAT(channels(incremental.framebuffer()), ContainerEq(channels(full)));
+}
+
+TEST(IncrementalRendererTest, MovingASphereAlsoRendersAgainTheTilesWhereItIsSeenNow)
+{
+    // With one sample per pixel the probe traces every path of the image, so nothing the move changed is missed
+    auto scene = makeScene("random");
+    auto const settings = editSettings(1);
+    Camera const camera(CameraSettings {}, 1.5);
+
+    IncrementalRenderer incremental(scene, camera, settings, 8);
+    incremental.render();
+
+    auto const sphere = sphereInView(scene);
+    sphere->setCenter(sphere->center() + Vec3(-1.5, 0.8, 0));
+
+    auto const rendered = incremental.update(SceneEdits {{sphere.get()}, {}, {}});
+
+    EXPECT_THAT(rendered, AllOf(Gt(0u), Lt(incremental.tiles().size())));
+
+    Framebuffer full(settings.width, settings.height);
+    render(scene, camera, settings, full);
+
+    EXPECT_THAT(channels(incremental.framebuffer()), ContainerEq(channels(full)));
+}
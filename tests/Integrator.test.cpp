@@ -0,0 +1,72 @@
+#include "Integrator.hpp"
+#include "Common.hpp"
+#include "Environment.hpp"
+#include "Material.hpp"
+#include "Sphere.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+namespace
+{
+    /// \brief A sky that is bright overhead, where the area light hangs, and dim elsewhere
+    HdrImage brightOverhead()
+    {
+        HdrImage image {16, 8, std::vector<Colour>(16 * 8, Colour(0.2, 0.2, 0.2))};
+
+        for (int x = 0; x < 16; ++x) {
+            image.pixels[static_cast<std::size_t>(x)] = Colour(20, 20, 20);
+        }
+
+        return image;
+    }
+
+    /// \brief A diffuse ground under a spherical light, which emits @param emit
+    /// \param[in] sampled Whether the light is in the scene's light list
+    Scene groundUnderLight(Colour const& emit, bool const sampled, std::shared_ptr<rt::Environment const> environment)
+    {
+        Scene scene;
+        auto const light = std::make_shared<Sphere>(Point3(0, 3, 0), 0.5, std::make_shared<DiffuseLight>(emit));
+
+        scene.world.add(std::make_shared<Sphere>(Point3(0, -1000, 0), 1000, std::make_shared<Lambertian>(Colour(0.5, 0.5, 0.5))));
+        scene.world.add(light);
+
+        if (sampled) {
+            scene.lights.add(light);
+        }
+
+        scene.environment = std::move(environment);
+        return scene;
+    }
+
+    /// \brief Get the mean brightness that a camera ray looking down at the ground sees
+    double meanRadiance(Scene const& scene)
+    {
+        constexpr int samples = 200000;
+        Ray const ray(Point3(0, 1, 4), Vec3(0, -1, -4));
+        double sum = 0.0;
+
+        seedRandom(17);
+
+        for (int i = 0; i < samples; ++i) {
+            sum += luminance(rayColour(ray, scene, 2));
+        }
+
+        return sum / samples;
+    }
+}
+
+TEST(IntegratorTest, AreaLightsAndAnEnvironmentTogetherGiveTheSumOfTheirSeparateLight)
+{
+    auto const environment = std::make_shared<EnvironmentMap>(brightOverhead());
+
+    // The light stays in the world as a dark sphere when only the environment shines, so it shades the ground alike
+    auto const lightOnly = meanRadiance(groundUnderLight(Colour(30, 30, 30), true, nullptr));
+    auto const environmentOnly = meanRadiance(groundUnderLight(Colour(0, 0, 0), false, environment));
+    auto const both = meanRadiance(groundUnderLight(Colour(30, 30, 30), true, environment));
+
+    EXPECT_THAT(both, DoubleNear(lightOnly + environmentOnly, 0.02 * (lightOnly + environmentOnly)));
+}
@@ -0,0 +1,82 @@
+#include "Kernels.hpp"
+#include "Colour.hpp"
+#include "Common.hpp"
+#include "Sphere.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(KernelsTest, EveryInstructionSetFindsTheSameSpheresAsTheScalarCode)
+{
+    seedRandom(3);
+
+    // Eleven spheres fill one vector of every width and spill into the next
+    std::vector<Sphere> spheres;
+    std::array<std::vector<double>, 4> soa;
+
+    for (int i = 0; i < 11; ++i) {
+        spheres.emplace_back(Point3(randomDouble(-2, 2), randomDouble(-2, 2), randomDouble(-2, 2)), randomDouble(0.1, 1.0), nullptr);
+        soa[0].push_back(spheres.back().center().x());
+        soa[1].push_back(spheres.back().center().y());
+        soa[2].push_back(spheres.back().center().z());
+        soa[3].push_back(spheres.back().radius());
+    }
+
+    SphereBatch const batch {soa[0].data(), soa[1].data(), soa[2].data(), soa[3].data(), spheres.size()};
+    auto const isas = supportedIsas();
+    ASSERT_THAT(isas, Contains(Isa::baseline));
+
+    for (int r = 0; r < 500; ++r) {
+        Ray const ray(Point3(randomDouble(-4, 4), randomDouble(-4, 4), randomDouble(-4, 4)), randomUnitVector());
+        KernelRay const kernelRay {{ray.getOrigin().x(), ray.getOrigin().y(), ray.getOrigin().z()}, {ray.getDirection().x(), ray.getDirection().y(), ray.getDirection().z()}};
+
+        auto expected = spheres.size();
+        auto closest = infinity;
+        HitRecord record;
+
+        for (std::size_t i = 0; i < spheres.size(); ++i) {
+            if (spheres[i].hit(ray, 0.001, closest, record)) {
+                closest = record.t;
+                expected = i;
+            }
+        }
+
+        for (auto const isa : isas) {
+            EXPECT_THAT(kernels(isa).closestSphere(batch, kernelRay, 0.001, infinity), Eq(expected)) << isaName(isa);
+            EXPECT_THAT(kernels(isa).anySphere(batch, kernelRay, 0.001, infinity), Eq(expected < spheres.size())) << isaName(isa);
+        }
+    }
+}
+
+TEST(KernelsTest, EveryInstructionSetEncodesPixelsAsToBytesDoes)
+{
+    std::vector<double> values;
+
+    for (int i = 0; i < 301; ++i) {
+        values.push_back(i * 0.0123);
+    }
+
+    for (auto const isa : supportedIsas()) {
+        std::vector<std::uint8_t> bytes(values.size());
+        kernels(isa).encodePixels(values.data(), values.size(), 0.25, bytes.data());
+
+        for (std::size_t i = 0; i + 2 < values.size(); i += 3) {
+            auto const expected = toBytes(Colour(values[i], values[i + 1], values[i + 2]), 4);
+            EXPECT_THAT((std::array<std::uint8_t, 3> {bytes[i], bytes[i + 1], bytes[i + 2]}), Eq(expected)) << isaName(isa);
+        }
+    }
+}
+
+TEST(KernelsTest, InstructionSetsAreNamedAsOnTheCommandLine)
+{
+    for (auto const isa : {Isa::baseline, Isa::sse4, Isa::avx2, Isa::avx512}) {
+        EXPECT_THAT(parseIsa(isaName(isa)), Eq(isa));
+    }
+
+    EXPECT_THROW(parseIsa("neon"), std::invalid_argument);
+    EXPECT_THAT(isSupported(detectIsa()), IsTrue());
+    EXPECT_THAT(detectIsa(), Ne(Isa::avx512));
+}
@@ -0,0 +1,69 @@
+#include "LazyBvh.hpp"
+#include "Common.hpp"
+#include "HittableList.hpp"
+#include "Parallel.hpp"
+#include "Sphere.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(LazyBvhTest, ThreadsSplittingTogetherFindTheSameHitsAsTestingEveryObject)
+{
+    seedRandom(3);
+    std::vector<std::shared_ptr<Hittable>> objects;
+    HittableList list;
+
+    for (int i = 0; i < 5000; ++i) {
+        auto sphere = std::make_shared<Sphere>(Point3::random(-50, 50), randomDouble(0.1, 0.5), nullptr);
+        objects.push_back(sphere);
+        list.add(sphere);
+    }
+
+    LazyBvh const lazy(objects);
+    auto const upFront = lazy.builtNodes();
+
+    std::vector<Ray> rays;
+
+    for (int i = 0; i < 2000; ++i) {
+        rays.emplace_back(Point3::random(-60, 60), randomUnitVector());
+    }
+
+    parallelFor(rays.size(), 8, [&](std::size_t i, unsigned) {
+        HitRecord expected;
+        HitRecord actual;
+        auto const hit = list.hit(rays[i], 0.001, infinity, expected);
+
+        ASSERT_THAT(lazy.hit(rays[i], 0.001, infinity, actual), Eq(hit));
+        ASSERT_THAT(lazy.occluded(rays[i], 0.001, infinity), Eq(hit));
+
+        if (hit) {
+            EXPECT_THAT(actual.t, DoubleEq(expected.t));
+        }
+    });
+
+    EXPECT_THAT(lazy.builtNodes(), Gt(upFront));
+}
+
+TEST(LazyBvhTest, SplitsOnlyWhereRaysGo)
+{
+    seedRandom(4);
+    std::vector<std::shared_ptr<Hittable>> objects;
+
+    for (int i = 0; i < 20000; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-100, 100), 0.2, nullptr));
+    }
+
+    Bvh const full(objects);
+    LazyBvh const lazy(objects);
+
+    // Rays through one small corner of the world
+    for (int i = 0; i < 200; ++i) {
+        HitRecord record;
+        lazy.hit(Ray(Point3(-100, -100, -100) + Vec3::random(0, 5), Vec3(1, 1, 1) + (0.1 * randomUnitVector())), 0.001, 20.0, record);
+    }
+
+    EXPECT_THAT(lazy.builtNodes(), Lt(full.nodeCount() / 10));
+}
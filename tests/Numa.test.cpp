@@ -0,0 +1,83 @@
+#include "Numa.hpp"
+#include "Parallel.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <mutex>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(NumaTest, PinnedWorkersVisitEveryIndexOnceAndLeaveTheCallerAsItWas)
+{
+    cpu_set_t before;
+    ASSERT_THAT(sched_getaffinity(0, sizeof(before), &before), Eq(0));
+
+    for (auto const policy : {Pinning::compact, Pinning::scatter}) {
+        setPinning(policy);
+
+        auto const split = splitByNode(1000, 5);
+        EXPECT_THAT(split.size(), Eq(numaNodes().size() + 1));
+        EXPECT_THAT(split.front(), Eq(0u));
+        EXPECT_THAT(split.back(), Eq(1000u));
+
+        std::vector<std::atomic<int>> visits(1000);
+
+        parallelFor(visits.size(), 5, [&](std::size_t i, unsigned threadIndex) {
+            ++visits[i];
+            EXPECT_THAT(currentNode(), Eq(workerPlace(threadIndex).node));
+        });
+
+        for (auto const& count : visits) {
+            EXPECT_THAT(count.load(), Eq(1));
+        }
+
+        EXPECT_THAT(currentNode(), Eq(0u)) << pinningName(policy);
+    }
+
+    setPinning(Pinning::none);
+    EXPECT_THAT(splitByNode(1000, 5), ElementsAre(0u, 1000u));
+
+    cpu_set_t after;
+    ASSERT_THAT(sched_getaffinity(0, sizeof(after), &after), Eq(0));
+    EXPECT_TRUE(CPU_EQUAL(&before, &after));
+}
+
+TEST(NumaTest, PoliciesAreReadByName)
+{
+    for (auto const policy : {Pinning::none, Pinning::compact, Pinning::scatter}) {
+        EXPECT_THAT(parsePinning(pinningName(policy)), Eq(policy));
+    }
+
+    EXPECT_THROW(parsePinning("spread"), std::invalid_argument);
+}
+
+TEST(NumaTest, PinnedWorkersTakingIndicesInAscendingOrderVisitEveryIndexOnce)
+{
+    setPinning(Pinning::scatter);
+
+    std::mutex mutex;
+    std::vector<std::vector<std::size_t>> taken(5);
+
+    parallelFor(1000, 5, IndexOrder::ascending, [&](std::size_t i, unsigned threadIndex) {
+        std::lock_guard lock(mutex);
+        taken[threadIndex].push_back(i);
+    });
+
+    setPinning(Pinning::none);
+
+    // One counter from the first index up hands every worker its indices in rising order, whatever node it is on
+    std::vector<std::size_t> all;
+
+    for (auto const& indices : taken) {
+        EXPECT_TRUE(std::is_sorted(indices.cbegin(), indices.cend()));
+        all.insert(all.end(), indices.cbegin(), indices.cend());
+    }
+
+    std::sort(all.begin(), all.end());
+    ASSERT_THAT(all, SizeIs(1000u));
+    EXPECT_THAT(std::adjacent_find(all.cbegin(), all.cend()), Eq(all.cend()));
+    EXPECT_THAT(all.back(), Eq(999u));
+}
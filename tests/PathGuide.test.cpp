@@ -0,0 +1,111 @@
+#include "PathGuide.hpp"
+#include "Common.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace rt;
+using namespace ::testing;
+
+namespace
+{
+    /// \brief A tree that has learned that nearly all light arrives from around (0.6, 0.3, 0.74)
+    DirectionalTree learnedFromAbove()
+    {
+        DirectionalTree tree;
+        seedRandom(1);
+
+        // Each pass refines the cells where the last one found light, as between the passes of a render
+        for (int pass = 0; pass < 6; ++pass) {
+            if (pass > 0) {
+                tree = tree.refined(0.01, 16);
+            }
+
+            for (int i = 0; i < 2000; ++i) {
+                tree.record(unitVector(Vec3(0.6, 0.3, 0.74) + (0.02 * randomInUnitSphere())), 1.0f);
+                tree.record(randomUnitVector(), 0.01f);
+            }
+        }
+
+        return tree;
+    }
+}
+
+TEST(DirectionalTreeTest, SamplesWhereTheLightCameFromWithAConsistentDensity)
+{
+    auto const tree = learnedFromAbove();
+    ASSERT_THAT(tree.size(), Gt(4u));
+
+    int towards = 0;
+
+    for (int i = 0; i < 1000; ++i) {
+        double pdf {};
+        auto const direction = tree.sample(pdf);
+
+        EXPECT_THAT(direction.length(), DoubleNear(1.0, 1e-9));
+        EXPECT_THAT(tree.pdf(direction), DoubleNear(pdf, 1e-6 * pdf));
+        towards += dot(direction, unitVector(Vec3(0.6, 0.3, 0.74))) > 0.99 ? 1 : 0;
+    }
+
+    EXPECT_THAT(towards, Gt(800));
+    EXPECT_THAT(tree.pdf(unitVector(Vec3(0.6, 0.3, 0.74))), Gt(100.0 * tree.pdf(Vec3(0, -1, 0))));
+}
+
+TEST(DirectionalTreeTest, DensityIntegratesToOneOverTheSphere)
+{
+    auto const tree = learnedFromAbove();
+
+    // The density is constant over the cells of the quadtree, so a grid about as fine as its deepest cells
+    // integrates it closely
+    constexpr int n = 1024;
+    double integral = 0.0;
+
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            auto const cosTheta = (2.0 * (i + 0.5) / n) - 1.0;
+            auto const sinTheta = std::sqrt(1.0 - (cosTheta * cosTheta));
+            auto const phi = 2.0 * pi * (j + 0.5) / n;
+
+            integral += tree.pdf(Vec3(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi)));
+        }
+    }
+
+    EXPECT_THAT(integral * 4.0 * pi / (n * n), DoubleNear(1.0, 0.01));
+}
+
+TEST(PathGuideTest, BusyRegionsSplitAndThreadsRecordWithoutLosingLight)
+{
+    GuideSettings settings;
+    settings.splitSamples = 300;
+    PathGuide guide(Aabb(Point3(-1, -1, -1), Point3(1, 1, 1)), settings);
+
+    ASSERT_THAT(guide.canSample(guide.locate(Point3(0, 0, 0))), IsFalse());
+
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&guide, t] {
+            for (int i = 0; i < 1000; ++i) {
+                auto const x = (t % 2 == 0 ? -0.5 : 0.5);
+                guide.record(guide.locate(Point3(x, 0, 0)), Vec3(0, 1, 0), 1.0, 0.5);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    guide.refine();
+
+    ASSERT_THAT(guide.regions(), Gt(1u));
+
+    auto const left = guide.locate(Point3(-0.5, 0, 0));
+    auto const right = guide.locate(Point3(0.5, 0, 0));
+
+    EXPECT_THAT(left, Ne(right));
+    EXPECT_THAT(guide.canSample(left), IsTrue());
+    EXPECT_THAT(guide.pdf(left, Vec3(0, 1, 0)), Gt(1.0 / (4.0 * pi)));
+}
@@ -0,0 +1,96 @@
+#include "PhotonMap.hpp"
+#include "Material.hpp"
+#include "Scene.hpp"
+#include "Sphere.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+namespace
+{
+    /// \brief A diffuse hit on the plane z = 0, seen from the side of @param normal
+    HitRecord planeHit(Point3 const& point, Vec3 const& normal, std::shared_ptr<Material> const& material)
+    {
+        HitRecord record;
+        record.point = point;
+        record.normal = normal;
+        record.frontFace = true;
+        record.t = 1.0;
+        record.materialPtr = material.get();
+
+        return record;
+    }
+}
+
+TEST(PhotonMapTest, EvenlySpreadPhotonsGiveTheirIrradianceTimesTheAlbedoOverPi)
+{
+    constexpr double spacing = 0.01;
+    constexpr float power = 0.5f;
+    std::vector<Photon> photons;
+
+    for (int i = -100; i <= 100; ++i) {
+        for (int j = -100; j <= 100; ++j) {
+            photons.push_back({{static_cast<float>(i * spacing), static_cast<float>(j * spacing), 0.0f}, {0.0f, 0.0f, -1.0f}, {power, power, power}});
+        }
+    }
+
+    auto const material = std::make_shared<Lambertian>(Colour(0.5, 0.5, 0.5));
+    auto const expected = 0.5 / pi * power / (spacing * spacing);
+
+    for (unsigned threads : {1u, 3u}) {
+        PhotonMap const map(photons, 0.2, threads);
+        ASSERT_THAT(map.size(), Eq(photons.size()));
+
+        auto const lit = map.radiance(planeHit(Point3(0.123, -0.2, 0), Vec3(0, 0, 1), material));
+        EXPECT_THAT(lit.x(), DoubleNear(expected, 0.03 * expected));
+
+        auto const behind = map.radiance(planeHit(Point3(0.123, -0.2, 0), Vec3(0, 0, -1), material));
+        EXPECT_THAT(behind.x(), Eq(0.0));
+
+        auto const outside = map.radiance(planeHit(Point3(3, 3, 0), Vec3(0, 0, 1), material));
+        EXPECT_THAT(outside.x(), Eq(0.0));
+    }
+}
+
+TEST(PhotonMapTest, GlassFocusesTheSameCausticWhateverTheThreads)
+{
+    Scene scene;
+    auto const ground = std::make_shared<Lambertian>(Colour(0.8, 0.8, 0.8));
+    auto const light = std::make_shared<Sphere>(Point3(0, 4, 0), 0.3, std::make_shared<DiffuseLight>(Colour(20, 20, 20)));
+
+    scene.world.add(std::make_shared<Sphere>(Point3(0, -1000, 0), 1000, ground));
+    scene.world.add(std::make_shared<Sphere>(Point3(0, 1, 0), 1, std::make_shared<Dielectric>(1.5)));
+    scene.world.add(light);
+    scene.lights.add(light);
+
+    PhotonSettings settings;
+    settings.photons = 20000;
+    settings.radius = 0.1;
+    settings.seed = 5;
+
+    settings.threads = 1;
+    auto const single = traceCaustics(scene, settings);
+    settings.threads = 3;
+    auto const several = traceCaustics(scene, settings);
+
+    ASSERT_THAT(single.size(), Gt(0u));
+    ASSERT_THAT(several.size(), Eq(single.size()));
+
+    // The glass sphere focuses light onto the ground right below it, brighter than anywhere off to the side
+    auto const below = single.radiance(planeHit(Point3(0, 0, 0), Vec3(0, 1, 0), ground));
+    auto const aside = single.radiance(planeHit(Point3(3, 0, 0), Vec3(0, 1, 0), ground));
+
+    EXPECT_THAT(below.x(), Gt(aside.x()));
+    EXPECT_THAT(several.radiance(planeHit(Point3(0, 0, 0), Vec3(0, 1, 0), ground)).x(), Eq(below.x()));
+}
+
+TEST(PhotonMapTest, ScenesWithoutLightsHaveNoCaustics)
+{
+    PhotonSettings settings;
+    settings.photons = 100;
+
+    EXPECT_THAT(traceCaustics(Scene {}, settings).size(), Eq(0u));
+}
@@ -0,0 +1,65 @@
+#include "Preview.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+namespace
+{
+    RenderSettings previewSettings()
+    {
+        RenderSettings settings;
+        settings.width = 24;
+        settings.height = 16;
+        settings.samplesPerPixel = 16;
+        settings.threads = 2;
+        settings.seed = 3;
+        return settings;
+    }
+}
+
+TEST(PreviewTest, RefinesFromCoarseToFullSizeAndEndsWithTheRequestedSamples)
+{
+    auto const scene = smallLightsScene();
+    auto const settings = previewSettings();
+    std::vector<std::pair<int, int>> steps;
+
+    Preview preview(scene, settings, CameraSettings {}, [&](FloatImage const& image, PreviewStep const& step) {
+        EXPECT_THAT(image.width, Eq(settings.width));
+        EXPECT_THAT(image.height, Eq(settings.height));
+        EXPECT_THAT(step.final, Eq(step.scale == 1 and step.samplesPerPixel == settings.samplesPerPixel));
+        steps.emplace_back(step.scale, step.samplesPerPixel);
+    });
+
+    preview.finish();
+    preview.run();
+
+    EXPECT_THAT(steps, ElementsAre(Pair(4, 1), Pair(2, 1), Pair(1, 1), Pair(1, 4), Pair(1, 16)));
+}
+
+TEST(PreviewTest, MovingTheCameraStartsAgainFromTheCoarsestStep)
+{
+    auto const scene = smallLightsScene();
+    auto const settings = previewSettings();
+    std::vector<int> scales;
+    Preview* running = nullptr;
+
+    Preview preview(scene, settings, CameraSettings {}, [&](FloatImage const&, PreviewStep const& step) {
+        scales.push_back(step.scale);
+
+        // Move once, after the first full-size step
+        if (scales.size() == 3) {
+            CameraSettings moved;
+            moved.lookFrom = Point3(0, 2, 10);
+            running->setCamera(moved);
+        }
+    });
+
+    running = &preview;
+    preview.finish();
+    preview.run();
+
+    EXPECT_THAT(scales, ElementsAre(4, 2, 1, 4, 2, 1, 1, 1));
+}
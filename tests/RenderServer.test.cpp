@@ -0,0 +1,92 @@
+#include "RenderServer.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace rt;
+using namespace ::testing;
+
+class RenderServerTest : public Test
+{
+public:
+    RenderServerTest()
+    {
+        defaults.settings.width = 300;
+        defaults.settings.height = 200;
+        defaults.settings.samplesPerPixel = 1;
+        defaults.settings.threads = 2;
+    }
+
+    RenderJob defaults;
+    Scene scene;
+};
+
+TEST_F(RenderServerTest, FieldsOverrideTheDefaults)
+{
+    auto const job = parseRenderJob("render width=64 height=32 spp=4 from=1,2,3 fov=45", defaults);
+
+    EXPECT_THAT(job.settings.width, Eq(64));
+    EXPECT_THAT(job.settings.height, Eq(32));
+    EXPECT_THAT(job.settings.samplesPerPixel, Eq(4));
+    EXPECT_THAT(job.settings.maxDepth, Eq(defaults.settings.maxDepth));
+    EXPECT_THAT(job.camera.lookFrom.y(), DoubleEq(2.0));
+    EXPECT_THAT(job.camera.verticalFovInDegrees, DoubleEq(45.0));
+}
+
+TEST_F(RenderServerTest, WidthAloneKeepsTheAspectRatio)
+{
+    EXPECT_THAT(parseRenderJob("render width=90", defaults).settings.height, Eq(60));
+}
+
+TEST_F(RenderServerTest, MalformedRequestsAreRejected)
+{
+    EXPECT_THROW(parseRenderJob("draw width=10", defaults), std::invalid_argument);
+    EXPECT_THROW(parseRenderJob("render width=-3", defaults), std::invalid_argument);
+    EXPECT_THROW(parseRenderJob("render from=1,2", defaults), std::invalid_argument);
+    EXPECT_THROW(parseRenderJob("render colour=red", defaults), std::invalid_argument);
+}
+
+TEST_F(RenderServerTest, RequestsTooLargeToServeAreAnsweredWithAnErrorAndTheNextJobIsServed)
+{
+    std::istringstream in("render width=1000000 height=2\nrender width=10000 height=10000\nrender width=4096 height=4096 spp=1000\n"
+                          "render width=3 height=2\n");
+    std::ostringstream out;
+
+    EXPECT_FALSE(serve(scene, defaults, in, out));
+
+    auto const reply = out.str();
+    std::string const errors = "error The image must be at most 16384 pixels on a side\n"
+                               "error The image must have at most 67108864 pixels\n"
+                               "error The job must take at most 4294967296 samples\n";
+
+    EXPECT_THAT(reply.substr(0, errors.size()), Eq(errors));
+    EXPECT_THAT(reply.substr(errors.size()), StartsWith("P6\n3 2\n255\n"));
+}
+
+TEST_F(RenderServerTest, EveryJobIsAnsweredInOrder)
+{
+    std::istringstream in("render width=4 height=3\n\nrender bogus\n# comment\nrender width=5 height=2\nquit\nrender width=9 height=9\n");
+    std::ostringstream out;
+
+    EXPECT_FALSE(serve(scene, defaults, in, out));
+
+    auto const header = [](int width, int height) {
+        return "P6\n" + std::to_string(width) + ' ' + std::to_string(height) + "\n255\n";
+    };
+
+    auto const expected = header(4, 3) + std::string(4 * 3 * 3, 'x') + "error Expected name=value: bogus\n" + header(5, 2) + std::string(5 * 2 * 3, 'x');
+    auto reply = out.str();
+
+    ASSERT_THAT(reply.size(), Eq(expected.size()));
+
+    // Blank out the pixels, which depend on the random samples
+    auto const firstPixels = header(4, 3).size();
+    auto const secondPixels = expected.size() - (5 * 2 * 3);
+    reply.replace(firstPixels, 4 * 3 * 3, 4 * 3 * 3, 'x');
+    reply.replace(secondPixels, 5 * 2 * 3, 5 * 2 * 3, 'x');
+
+    EXPECT_THAT(reply, Eq(expected));
+}
@@ -0,0 +1,132 @@
+#include "Renderer.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <mutex>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(RenderViewsTest, EveryViewIsHandedOverOnceWhenDone)
+{
+    Scene scene;
+    std::vector<RenderJob> views(5);
+
+    for (std::size_t i = 0; i < views.size(); ++i) {
+        views[i].settings.width = 8 + static_cast<int>(i);
+        views[i].settings.height = 6;
+        views[i].settings.samplesPerPixel = 2;
+        views[i].settings.threads = 3;
+        views[i].settings.showProgress = false;
+    }
+
+    std::mutex mutex;
+    std::vector<int> widths(views.size());
+
+    renderViews(scene, views, [&](std::size_t view, Framebuffer& framebuffer) {
+        std::lock_guard lock(mutex);
+        EXPECT_THAT(widths[view], Eq(0));
+        EXPECT_THAT(framebuffer.samplesPerPixel, Eq(2));
+        widths[view] = framebuffer.width;
+    });
+
+    EXPECT_THAT(widths, ElementsAre(8, 9, 10, 11, 12));
+}
+
+TEST(DeadlineRenderTest, RendersOneSampleEvenPastTheDeadlineAndStopsAtTheLimit)
+{
+    Scene scene;
+    RenderSettings settings;
+    settings.width = 8;
+    settings.height = 6;
+    settings.samplesPerPixel = 5;
+    settings.threads = 2;
+    settings.showProgress = false;
+
+    Framebuffer late(settings.width, settings.height);
+    auto const past = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    ASSERT_THAT(render(scene, Camera(CameraSettings {}, 1.5), settings, past, late), Eq(1));
+    ASSERT_THAT(late.samplesPerPixel, Eq(1));
+
+    Framebuffer early(settings.width, settings.height);
+    auto const future = std::chrono::steady_clock::now() + std::chrono::hours(1);
+    ASSERT_THAT(render(scene, Camera(CameraSettings {}, 1.5), settings, future, early), Eq(5));
+    ASSERT_THAT(early.samplesPerPixel, Eq(5));
+}
+
+TEST(DeterministicRenderTest, ThreadCountDoesNotChangeTheImageButTheSeedDoes)
+{
+    auto const scene = smallLightsScene();
+    RenderSettings settings;
+    settings.width = 12;
+    settings.height = 8;
+    settings.samplesPerPixel = 3;
+    settings.showProgress = false;
+    settings.seed = 7;
+
+    auto const renderWith = [&](int threads, std::uint32_t seed) {
+        auto configured = settings;
+        configured.threads = threads;
+        configured.seed = seed;
+        Framebuffer framebuffer(settings.width, settings.height);
+        render(scene, Camera(CameraSettings {}, 1.5), configured, framebuffer);
+        std::vector<double> channels;
+        for (auto const& colour : framebuffer.colour) {
+            channels.insert(channels.end(), { colour.x(), colour.y(), colour.z() });
+        }
+        return channels;
+    };
+
+    auto const single = renderWith(1, 7);
+    ASSERT_THAT(renderWith(3, 7), ContainerEq(single));
+    ASSERT_THAT(renderWith(3, 8), Ne(single));
+}
+
+TEST(FloatImageRenderTest, WritesTheMeanOfEveryPixelIntoTheCallersRowsAndStopsWhenCancelled)
+{
+    auto const scene = smallLightsScene();
+    RenderSettings settings;
+    settings.width = 10;
+    settings.height = 7;
+    settings.samplesPerPixel = 2;
+    settings.threads = 3;
+    settings.showProgress = false;
+    settings.seed = 4;
+
+    Camera const camera(CameraSettings {}, 1.5);
+    Framebuffer framebuffer(settings.width, settings.height);
+    render(scene, camera, settings, framebuffer);
+
+    // Rows are padded, and the padding must stay untouched
+    constexpr std::size_t stride = 3 * 10 + 2;
+    std::vector<float> pixels(stride * 7, -1.0f);
+    std::vector<int> reported;
+
+    TileProgress progress;
+    progress.tileSize = 4;
+    progress.tileDone = [&](Tile const& tile, int done, int count) {
+        reported.push_back(tile.index);
+        EXPECT_THAT(done, Eq(static_cast<int>(reported.size())));
+        EXPECT_THAT(count, Eq(6));
+    };
+
+    ASSERT_THAT(render(scene, camera, settings, FloatImage {pixels.data(), 10, 7, stride}, progress), IsTrue());
+    EXPECT_THAT(reported, UnorderedElementsAre(0, 1, 2, 3, 4, 5));
+
+    for (int y = 0; y < 7; ++y) {
+        for (int x = 0; x < 10; ++x) {
+            auto const expected = framebuffer.mean(framebuffer.index(x, y));
+            EXPECT_THAT(pixels[(y * stride) + (3 * x) + 1], FloatEq(static_cast<float>(expected.y())));
+        }
+
+        EXPECT_THAT(pixels[(y * stride) + 30], Eq(-1.0f));
+    }
+
+    std::atomic<bool> cancel {false};
+    progress.cancel = &cancel;
+    progress.tileDone = [&](Tile const&, int, int) { cancel = true; };
+    settings.threads = 1;
+
+    EXPECT_THAT(render(scene, camera, settings, FloatImage {pixels.data(), 10, 7, stride}, progress), IsFalse());
+}
@@ -0,0 +1,68 @@
+#include "Sphere.hpp"
+#include "Common.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace rt;
+using namespace ::testing;
+
+class SphereSamplingTest : public Test
+{
+public:
+    Sphere sphere { Point3(0, 0, -5), 1.0, nullptr };
+    Point3 origin { 0, 0, 0 };
+};
+
+TEST_F(SphereSamplingTest, RandomDirectionsAlwaysHitTheSphere)
+{
+    for (int i = 0; i < 1000; ++i) {
+        auto const direction = sphere.random(origin);
+        HitRecord record;
+
+        ASSERT_THAT(direction.length(), DoubleNear(1.0, 1e-9));
+        ASSERT_TRUE(sphere.hit(Ray(origin, direction), 0.001, infinity, record));
+    }
+}
+
+TEST_F(SphereSamplingTest, DensityIsTheInverseOfTheSubtendedSolidAngle)
+{
+    auto const cosThetaMax = std::sqrt(1.0 - 1.0 / 25.0);
+    auto const expected = 1.0 / (2.0 * pi * (1.0 - cosThetaMax));
+
+    ASSERT_THAT(sphere.pdfValue(origin, Vec3(0, 0, -1)), DoubleNear(expected, 1e-9));
+}
+
+TEST_F(SphereSamplingTest, DensityIsZeroForDirectionsThatMissTheSphere)
+{
+    ASSERT_THAT(sphere.pdfValue(origin, Vec3(0, 0, 1)), Eq(0.0));
+    ASSERT_THAT(sphere.pdfValue(origin, Vec3(1, 0, 0)), Eq(0.0));
+}
+
+TEST_F(SphereSamplingTest, EveryDirectionIsEquallyLikelyFromInsideTheSphere)
+{
+    ASSERT_THAT(sphere.pdfValue(Point3(0, 0, -5), Vec3(0, 1, 0)), DoubleNear(1.0 / (4.0 * pi), 1e-9));
+}
+
+TEST_F(SphereSamplingTest, OcclusionQueryAgreesWithHitQuery)
+{
+    for (int i = 0; i < 1000; ++i) {
+        auto const direction = randomUnitVector();
+        auto const tMax = randomDouble(0, 10);
+        HitRecord record;
+
+        ASSERT_THAT(sphere.occluded(Ray(origin, direction), 0.001, tMax), Eq(sphere.hit(Ray(origin, direction), 0.001, tMax, record)));
+    }
+}
+
+TEST_F(SphereSamplingTest, OcclusionQueryRespectsTheRayInterval)
+{
+    Ray const ray(origin, Vec3(0, 0, -1));
+
+    ASSERT_TRUE(sphere.occluded(ray, 0.001, infinity));
+    ASSERT_TRUE(sphere.occluded(ray, 3.5, 4.5));
+    ASSERT_TRUE(sphere.occluded(ray, 5.0, 6.5));
+    ASSERT_FALSE(sphere.occluded(ray, 0.001, 3.9));
+    ASSERT_FALSE(sphere.occluded(ray, 4.5, 5.5));
+    ASSERT_FALSE(sphere.occluded(ray, 6.1, infinity));
+}
@@ -0,0 +1,60 @@
+#include "Statistics.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace rt;
+using namespace ::testing;
+
+TEST(StatisticsTest, CountsOfFinishedThreadsAreKept)
+{
+    auto const before = collectStatistics();
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            auto& stats = threadStatistics();
+            stats.primaryRays.add(10);
+            stats.pathLengths[3].add();
+            countIntersectionTest(PrimitiveKind::sphere);
+            countScatter(MaterialKind::metal);
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto const after = collectStatistics();
+
+    ASSERT_THAT(after.primaryRays - before.primaryRays, Eq(40u));
+    ASSERT_THAT(after.pathLengths[3] - before.pathLengths[3], Eq(4u));
+    ASSERT_THAT(after.intersectionTests[0] - before.intersectionTests[0], Eq(4u));
+    ASSERT_THAT(after.scatterEvents[1] - before.scatterEvents[1], Eq(4u));
+}
+
+TEST(StatisticsTest, PhasesAccumulateAndAppearInTheSummary)
+{
+    {
+        PhaseTimer const first("test phase");
+    }
+    {
+        PhaseTimer const second("test phase");
+    }
+
+    auto const summary = collectStatistics();
+    auto const phases = std::count_if(summary.phaseSeconds.cbegin(), summary.phaseSeconds.cend(), [](auto const& phase) {
+        return phase.first == "test phase";
+    });
+
+    std::ostringstream json;
+    writeStatisticsJson(json, summary);
+
+    ASSERT_THAT(phases, Eq(1));
+    ASSERT_THAT(json.str(), HasSubstr("\"test phase\": "));
+    ASSERT_THAT(json.str(), HasSubstr("\"rays\": {\"primary\": "));
+}
@@ -0,0 +1,134 @@
+#include "TextureCache.hpp"
+#include "TiledImage.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+
+using namespace rt;
+using namespace ::testing;
+
+class TiledImageTest : public Test
+{
+public:
+    TiledImageTest()
+    {
+        // Left half black, right half white
+        HdrImage image { 40, 24, {} };
+
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                image.pixels.push_back(x < 20 ? Colour(0, 0, 0) : Colour(1, 1, 1));
+            }
+        }
+
+        writeTiledImage(image, path, 16);
+    }
+
+    ~TiledImageTest() override
+    {
+        std::remove(path.c_str());
+    }
+
+    std::string path { (std::filesystem::temp_directory_path() / "raytracing-tiled-image-test.rtt").string() };
+};
+
+TEST_F(TiledImageTest, StoresAFullMipChain)
+{
+    TiledImageFile const file(path);
+
+    ASSERT_THAT(file.tileSize(), Eq(16));
+    ASSERT_THAT(file.levelCount(), Eq(6));     // 40x24, 20x12, 10x6, 5x3, 2x1, 1x1
+    ASSERT_THAT(file.level(0).tilesX, Eq(3u));
+    ASSERT_THAT(file.level(0).tilesY, Eq(2u));
+    ASSERT_THAT(file.level(5).width, Eq(1u));
+}
+
+TEST_F(TiledImageTest, TilesHoldTheImageTexels)
+{
+    TiledImageFile const file(path);
+    std::vector<std::uint8_t> texels;
+
+    file.readTile(0, 0, 0, texels);
+    ASSERT_THAT(texels.size(), Eq(16u * 16u * 3u));
+    ASSERT_THAT(texels[0], Eq(0));
+
+    file.readTile(0, 2, 1, texels);
+    ASSERT_THAT(texels[0], Eq(255));
+}
+
+TEST_F(TiledImageTest, CoarsestLevelAveragesTheImage)
+{
+    TiledImageFile const file(path);
+    std::vector<std::uint8_t> texels;
+
+    file.readTile(file.levelCount() - 1, 0, 0, texels);
+
+    // Half white in linear space is sqrt(0.5) after gamma 2 encoding
+    ASSERT_THAT(texels[0], Eq(static_cast<int>(255.999 * std::sqrt(0.5))));
+}
+
+TEST_F(TiledImageTest, CacheReturnsTheSameTileWhileItIsResident)
+{
+    TiledImageFile const file(path);
+    TextureCache cache(1 << 20);
+
+    auto const first = cache.tile(file, 0, 1, 0);
+    auto const second = cache.tile(file, 0, 1, 0);
+
+    ASSERT_THAT(first.get(), Eq(second.get()));
+    ASSERT_THAT(cache.statistics().hits, Eq(1u));
+    ASSERT_THAT(cache.statistics().misses, Eq(1u));
+}
+
+TEST_F(TiledImageTest, CacheStaysWithinItsBudget)
+{
+    TiledImageFile const file(path);
+    auto const tileBytes = std::size_t{16} * 16 * 3;
+    TextureCache cache(16 * tileBytes);    // one tile per shard
+
+    for (int round = 0; round < 3; ++round) {
+        for (int level = 0; level < file.levelCount(); ++level) {
+            for (std::uint32_t ty = 0; ty < file.level(level).tilesY; ++ty) {
+                for (std::uint32_t tx = 0; tx < file.level(level).tilesX; ++tx) {
+                    cache.tile(file, level, static_cast<int>(tx), static_cast<int>(ty));
+                }
+            }
+        }
+    }
+
+    ASSERT_THAT(cache.statistics().peakBytes, Le(16 * tileBytes));
+}
+
+TEST_F(TiledImageTest, CacheKeepsFilesApartWhoseIdsDifferOnlyAbove16Bits)
+{
+    // The same image mirrored, so that its first tile is white where the other's is black
+    auto const mirroredPath = (std::filesystem::temp_directory_path() / "raytracing-tiled-image-test-mirrored.rtt").string();
+    HdrImage mirrored { 40, 24, {} };
+
+    for (int y = 0; y < mirrored.height; ++y) {
+        for (int x = 0; x < mirrored.width; ++x) {
+            mirrored.pixels.push_back(x < 20 ? Colour(1, 1, 1) : Colour(0, 0, 0));
+        }
+    }
+
+    writeTiledImage(mirrored, mirroredPath, 16);
+
+    TiledImageFile const file(path);
+    TextureCache cache(1 << 20);
+    ASSERT_THAT((*cache.tile(file, 0, 0, 0))[0], Eq(0));
+
+    auto other = std::make_unique<TiledImageFile>(mirroredPath);
+
+    while (other->id() != file.id() + 0x10000) {
+        other = std::make_unique<TiledImageFile>(mirroredPath);
+    }
+
+    EXPECT_THAT((*cache.tile(*other, 0, 0, 0))[0], Eq(255));
+    EXPECT_THAT(cache.statistics().misses, Eq(2u));
+
+    std::remove(mirroredPath.c_str());
+}
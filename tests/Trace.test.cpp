@@ -0,0 +1,69 @@
+#include "Trace.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+
+using namespace rt;
+using namespace ::testing;
+
+namespace
+{
+    /// \brief Count the occurrences of @param pattern in @param text
+    std::size_t count(std::string const& text, std::string const& pattern)
+    {
+        std::size_t n = 0;
+
+        for (auto i = text.find(pattern); i != std::string::npos; i = text.find(pattern, i + 1)) {
+            ++n;
+        }
+
+        return n;
+    }
+
+    std::string trace()
+    {
+        std::ostringstream out;
+        writeTrace(out);
+        return out.str();
+    }
+}
+
+TEST(TraceTest, ScopesAreOnlyRecordedWhileTracingIsEnabled)
+{
+    {
+        TraceScope const span("untraced span");
+    }
+
+    enableTracing();
+
+    {
+        TraceScope const span("traced span", 7);
+    }
+
+    disableTracing();
+
+    auto const json = trace();
+
+    ASSERT_THAT(json, Not(HasSubstr("untraced span")));
+    ASSERT_THAT(json, HasSubstr("{\"name\": \"traced span\", \"ph\": \"X\""));
+    ASSERT_THAT(json, HasSubstr("\"args\": {\"index\": 7}"));
+}
+
+TEST(TraceTest, ThreadsThatRunOneAfterAnotherShareALane)
+{
+    auto const lanesBefore = count(trace(), "\"thread_name\"");
+    enableTracing();
+
+    for (int i = 0; i < 3; ++i) {
+        std::thread([i] { TraceScope const span("lane test", i); }).join();
+    }
+
+    disableTracing();
+    auto const json = trace();
+
+    ASSERT_THAT(count(json, "\"lane test\""), Eq(3u));
+    ASSERT_THAT(count(json, "\"thread_name\""), Le(lanesBefore + 1));
+}
@@ -0,0 +1,4 @@
+# Expected primary+secondary ray throughput of the throughput test, in Mrays/s. The throughput depends on the machine
+# and on how busy it is, so the test is only registered when a baseline is given, e.g. -DRT_BASELINE_MRAYS=0.8 on the
+# machine the baseline was measured on.
+set(RT_BASELINE_MRAYS "" CACHE STRING "Baseline throughput for the throughput regression test (Mrays/s); empty leaves the test out")